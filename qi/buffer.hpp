@@ -85,15 +85,16 @@ namespace qi
      * \brief Copy constructor.
      * \param buffer The buffer to copy.
      *
-     * As data are store as a shared pointer, the different copy
-     * of the same buffer all handle the same data.
+     * The copies share the same data until one of them is modified, which
+     * makes copying cheap. The data is copied right away if a pointer allowing
+     * to modify it has been obtained by `data()` or `reserve()`.
      */
     Buffer(const Buffer& buffer);
     /**
      * \brief Assignment operator.
-     * As data are store as a shared pointer, the different copy
-     * of the same buffer all handle the same data.
+     * The copies share the same data until one of them is modified.
      * \param buffer The buffer to copy.
+     * \see Buffer(const Buffer&)
      */
     Buffer& operator = (const Buffer& buffer);
 
@@ -178,6 +179,7 @@ namespace qi
 
     /**
      * \brief Return a pointer to the raw data storage of this buffer.
+     * If the data is shared with other buffers, it is copied first.
      * \return the pointer to the data.
      */
     void* data();
@@ -210,11 +212,26 @@ namespace qi
      */
     size_t read(void* buffer, size_t offset = 0, size_t length = 0) const;
 
+    /**
+     * \brief Return a buffer of the \a length bytes at \a offset in this buffer.
+     * The slice shares the data of this buffer, until one of them is modified.
+     * Sub-buffers that are entirely in the slice are kept.
+     * If the range is not in the buffer throw a std::out_of_range.
+     * \param offset Offset of the slice in this buffer.
+     * \param length Size of the slice.
+     * \return the slice.
+     */
+    Buffer slice(size_t offset, size_t length) const;
+
     bool operator==(const Buffer& b) const;
     friend KA_GENERATE_REGULAR_OP_DIFFERENT(Buffer)
 
   private:
     friend class BufferReader;
+    friend Buffer makeBufferOnExternalMemory(unsigned char* data, size_t size,
+                                             boost::shared_ptr<void> owner);
+    friend void* reserveForFill(Buffer& buffer, size_t size);
+    friend void* dataForFill(Buffer& buffer);
     // CS4251
     boost::shared_ptr<BufferPrivate> _p;
   };
@@ -286,6 +303,7 @@ namespace qi
     size_t position() const;
 
   private:
+    friend Buffer readBufferSlice(BufferReader& reader, size_t length);
     const Buffer* _buffer;
     size_t  _cursor;
     size_t  _subCursor; // position in sub-buffers
@@ -0,0 +1,63 @@
+#pragma once
+/*
+**  Copyright (C) 2012 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+#ifndef _QI_CALLBATCH_HPP_
+#define _QI_CALLBATCH_HPP_
+
+#include <string>
+#include <utility>
+#include <vector>
+#include <qi/anyvalue.hpp>
+
+namespace qi
+{
+  /// Calls of several methods of an object, to be made in order with
+  /// `GenericObject::callBatch`.
+  ///
+  /// Example:
+  ///   qi::CallBatch batch;
+  ///   batch.add("setStiffness", "HeadYaw", 1.f)
+  ///        .add("setStiffness", "HeadPitch", 1.f)
+  ///        .add("getStiffness", "HeadYaw");
+  ///   qi::Future<std::vector<qi::AnyValue>> results = motion.callBatch(batch);
+  class CallBatch
+  {
+  public:
+    struct Call
+    {
+      /// Name of the method, with its signature ('name::(args)') or not.
+      std::string method;
+      AnyValueVector args;
+    };
+
+    template <typename... Args>
+    CallBatch& add(std::string method, Args&&... args)
+    {
+      _calls.push_back(Call{ std::move(method), AnyValueVector{ AnyValue::from(args)... } });
+      return *this;
+    }
+
+    const std::vector<Call>& calls() const
+    {
+      return _calls;
+    }
+
+    std::size_t size() const
+    {
+      return _calls.size();
+    }
+
+    bool empty() const
+    {
+      return _calls.empty();
+    }
+
+  private:
+    std::vector<Call> _calls;
+  };
+}
+
+#endif  // _QI_CALLBATCH_HPP_
@@ -0,0 +1,113 @@
+#pragma once
+/*
+**  Copyright (C) 2012 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+#ifndef _QI_CALLOPTIONS_HPP_
+#define _QI_CALLOPTIONS_HPP_
+
+#include <algorithm>
+#include <boost/optional.hpp>
+#include <ka/macroregular.hpp>
+#include <qi/api.hpp>
+#include <qi/clock.hpp>
+
+namespace qi
+{
+  /// Error of the calls whose deadline passed before they completed.
+  static const char* const callDeadlineExceededError = "Call deadline exceeded.";
+
+  /// Priority of a call in the send queues, relative to the other messages.
+  enum class CallPriority
+  {
+    /// Sent before the other calls and their replies, like control messages.
+    High = 0,
+    Normal = 1,
+    /// Sent after the other messages, such as bulk transfers.
+    Low = 2,
+  };
+
+  /// Options of a call made with `GenericObject::async`.
+  struct CallOptions
+  {
+    /// Point in time after which the caller is not interested in the result of
+    /// the call anymore.
+    ///
+    /// When it passes, a pending remote call fails locally with
+    /// `callDeadlineExceededError`, and a call that was not executed yet is
+    /// not executed at all. The deadline is inherited by the calls made while
+    /// executing the call, including on the remote end.
+    boost::optional<SteadyClockTimePoint> deadline;
+
+    /// Priority of the call, and of its reply on the remote end, in the send
+    /// queues of the sockets. By default, the call inherits the priority of the
+    /// call being executed, if any. The priority is inherited by the calls made
+    /// while executing the call, including on the remote end.
+    boost::optional<CallPriority> priority;
+
+  // Regular:
+    KA_GENERATE_FRIEND_REGULAR_OPS_2(CallOptions, deadline, priority)
+  };
+
+  /// Returns options with a deadline `timeout` from now.
+  inline CallOptions callTimeout(Duration timeout)
+  {
+    CallOptions options;
+    options.deadline = SteadyClock::now() + timeout;
+    return options;
+  }
+
+  /// Returns the deadline of the call being executed by this thread, if any.
+  QI_API boost::optional<SteadyClockTimePoint> currentCallDeadline();
+
+  /// Returns the priority of the call being executed by this thread, if any.
+  QI_API boost::optional<CallPriority> currentCallPriority();
+
+  namespace detail
+  {
+    /// Returns the earliest of two optional deadlines.
+    inline boost::optional<SteadyClockTimePoint> earliestDeadline(
+      const boost::optional<SteadyClockTimePoint>& a,
+      const boost::optional<SteadyClockTimePoint>& b)
+    {
+      if (!a)
+        return b;
+      if (!b)
+        return a;
+      return std::min(*a, *b);
+    }
+
+    /// Sets the deadline of the calls made by this thread until it is
+    /// destroyed, and then restores the previous one.
+    class QI_API CallDeadlineScope
+    {
+    public:
+      explicit CallDeadlineScope(boost::optional<SteadyClockTimePoint> deadline);
+      ~CallDeadlineScope();
+
+      CallDeadlineScope(const CallDeadlineScope&) = delete;
+      CallDeadlineScope& operator=(const CallDeadlineScope&) = delete;
+
+    private:
+      boost::optional<SteadyClockTimePoint> _previous;
+    };
+
+    /// Sets the priority of the calls made by this thread until it is
+    /// destroyed, and then restores the previous one.
+    class QI_API CallPriorityScope
+    {
+    public:
+      explicit CallPriorityScope(boost::optional<CallPriority> priority);
+      ~CallPriorityScope();
+
+      CallPriorityScope(const CallPriorityScope&) = delete;
+      CallPriorityScope& operator=(const CallPriorityScope&) = delete;
+
+    private:
+      boost::optional<CallPriority> _previous;
+    };
+  }
+}
+
+#endif  // _QI_CALLOPTIONS_HPP_
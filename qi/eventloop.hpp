@@ -12,6 +12,7 @@
 KA_WARNING_DISABLE(4503, ) // decorated name length
 
 # include <boost/thread/synchronized_value.hpp>
+# include <vector>
 # include <boost/function.hpp>
 
 # include <qi/types.hpp>
@@ -204,6 +205,18 @@ namespace qi
   /// \brief Returns the global network eventloop, created on demand on first call.
   QI_API EventLoop* getNetworkEventLoop();
 
+  /**
+   * \brief Returns the network eventloops among which sockets are distributed,
+   * created on demand on first call. The first one is the global network
+   * eventloop.
+   *
+   * There is only one unless the environment variable
+   * `QI_NETWORK_EVENTLOOP_COUNT` gives another count (0 meaning one per CPU).
+   * Each eventloop has a single thread, pinned to its own CPU unless
+   * `QI_NETWORK_EVENTLOOP_PIN` is set to 0.
+   */
+  QI_API const std::vector<EventLoop*>& getNetworkEventLoops();
+
   /**
    * \brief Starts the eventloop with nthread threads. Does nothing if already started.
    * \param nthread Set the minimum number of worker threads in the pool.
@@ -0,0 +1,99 @@
+#pragma once
+/*
+**  Copyright (C) 2012 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+#ifndef _QI_MESSAGING_MESSAGESOCKETSTATS_HPP_
+#define _QI_MESSAGING_MESSAGESOCKETSTATS_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <ka/macroregular.hpp>
+#include <qi/clock.hpp>
+#include <qi/url.hpp>
+
+namespace qi
+{
+  /// Distribution of durations in buckets of exponentially growing bounds.
+  ///
+  /// The bucket `i` counts the durations lower than `upperBound(i)` that are
+  /// not counted by the previous buckets: 1 µs, 2 µs, 4 µs and so on up to
+  /// about 4 s. The last bucket counts the longer durations.
+  struct DurationHistogram
+  {
+    static const std::size_t bucketCount = 24u;
+
+    std::array<std::uint64_t, bucketCount> counts;
+
+  // Regular:
+    KA_GENERATE_FRIEND_REGULAR_OPS_1(DurationHistogram, counts)
+
+  // DurationHistogram:
+    static Duration upperBound(std::size_t bucket)
+    {
+      return bucket + 1u < bucketCount
+        ? Duration{MicroSeconds{std::int64_t{1} << bucket}}
+        : Duration::max();
+    }
+
+    static std::size_t bucketOf(Duration duration)
+    {
+      std::size_t bucket = 0u;
+      while (bucket + 1u < bucketCount && duration >= upperBound(bucket))
+        ++bucket;
+      return bucket;
+    }
+
+    std::uint64_t count() const
+    {
+      return std::accumulate(counts.begin(), counts.end(), std::uint64_t{0u});
+    }
+
+    /// Returns the upper bound of the bucket of the given quantile (between 0
+    /// and 1), or zero if the histogram is empty.
+    Duration quantileUpperBound(double quantile) const
+    {
+      const auto total = count();
+      if (total == 0u)
+        return Duration::zero();
+      const auto rank = static_cast<std::uint64_t>(quantile * static_cast<double>(total));
+      std::uint64_t cumulated = 0u;
+      for (std::size_t bucket = 0u; bucket != bucketCount; ++bucket)
+      {
+        cumulated += counts[bucket];
+        if (cumulated > rank)
+          return upperBound(bucket);
+      }
+      return upperBound(bucketCount - 1u);
+    }
+  };
+
+  /// Traffic of a message socket since its creation.
+  struct MessageSocketStats
+  {
+    /// Remote endpoint of the socket if it is connected, otherwise the url it
+    /// was asked to connect to, if any.
+    Url url;
+    std::uint64_t sentMessageCount;
+    std::uint64_t sentByteCount;
+    std::uint64_t receivedMessageCount;
+    std::uint64_t receivedByteCount;
+    /// Current and maximum number of messages in the send queue.
+    std::size_t sendQueueDepth;
+    std::size_t maxSendQueueDepth;
+    /// Time spent by messages in the send queue, before being written.
+    DurationHistogram sendQueueWait;
+    /// Time spent by the socket to handle each received message.
+    DurationHistogram dispatchTime;
+
+  // Regular:
+    KA_GENERATE_FRIEND_REGULAR_OPS_9(MessageSocketStats, url, sentMessageCount, sentByteCount,
+                                     receivedMessageCount, receivedByteCount, sendQueueDepth,
+                                     maxSendQueueDepth, sendQueueWait, dispatchTime)
+  };
+}
+
+#endif  // _QI_MESSAGING_MESSAGESOCKETSTATS_HPP_
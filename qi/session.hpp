@@ -12,6 +12,7 @@
 #include <qi/messaging/serviceinfo.hpp>
 #include <qi/messaging/authproviderfactory.hpp>
 #include <qi/messaging/clientauthenticatorfactory.hpp>
+#include <qi/messaging/messagesocketstats.hpp>
 #include <qi/future.hpp>
 #include <qi/anyobject.hpp>
 #include <ka/macro.hpp>
@@ -211,6 +212,20 @@ QI_GEN(genCall)
      */
     qi::FutureSync<void> waitForService(const std::string& service);
 
+    /** Returns the traffic of the sockets of the session: the ones connected
+     * to the service directory and to services, and the ones of the clients
+     * connected to the services of the session.
+     */
+    qi::FutureSync<std::vector<MessageSocketStats>> socketStats() const;
+
+    /** Returns a future set once none of the sockets of the session (see
+     * `socketStats`) has a full send queue. Producers of frequent events or
+     * calls can wait for it before sending more, instead of letting the queues
+     * grow. The watermarks are set through the QIMESSAGING_SOCKET_SEND_QUEUE_*
+     * environment variables.
+     */
+    qi::FutureSync<void> sendQueuesNotFull() const;
+
   public:
     qi::Signal<unsigned int, std::string> serviceRegistered;
     qi::Signal<unsigned int, std::string> serviceUnregistered;
@@ -281,6 +281,31 @@ namespace qi {
   class Signal<void> : public Signal<>
   {};
 
+  /// How the events of a signal are delivered to a remote subscriber. The
+  /// publisher skips the events that the policy does not let through, instead
+  /// of sending them all to a subscriber that cannot keep up.
+  struct EventDeliveryPolicy
+  {
+    /// Maximum number of events per second, or 0 for no limit.
+    double maxRate = 0.;
+    /// Only one event out of `decimation` is delivered.
+    unsigned int decimation = 1u;
+    /// Only the latest event matters: an event that is not delivered yet is
+    /// replaced by a newer one, and events over the maximum rate are delayed
+    /// instead of being skipped.
+    bool conflate = false;
+
+    friend bool operator==(const EventDeliveryPolicy& a, const EventDeliveryPolicy& b)
+    {
+      return a.maxRate == b.maxRate && a.decimation == b.decimation && a.conflate == b.conflate;
+    }
+
+    friend bool operator!=(const EventDeliveryPolicy& a, const EventDeliveryPolicy& b)
+    {
+      return !(a == b);
+    }
+  };
+
   struct SignalSubscriberPrivate;
 
   /** Event subscriber info.
@@ -327,6 +352,19 @@ QI_WARNING_POP()
 
     SignalSubscriber setCallType(MetaCallType ct);
 
+    /** Sets how the events are delivered if the signal is remote.
+     *
+     * The subscribers of a signal of a remote object share a single
+     * registration to the remote signal: the remote end only applies the
+     * policy while all of them asked for the same one. Otherwise, or if the
+     * remote end does not support policies, all the events are transferred
+     * and the policy is applied on the subscriber's end.
+     */
+    SignalSubscriber setDeliveryPolicy(const EventDeliveryPolicy& policy);
+
+    /// @return the delivery policy set on this subscriber, if any.
+    boost::optional<EventDeliveryPolicy> deliveryPolicy() const;
+
     /// @return the identifier of the subscription (aka link)
     SignalLink link() const;
     operator SignalLink() const;
@@ -385,6 +423,9 @@ QI_WARNING_POP()
 
     // ExecutionContext on which to schedule the call
     std::atomic<ExecutionContext*> executionContext{nullptr};
+
+    // How the events are delivered if the signal is remote
+    boost::optional<EventDeliveryPolicy> deliveryPolicy;
   };
 } // qi
 
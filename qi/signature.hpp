@@ -58,6 +58,9 @@ namespace qi {
   * annotation: may contain arbitrary content except \0
       and must balance all (), {}, [] and <> within
   * for tuple annotation has the following form: "<TupleName,elementName0,...,elementName1>"
+  *
+  * Signatures built from the same string share their parsed representation,
+  * which is never modified.
   */
   class Signature;
   using SignatureVector = std::vector<Signature>;
@@ -0,0 +1,106 @@
+#pragma once
+/*
+**  Copyright (C) 2012 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+#ifndef _QI_STRINGVIEW_HPP_
+# define _QI_STRINGVIEW_HPP_
+
+# include <qi/buffer.hpp>
+# include <cstring>
+# include <ostream>
+# include <string>
+
+namespace qi
+{
+  /**
+   * \brief Read-only string whose characters are stored in a qi::Buffer.
+   * \includename{qi/stringview.hpp}
+   *
+   * Copies share the characters. A StringView decoded from a message is a
+   * slice of the message payload: the characters are not copied, and the
+   * payload is kept alive as long as the StringView is.
+   *
+   * A StringView has the signature of a string, so functions can take
+   * StringView parameters in place of std::string ones.
+   */
+  class StringView
+  {
+  public:
+    StringView() = default;
+
+    StringView(const char* data, std::size_t size)
+    {
+      _buffer.write(data, size);
+    }
+
+    StringView(const std::string& str)
+      : StringView(str.data(), str.size())
+    {
+    }
+
+    /// The whole buffer is the content of the string.
+    explicit StringView(Buffer buffer)
+      : _buffer(std::move(buffer))
+    {
+    }
+
+    /// Not null-terminated.
+    const char* data() const
+    {
+      return static_cast<const char*>(_buffer.data());
+    }
+
+    std::size_t size() const
+    {
+      return _buffer.size();
+    }
+
+    bool empty() const
+    {
+      return size() == 0u;
+    }
+
+    /// Returns a copy of the characters.
+    std::string str() const
+    {
+      return empty() ? std::string() : std::string(data(), size());
+    }
+
+    const Buffer& buffer() const
+    {
+      return _buffer;
+    }
+
+    // The data of an empty StringView may be null, which memcmp does not accept.
+    friend bool operator==(const StringView& a, const StringView& b)
+    {
+      return a.size() == b.size()
+          && (a.empty() || std::memcmp(a.data(), b.data(), a.size()) == 0);
+    }
+
+    friend bool operator==(const StringView& a, const std::string& b)
+    {
+      return a.size() == b.size()
+          && (a.empty() || std::memcmp(a.data(), b.data(), a.size()) == 0);
+    }
+
+    friend bool operator==(const std::string& a, const StringView& b)
+    {
+      return b == a;
+    }
+
+    friend KA_GENERATE_REGULAR_OP_DIFFERENT(StringView)
+
+    friend std::ostream& operator<<(std::ostream& out, const StringView& s)
+    {
+      return out.write(s.data(), static_cast<std::streamsize>(s.size()));
+    }
+
+  private:
+    Buffer _buffer;
+  };
+}
+
+#endif  // _QI_STRINGVIEW_HPP_
@@ -14,6 +14,8 @@
 #include <boost/smart_ptr/enable_shared_from_this.hpp>
 
 #include <qi/api.hpp>
+#include <qi/callbatch.hpp>
+#include <qi/calloptions.hpp>
 #include <qi/type/detail/futureadapter.hpp>
 #include <qi/type/detail/manageable.hpp>
 #include <qi/future.hpp>
@@ -53,6 +55,9 @@ public:
   template <typename R, typename... Args>
   qi::Future<R> async(const std::string& methodName, Args&&... args);
 
+  template <typename R, typename... Args>
+  qi::Future<R> async(const CallOptions& options, const std::string& methodName, Args&&... args);
+
   /**
    * Call a method dynamically, using an extensible list of arguments and
    * specific call policies. Since the underlying call may be asynchronous,
@@ -80,6 +85,27 @@ public:
   qi::Future<AnyReference> metaCall(unsigned int method, const GenericFunctionParameters& params, MetaCallType callType = MetaCallType_Auto, Signature returnSignature = Signature());
   //@}
 
+  /**
+   * Call several methods in order, each one once the previous one returned,
+   * and return their results.
+   *
+   * If the object is a proxy and its remote end supports it, the whole batch
+   * is sent in a single message and its results come back in a single reply.
+   * The calls following a failing one are not made, and the batch fails with
+   * the error of that call.
+   */
+  qi::Future<AnyValueVector> callBatch(const CallBatch& batch);
+
+  /**
+   * Call several methods by ID in order, each one once the previous one
+   * returned, and return their results. Unlike callBatch(), each call is made
+   * separately.
+   * @param calls pairs of method ID and arguments.
+   * @param callType type of the calls.
+   */
+  qi::Future<AnyValueVector> metaCallBatch(std::vector<std::pair<unsigned int, AnyValueVector>> calls,
+                                           MetaCallType callType = MetaCallType_Auto);
+
   /// Find method named name callable with arguments parameters
   int findMethod(const std::string& name, const GenericFunctionParameters& parameters);
 
@@ -217,6 +243,19 @@ qi::Future<R> GenericObject::async(const std::string& methodName, Args&&... args
   return result.future();
 }
 
+/// Calls a method of the generic object asynchronously, with the given options.
+/// The deadline of the options is narrowed to the one of the call being executed
+/// by this thread, if any, whose priority is used if the options have none.
+/// @return a future tracking the result of the underlying method call.
+template <typename R, typename... Args>
+qi::Future<R> GenericObject::async(const CallOptions& options, const std::string& methodName, Args&&... args)
+{
+  detail::CallDeadlineScope deadline(
+    detail::earliestDeadline(currentCallDeadline(), options.deadline));
+  detail::CallPriorityScope priority(options.priority ? options.priority : currentCallPriority());
+  return async<R>(methodName, std::forward<Args>(args)...);
+}
+
 template<typename T>
 qi::FutureSync<T> GenericObject::property(const std::string& name)
 {
@@ -163,6 +163,20 @@ namespace detail {
       return go()->template async<R>(methodName, std::forward<Args>(args)...);
     }
     template <typename R, typename... Args>
+    qi::Future<R> async(const CallOptions& options, const std::string& methodName, Args&&... args) const
+    {
+      return go()->template async<R>(options, methodName, std::forward<Args>(args)...);
+    }
+    inline qi::Future<AnyValueVector> callBatch(const CallBatch& batch) const
+    {
+      return go()->callBatch(batch);
+    }
+    inline qi::Future<AnyValueVector> metaCallBatch(std::vector<std::pair<unsigned int, AnyValueVector>> calls,
+                                                    MetaCallType callType = MetaCallType_Auto) const
+    {
+      return go()->metaCallBatch(std::move(calls), callType);
+    }
+    template <typename R, typename... Args>
     R call(const std::string& methodName, Args&&... args) const
     {
       return go()->template call<R>(methodName, std::forward<Args>(args)...);
@@ -9,6 +9,7 @@
 
 #include <algorithm>
 #include <qi/os.hpp>
+#include <qi/stringview.hpp>
 #include <qi/type/detail/structtypeinterface.hxx>
 
 namespace qi
@@ -78,6 +79,30 @@ namespace qi
   class TypeImpl<char*>: public TypeCStringImpl
   {};
 
+  class TypeStringViewImpl: public StringTypeInterface
+  {
+  public:
+    using Methods = DefaultTypeImplMethods<StringView, TypeByPointerPOD<StringView>>;
+    ManagedRawString get(void* storage) override
+    {
+      // The characters are shared, not copied.
+      StringView* ptr = (StringView*)Methods::ptrFromStorage(&storage);
+      return ManagedRawString(RawString(const_cast<char*>(ptr->data()), ptr->size()),
+          Deleter());
+    }
+    void set(void** storage, const char* value, size_t sz) override
+    {
+      StringView* ptr = (StringView*)Methods::ptrFromStorage(storage);
+      *ptr = StringView(value, sz);
+    }
+
+    _QI_BOUNCE_TYPE_METHODS(Methods);
+  };
+
+  template<>
+  class TypeImpl<StringView>: public TypeStringViewImpl
+  {};
+
 
   template<int I> class TypeImpl<char [I]>: public StringTypeInterface
   {
@@ -9,6 +9,8 @@
 
 #include <cstdio>
 #include <cstring>
+#include <new>
+#include <sstream>
 #include <stdexcept>
 #include <iomanip>
 #include <ctype.h>
@@ -26,6 +28,19 @@ namespace qi
 {
   BufferPrivate::BufferPrivate() = default;
 
+  /// Throws std::bad_alloc if memory cannot be allocated.
+  /// Returns null if size is 0.
+  static unsigned char* allocateCopy(const unsigned char* data, size_t size)
+  {
+    if (size == 0)
+      return nullptr;
+    auto copy = static_cast<unsigned char*>(malloc(size));
+    if (!copy)
+      throw std::bad_alloc();
+    ::memcpy(copy, data, size);
+    return copy;
+  }
+
   BufferPrivate::~BufferPrivate()
   {
     if (_bigdata)
@@ -35,17 +50,17 @@ namespace qi
     }
   }
 
+  // Heap storage of a copy only holds the used bytes: writing more resizes it.
   BufferPrivate::BufferPrivate(const BufferPrivate& b)
     : _bigdata(nullptr)
     , _cachedSubBufferTotalSize(b._cachedSubBufferTotalSize)
     , used(b.used)
-    , available(b.available)
+    , available(b._bigdata || b._external ? b.used : b.available)
     , _subBuffers(b._subBuffers)
   {
-    if (b._bigdata)
+    if (b._bigdata || b._external)
     {
-      _bigdata = static_cast<unsigned char*>(malloc(b.used));
-      ::memcpy(_bigdata, b._bigdata, b.used);
+      _bigdata = allocateCopy(b.data(), b.used);
     }
     else
     {
@@ -56,24 +71,26 @@ namespace qi
   BufferPrivate& BufferPrivate::operator=(const BufferPrivate& b)
   {
     if (&b == this) return *this;
+    // Allocate first, so that this buffer is unchanged if it fails.
+    unsigned char* bigdata = nullptr;
+    if (b._bigdata || b._external)
+      bigdata = allocateCopy(b.data(), b.used);
     _cachedSubBufferTotalSize = b._cachedSubBufferTotalSize;
     used = b.used;
-    available = b.available;
+    available = b._bigdata || b._external ? b.used : b.available;
     _subBuffers = b._subBuffers;
     if (_bigdata)
     {
       free(_bigdata);
       _bigdata = NULL;
     }
-    if (b._bigdata)
-    {
-      _bigdata = static_cast<unsigned char*>(malloc(b.used));
-      ::memcpy(_bigdata, b._bigdata, b.used);
-    }
-    else
-    {
+    _external = nullptr;
+    _externalOwner.reset();
+    _exposed = false;
+    if (bigdata)
+      _bigdata = bigdata;
+    else if (!b._bigdata && !b._external)
       ::memcpy(_data, b._data, b.used);
-    }
     return *this;
   }
 
@@ -112,6 +129,8 @@ namespace qi
 
   unsigned char* BufferPrivate::data()
   {
+    if (_external)
+      return _external;
     return _bigdata ? _bigdata : _data;
   }
 
@@ -130,26 +149,100 @@ namespace qi
     newBigdata = static_cast<unsigned char *>(realloc(_bigdata, neededSize));
     if (newBigdata == NULL)
       return false;
-    if (!_bigdata && used > 0)
+    if (_external)
+    {
+      ::memcpy(newBigdata, _external, used);
+      _external = nullptr;
+      _externalOwner.reset();
+    }
+    else if (!_bigdata && used > 0)
       ::memcpy(newBigdata, _data, used);
     available = neededSize;
     _bigdata = newBigdata; // Don't worry, realloc free previous buffer if needed
     return true;
   }
 
+  namespace
+  {
+    /// Gives the buffer storage of its own before it is modified.
+    /// Returns false if memory cannot be allocated.
+    bool makeWritable(boost::shared_ptr<BufferPrivate>& p)
+    {
+      if (!p.unique())
+      {
+        try
+        {
+          p = boost::make_shared<BufferPrivate>(*p);
+        }
+        catch (const std::bad_alloc&)
+        {
+          return false;
+        }
+      }
+      else if (p->_external && !p->_externalOwner.unique())
+        // The memory belongs to another buffer that this one is a slice of.
+        return p->resize(p->used);
+      return true;
+    }
+
+    /// Copies are deep if the storage can be modified behind them.
+    boost::shared_ptr<BufferPrivate> share(const boost::shared_ptr<BufferPrivate>& p)
+    {
+      return p->_exposed ? boost::make_shared<BufferPrivate>(*p) : p;
+    }
+  } // anonymous namespace
+
   Buffer::Buffer()
     : _p(boost::make_shared<BufferPrivate>())
   {
   }
 
+  Buffer makeBufferOnExternalMemory(unsigned char* data, size_t size,
+                                    boost::shared_ptr<void> owner)
+  {
+    Buffer buffer;
+    buffer._p->_external = data;
+    buffer._p->_externalOwner = std::move(owner);
+    buffer._p->used = size;
+    buffer._p->available = size;
+    return buffer;
+  }
+
+  void* reserveForFill(Buffer& buffer, size_t size)
+  {
+    auto& p = buffer._p;
+    if (!makeWritable(p))
+      return nullptr;
+    if (p->used + size > p->available)
+    {
+      bool success = p->resize(p->used + size);
+      if (!success) {
+        qiLogVerbose() << "reserve(" << size << ") failed, buffer size is " << p->available;
+        return nullptr;
+      }
+    }
+
+    void *ptr = p->data() + p->used;
+    p->used += size;
+
+    return ptr;
+  }
+
+  void* dataForFill(Buffer& buffer)
+  {
+    if (!makeWritable(buffer._p))
+      return nullptr;
+    return buffer._p->data();
+  }
+
   Buffer::Buffer(const Buffer& b)
-    : _p(boost::make_shared<BufferPrivate>(*b._p))
+    : _p(share(b._p))
   {
   }
 
   Buffer& Buffer::operator=(const Buffer& b)
   {
-    _p = boost::make_shared<BufferPrivate>(*b._p);
+    _p = share(b._p);
     return *this;
   }
 
@@ -169,6 +262,11 @@ namespace qi
 
   bool Buffer::write(const void *data, size_t size)
   {
+    if (!makeWritable(_p))
+    {
+      qiLogVerbose() << "write(" << size << ") failed, cannot copy the shared buffer";
+      return false;
+    }
     if (_p->used + size > _p->available)
     {
       bool ret = _p->resize(_p->used + size);
@@ -238,23 +336,19 @@ namespace qi
   */
   void *Buffer::reserve(size_t size)
   {
-    if (_p->used + size > _p->available)
-    {
-      bool success = _p->resize(_p->used + size);
-      if (!success) {
-        qiLogVerbose() << "reserve(" << size << ") failed, buffer size is " << _p->available;
-        return nullptr;
-      }
-    }
-
-    void *p = _p->data() + _p->used;
-    _p->used += size;
-
+    void* p = reserveForFill(*this, size);
+    if (p)
+      _p->_exposed = true;
     return p;
   }
 
   void Buffer::clear()
   {
+    if (!_p.unique())
+    {
+      _p = boost::make_shared<BufferPrivate>();
+      return;
+    }
     _p->used = 0;
     _p->_subBuffers.clear();
     _p->_cachedSubBufferTotalSize = 0;
@@ -262,7 +356,12 @@ namespace qi
 
   void* Buffer::data()
   {
-    return _p ? _p->data() : 0;
+    if (!_p)
+      return 0;
+    void* p = dataForFill(*this);
+    if (p)
+      _p->_exposed = true;
+    return p;
   }
 
   const void* Buffer::data() const
@@ -294,9 +393,47 @@ namespace qi
     return copy;
   }
 
+  Buffer Buffer::slice(size_t offset, size_t length) const
+  {
+    if (offset > _p->used || length > _p->used - offset)
+    {
+      std::stringstream err;
+      err << "Slice of " << length << " byte(s) at " << offset
+          << " is out of a buffer of size " << _p->used << ".";
+      throw std::out_of_range(err.str());
+    }
+
+    Buffer result;
+    // Small slices are as cheap to copy and do not keep this storage alive.
+    if (_p->_exposed || length <= STATIC_BLOCK)
+    {
+      if (!result.write(_p->data() + offset, length))
+        throw std::bad_alloc();
+    }
+    else
+    {
+      auto& r = *result._p;
+      r._external = _p->data() + offset;
+      r._externalOwner = _p;
+      r.used = length;
+      r.available = length;
+    }
+
+    auto& r = *result._p;
+    for (const auto& sub : _p->_subBuffers)
+    {
+      if (sub.first >= offset && sub.first + sizeof(size_type) <= offset + length)
+      {
+        r._subBuffers.push_back(std::make_pair(sub.first - offset, sub.second));
+        r._cachedSubBufferTotalSize += sub.second.totalSize();
+      }
+    }
+    return result;
+  }
+
   bool Buffer::operator==(const Buffer& b) const
   {
-    return boost::equal_pointees(_p, b._p);
+    return _p == b._p || boost::equal_pointees(_p, b._p);
   }
 
   namespace detail {
@@ -12,7 +12,9 @@
 
 #include <vector>
 #include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
 #include <qi/atomic.hpp>
+#include <qi/buffer.hpp>
 #include <qi/types.hpp>
 #include <ka/macroregular.hpp>
 
@@ -42,7 +44,34 @@ namespace qi
     size_t          available = std::extent<decltype(_data)>::value; // total size of buffer
 
     std::vector<std::pair<size_t, Buffer> > _subBuffers;
+
+    // Memory not allocated by the buffer (a shared memory mapping for
+    // instance), used in place of `_bigdata`. It is kept alive by the owner
+    // and given up for a copy as soon as the buffer needs to grow.
+    unsigned char*  _external = nullptr;
+    boost::shared_ptr<void> _externalOwner;
+
+    // Set once a pointer allowing to modify the data has been given out. The
+    // storage is then never shared, as it could change behind the copies.
+    bool            _exposed = false;
   };
+
+  /// Returns a buffer whose content is the `size` bytes at `data`, without
+  /// copying them. The memory must be writable and stay valid as long as
+  /// `owner` is alive. Copies of the returned buffer get their own storage.
+  Buffer makeBufferOnExternalMemory(unsigned char* data, size_t size,
+                                    boost::shared_ptr<void> owner);
+
+  /// Same as `Buffer::reserve` and `Buffer::data`, except that the buffer can
+  /// still share its storage afterwards. The returned memory must be filled
+  /// before the buffer is copied.
+  void* reserveForFill(Buffer& buffer, size_t size);
+  void* dataForFill(Buffer& buffer);
+
+  /// Returns a slice of the `length` bytes at the reader position, and moves
+  /// the reader past them.
+  /// Throws a `std::out_of_range` if there are not enough bytes left.
+  Buffer readBufferSlice(BufferReader& reader, size_t length);
 }
 
 #endif  // _SRC_BUFFER_P_HPP_
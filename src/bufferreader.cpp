@@ -87,4 +87,16 @@ namespace qi {
   {
     return _cursor;
   }
+
+  Buffer readBufferSlice(BufferReader& reader, size_t length)
+  {
+    Buffer slice = reader._buffer->slice(reader._cursor, length);
+    reader._cursor += length;
+    // Sub-buffers that were in the slice have been read as well.
+    const auto& subBuffers = reader._buffer->subBuffers();
+    while (reader._subCursor < subBuffers.size()
+           && subBuffers[reader._subCursor].first < reader._cursor)
+      ++reader._subCursor;
+    return slice;
+  }
 }
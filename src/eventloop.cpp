@@ -2,6 +2,8 @@
 **  Copyright (C) 2012, 2013 Aldebaran Robotics
 **  See COPYING for the license
 */
+#include <algorithm>
+#include <cstdlib>
 #include <thread>
 #include <system_error>
 #include <memory>
@@ -1092,4 +1094,47 @@ namespace qi {
     return _getNetwork(_networkEventLoop);
   }
 
+  namespace
+  {
+    std::size_t networkEventLoopCountFromEnv()
+    {
+      const auto count = os::getenv("QI_NETWORK_EVENTLOOP_COUNT");
+      if (count.empty())
+        return 1u;
+      const auto n = std::strtoul(count.c_str(), 0, 0);
+      return n ? n : static_cast<std::size_t>(std::max(os::numberOfCPUs(), 1l));
+    }
+
+    void pinNetworkEventLoop(EventLoop* loop, int cpu)
+    {
+      loop->async([=] {
+        if (!os::setCurrentThreadCPUAffinity({cpu}))
+          qiLogVerbose() << "Could not pin the network eventloop thread to CPU " << cpu;
+      });
+    }
+  }
+
+  const std::vector<EventLoop*>& getNetworkEventLoops()
+  {
+    // The extra eventloops are never destroyed: sockets may still refer to them
+    // while the application exits.
+    static const std::vector<EventLoop*> loops = [] {
+      const auto count = networkEventLoopCountFromEnv();
+      std::vector<EventLoop*> loops{getNetworkEventLoop()};
+      for (std::size_t i = 1u; i < count; ++i)
+      {
+        loops.push_back(new EventLoop("EventLoopNetwork" + std::to_string(i), 1, 1, 1, false));
+      }
+      if (count > 1u && os::getenv("QI_NETWORK_EVENTLOOP_PIN") != "0")
+      {
+        const auto cpuCount = std::max(os::numberOfCPUs(), 1l);
+        for (std::size_t i = 0u; i != loops.size(); ++i)
+          pinNetworkEventLoop(loops[i], static_cast<int>(i % static_cast<std::size_t>(cpuCount)));
+      }
+      qiLogVerbose() << "Network eventloops: " << loops.size();
+      return loops;
+    }();
+    return loops;
+  }
+
 }
@@ -3,12 +3,18 @@
 **  See COPYING for the license
 */
 
+#include <algorithm>
 #include <boost/make_shared.hpp>
 
 #include <qi/anyobject.hpp>
+#include <qi/calloptions.hpp>
+#include <qi/os.hpp>
 #include <qi/type/objecttypebuilder.hpp>
 #include <src/type/signal_p.hpp>
 #include "boundobject.hpp"
+#include "eventthrottle.hpp"
+#include "metaobjectdiskcache.hpp"
+#include "sharedmemorybuffer.hpp"
 
 const auto logCategory = "qimessaging.boundobject";
 qiLogCategory(logCategory);
@@ -23,14 +29,14 @@ const auto invalidValueError = "The value is invalid.";
 namespace qi
 {
 
-  static AnyReference forwardEvent(const GenericFunctionParameters& params,
-                                   unsigned int service, unsigned int object,
-                                   unsigned int event, Signature sig,
-                                   MessageSocketPtr client,
-                                   boost::weak_ptr<ObjectHost> context,
-                                   const std::string& signature)
+  // Returns an event message holding the arguments serialized for the socket, converted to
+  // `signature` if the subscriber asked for it.
+  static qi::Message eventMessage(const GenericFunctionParameters& params,
+                                  Signature sig,
+                                  MessageSocketPtr client,
+                                  boost::weak_ptr<ObjectHost> context,
+                                  const std::string& signature)
   {
-    qiLogDebug() << "forwardEvent";
     qi::Message msg;
     // FIXME: would like to factor with serveresult.hpp convertAndSetValue()
     // but we have a setValue/setValues issue
@@ -80,20 +86,208 @@ namespace qi
         msg.setValues(params, "m", context, client);
       }
     }
-    msg.setService(service);
-    msg.setFunction(event);
-    msg.setType(Message::Type_Event);
-    msg.setObject(object);
-    client->send(std::move(msg));
-    return AnyReference();
+    return msg;
   }
 
+  /// Remote subscribers of a signal of the object. They all receive its events through a single
+  /// local connection to the signal, so that the arguments of an emission are serialized once and
+  /// the same payload is sent to every subscriber that can take it.
+  struct BoundObject::EventForwarder
+  {
+    // Delivery of the events to a subscriber that asked for a policy.
+    struct Delivery
+    {
+      explicit Delivery(const EventDeliveryPolicy& policy)
+        : throttle(policy)
+      {}
+
+      boost::mutex mutex;
+      EventThrottle throttle;
+      // Latest event waiting for the maximum rate to allow its delivery.
+      boost::optional<qi::Message> deferred;
+      bool timerPending = false;
+    };
+    using DeliveryPtr = boost::shared_ptr<Delivery>;
+
+    struct Subscriber
+    {
+      MessageSocketPtr socket;
+      SignalLink remoteSignalLinkId;
+      // Signature the subscriber asked the arguments to be converted to, if any.
+      std::string signature;
+      // Null if the subscriber takes all the events.
+      DeliveryPtr delivery;
+    };
+
+    // Sends the deferred event of the subscriber once the maximum rate allows it.
+    static void sendDeferred(boost::weak_ptr<Delivery> weakDelivery, MessageSocketPtr socket)
+    {
+      const auto delivery = weakDelivery.lock();
+      if (!delivery) // The subscriber is gone.
+        return;
+      boost::optional<qi::Message> msg;
+      {
+        boost::mutex::scoped_lock lock(delivery->mutex);
+        const auto now = SteadyClock::now();
+        const auto sendTime = delivery->throttle.nextSendTime();
+        if (delivery->deferred && now < sendTime)
+        {
+          // An event was sent since the timer was set.
+          getEventLoop()->asyncAt([=] { sendDeferred(weakDelivery, socket); }, sendTime);
+          return;
+        }
+        delivery->timerPending = false;
+        if (!delivery->deferred)
+          return;
+        delivery->throttle.sent(now);
+        msg = std::move(delivery->deferred);
+        delivery->deferred = boost::none;
+      }
+      socket->send(std::move(*msg));
+    }
+
+    // Keeps the event as the one to send when the maximum rate allows it, in place of any older
+    // one.
+    static void defer(const Subscriber& target, qi::Message msg)
+    {
+      SteadyClockTimePoint sendTime;
+      {
+        boost::mutex::scoped_lock lock(target.delivery->mutex);
+        target.delivery->deferred = std::move(msg);
+        if (target.delivery->timerPending)
+          return;
+        target.delivery->timerPending = true;
+        sendTime = target.delivery->throttle.nextSendTime();
+      }
+      boost::weak_ptr<Delivery> weakDelivery = target.delivery;
+      const auto socket = target.socket;
+      getEventLoop()->asyncAt([=] { sendDeferred(weakDelivery, socket); }, sendTime);
+    }
+
+    // Returns what to do with the event for the subscriber.
+    static EventThrottle::Admission admit(const Subscriber& target)
+    {
+      if (!target.delivery)
+        return EventThrottle::Admission::Send;
+      boost::mutex::scoped_lock lock(target.delivery->mutex);
+      const auto admission = target.delivery->throttle.admit(SteadyClock::now());
+      // The event is newer than the deferred one.
+      if (admission == EventThrottle::Admission::Send)
+        target.delivery->deferred = boost::none;
+      return admission;
+    }
+
+    unsigned int service;
+    unsigned int object;
+    unsigned int event;
+    Signature sig;
+    boost::weak_ptr<ObjectHost> context;
+    Future<SignalLink> localSignalLinkId;
+    boost::synchronized_value<std::vector<Subscriber>> subscribers;
+
+    void forward(const GenericFunctionParameters& params) const
+    {
+      const auto targets = subscribers.get();
+      qiLogDebug() << "forwardEvent to " << targets.size() << " subscribers";
+
+      // Payload serialized without a socket, shared by the subscribers that need no conversion.
+      // Objects and buffers passed through shared memory are serialized for a socket, such
+      // payloads are serialized for each subscriber instead.
+      boost::optional<qi::Message> shared;
+      bool shareable = true;
+      for (const auto& target : targets)
+      {
+        try
+        {
+          const auto admission = admit(target);
+          if (admission == EventThrottle::Admission::Drop)
+            continue;
+
+          const bool takesSharedPayload =
+            shareable && target.signature.empty() && !shm::isEnabled(*target.socket);
+          if (takesSharedPayload && !shared)
+          {
+            try
+            {
+              shared = qi::Message();
+              shared->setValues(params, sig, context, MessageSocketPtr());
+            }
+            catch (const std::exception& e)
+            {
+              qiLogDebug() << "forwardEvent cannot share the payload: " << e.what();
+              shared = boost::none;
+              shareable = false;
+            }
+          }
+
+          // Copies of the message share its payload.
+          qi::Message msg = (takesSharedPayload && shared)
+                              ? *shared
+                              : eventMessage(params, sig, target.socket, context, target.signature);
+          msg.setService(service);
+          msg.setFunction(event);
+          msg.setType(Message::Type_Event);
+          msg.setObject(object);
+          if (target.delivery && target.delivery->throttle.policy().conflate)
+            msg.setConflatable(true);
+          if (admission == EventThrottle::Admission::Defer)
+            defer(target, std::move(msg));
+          else
+            target.socket->send(std::move(msg));
+        }
+        catch (const std::exception& e)
+        {
+          // Other subscribers must still receive the event.
+          qiLogWarning() << "Failed to forward event " << event << " to socket "
+                         << target.socket.get() << ": " << e.what();
+        }
+      }
+    }
+  };
+
   struct BoundObject::CancelableKit
   {
     BoundObject::CancelableMap map;
     boost::mutex                      guard;
   };
 
+  namespace
+  {
+    /// Bound object whose function is being called synchronously by this thread, and the socket
+    /// that sent the call.
+    struct CurrentCall
+    {
+      const BoundObject* object;
+      MessageSocketPtr socket;
+    };
+
+    thread_local CurrentCall currentCall = { nullptr, {} };
+
+    /// With QIMESSAGING_DECODE_STRING_VIEWS=1, the string arguments of calls
+    /// and posts are decoded as views of the message payload. Functions taking
+    /// StringView parameters receive them without any copy; others get them
+    /// converted.
+    Message::StringDecoding argumentStringDecoding()
+    {
+      static const bool views = os::getenv("QIMESSAGING_DECODE_STRING_VIEWS") == "1";
+      return views ? Message::StringDecoding::View : Message::StringDecoding::Copy;
+    }
+  }
+
+  MessageSocketPtr BoundObject::callerSocket() const
+  {
+    return currentCall.object == this ? currentCall.socket : MessageSocketPtr();
+  }
+
+  MessageSocketPtr BoundObject::currentSocket() const
+  {
+#ifndef NDEBUG
+    if (_callType != MetaCallType_Direct)
+      qiLogWarning() << " currentSocket() used but callType is not direct";
+#endif
+    return callerSocket();
+  }
+
   BoundObject::BoundObject(unsigned int serviceId,
                            unsigned int objectId,
                            qi::AnyObject object,
@@ -129,7 +323,7 @@ namespace qi
     {
       ob = new qi::ObjectTypeBuilder<BoundObject>();
       // these are called synchronously by onMessage (and this is needed for
-      // _currentSocket), no need for threadsafety here
+      // callerSocket()), they only lock what they share with concurrent calls
       ob->setThreadingModel(ObjectThreadingModel_MultiThread);
       /* Network-related stuff.
       */
@@ -146,6 +340,9 @@ namespace qi
       ob->advertiseMethod("setProperty", &BoundObject::setProperty, MetaCallType_Queued, qi::Message::BoundObjectFunction_SetProperty);
       ob->advertiseMethod("properties",       &BoundObject::properties, MetaCallType_Direct, qi::Message::BoundObjectFunction_Properties);
       ob->advertiseMethod("registerEventWithSignature"  , &BoundObject::registerEventWithSignature, MetaCallType_Direct, qi::Message::BoundObjectFunction_RegisterEventWithSignature);
+      ob->advertiseMethod("callBatch",       &BoundObject::callBatch, MetaCallType_Direct, qi::Message::BoundObjectFunction_CallBatch);
+      ob->advertiseMethod("registerEventWithPolicy", &BoundObject::registerEventWithPolicy, MetaCallType_Direct, qi::Message::BoundObjectFunction_RegisterEventWithPolicy);
+      ob->advertiseMethod("metaObjectFingerprint", &BoundObject::metaObjectFingerprint, MetaCallType_Direct, qi::Message::BoundObjectFunction_MetaObjectFingerprint);
     }
     AnyObject result = ob->object(self, &AnyObject::deleteGenericObjectOnly);
     return result;
@@ -153,65 +350,176 @@ namespace qi
 
   // Bound Method
   qi::Future<SignalLink> BoundObject::registerEvent(unsigned int objectId, unsigned int eventId, SignalLink remoteSignalLinkId) {
-    // fetch signature
-    const MetaSignal* ms = _object.metaObject().signal(eventId);
-    if (!ms)
-      throw std::runtime_error("No such signal");
-    QI_ASSERT(_currentSocket);
-    AnyFunction mc = AnyFunction::fromDynamicFunction(boost::bind(&forwardEvent, _1, _serviceId, _objectId, eventId, ms->parametersSignature(), _currentSocket, asHostWeakPtr(), ""));
-    qi::Future<SignalLink> linking = _object.connect(eventId, mc);
-    auto& linkEntry = _links[_currentSocket][remoteSignalLinkId];
-    linkEntry = RemoteSignalLink(linking, eventId);
-    return linking.andThen([=](SignalLink linkId) mutable {
-      QI_LOG_DEBUG_BOUNDOBJECT() << "Registered event remote_signal_link=" << remoteSignalLinkId
-                                 << " local_link=" << linkId;
-      return linkId;
-    });
+    return addEventSubscriber(eventId, remoteSignalLinkId, "");
   }
 
   qi::Future<SignalLink> BoundObject::registerEventWithSignature(unsigned int objectId, unsigned int eventId, SignalLink remoteSignalLinkId, const std::string& signature) {
+    return addEventSubscriber(eventId, remoteSignalLinkId, signature);
+  }
+
+  qi::Future<SignalLink> BoundObject::registerEventWithPolicy(unsigned int objectId, unsigned int eventId,
+                                                              SignalLink remoteSignalLinkId,
+                                                              const std::string& signature, double maxRate,
+                                                              unsigned int decimation, bool conflate) {
+    EventDeliveryPolicy policy;
+    policy.maxRate = maxRate;
+    policy.decimation = decimation;
+    policy.conflate = conflate;
+    return addEventSubscriber(eventId, remoteSignalLinkId, signature, policy);
+  }
+
+  // Bound Method
+  qi::Future<void> BoundObject::unregisterEvent(unsigned int objectId, unsigned int QI_UNUSED(event), SignalLink remoteSignalLinkId)
+  {
+    // The invalid signal link is never connected, therefore the disconnection
+    // is always successful.
+    if (!isValidSignalLink(remoteSignalLinkId))
+      return futurize();
+
+    const auto socket = callerSocket();
+    boost::optional<Future<SignalLink>> localSignalLinkId;
+    {
+      boost::mutex::scoped_lock lock(_linksMutex);
+      ServiceSignalLinks&          sl = _links[socket];
+      ServiceSignalLinks::iterator it = sl.find(remoteSignalLinkId);
+
+      if (it == sl.end())
+      {
+        std::stringstream ss;
+        ss << "Unregister request failed for " << remoteSignalLinkId << " " << objectId;
+        qiLogError() << ss.str();
+        throw std::runtime_error(ss.str());
+      }
+
+      const auto eventId = it->second.event;
+      sl.erase(it);
+      if (sl.empty())
+        _links.erase(socket);
+      localSignalLinkId = removeEventSubscriber(eventId, socket, remoteSignalLinkId);
+    }
+    // Other remote subscribers still receive the events through the local connection.
+    if (!localSignalLinkId)
+      return futurize();
+    auto object = _object;
+    return localSignalLinkId->andThen([=](SignalLink link) {
+      return object.disconnect(link).async();
+    }).unwrap();
+  }
+
+  qi::Future<SignalLink> BoundObject::addEventSubscriber(unsigned int eventId,
+                                                         SignalLink remoteSignalLinkId,
+                                                         const std::string& signature,
+                                                         boost::optional<EventDeliveryPolicy> policy)
+  {
     // fetch signature
     const MetaSignal* ms = _object.metaObject().signal(eventId);
     if (!ms)
       throw std::runtime_error("No such signal");
-    QI_ASSERT(_currentSocket);
-    AnyFunction mc = AnyFunction::fromDynamicFunction(boost::bind(&forwardEvent, _1, _serviceId, _objectId, eventId, ms->parametersSignature(), _currentSocket, asHostWeakPtr(), signature));
-    qi::Future<SignalLink> linking = _object.connect(eventId, mc);
-    auto& linkEntry = _links[_currentSocket][remoteSignalLinkId];
-    linkEntry = RemoteSignalLink(linking, eventId);
-    return linking.andThen([=](SignalLink linkId) mutable {
+    const auto socket = callerSocket();
+    QI_ASSERT(socket);
+
+    EventForwarderPtr forwarder;
+    Promise<SignalLink> linking;
+    bool mustConnect = false;
+    boost::optional<Future<SignalLink>> replacedSignalLinkId;
+    {
+      boost::mutex::scoped_lock lock(_linksMutex);
+      auto& links = _links[socket];
+      const auto replaced = links.find(remoteSignalLinkId);
+      if (replaced != links.end())
+        replacedSignalLinkId =
+          removeEventSubscriber(replaced->second.event, socket, remoteSignalLinkId);
+
+      auto& slot = _eventForwarders[eventId];
+      if (!slot)
+      {
+        slot = boost::make_shared<EventForwarder>();
+        slot->service = _serviceId;
+        slot->object = _objectId;
+        slot->event = eventId;
+        slot->sig = ms->parametersSignature();
+        slot->context = asHostWeakPtr();
+        slot->localSignalLinkId = linking.future();
+        mustConnect = true;
+      }
+      forwarder = slot;
+      forwarder->subscribers->push_back(EventForwarder::Subscriber{
+        socket, remoteSignalLinkId, signature,
+        policy ? boost::make_shared<EventForwarder::Delivery>(*policy)
+               : EventForwarder::DeliveryPtr() });
+      links[remoteSignalLinkId] = RemoteSignalLink(forwarder->localSignalLinkId, eventId);
+    }
+
+    auto object = _object;
+    if (replacedSignalLinkId)
+      replacedSignalLinkId->andThen([=](SignalLink link) { object.disconnect(link); });
+
+    // Only the first remote subscriber connects to the signal.
+    if (mustConnect)
+    {
+      AnyFunction mc = AnyFunction::fromDynamicFunction(
+        [forwarder](const GenericFunctionParameters& params) {
+          forwarder->forward(params);
+          return AnyReference();
+        });
+      Future<SignalLink> connecting = object.connect(eventId, mc);
+      adaptFuture(connecting, linking);
+      connecting.then(FutureCallbackType_Sync,
+                      track([this, forwarder](const Future<SignalLink>& fut) {
+                        if (!fut.hasValue())
+                          removeEventForwarder(forwarder);
+                      }, weak_from_this()));
+    }
+
+    return forwarder->localSignalLinkId.andThen([=](SignalLink linkId) mutable {
       QI_LOG_DEBUG_BOUNDOBJECT() << "Registered event remote_signal_link=" << remoteSignalLinkId
                                  << " local_link=" << linkId;
       return linkId;
     });
   }
 
-  // Bound Method
-  qi::Future<void> BoundObject::unregisterEvent(unsigned int objectId, unsigned int QI_UNUSED(event), SignalLink remoteSignalLinkId)
+  boost::optional<qi::Future<SignalLink>> BoundObject::removeEventSubscriber(
+    unsigned int eventId, const MessageSocketPtr& socket, SignalLink remoteSignalLinkId)
   {
-    // The invalid signal link is never connected, therefore the disconnection
-    // is always successful.
-    if (!isValidSignalLink(remoteSignalLinkId))
-      return futurize();
+    const auto it = _eventForwarders.find(eventId);
+    if (it == _eventForwarders.end())
+      return {};
+    const auto forwarder = it->second;
+    {
+      auto subscribers = forwarder->subscribers.synchronize();
+      subscribers->erase(std::remove_if(subscribers->begin(), subscribers->end(),
+                                        [&](const EventForwarder::Subscriber& subscriber) {
+                                          return subscriber.socket == socket
+                                              && subscriber.remoteSignalLinkId == remoteSignalLinkId;
+                                        }),
+                         subscribers->end());
+      if (!subscribers->empty())
+        return {};
+    }
+    _eventForwarders.erase(it);
+    return forwarder->localSignalLinkId;
+  }
 
-    ServiceSignalLinks&          sl = _links[_currentSocket];
-    ServiceSignalLinks::iterator it = sl.find(remoteSignalLinkId);
+  void BoundObject::removeEventForwarder(const EventForwarderPtr& forwarder)
+  {
+    boost::mutex::scoped_lock lock(_linksMutex);
+    const auto it = _eventForwarders.find(forwarder->event);
+    if (it != _eventForwarders.end() && it->second == forwarder)
+      _eventForwarders.erase(it);
 
-    if (it == sl.end())
+    for (const auto& subscriber : forwarder->subscribers.get())
     {
-      std::stringstream ss;
-      ss << "Unregister request failed for " << remoteSignalLinkId << " " << objectId;
-      qiLogError() << ss.str();
-      throw std::runtime_error(ss.str());
+      const auto socketLinks = _links.find(subscriber.socket);
+      if (socketLinks == _links.end())
+        continue;
+      auto& links = socketLinks->second;
+      const auto link = links.find(subscriber.remoteSignalLinkId);
+      // The subscriber may have subscribed again since, through another forwarder.
+      if (link != links.end() && link->second.localSignalLinkId == forwarder->localSignalLinkId)
+        links.erase(link);
+      if (links.empty())
+        _links.erase(socketLinks);
     }
-
-    auto localSignalLinkId = it->second.localSignalLinkId;
-    sl.erase(it);
-    if (sl.empty())
-      _links.erase(_currentSocket);
-    return localSignalLinkId.andThen([=](SignalLink link) {
-      return _object.disconnect(link).async();
-    }).unwrap();
   }
 
   // Bound Method
@@ -220,6 +528,29 @@ namespace qi
     return qi::MetaObject::merge(_self.metaObject(), _object.metaObject());
   }
 
+  std::string BoundObject::metaObjectFingerprint(unsigned int objectId) {
+    // Lets clients check the metaobject they stored on disk.
+    return MetaObjectDiskCache::fingerprint(metaObject(objectId));
+  }
+
+
+  // Bound Method
+  qi::Future<AnyValueVector> BoundObject::callBatch(
+      const std::vector<std::pair<unsigned int, AnyValueVector>>& calls)
+  {
+    QI_LOG_DEBUG_BOUNDOBJECT() << "Calling a batch of " << calls.size() << " methods";
+    // Only the methods of the object can be called, as if they were called one by one.
+    for (const auto& call : calls)
+    {
+      if (call.first < Manageable::startId || !_object.metaObject().method(call.first))
+      {
+        std::ostringstream ss;
+        ss << "No such method " << call.first << " in the batch.";
+        return makeFutureError<AnyValueVector>(ss.str());
+      }
+    }
+    return _object.metaCallBatch(calls, _callType);
+  }
 
   void BoundObject::terminate(unsigned int)
   {
@@ -242,7 +573,6 @@ namespace qi
 
   DispatchStatus BoundObject::onMessage(const qi::Message& msg, MessageSocketPtr socket)
   {
-    boost::recursive_mutex::scoped_lock lock(_callMutex);
     bool exceptionWasThrown = false;
     try {
       if (msg.version() > Message::Header::currentVersion())
@@ -259,6 +589,20 @@ namespace qi
                                  << " type=" << msg.type()
                                  << ", size=" << msg.buffer().size();
 
+      // The caller already gave up on calls whose deadline passed: do not even decode them.
+      const auto deadline =
+        msg.type() == Message::Type_Call ? msg.deadline() : boost::none;
+      const auto priority =
+        msg.type() == Message::Type_Call ? msg.callPriority() : boost::none;
+      if (deadline && SteadyClock::now() >= *deadline)
+      {
+        QI_LOG_DEBUG_BOUNDOBJECT() << "Dropping call " << msg.address() << ", its deadline passed";
+        serverResultAdapter(qi::makeFutureError<AnyReference>(callDeadlineExceededError),
+                            Signature(), _gethost(), socket, msg.address(), Signature(),
+                            CancelableKitWeak(), AtomicIntPtr(), priority);
+        return DispatchStatus::MessageHandled_WithError;
+      }
+
       QI_ASSERT_TRUE(msg.object() == _objectId);
       qi::AnyObject    obj;
       unsigned int     funcId;
@@ -330,7 +674,7 @@ namespace qi
       // AnyReference and achieve exception-safety through a scoped, than using
       // an AnyValue.
       bool mustDestroyRef = true;
-      ref = msg.value(sigparam, socket).release();
+      ref = msg.value(sigparam, socket, argumentStringDecoding()).release();
       auto guard = ka::scoped([&]() {
         if (mustDestroyRef)
         {
@@ -359,24 +703,24 @@ namespace qi
         mustDestroyRef = true; // Reactivate destroy on scope exit.
       }
       mfp = ref.asTupleValuePtr();
-      /* Because of 'global' _currentSocket, we cannot support parallel
-      * executions at this point.
-      * Both on self, and on obj which can use currentSocket() too.
+      /* Messages are decoded and dispatched concurrently: nothing is locked at
+      * this point. The socket of the message is only known by the functions
+      * executed synchronously by this thread, through callerSocket(): the
+      * special functions on self, and the functions of obj when _callType is
+      * Direct (see currentSocket()).
       *
-      * So put a lock, and rely on metaCall we invoke being asynchronous for// execution
-      * This is decided by _callType, set from BoundObject ctor argument, passed by Server, which
+      * _callType is set from BoundObject ctor argument, passed by Server, which
       * uses its internal _defaultCallType, passed to its constructor, default
       * to queued. When Server is instanciated by ObjectHost, it uses the default
       * value.
-      *
-      * As a consequence, users of currentSocket() must set _callType to Direct.
-      * Calling currentSocket multiple times in a row should be avoided.
       */
+      auto restoreCurrentCall = ka::scoped(currentCall, [](CurrentCall previous) {
+        currentCall = std::move(previous);
+      });
+      currentCall = CurrentCall{ this, socket };
       switch (msg.type())
       {
       case Message::Type_Call: {
-        boost::recursive_mutex::scoped_lock lock(_mutex);
-        _currentSocket = socket;
 
         // Property accessors are insecure to call synchronously
         // because users can customize them.
@@ -385,6 +729,9 @@ namespace qi
         qi::MetaCallType callType = isUserDefinedFunction ? _callType : MetaCallType_Direct;
 
         qi::Signature sig = returnSignature.empty() ? Signature() : Signature(returnSignature);
+        // The calls made by the method inherit the deadline and the priority of this one.
+        detail::CallDeadlineScope deadlineScope(deadline);
+        detail::CallPriorityScope priorityScope(priority);
         qi::Future<AnyReference> fut = obj.metaCall(funcId, mfp, callType, sig);
         AtomicIntPtr cancelRequested = boost::make_shared<Atomic<int> >(0);
         {
@@ -397,11 +744,10 @@ namespace qi
         const MetaMethod* mm = obj.metaObject().method(funcId);
         if (mm)
           retSig = mm->returnSignature();
-        _currentSocket.reset();
 
         fut.connect(boost::bind<void>
                     (&BoundObject::serverResultAdapter, _1, retSig, _gethost(), socket, msg.address(), sig,
-                     CancelableKitWeak(_cancelables), cancelRequested));
+                     CancelableKitWeak(_cancelables), cancelRequested, priority));
       }
         break;
       case Message::Type_Post: {
@@ -670,7 +1016,8 @@ namespace qi
                                             MessageSocketPtr socket,
                                             const qi::MessageAddress& replyaddr,
                                             const Signature& forcedReturnSignature,
-                                            CancelableKitWeak kit)
+                                            CancelableKitWeak kit,
+                                            boost::optional<CallPriority> priority)
   {
     QI_ASSERT_TRUE(val.isValid());
     _removeCachedFuture(kit, socket, replyaddr.messageId);
@@ -720,6 +1067,8 @@ namespace qi
       ret.setType(qi::Message::Type_Error);
       ret.setError("Unknown error caught while forwarding the answer");
     }
+    if (priority)
+      ret.setPriority(Message::priorityOf(*priority));
     if (!socket->send(std::move(ret)))
     {
       // TODO: if `convertAndSetValue` transfers ownership of `val` in the object host,
@@ -737,7 +1086,8 @@ namespace qi
                                         const qi::MessageAddress& replyaddr,
                                         const Signature& forcedReturnSignature,
                                         CancelableKitWeak kit,
-                                        AtomicIntPtr cancelRequested)
+                                        AtomicIntPtr cancelRequested,
+                                        boost::optional<CallPriority> priority)
   {
     if(!socket->isConnected())
     {
@@ -760,7 +1110,8 @@ namespace qi
         if (ao)
         {
           boost::function<void()> cb = boost::bind(&BoundObject::serverResultAdapterNext, val, targetSignature,
-                                                   host, socket, replyaddr, forcedReturnSignature, kit);
+                                                   host, socket, replyaddr, forcedReturnSignature, kit,
+                                                   priority);
           if (ao->call<bool>("isValid"))
           {
             ao->call<void>("_connect", cb);
@@ -809,6 +1160,8 @@ namespace qi
       }
     }
     _removeCachedFuture(kit, socket, replyaddr.messageId);
+    if (priority)
+      ret.setPriority(Message::priorityOf(*priority));
     if (!socket->send(std::move(ret)))
     {
       // TODO: Check if `val` must be destroyed here. Take into account the potential
@@ -850,27 +1203,36 @@ namespace qi
   {
     QI_LOG_DEBUG_BOUNDOBJECT() << "Disconnecting links from socket " << socket;
 
-    boost::recursive_mutex::scoped_lock lock(_callMutex);
-    auto it = _links.find(socket);
-
-    std::size_t count = 0;
-
-    if (it != _links.end())
+    ServiceSignalLinks links;
+    std::vector<Future<SignalLink>> localSignalLinkIds;
     {
-      count = it->second.size();
-      for (const auto& linkSlot : it->second)
-      {
-        // FIXME: Do this in the destructor of `RemoteSignalLink` instead, and make it move only.
-        const auto remoteLink = linkSlot.second;
-        _object.disconnect(remoteLink.localSignalLinkId.value()).async().then([](Future<void> f) {
-          if (f.hasError())
-            qiLogError() << f.error();
-        });
-      }
+      boost::mutex::scoped_lock lock(_linksMutex);
+      auto it = _links.find(socket);
+      if (it == _links.end())
+        return 0;
+      links = std::move(it->second);
       _links.erase(it);
+      for (const auto& linkSlot : links)
+      {
+        if (const auto localSignalLinkId =
+              removeEventSubscriber(linkSlot.second.event, socket, linkSlot.first))
+          localSignalLinkIds.push_back(*localSignalLinkId);
+      }
+    }
+
+    // Only disconnect from the signals that have no remote subscriber left.
+    auto object = _object;
+    for (auto localSignalLinkId : localSignalLinkIds)
+    {
+      localSignalLinkId.andThen([=](SignalLink link) {
+        return object.disconnect(link).async();
+      }).unwrap().then([](Future<void> f) {
+        if (f.hasError())
+          qiLogError() << f.error();
+      });
     }
 
-    return count;
+    return links.size();
   }
 
   namespace detail
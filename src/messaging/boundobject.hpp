@@ -117,29 +117,26 @@ namespace qi
     //PUBLIC BOUND METHODS
     qi::Future<SignalLink> registerEvent(unsigned int serviceId, unsigned int eventId, SignalLink linkId);
     qi::Future<SignalLink> registerEventWithSignature(unsigned int serviceId, unsigned int eventId, SignalLink linkId, const std::string& signature);
+    qi::Future<SignalLink> registerEventWithPolicy(unsigned int serviceId, unsigned int eventId, SignalLink linkId,
+                                                   const std::string& signature, double maxRate,
+                                                   unsigned int decimation, bool conflate);
     qi::Future<void> unregisterEvent(unsigned int serviceId, unsigned int eventId, SignalLink linkId);
     qi::MetaObject metaObject(unsigned int serviceId);
+    std::string    metaObjectFingerprint(unsigned int serviceId);
     void           terminate(unsigned int serviceId); //bound only in special cases
     qi::Future<AnyValue> property(const AnyValue& name);
     Future<void>   setProperty(const AnyValue& name, AnyValue value);
     std::vector<std::string> properties();
+    qi::Future<AnyValueVector> callBatch(const std::vector<std::pair<unsigned int, AnyValueVector>>& calls);
   public:
     /*
-    * Returns the last socket that sent a message to this object.
-    * Considering the volatility of this operation, Users of currentSocket()
-    * must set _callType to Direct, otherwise behavior is undefined. Calling
-    * currentSocket multiple times in a row in the same context should be
-    * avoided: call it once and use the return value, unless you know what
-    * you're doing.
+    * Returns the socket that sent the call being executed by this thread on
+    * this object, or null if there is none.
+    * Only calls executed synchronously by the thread receiving them have a
+    * current socket: users of currentSocket() must set _callType to Direct,
+    * otherwise behavior is undefined.
     */
-    inline qi::MessageSocketPtr currentSocket() const {
-#ifndef NDEBUG
-      if (_callType != MetaCallType_Direct)
-        qiLogWarning("qimessaging.boundobject") << " currentSocket() used but callType is not direct";
-#endif
-      boost::recursive_mutex::scoped_lock lock(_mutex);
-      return _currentSocket;
-    }
+    qi::MessageSocketPtr currentSocket() const;
 
     inline AnyObject object() { return _object;}
     unsigned int id() const { return _objectId; }
@@ -176,6 +173,30 @@ namespace qi
 
     DispatchStatus onMessage(const qi::Message& msg, MessageSocketPtr socket);
 
+    // Socket of the call being executed by this thread on this object, if any.
+    MessageSocketPtr callerSocket() const;
+
+    // Forwards the events of a signal to all its remote subscribers.
+    struct EventForwarder;
+    using EventForwarderPtr = boost::shared_ptr<EventForwarder>;
+
+    // Adds the caller socket to the remote subscribers of the signal, connecting to the signal if
+    // it is the first one. Returns the link of the local connection.
+    qi::Future<SignalLink> addEventSubscriber(unsigned int eventId, SignalLink remoteSignalLinkId,
+                                              const std::string& signature,
+                                              boost::optional<EventDeliveryPolicy> policy = {});
+
+    // Removes a remote subscriber of the signal. If it was the last one, returns the link of the
+    // local connection, that the caller must disconnect without holding the lock.
+    // Precondition: `_linksMutex` is locked.
+    boost::optional<qi::Future<SignalLink>> removeEventSubscriber(unsigned int eventId,
+                                                                  const MessageSocketPtr& socket,
+                                                                  SignalLink remoteSignalLinkId);
+
+    // Removes a forwarder whose connection to the signal failed, with the links of its remote
+    // subscribers, so that they can subscribe again.
+    void removeEventForwarder(const EventForwarderPtr& forwarder);
+
     qi::AnyObject createBoundObjectType(BoundObject *self, bool bindTerminate = false);
 
     inline boost::weak_ptr<ObjectHost> _gethost()
@@ -193,15 +214,18 @@ namespace qi
     }
 
     static void _removeCachedFuture(CancelableKitWeak kit, MessageSocketPtr sock, MessageId id);
+    // The reply is given the priority of the call, if any.
     static void serverResultAdapterNext(AnyReference val, Signature targetSignature,
                                         boost::weak_ptr<ObjectHost> host,
                                  MessageSocketPtr sock, const MessageAddress& replyAddr,
-                                 const Signature& forcedReturnSignature, CancelableKitWeak kit);
+                                 const Signature& forcedReturnSignature, CancelableKitWeak kit,
+                                 boost::optional<CallPriority> priority);
     static void serverResultAdapter(Future<AnyReference> future, const Signature& targetSignature,
                                     boost::weak_ptr<ObjectHost> host,
                                     MessageSocketPtr sock, const MessageAddress& replyAddr,
                                     const Signature& forcedReturnSignature, CancelableKitWeak kit,
-                                    AtomicIntPtr cancelRequested = AtomicIntPtr());
+                                    AtomicIntPtr cancelRequested = AtomicIntPtr(),
+                                    boost::optional<CallPriority> priority = {});
 
     // @returns The number of removed connections.
     std::size_t removeConnections(const MessageSocketPtr& socket) noexcept;
@@ -220,11 +244,13 @@ namespace qi
     // Event handling.
     BySocketServiceSignalLinks _links;
 
-    // Locked when a `Call` message is received. It protects `_links`, `_object` and `_self`.
-    // TODO: Use a synchronized_value instead.
-    boost::recursive_mutex _callMutex;
+    // event id -> forwarder of the events to the remote subscribers
+    boost::container::flat_map<unsigned int, EventForwarderPtr> _eventForwarders;
 
-    qi::MessageSocketPtr _currentSocket;
+    // Protects `_links` and `_eventForwarders`. It is only held while the maps are accessed, never
+    // while calling user code.
+    // TODO: Use a synchronized_value instead.
+    boost::mutex _linksMutex;
 
     using MessageDispatchConnectionList = std::vector<MessageDispatchConnection>;
     boost::synchronized_value<MessageDispatchConnectionList> _messageDispatchConnectionList;
@@ -234,9 +260,6 @@ namespace qi
     qi::AnyObject          _self;
     const qi::MetaCallType _callType;
     boost::optional<boost::weak_ptr<qi::ObjectHost>> _owner;
-    // prevents parallel onMessage on self execution and protects the current socket
-    // TODO: Use a synchronized_value instead.
-    mutable boost::recursive_mutex           _mutex;
     boost::synchronized_value<boost::function<void (MessageSocketPtr)>> _onSocketUnboundCallback;
 
     static std::atomic<unsigned int> _nextId;
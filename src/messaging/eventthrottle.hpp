@@ -0,0 +1,80 @@
+#pragma once
+/*
+**  Copyright (C) 2012 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+#ifndef _SRC_EVENTTHROTTLE_HPP_
+#define _SRC_EVENTTHROTTLE_HPP_
+
+#include <boost/optional.hpp>
+#include <qi/clock.hpp>
+#include <qi/signal.hpp>
+
+namespace qi
+{
+  /// Decides which events of a signal are delivered to a subscriber, according
+  /// to its delivery policy.
+  ///
+  /// Not thread-safe.
+  class EventThrottle
+  {
+  public:
+    enum class Admission
+    {
+      /// The event must be delivered now.
+      Send,
+      /// The event must be delivered at `nextSendTime()`, unless a newer one
+      /// replaces it meanwhile.
+      Defer,
+      /// The event must not be delivered.
+      Drop,
+    };
+
+    explicit EventThrottle(const EventDeliveryPolicy& policy)
+      : _policy(policy)
+    {
+      if (_policy.maxRate > 0.)
+        _minInterval = boost::chrono::duration_cast<Duration>(
+          boost::chrono::duration<double>(1. / _policy.maxRate));
+    }
+
+    /// Decides the fate of an event emitted at `now`. If it is sent, it counts
+    /// for the maximum rate.
+    Admission admit(SteadyClockTimePoint now)
+    {
+      const auto index = _emissionCount++;
+      if (_policy.decimation > 1u && index % _policy.decimation != 0u)
+        return Admission::Drop;
+      if (_lastSendTime && now < nextSendTime())
+        return _policy.conflate ? Admission::Defer : Admission::Drop;
+      sent(now);
+      return Admission::Send;
+    }
+
+    /// Records that a deferred event was sent at `now`.
+    void sent(SteadyClockTimePoint now)
+    {
+      _lastSendTime = now;
+    }
+
+    /// Time from which the next event can be sent.
+    SteadyClockTimePoint nextSendTime() const
+    {
+      return _lastSendTime ? *_lastSendTime + _minInterval : SteadyClockTimePoint{};
+    }
+
+    const EventDeliveryPolicy& policy() const
+    {
+      return _policy;
+    }
+
+  private:
+    EventDeliveryPolicy _policy;
+    Duration _minInterval = Duration::zero();
+    unsigned long long _emissionCount = 0u;
+    boost::optional<SteadyClockTimePoint> _lastSendTime;
+  };
+}
+
+#endif  // _SRC_EVENTTHROTTLE_HPP_
@@ -19,7 +19,9 @@
 #include <qi/binarycodec.hpp>
 
 #include "boundobject.hpp"
+#include "messagesocket.hpp"
 #include "remoteobject_p.hpp"
+#include "sharedmemorybuffer.hpp"
 
 qiLogCategory("qimessaging.message");
 
@@ -80,6 +82,12 @@ namespace qi
       return "Properties";
     case BoundObjectFunction_RegisterEventWithSignature:
       return "RegisterEventWithSignature";
+    case BoundObjectFunction_CallBatch:
+      return "CallBatch";
+    case BoundObjectFunction_RegisterEventWithPolicy:
+      return "RegisterEventWithPolicy";
+    case BoundObjectFunction_MetaObjectFingerprint:
+      return "MetaObjectFingerprint";
     }
 
     if (service != qi::Message::Service_ServiceDirectory)
@@ -281,10 +289,93 @@ namespace qi
     }
   }
 
+  void Message::encodeBinary(const qi::AutoAnyReference& ref,
+                             SerializeObjectCallback onObject,
+                             MessageSocketPtr socket)
+  {
+    auto updateHeaderSize =
+        ka::scoped([&] { _header.size = static_cast<qi::uint32_t>(_buffer.totalSize()); });
+    StreamContext::SendCacheRecorder recorder(socket.get(), _transmittedMetaObjects,
+                                              _sharedMemorySegments);
+    qi::encodeBinary(&_buffer, ref, onObject, socket);
+  }
+
+  void Message::unlinkSharedMemorySegments() const
+  {
+    for (const auto& name : _sharedMemorySegments)
+      shm::unlinkSegment(name);
+  }
+
+  void Message::setDeadline(SteadyClockTimePoint deadline)
+  {
+    const qi::int64_t timeLeft =
+      boost::chrono::duration_cast<MicroSeconds>(deadline - SteadyClock::now()).count();
+    _buffer.write(&timeLeft, sizeof(timeLeft));
+    _header.size = static_cast<qi::uint32_t>(_buffer.totalSize());
+    addFlags(TypeFlag_Deadline);
+  }
+
+  void Message::setCallPriority(CallPriority priority)
+  {
+    setPriority(priorityOf(priority));
+    if (priority == CallPriority::High)
+      addFlags(TypeFlag_ControlPriority);
+    else if (priority == CallPriority::Low)
+      addFlags(TypeFlag_BulkPriority);
+  }
+
+  boost::optional<CallPriority> Message::callPriority() const
+  {
+    if (flags() & TypeFlag_ControlPriority)
+      return CallPriority::High;
+    if (flags() & TypeFlag_BulkPriority)
+      return CallPriority::Low;
+    return {};
+  }
+
+  boost::optional<SteadyClockTimePoint> Message::deadline() const
+  {
+    qi::int64_t timeLeft = 0;
+    if (!(flags() & TypeFlag_Deadline) || _buffer.size() < sizeof(timeLeft))
+      return {};
+    _buffer.read(&timeLeft, _buffer.size() - sizeof(timeLeft), sizeof(timeLeft));
+    return SteadyClock::now() + MicroSeconds(timeLeft);
+  }
+
+  namespace
+  {
+    /// Type in which to decode a value of the signature. With views, the
+    /// strings that are members of unnamed tuples are decoded as StringView.
+    /// Named tuples are structures, whose registered type is kept.
+    TypeInterface* typeFromSignature(const Signature& signature,
+                                     Message::StringDecoding strings)
+    {
+      if (strings == Message::StringDecoding::Copy
+          || signature.type() != Signature::Type_Tuple
+          || !signature.annotation().empty())
+        return TypeInterface::fromSignature(signature);
+
+      std::vector<TypeInterface*> memberTypes;
+      bool hasView = false;
+      for (const auto& member : signature.children())
+      {
+        TypeInterface* memberType = member.type() == Signature::Type_String
+            ? typeOf<StringView>()
+            : typeFromSignature(member, strings);
+        if (!memberType)
+          return nullptr;
+        hasView = hasView || memberType != TypeInterface::fromSignature(member);
+        memberTypes.push_back(memberType);
+      }
+      return hasView ? makeTupleType(memberTypes) : TypeInterface::fromSignature(signature);
+    }
+  }
+
   AnyValue Message::value(const qi::Signature& signature,
-                              const qi::MessageSocketPtr& socket) const
+                          const qi::MessageSocketPtr& socket,
+                          StringDecoding strings) const
   {
-    qi::TypeInterface* type = qi::TypeInterface::fromSignature(signature);
+    qi::TypeInterface* type = typeFromSignature(signature, strings);
     if (!type) {
       qiLogError() <<"fromBuffer: unknown type " << signature.toString();
       throw std::runtime_error("Could not construct type for " + signature.toString());
@@ -15,11 +15,15 @@
 #include <qi/binarycodec.hpp>
 #include <qi/anyfunction.hpp>
 #include <qi/types.hpp>
+#include <qi/clock.hpp>
+#include <qi/calloptions.hpp>
 #include <ka/macroregular.hpp>
 #include <qi/assert.hpp>
 #include <qi/messaging/messagesocket_fwd.hpp>
 #include <ka/scoped.hpp>
 #include <boost/weak_ptr.hpp>
+#include <boost/optional.hpp>
+#include <vector>
 
 namespace qi {
 
@@ -80,6 +84,9 @@ namespace qi {
       BoundObjectFunction_SetProperty       = 6,
       BoundObjectFunction_Properties        = 7,
       BoundObjectFunction_RegisterEventWithSignature = 8,
+      BoundObjectFunction_CallBatch         = 9,
+      BoundObjectFunction_RegisterEventWithPolicy = 10,
+      BoundObjectFunction_MetaObjectFingerprint = 11,
     };
 
     enum ServerFunction
@@ -129,6 +136,40 @@ namespace qi {
      * NOT IMPLEMENTED
      */
     static const unsigned int TypeFlag_ReturnType = 2;
+    /* If flag is set on a call, the payload ends with the time left before the
+     * deadline of the call when it was sent, in microseconds (int64).
+     * Only sent to remote ends with the CallDeadline capability.
+     */
+    static const unsigned int TypeFlag_Deadline = 4;
+    /* If one of these flags is set on a call, the remote end gives the matching
+     * priority class to the reply (see `Priority`), and to the calls it makes
+     * while executing it. Only sent to remote ends with the CallPriority
+     * capability.
+     */
+    static const unsigned int TypeFlag_ControlPriority = 8;
+    static const unsigned int TypeFlag_BulkPriority = 16;
+
+    /// Priority class of a message in the send queue of a socket. A message
+    /// is sent before the queued messages of the lower classes (the lower the
+    /// value, the higher the class).
+    enum class Priority
+    {
+      Control = 0,
+      Normal  = 1,
+      Bulk    = 2,
+    };
+    static const std::size_t priorityCount = 3;
+
+    /// Priority class of the messages of a call of the given priority.
+    static Priority priorityOf(CallPriority priority)
+    {
+      switch (priority)
+      {
+      case CallPriority::High: return Priority::Control;
+      case CallPriority::Low: return Priority::Bulk;
+      default: return Priority::Normal;
+      }
+    }
 
     struct Header
     {
@@ -282,6 +323,59 @@ namespace qi {
       return _buffer;
     }
 
+    /// Overrides the priority class the socket gives to the message from its
+    /// type. The priority is local to the sending process: it is not sent.
+    void setPriority(Priority priority)
+    {
+      _priority = priority;
+    }
+
+    boost::optional<Priority> priority() const
+    {
+      return _priority;
+    }
+
+    /// Sets the priority of a call, and the TypeFlag_*Priority flag so that
+    /// the remote end gives it to the reply.
+    QI_API void setCallPriority(CallPriority priority);
+
+    /// Returns the priority given to a call by its TypeFlag_*Priority flags, if
+    /// any.
+    QI_API boost::optional<CallPriority> callPriority() const;
+
+    /// Marks an event as replaceable: while it waits in the send queue of a
+    /// socket, it is replaced by a newer conflatable event of the same signal.
+    /// Local to the sending process: it is not sent.
+    void setConflatable(bool conflatable)
+    {
+      _conflatable = conflatable;
+    }
+
+    bool conflatable() const
+    {
+      return _conflatable;
+    }
+
+    /// Uids of the MetaObjects transmitted in full by the payload, that the
+    /// socket marks as known by the other end once the message is written.
+    /// Local to the sending process: it is not sent.
+    const std::vector<unsigned int>& transmittedMetaObjects() const
+    {
+      return _transmittedMetaObjects;
+    }
+
+    /// Names of the shared memory segments exported by the payload, that the
+    /// other end removes when it receives the message.
+    /// Local to the sending process: it is not sent.
+    const std::vector<std::string>& sharedMemorySegments() const
+    {
+      return _sharedMemorySegments;
+    }
+
+    /// Removes the shared memory segments exported by the payload. To be
+    /// called when the message is not going to be written.
+    void unlinkSharedMemorySegments() const;
+
     Buffer extractBuffer()
     {
       Buffer extracted = std::move(_buffer);
@@ -295,6 +389,9 @@ namespace qi {
 
       // Clear the buffer before setting an error.
       _buffer.clear();
+      _transmittedMetaObjects.clear();
+      unlinkSharedMemorySegments();
+      _sharedMemorySegments.clear();
       _header.size = static_cast<qi::uint32_t>(_buffer.totalSize());
 
       // Error message is of type m (dynamic)
@@ -302,8 +399,28 @@ namespace qi {
       setValue(AnyReference::from(v), "m");
     }
 
+    /// Appends the time left before the deadline to the payload, and sets the
+    /// TypeFlag_Deadline flag. Must be called once the payload is complete.
+    QI_API void setDeadline(SteadyClockTimePoint deadline);
+
+    /// Returns the deadline of the call, relative to the steady clock of this
+    /// process, if the message carries one. The time spent in transit is not
+    /// accounted for.
+    QI_API boost::optional<SteadyClockTimePoint> deadline() const;
+
+    /// How value() decodes strings.
+    enum class StringDecoding
+    {
+      /// As std::string, copying their characters.
+      Copy,
+      /// As StringView, slices of the payload, for the strings that are
+      /// members of unnamed tuples such as argument packs.
+      View,
+    };
+
     ///@return signature, set by setParameters() or setSignature()
-    QI_API AnyValue value(const Signature &signature, const qi::MessageSocketPtr &socket) const;
+    QI_API AnyValue value(const Signature &signature, const qi::MessageSocketPtr &socket,
+                          StringDecoding strings = StringDecoding::Copy) const;
 
     QI_API void setValue(const AutoAnyReference& value,
                   const Signature& signature,
@@ -336,15 +453,14 @@ namespace qi {
     Buffer _buffer;
     std::string signature;
     Header _header;
+    boost::optional<Priority> _priority;
+    bool _conflatable = false;
+    std::vector<unsigned int> _transmittedMetaObjects;
+    std::vector<std::string> _sharedMemorySegments;
 
     void encodeBinary(const qi::AutoAnyReference& ref,
                       SerializeObjectCallback onObject,
-                      MessageSocketPtr socket)
-    {
-      auto updateHeaderSize =
-          ka::scoped([&] { _header.size = static_cast<qi::uint32_t>(_buffer.totalSize()); });
-      qi::encodeBinary(&_buffer, ref, onObject, socket);
-    }
+                      MessageSocketPtr socket);
   };
 
   inline std::ostream& operator<<(std::ostream& os, const qi::MessageAddress &address)
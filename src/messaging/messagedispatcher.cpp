@@ -3,7 +3,9 @@
 **  See COPYING for the license
 */
 #include "messagedispatcher.hpp"
+#include <algorithm>
 #include <ka/errorhandling.hpp>
+#include <ka/scoped.hpp>
 
 static const auto logCategory = "qimessaging.messagedispatcher";
 qiLogCategory(logCategory);
@@ -16,24 +18,16 @@ qiLogCategory(logCategory);
 namespace qi
 {
 
-namespace
+MessageDispatcher::MessageDispatcher(ExecutionContext& execContext)
+  : _execContext{ execContext }
+  , _routes{ new Routes{} }
+  , _retiredRouteCount{ 0u }
 {
-
-  /// std::map || boost::flat_map M
-  template<typename M>
-  boost::optional<typename M::mapped_type> find(const M& map, const typename M::key_type& key)
-  {
-    const auto it = map.find(key);
-    if (it == map.end())
-      return {};
-    return it->second;
-  }
-
 }
 
-MessageDispatcher::MessageDispatcher(ExecutionContext& execContext)
-  : _execContext{ execContext }
+MessageDispatcher::~MessageDispatcher()
 {
+  delete _routes.load();
 }
 
 Future<bool> MessageDispatcher::dispatch(Message msg)
@@ -44,25 +38,86 @@ Future<bool> MessageDispatcher::dispatch(Message msg)
   const auto sharedMsg = std::make_shared<Message>(std::move(msg));
   return _execContext.async([=] {
     const auto& msg = *sharedMsg;
-    const auto handlers = find(_state->recipients, RecipientId{ msg.service(), msg.object() })
-                            .value_or(MessageHandlerList{});
+    const auto handlers = this->handlers(RecipientId{ msg.service(), msg.object() });
     QI_LOG_DEBUG_MSGDISPATCHER() << "Dispatching a message " << msg.address() << " to "
-                                 << handlers.size() << " handlers.";
-    return tryDispatch(handlers, msg);
+                                 << (handlers ? handlers->size() : 0u) << " handlers.";
+    return handlers && tryDispatch(*handlers, msg);
   });
 }
 
+MessageDispatcher::LookupCounter& MessageDispatcher::lookupCounter() const
+{
+  // Threads are spread over the counters in turn.
+  static std::atomic<std::size_t> nextIndex{ 0u };
+  static thread_local const std::size_t index = nextIndex++ % lookupCounterCount;
+  return _lookupCounters[index];
+}
+
+MessageDispatcher::MessageHandlerListPtr MessageDispatcher::handlers(RecipientId recipientId) const
+{
+  MessageHandlerListPtr result;
+  {
+    // Routes are only freed once no lookup that could have loaded them is in
+    // progress (see `reclaim`). The handlers are shared, so that they can be
+    // called after the lookup.
+    auto& counter = lookupCounter().count;
+    ++counter;
+    const auto _ = ka::scoped([&] { --counter; });
+    const auto& recipients = _routes.load()->recipients;
+    const auto it = recipients.find(recipientId);
+    if (it != recipients.end())
+      result = it->second;
+  }
+
+  // Lookups in progress during the last connection or disconnection may have
+  // prevented it from freeing the routes it replaced.
+  if (_retiredRouteCount.load(std::memory_order_relaxed) != 0u)
+  {
+    std::unique_lock<std::mutex> lock(_writeMutex, std::try_to_lock);
+    if (lock.owns_lock())
+      reclaim();
+  }
+  return result;
+}
+
+void MessageDispatcher::publish(std::unique_ptr<Routes> routes)
+{
+  // A lookup that starts after this point sees the new routes.
+  std::unique_ptr<const Routes> replaced{ _routes.exchange(routes.release()) };
+  _retiredRoutes.push_back(RetiredRoutes{ std::move(replaced), LookupCounterSet{}.set() });
+  reclaim();
+}
+
+void MessageDispatcher::reclaim() const
+{
+  LookupCounterSet idleCounters;
+  for (std::size_t i = 0u; i != lookupCounterCount; ++i)
+    idleCounters[i] = _lookupCounters[i].count.load() == 0u;
+
+  const auto end = std::remove_if(_retiredRoutes.begin(), _retiredRoutes.end(),
+                                  [&](RetiredRoutes& retired) {
+                                    retired.busyCounters &= ~idleCounters;
+                                    return retired.busyCounters.none();
+                                  });
+  _retiredRoutes.erase(end, _retiredRoutes.end());
+  _retiredRouteCount.store(_retiredRoutes.size(), std::memory_order_relaxed);
+}
+
 SignalLink MessageDispatcher::messagePendingConnect(unsigned int serviceId,
                                                     unsigned int objectId,
                                                     MessageHandler fun) noexcept
 {
-  auto state = _state.synchronize();
-  auto& handlers = state->recipients[RecipientId{ serviceId, objectId }];
-  const auto newSignalLinkId = state->nextSignalLink++;
+  std::lock_guard<std::mutex> lock(_writeMutex);
+  std::unique_ptr<Routes> routes{ new Routes(*_routes.load()) };
+  auto& handlersPtr = routes->recipients[RecipientId{ serviceId, objectId }];
+  auto handlers = handlersPtr ? *handlersPtr : MessageHandlerList{};
+  const auto newSignalLinkId = _nextSignalLink++;
   QI_LOG_DEBUG_MSGDISPATCHER() << "Connecting a handler (linkId=" << newSignalLinkId
                                << ") for message dispatch for service=" << serviceId
                                << ", object=" << objectId;
   handlers.emplace(newSignalLinkId, std::move(fun));
+  handlersPtr = std::make_shared<const MessageHandlerList>(std::move(handlers));
+  publish(std::move(routes));
   return newSignalLinkId;
 }
 
@@ -75,19 +130,24 @@ bool MessageDispatcher::messagePendingDisconnect(unsigned int serviceId,
   if (!isValidSignalLink(linkId))
     return true;
 
-  auto state = _state.synchronize();
-  const auto it = state->recipients.find(RecipientId{ serviceId, objectId });
-  if (it == state->recipients.end())
+  std::lock_guard<std::mutex> lock(_writeMutex);
+  const auto& current = _routes.load()->recipients;
+  const auto it = current.find(RecipientId{ serviceId, objectId });
+  if (it == current.end() || it->second->count(linkId) == 0u)
     return false;
 
   QI_LOG_DEBUG_MSGDISPATCHER()
     << "Disconnecting a handler (linkId=" << linkId
     << ") for message dispatch for service=" << serviceId << ", object=" << objectId;
-  auto& handlers = it->second;
-  const auto disconnectedCount = handlers.erase(linkId);
+  std::unique_ptr<Routes> routes{ new Routes(*_routes.load()) };
+  auto handlers = *it->second;
+  handlers.erase(linkId);
   if (handlers.empty())
-    state->recipients.erase(it);
-  return disconnectedCount == 1;
+    routes->recipients.erase(it->first);
+  else
+    routes->recipients[it->first] = std::make_shared<const MessageHandlerList>(std::move(handlers));
+  publish(std::move(routes));
+  return true;
 }
 
 bool MessageDispatcher::tryDispatch(const MessageHandlerList& handlers, const Message& msg)
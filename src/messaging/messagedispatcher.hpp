@@ -9,7 +9,12 @@
 
 #include <qi/anyobject.hpp>
 
-#include <boost/thread/synchronized_value.hpp>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include <boost/container/flat_map.hpp>
 
 #include "message.hpp"
@@ -26,7 +31,8 @@ namespace qi {
    * This class generate an error message for all pending message that have timed out.
    * at the moment it only generate message if the socket have been disconnected.
    *
-   * TODO: handle timeout on request taking too long to complete
+   * Calls taking too long to complete are handled by their deadline instead (see
+   * `CallOptions`): the remote object fails them locally when it passes.
    */
   class MessageDispatcher
   {
@@ -34,6 +40,10 @@ namespace qi {
     using MessageHandler = std::function<DispatchStatus (const Message&)>;
 
     MessageDispatcher(ExecutionContext& execContext);
+    ~MessageDispatcher();
+
+    MessageDispatcher(const MessageDispatcher&) = delete;
+    MessageDispatcher& operator=(const MessageDispatcher&) = delete;
 
     Future<bool> dispatch(Message msg);
 
@@ -58,19 +68,71 @@ namespace qi {
     ExecutionContext& _execContext;
 
     using MessageHandlerList = boost::container::flat_map<SignalLink, MessageHandler>;
-    using RecipientMessageHandlerMap = boost::container::flat_map<RecipientId, MessageHandlerList>;
+    using MessageHandlerListPtr = std::shared_ptr<const MessageHandlerList>;
+    using RecipientMessageHandlerMap = boost::container::flat_map<RecipientId, MessageHandlerListPtr>;
+
+    /// Returns the handlers connected for the recipient, or null if there are
+    /// none.
+    ///
+    /// It takes no lock, and can therefore be called from many threads at once
+    /// without contention.
+    MessageHandlerListPtr handlers(RecipientId recipientId) const;
 
-    // Mutable state of the object.
-    struct State
+  private:
+    /// Immutable routing table.
+    ///
+    /// Handlers are looked up in the current routes without lock. Connections
+    /// and disconnections publish a modified copy instead of changing them.
+    struct Routes
     {
       RecipientMessageHandlerMap recipients;
-      SignalLink nextSignalLink = 0;
     };
-    using SyncState =  boost::synchronized_value<State>;
-    SyncState _state;
 
-  private:
+    /// Makes the routes current, and frees the replaced ones as soon as no
+    /// lookup can be using them anymore.
+    /// Precondition: The write mutex is locked.
+    void publish(std::unique_ptr<Routes> routes);
+
+    /// Frees the replaced routes that no lookup can be using anymore.
+    /// Precondition: The write mutex is locked.
+    void reclaim() const;
+
     static bool tryDispatch(const MessageHandlerList& handlers, const Message& msg);
+
+    /// Counter of the lookups in progress in the threads that share it.
+    ///
+    /// Padded to its own cache line, so that the lookups of threads using
+    /// different counters do not contend.
+    struct LookupCounter
+    {
+      std::atomic<std::size_t> count{ 0u };
+      char padding[64 - sizeof(std::atomic<std::size_t>)];
+    };
+    static const std::size_t lookupCounterCount = 16u;
+    using LookupCounterSet = std::bitset<lookupCounterCount>;
+
+    /// Replaced routes, with the counters not yet seen at zero since they were
+    /// replaced. A counter at zero has no lookup that started before the
+    /// replacement, so the routes are freed once every counter has been.
+    struct RetiredRoutes
+    {
+      std::unique_ptr<const Routes> routes;
+      LookupCounterSet busyCounters;
+    };
+
+    /// Counter of the lookups of the calling thread.
+    LookupCounter& lookupCounter() const;
+
+    std::atomic<const Routes*> _routes;
+    mutable std::array<LookupCounter, lookupCounterCount> _lookupCounters;
+
+    // Serializes connections and disconnections, and the freeing of routes.
+    mutable std::mutex _writeMutex;
+    SignalLink _nextSignalLink = 0;
+    mutable std::vector<RetiredRoutes> _retiredRoutes;
+    /// Number of replaced routes not yet freed. Lookups free them when a
+    /// connection or a disconnection could not.
+    mutable std::atomic<std::size_t> _retiredRouteCount;
   };
 }
 
@@ -2,6 +2,7 @@
 #include <src/messaging/sock/option.hpp>
 #include "messagesocket.hpp"
 #include "tcpmessagesocket.hpp"
+#include "sock/networkasiolocal.hpp"
 
 // Disable "'this': used in base member initializer list"
 #include <ka/macro.hpp>
@@ -25,9 +26,36 @@ namespace qi
 
   MessageSocketPtr makeMessageSocket(const std::string &protocol, qi::EventLoop *eventLoop)
   {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    if (protocol == sock::localScheme())
+    {
+      return makeTcpMessageSocket<sock::NetworkAsioLocal>(protocol, eventLoop);
+    }
+#endif
+    if (sock::socketBackend() == sock::SocketBackend::Uring)
+    {
+      return makeTcpMessageSocket<sock::NetworkAsioUring,
+                                  sock::SocketWithContext<sock::NetworkAsio>>(protocol, eventLoop);
+    }
     return makeTcpMessageSocket(protocol, eventLoop);
   }
 
+  Future<void> sendQueuesNotFull(const std::vector<MessageSocketPtr>& sockets)
+  {
+    std::vector<Future<void>> notFull;
+    for (const auto& socket : sockets)
+    {
+      auto future = socket->sendQueueNotFull();
+      if (!future.isFinished())
+        notFull.push_back(std::move(future));
+    }
+    if (notFull.empty())
+      return futurize();
+    // A broken promise means that the queue is gone: it is not full anymore.
+    return waitForAll(notFull).async().andThen(FutureCallbackType_Sync,
+                                               [](const std::vector<Future<void>>&) {});
+  }
+
   MessageDispatchConnection::MessageDispatchConnection() noexcept = default;
 
   MessageDispatchConnection::MessageDispatchConnection(MessageSocketPtr socket,
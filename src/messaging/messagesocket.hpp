@@ -13,9 +13,12 @@
 # include <qi/signal.hpp>
 # include <qi/binarycodec.hpp>
 # include <qi/messaging/messagesocket_fwd.hpp>
+# include <qi/messaging/messagesocketstats.hpp>
 # include <string>
 # include "messagedispatcher.hpp"
 # include "streamcontext.hpp"
+# include "sock/networkeventloops.hpp"
+# include "sock/sendqueuemonitor.hpp"
 
 namespace qi {
   namespace detail {
@@ -84,6 +87,17 @@ namespace qi
 
     virtual qi::Url url() const = 0;
 
+    /// Messages waiting in the send queue.
+    virtual sock::SendQueueMonitor::Depth sendQueueDepth() const = 0;
+
+    /// Returns a future set when the send queue is no longer full, so that
+    /// producers can wait for it before sending more messages.
+    /// The watermarks are given by `sock::getSendQueueLimitsFromEnv`.
+    virtual Future<void> sendQueueNotFull() const = 0;
+
+    /// Traffic of the socket since its creation, across reconnections.
+    virtual MessageSocketStats stats() const = 0;
+
     bool isConnected() const;
 
     qi::SignalLink messagePendingConnect(unsigned int serviceId,
@@ -118,7 +132,12 @@ namespace qi
   };
 
   using MessageSocketWeakPtr = boost::weak_ptr<MessageSocket>;
-  MessageSocketPtr makeMessageSocket(const std::string &protocol, qi::EventLoop *eventLoop = getNetworkEventLoop());
+  MessageSocketPtr makeMessageSocket(const std::string &protocol,
+                                     qi::EventLoop *eventLoop = sock::pickNetworkEventLoop());
+
+  /// Returns a future set once none of the given sockets has a full send queue.
+  /// Sockets that are destroyed while full no longer count.
+  Future<void> sendQueuesNotFull(const std::vector<MessageSocketPtr>& sockets);
 
   /// A connection to the message dispatch of a socket that acts as a RAII helper to connect and
   /// disconnect the object as a message handler. Instances do not own their underlying socket.
@@ -0,0 +1,139 @@
+/*
+**  Copyright (C) 2012 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <ka/scoped.hpp>
+#include <ka/sha1.hpp>
+#include <qi/binarycodec.hpp>
+#include <qi/log.hpp>
+#include <qi/os.hpp>
+#include <qi/path.hpp>
+#include "metaobjectdiskcache.hpp"
+
+qiLogCategory("qimessaging.metaobjectdiskcache");
+
+namespace qi
+{
+  namespace
+  {
+    std::string fingerprintOf(const void* data, std::size_t size)
+    {
+      const auto begin = static_cast<const char*>(data);
+      const auto digest = ka::sha1(begin, begin + size);
+      return std::string(digest.begin(), digest.end());
+    }
+
+    // Service names are not all valid file names.
+    std::string fileName(const std::string& serviceName)
+    {
+      std::string name = serviceName;
+      std::replace_if(name.begin(), name.end(), [](char c) {
+        return !std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-' && c != '.';
+      }, '_');
+      return name + ".metaobject";
+    }
+
+    boost::filesystem::path fsPath(const std::string& path)
+    {
+      return boost::filesystem::path(path, qi::unicodeFacet());
+    }
+  }
+
+  MetaObjectDiskCache* MetaObjectDiskCache::instance()
+  {
+    static MetaObjectDiskCache* const cache = []() -> MetaObjectDiskCache* {
+      if (os::getenv("QIMESSAGING_METAOBJECT_DISK_CACHE") != "1")
+        return nullptr;
+      const auto directory = path::userWritableDataPath("qimessaging", "metaobjects/");
+      if (directory.empty())
+        return nullptr;
+      return new MetaObjectDiskCache(directory);
+    }();
+    return cache;
+  }
+
+  MetaObjectDiskCache::MetaObjectDiskCache(std::string directory)
+    : _directory(std::move(directory))
+  {
+  }
+
+  std::string MetaObjectDiskCache::path(const std::string& serviceName) const
+  {
+    return (fsPath(_directory) / fileName(serviceName)).string(qi::unicodeFacet());
+  }
+
+  boost::optional<MetaObjectDiskCache::Entry> MetaObjectDiskCache::load(
+    const std::string& serviceName) const
+  {
+    boost::filesystem::ifstream file(fsPath(path(serviceName)), std::ios::binary);
+    if (!file)
+      return {};
+    const std::string data{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+    if (data.empty())
+      return {};
+
+    try
+    {
+      Buffer buffer;
+      buffer.write(data.data(), data.size());
+      BufferReader reader(buffer);
+      Entry entry;
+      decodeBinary(&reader, &entry.metaObject);
+      // If the file is corrupted but still decodes, the fingerprint does not
+      // match the one of the service anymore.
+      entry.fingerprint = fingerprintOf(data.data(), data.size());
+      return entry;
+    }
+    catch (const std::exception& e)
+    {
+      qiLogVerbose() << "Ignoring the metaobject stored for service '" << serviceName
+                     << "': " << e.what();
+      return {};
+    }
+  }
+
+  void MetaObjectDiskCache::store(const std::string& serviceName, const MetaObject& metaObject) const
+  {
+    try
+    {
+      Buffer buffer;
+      encodeBinary(&buffer, AnyReference::from(metaObject));
+
+      boost::filesystem::create_directories(fsPath(_directory));
+      // Write to a temporary file and rename it, so that concurrent readers
+      // and writers never see a partial file.
+      const auto finalPath = fsPath(path(serviceName));
+      const auto tmpPath = boost::filesystem::unique_path(finalPath.string() + ".%%%%-%%%%");
+      auto removeTmp = ka::scoped([&] {
+        boost::system::error_code ec;
+        boost::filesystem::remove(tmpPath, ec);
+      });
+      {
+        boost::filesystem::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        file.write(static_cast<const char*>(buffer.data()),
+                   static_cast<std::streamsize>(buffer.size()));
+        if (!file)
+          throw std::runtime_error("cannot write " + tmpPath.string());
+      }
+      boost::filesystem::rename(tmpPath, finalPath);
+    }
+    catch (const std::exception& e)
+    {
+      qiLogWarning() << "Cannot store the metaobject of service '" << serviceName
+                     << "': " << e.what();
+    }
+  }
+
+  std::string MetaObjectDiskCache::fingerprint(const MetaObject& metaObject)
+  {
+    Buffer buffer;
+    encodeBinary(&buffer, AnyReference::from(metaObject));
+    return fingerprintOf(buffer.data(), buffer.size());
+  }
+}
@@ -0,0 +1,56 @@
+#pragma once
+/*
+**  Copyright (C) 2012 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+#ifndef _SRC_METAOBJECTDISKCACHE_HPP_
+#define _SRC_METAOBJECTDISKCACHE_HPP_
+
+#include <string>
+#include <boost/optional.hpp>
+#include <qi/type/metaobject.hpp>
+
+namespace qi
+{
+  /// Metaobjects of the services this process connected to, stored on disk
+  /// under the name of the service. A client connecting again to a service
+  /// only asks for the fingerprint of its metaobject, and uses the stored one
+  /// if it did not change.
+  ///
+  /// Thread-safe.
+  class MetaObjectDiskCache
+  {
+  public:
+    struct Entry
+    {
+      MetaObject metaObject;
+      std::string fingerprint;
+    };
+
+    /// Returns the cache of the process, or null if it is disabled, which is
+    /// the default. It is enabled by setting QIMESSAGING_METAOBJECT_DISK_CACHE
+    /// to 1, and stored in the "metaobjects" directory of the writable data
+    /// path of "qimessaging".
+    static MetaObjectDiskCache* instance();
+
+    explicit MetaObjectDiskCache(std::string directory);
+
+    /// Returns the metaobject stored for the service, if there is a valid one.
+    boost::optional<Entry> load(const std::string& serviceName) const;
+
+    /// Replaces the metaobject stored for the service. Failures are logged.
+    void store(const std::string& serviceName, const MetaObject& metaObject) const;
+
+    /// Digest of the binary encoding of the metaobject. Both ends of a
+    /// connection compute the same one for the same metaobject.
+    static std::string fingerprint(const MetaObject& metaObject);
+
+  private:
+    std::string path(const std::string& serviceName) const;
+
+    std::string _directory;
+  };
+}
+
+#endif  // _SRC_METAOBJECTDISKCACHE_HPP_
@@ -60,6 +60,8 @@ namespace qi {
     using Server::setIdentity;
     using Server::endpoints;
     using Server::addOutgoingSocket;
+    using Server::sockets;
+    using Server::socketStats;
 
   private:
     //0 on error
@@ -0,0 +1,124 @@
+#pragma once
+/*
+**  Copyright (C) 2012 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+#ifndef _SRC_PENDINGCALLS_HPP_
+#define _SRC_PENDINGCALLS_HPP_
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <boost/container/flat_map.hpp>
+#include <boost/optional.hpp>
+
+namespace qi
+{
+  /// Table of the calls waiting for a reply, keyed by the id of their message.
+  ///
+  /// The entries are spread over shards by id, each with its own lock, so that
+  /// concurrent calls and replies on the same remote object rarely contend.
+  /// Consecutive ids land in different shards.
+  ///
+  /// All methods can be called concurrently from any thread.
+  ///
+  /// Regular T (typically a promise)
+  template<typename T>
+  class PendingCalls
+  {
+  public:
+    using Id = unsigned int;
+    using Entry = std::pair<Id, T>;
+
+    static const std::size_t shardCount = 32u;
+
+    PendingCalls() = default;
+    PendingCalls(const PendingCalls&) = delete;
+    PendingCalls& operator=(const PendingCalls&) = delete;
+
+    /// Adds the entry, replacing any existing one with the same id.
+    /// Returns false if an entry was replaced.
+    bool set(Id id, T value)
+    {
+      auto& s = shard(id);
+      std::lock_guard<std::mutex> lock(s.mutex);
+      auto res = s.calls.insert(std::make_pair(id, value));
+      if (!res.second)
+        res.first->second = std::move(value);
+      return res.second;
+    }
+
+    /// Removes the entry and returns its value, if it exists.
+    boost::optional<T> take(Id id)
+    {
+      auto& s = shard(id);
+      std::lock_guard<std::mutex> lock(s.mutex);
+      auto it = s.calls.find(id);
+      if (it == s.calls.end())
+        return {};
+      boost::optional<T> value(std::move(it->second));
+      s.calls.erase(it);
+      return value;
+    }
+
+    /// Removes the entry. Returns false if it did not exist.
+    bool erase(Id id)
+    {
+      auto& s = shard(id);
+      std::lock_guard<std::mutex> lock(s.mutex);
+      return s.calls.erase(id) != 0u;
+    }
+
+    /// Removes all the entries and returns them, to fail them at once (when the
+    /// connection is lost for instance).
+    /// The shards are emptied one after the other: an entry added concurrently
+    /// is either returned or kept in the table.
+    std::vector<Entry> takeAll()
+    {
+      std::vector<Entry> entries;
+      for (auto& s : _shards)
+      {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        for (auto& call : s.calls)
+          entries.emplace_back(call.first, std::move(call.second));
+        s.calls.clear();
+      }
+      return entries;
+    }
+
+    std::size_t size() const
+    {
+      std::size_t n = 0u;
+      for (auto& s : _shards)
+      {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        n += s.calls.size();
+      }
+      return n;
+    }
+
+  private:
+    struct Shard
+    {
+      mutable std::mutex mutex;
+      boost::container::flat_map<Id, T> calls;
+      // Keeps the locks of neighbouring shards on different cache lines.
+      char padding[64];
+    };
+
+    Shard& shard(Id id)
+    {
+      return _shards[id % shardCount];
+    }
+
+    std::array<Shard, shardCount> _shards;
+  };
+
+  template<typename T>
+  const std::size_t PendingCalls<T>::shardCount;
+}
+
+#endif  // _SRC_PENDINGCALLS_HPP_
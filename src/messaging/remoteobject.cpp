@@ -11,10 +11,16 @@ KA_WARNING_DISABLE(4355, )
 #include "remoteobject_p.hpp"
 #include "message.hpp"
 #include "messagesocket.hpp"
+#include "metaobjectdiskcache.hpp"
+#include "sharedmemorybuffer.hpp"
+#include "eventthrottle.hpp"
 #include <src/type/signal_p.hpp>
 #include <qi/log.hpp>
 #include <boost/thread/mutex.hpp>
 #include <qi/eventloop.hpp>
+#include <qi/calloptions.hpp>
+#include <qi/os.hpp>
+#include <algorithm>
 
 qiLogCategory("qimessaging.remoteobject");
 
@@ -26,17 +32,23 @@ qiLogCategory("qimessaging.remoteobject");
 namespace qi {
 
 
+  // Special method of the bound objects that registers to an event with a delivery policy. The
+  // metaobject of the remote end has it if it supports delivery policies.
+  static const char* const registerEventWithPolicyMethod = "registerEventWithPolicy::(IILsdIb)";
+
   static qi::MetaObject createRemoteObjectSpecialMetaObject() {
     qi::MetaObjectBuilder mob;
     mob.addMethod("L", "registerEvent", "(IIL)", qi::Message::BoundObjectFunction_RegisterEvent);
     mob.addMethod("v", "unregisterEvent", "(IIL)", qi::Message::BoundObjectFunction_UnregisterEvent);
     mob.addMethod(typeOf<MetaObject>()->signature(), "metaObject", "(I)", qi::Message::BoundObjectFunction_MetaObject);
     mob.addMethod("L", "registerEventWithSignature", "(IILs)", qi::Message::BoundObjectFunction_RegisterEventWithSignature);
+    mob.addMethod("s", "metaObjectFingerprint", "(I)", qi::Message::BoundObjectFunction_MetaObjectFingerprint);
     const auto mo = mob.metaObject();
     QI_ASSERT(mo.methodId("registerEvent::(IIL)") == qi::Message::BoundObjectFunction_RegisterEvent);
     QI_ASSERT(mo.methodId("unregisterEvent::(IIL)") == qi::Message::BoundObjectFunction_UnregisterEvent);
     QI_ASSERT(mo.methodId("metaObject::(I)") == qi::Message::BoundObjectFunction_MetaObject);
     QI_ASSERT(mo.methodId("registerEventWithSignature::(IILs)") == qi::Message::BoundObjectFunction_RegisterEventWithSignature);
+    QI_ASSERT(mo.methodId("metaObjectFingerprint::(I)") == qi::Message::BoundObjectFunction_MetaObjectFingerprint);
     return mo;
   }
 
@@ -47,14 +59,115 @@ namespace qi {
     {
       throw std::runtime_error("the remote object instance has been destroyed.");
     }
+
+    // Late answers to calls that exceeded their deadline are expected. Only the
+    // last ones are remembered.
+    const std::size_t maxExpiredCallIds = 1024;
+
+    bool propertyCacheEnabledByDefault()
+    {
+      static const bool enabled = os::getenv("QIMESSAGING_REMOTE_PROPERTY_CACHE") == "1";
+      return enabled;
+    }
   }
 
+  struct LocalEventDelivery
+  {
+    LocalEventDelivery(SignalSubscriber subscriber, const EventDeliveryPolicy& policy)
+      : subscriber(std::move(subscriber))
+      , throttle(policy)
+    {}
+
+    using ParametersPtr = std::shared_ptr<GenericFunctionParameters>;
+
+    // Delivers an event to the subscriber, unless the policy holds it back.
+    static void deliver(const LocalEventDeliveryPtr& delivery,
+                        const GenericFunctionParameters& params)
+    {
+      if (!delivery->active)
+      {
+        delivery->subscriber.call(copy(params), MetaCallType_Auto);
+        return;
+      }
+      {
+        boost::mutex::scoped_lock lock(delivery->mutex);
+        switch (delivery->throttle.admit(SteadyClock::now()))
+        {
+          case EventThrottle::Admission::Drop:
+            return;
+          case EventThrottle::Admission::Defer:
+          {
+            delivery->deferred = copy(params);
+            if (!delivery->timerPending)
+            {
+              delivery->timerPending = true;
+              boost::weak_ptr<LocalEventDelivery> weakDelivery = delivery;
+              getEventLoop()->asyncAt([=] { deliverDeferred(weakDelivery); },
+                                      delivery->throttle.nextSendTime());
+            }
+            return;
+          }
+          case EventThrottle::Admission::Send:
+            // A deferred event is older than this one.
+            delivery->deferred.reset();
+            break;
+        }
+      }
+      delivery->subscriber.call(copy(params), MetaCallType_Auto);
+    }
+
+    // Delivers the deferred event once the maximum rate allows it.
+    static void deliverDeferred(boost::weak_ptr<LocalEventDelivery> weakDelivery)
+    {
+      const auto delivery = weakDelivery.lock();
+      if (!delivery) // The subscriber is gone.
+        return;
+      ParametersPtr params;
+      {
+        boost::mutex::scoped_lock lock(delivery->mutex);
+        const auto now = SteadyClock::now();
+        const auto sendTime = delivery->throttle.nextSendTime();
+        if (delivery->deferred && now < sendTime)
+        {
+          // An event was delivered since the timer was set.
+          getEventLoop()->asyncAt([=] { deliverDeferred(weakDelivery); }, sendTime);
+          return;
+        }
+        delivery->timerPending = false;
+        if (!delivery->deferred)
+          return;
+        delivery->throttle.sent(now);
+        params = std::move(delivery->deferred);
+      }
+      delivery->subscriber.call(params, MetaCallType_Auto);
+    }
+
+    // The subscriber may be called asynchronously, after the parameters of the emission died.
+    static ParametersPtr copy(const GenericFunctionParameters& params)
+    {
+      return ParametersPtr{ new auto(params.copy()), [](GenericFunctionParameters* p) {
+                              p->destroy();
+                              delete p;
+                            } };
+    }
+
+    SignalSubscriber subscriber;
+    // True if the remote registration does not apply the policy of the subscriber.
+    std::atomic<bool> active{ false };
+    boost::mutex mutex;
+    EventThrottle throttle;
+    // Latest event waiting for the maximum rate to allow its delivery.
+    ParametersPtr deferred;
+    bool timerPending = false;
+  };
+
   RemoteObject::RemoteObject(unsigned int service, unsigned int object, boost::optional<ObjectUid> uid)
     : ObjectHost(service)
     , _socket()
     , _service(service)
     , _object(object)
     , _self(makeDynamicAnyObject(this, false, uid))
+    , _propertyCacheEnabled(propertyCacheEnabledByDefault())
   {
     setUid(_self.uid()); // Make sure this object's uid and _self's uid are the same.
     // Simple metaObject with only special methods. (<100)
@@ -108,31 +221,82 @@ namespace qi {
     throw PointerLockException();
   }
 
-  void RemoteObject::onMetaObject(qi::Future<qi::MetaObject> fut, qi::Promise<void> prom) {
+  void RemoteObject::onMetaObject(qi::Future<qi::MetaObject> fut, qi::Promise<void> prom,
+                                  const std::string& serviceName) {
     if (fut.hasError()) {
       qiLogVerbose() << "MetaObject error: " << fut.error();
       prom.setError(fut.error());
       return;
     }
     qiLogVerbose() << "Fetched metaobject";
-    setMetaObject(fut.value());
+    const MetaObject mo = fut.value();
+    setMetaObject(mo);
     prom.setValue(0);
-  }
-
 
+    if (MetaObjectDiskCache* const diskCache =
+          serviceName.empty() ? nullptr : MetaObjectDiskCache::instance())
+    {
+      // Do not block the network on the disk.
+      qi::async([=] { diskCache->store(serviceName, mo); });
+    }
+  }
 
   //retrieve the metaObject from the network
-  qi::Future<void> RemoteObject::fetchMetaObject() {
+  qi::Future<void> RemoteObject::requestMetaObject(const std::string& serviceName) {
     qiLogVerbose() << "Requesting metaobject";
     qi::Promise<void> prom(qi::FutureCallbackType_Sync);
     qi::Future<qi::MetaObject> fut =
       _self.async<qi::MetaObject>("metaObject", 0U);
     fut.connect(trackWithFallback(&throwRemoteObjectDestroyedException,
-                                  boost::bind<void>(&RemoteObject::onMetaObject, this, _1, prom),
+                                  boost::bind<void>(&RemoteObject::onMetaObject, this, _1, prom, serviceName),
                                   weak_from_this()));
     return prom.future();
   }
 
+  qi::Future<void> RemoteObject::fetchMetaObject(const std::string& serviceName) {
+    MetaObjectDiskCache* const diskCache =
+      serviceName.empty() ? nullptr : MetaObjectDiskCache::instance();
+    if (!diskCache)
+      return requestMetaObject(serviceName);
+
+    // Reading the file must not block the network thread that may call us.
+    qi::Promise<void> prom(qi::FutureCallbackType_Sync);
+    qi::Future<boost::optional<MetaObjectDiskCache::Entry>> fut =
+      qi::async([=] { return diskCache->load(serviceName); });
+    fut.connect(trackWithFallback(&throwRemoteObjectDestroyedException,
+      [=](qi::Future<boost::optional<MetaObjectDiskCache::Entry>> cached) mutable {
+        if (cached.hasValue() && cached.value())
+          adaptFuture(requestMetaObjectIfChanged(serviceName, *cached.value()), prom);
+        else
+          adaptFuture(requestMetaObject(serviceName), prom);
+      },
+      weak_from_this()));
+    return prom.future();
+  }
+
+  qi::Future<void> RemoteObject::requestMetaObjectIfChanged(const std::string& serviceName,
+                                                            const MetaObjectDiskCache::Entry& cached) {
+    // The metaobject is only transferred if it changed since it was stored.
+    qiLogVerbose() << "Requesting metaobject fingerprint";
+    qi::Promise<void> prom(qi::FutureCallbackType_Sync);
+    qi::Future<std::string> fut =
+      _self.async<std::string>("metaObjectFingerprint", 0U);
+    fut.connect(trackWithFallback(&throwRemoteObjectDestroyedException,
+      [=](qi::Future<std::string> fingerprint) mutable {
+        if (fingerprint.hasValue() && fingerprint.value() == cached.fingerprint)
+        {
+          qiLogVerbose() << "Using the stored metaobject of service '" << serviceName << "'";
+          setMetaObject(cached.metaObject);
+          prom.setValue(0);
+          return;
+        }
+        // The service changed, or its end does not compute fingerprints.
+        adaptFuture(requestMetaObject(serviceName), prom);
+      },
+      weak_from_this()));
+    return prom.future();
+  }
+
   //should be done in the object thread
   DispatchStatus RemoteObject::onMessagePending(const qi::Message &msg)
   {
@@ -195,21 +359,25 @@ namespace qi {
     }
 
     qi::Promise<AnyReference> promise;
+    if (auto pending = _promises.take(msg.id()))
     {
-      auto syncPromises = _promises.synchronize();
-      auto it = syncPromises->find(msg.id());
-      if (it != syncPromises->end()) {
-        promise = (*syncPromises)[msg.id()];
-        syncPromises->erase(it);
-        QI_LOG_DEBUG_REMOTEOBJECT() << "Handling promise id:" << msg.id();
-      }
-      else
-      {
-        qiLogError() << "no promise found for req id:" << msg.id() << "  obj: " << msg.service()
-                     << "  func: " << msg.function()
-                     << "  type: " << msg.type();
-        return DispatchStatus::MessageHandled_WithError;
-      }
+      promise = std::move(*pending);
+      QI_LOG_DEBUG_REMOTEOBJECT() << "Handling promise id:" << msg.id();
+    }
+    else if (takeExpiredCall(msg.id()))
+    {
+      QI_LOG_DEBUG_REMOTEOBJECT() << "Dropping late answer to call " << msg.id()
+                                  << ", whose deadline was exceeded";
+      releaseSharedMemorySegments(msg, sock);
+      return DispatchStatus::MessageHandled;
+    }
+    else
+    {
+      qiLogError() << "no promise found for req id:" << msg.id() << "  obj: " << msg.service()
+                   << "  func: " << msg.function()
+                   << "  type: " << msg.type();
+      releaseSharedMemorySegments(msg, sock);
+      return DispatchStatus::MessageHandled_WithError;
     }
 
     switch (msg.type()) {
@@ -294,6 +462,12 @@ namespace qi {
       }
     }
 
+    // The deadline of the call being executed by this thread, if any, is
+    // forwarded to the remote end.
+    const auto deadline = currentCallDeadline();
+    if (deadline && SteadyClock::now() >= *deadline)
+      return makeFutureError<AnyReference>(callDeadlineExceededError);
+
     qi::Promise<AnyReference> out;
     qi::Message msg;
     MessageSocketPtr sock;
@@ -306,14 +480,12 @@ namespace qi {
       {
         return makeFutureError<AnyReference>("Socket is not connected");
       }
-      auto syncPromises = _promises.synchronize();
-      if (syncPromises->find(msg.id()) != syncPromises->end())
+      QI_LOG_DEBUG_REMOTEOBJECT() << "Adding promise of message response id:" << msg.id();
+      if (!_promises.set(msg.id(), out))
       {
         qiLogError() << "There is already a pending promise with id "
                                    << msg.id();
       }
-      QI_LOG_DEBUG_REMOTEOBJECT() << "Adding promise of message response id:" << msg.id();
-      (*syncPromises)[msg.id()] = out;
     }
     qi::Signature funcSig = mm->parametersSignature();
     try {
@@ -333,6 +505,16 @@ namespace qi {
       msg.addFlags(Message::TypeFlag_ReturnType);
       msg.setValue(returnSignature.toString(), Signature("s"));
     }
+    if (deadline && sock->sharedCapability<bool>(capabilityname::callDeadline, false))
+      msg.setDeadline(*deadline);
+    // So is its priority, that the reply inherits.
+    if (const auto priority = currentCallPriority())
+    {
+      if (sock->sharedCapability<bool>(capabilityname::callPriority, false))
+        msg.setCallPriority(*priority);
+      else
+        msg.setPriority(Message::priorityOf(*priority));
+    }
     msg.setType(qi::Message::Type_Call);
     msg.setService(_service);
     msg.setObject(_object);
@@ -340,6 +522,7 @@ namespace qi {
 
     //error will come back as a error message
     const auto msgId = msg.id();
+    const auto msgPriority = msg.priority();
     if (!sock->isConnected() || !sock->send(std::move(msg))) {
       qi::MetaMethod*   meth = metaObject().method(method);
       std::stringstream ss;
@@ -358,14 +541,61 @@ namespace qi {
       }
       out.setError(ss.str());
       QI_LOG_DEBUG_REMOTEOBJECT() << "Removing promise id:" << msgId;
-      _promises->erase(msgId);
+      _promises.erase(msgId);
     }
     else
-      out.setOnCancel(qi::bind(&RemoteObject::onFutureCancelled, this, msgId));
+    {
+      out.setOnCancel(qi::bind(&RemoteObject::onFutureCancelled, this, msgId, msgPriority));
+      if (deadline)
+      {
+        // Fail the call locally when its deadline passes, whether the remote end
+        // knows about it or not, and cancel it remotely so that it stops using
+        // resources there.
+        boost::weak_ptr<RemoteObject> weakSelf = shared_from_this();
+        auto timer = getEventLoop()->asyncAt([weakSelf, msgId, msgPriority] {
+          if (auto self = weakSelf.lock())
+          {
+            // Remembered first, so that a reply coming right after is not
+            // reported as unexpected.
+            self->callExpired(msgId);
+            if (auto promise = self->_promises.take(msgId))
+            {
+              qiLogDebug() << "Deadline of call " << msgId << " exceeded";
+              promise->setError(callDeadlineExceededError);
+              self->onFutureCancelled(msgId, msgPriority);
+            }
+            else
+            {
+              self->takeExpiredCall(msgId);
+            }
+          }
+        }, *deadline);
+        out.future().connect([timer](const Future<AnyReference>&) mutable { timer.cancel(); });
+      }
+    }
     return out.future();
   }
 
-  void RemoteObject::onFutureCancelled(unsigned int originalMessageId)
+  void RemoteObject::callExpired(unsigned int id)
+  {
+    auto ids = _expiredCallIds.synchronize();
+    if (ids->size() == maxExpiredCallIds)
+      ids->pop_front();
+    ids->push_back(id);
+  }
+
+  bool RemoteObject::takeExpiredCall(unsigned int id)
+  {
+    auto ids = _expiredCallIds.synchronize();
+    const auto it = std::find(ids->begin(), ids->end(), id);
+    if (it == ids->end())
+      return false;
+    ids->erase(it);
+    return true;
+  }
+
+  void RemoteObject::onFutureCancelled(unsigned int originalMessageId,
+                                       boost::optional<Message::Priority> priority)
   {
     QI_LOG_DEBUG_REMOTEOBJECT() << "Cancel request for message " << originalMessageId;
     MessageSocketPtr sock = *_socket;
@@ -386,9 +616,37 @@ namespace qi {
     cancelMessage.setType(Message::Type_Cancel);
     cancelMessage.setValue(AnyReference::from(originalMessageId), "I");
     cancelMessage.setObject(_object);
+    if (priority)
+      cancelMessage.setPriority(*priority);
     sock->send(std::move(cancelMessage));
   }
 
+  void RemoteObject::releaseSharedMemorySegments(const qi::Message& msg,
+                                                 const MessageSocketPtr& sock)
+  {
+    // The other end only exports buffers to an end that can import them.
+    if (!sock || !shm::canImport(*sock))
+      return;
+    Signature signature;
+    if (msg.type() == Message::Type_Error || (msg.flags() & Message::TypeFlag_DynamicPayload))
+      signature = "m";
+    else if (msg.type() == Message::Type_Reply)
+    {
+      if (MetaMethod* mm = metaObject().method(msg.function()))
+        signature = mm->returnSignature();
+    }
+    if (!signature.isValid())
+      return;
+    try
+    {
+      msg.value(signature, sock);
+    }
+    catch (const std::exception& e)
+    {
+      qiLogVerbose() << "Cannot decode discarded message " << msg.address() << ": " << e.what();
+    }
+  }
+
   void RemoteObject::metaPost(AnyObject, unsigned int event, const qi::GenericFunctionParameters &in)
   {
     // Bounce the emit request to server
@@ -445,8 +703,23 @@ namespace qi {
   {
     qi::Promise<SignalLink> prom(qi::FutureCallbackType_Sync);
 
+    // A subscriber that asked for a policy is bound through a delivery, which applies the policy
+    // when the remote registration cannot.
+    const auto policy = sub.deliveryPolicy();
+    LocalEventDeliveryPtr delivery;
+    SignalSubscriber local = sub;
+    if (policy)
+    {
+      delivery = boost::make_shared<LocalEventDelivery>(sub, *policy);
+      local = SignalSubscriber(AnyFunction::fromDynamicFunction(
+        [delivery](const GenericFunctionParameters& params) {
+          LocalEventDelivery::deliver(delivery, params);
+          return AnyReference();
+        }), MetaCallType_Direct);
+    }
+
     // Bind the subscriber locally.
-    SignalLink uid = DynamicObject::metaConnect(event, sub).value();
+    SignalLink uid = DynamicObject::metaConnect(event, local).value();
 
     boost::recursive_mutex::scoped_lock _lock(_localToRemoteSignalLinkMutex);
     // maintain a map of localsignal -> remotesignal
@@ -488,15 +761,42 @@ namespace qi {
       rsl.remoteSignalLink = uid;
       QI_LOG_DEBUG_REMOTEOBJECT() << "connect() to " << event << " gave " << uid
                                   << " (new remote connection)";
-      if (score >= 0.2)
-        rsl.future = _self.async<SignalLink>("registerEvent", _service, event, uid);
-      else // we might or might not be capable to convert, ask the remote end to try also
-        rsl.future =
-            _self.async<SignalLink>("registerEventWithSignature", _service, event, uid, subSignature.toString());
+      // we might or might not be capable to convert, ask the remote end to try also
+      rsl.forcedSignature = score >= 0.2 ? std::string() : subSignature.toString();
+      const bool remoteHasPolicies = metaObject().methodId(registerEventWithPolicyMethod) >= 0;
+      if (policy && !remoteHasPolicies)
+        qiLogVerbose() << "The remote end does not support event delivery policies, all the events of "
+                       << event << " will be transferred and the policy applied on this end";
+      if (remoteHasPolicies)
+        rsl.policy = policy;
+      rsl.future = registerRemoteEvent(event, uid, rsl.forcedSignature, rsl.policy);
     }
     else
     {
       QI_LOG_DEBUG_REMOTEOBJECT() << "connect() to " << event << " gave " << uid << " (reusing remote connection)";
+      // The events of the shared registration are delivered to all the local subscribers: a policy
+      // that one of them did not ask for would make it miss events. The policies are then applied
+      // on this end.
+      if (rsl.policy && policy != rsl.policy)
+      {
+        qiLogVerbose() << "Subscribers of " << event << " asked for different delivery policies, "
+                       << "all the events will be transferred and the policies applied on this end";
+        rsl.policy.reset();
+        for (const auto& localDelivery : rsl.localDeliveries)
+          localDelivery.second->active = true;
+        const auto remoteSignalLink = rsl.remoteSignalLink;
+        const auto forcedSignature = rsl.forcedSignature;
+        rsl.future = rsl.future.andThen(FutureCallbackType_Sync,
+          trackWithFallback(&throwRemoteObjectDestroyedException, [=](SignalLink) {
+            return registerRemoteEvent(event, remoteSignalLink, forcedSignature, {});
+          }, weak_from_this())).unwrap();
+      }
+    }
+
+    if (delivery)
+    {
+      delivery->active = policy != rsl.policy;
+      rsl.localDeliveries[uid] = delivery;
     }
 
     rsl.future.connect(trackWithFallback(&throwRemoteObjectDestroyedException,
@@ -505,6 +805,21 @@ namespace qi {
     return prom.future();
   }
 
+  qi::Future<SignalLink> RemoteObject::registerRemoteEvent(
+    unsigned int event, SignalLink remoteSignalLink, const std::string& forcedSignature,
+    const boost::optional<EventDeliveryPolicy>& policy)
+  {
+    // The remote end replaces the registration of a link that it already knows.
+    if (policy)
+      return _self.async<SignalLink>("registerEventWithPolicy", _service, event, remoteSignalLink,
+                                     forcedSignature, policy->maxRate, policy->decimation,
+                                     policy->conflate);
+    if (forcedSignature.empty())
+      return _self.async<SignalLink>("registerEvent", _service, event, remoteSignalLink);
+    return _self.async<SignalLink>("registerEventWithSignature", _service, event, remoteSignalLink,
+                                   forcedSignature);
+  }
+
   qi::Future<void> RemoteObject::metaDisconnect(SignalLink linkId)
   {
     // The invalid signal link is never connected, therefore the disconnection
@@ -541,6 +856,7 @@ namespace qi {
 
           if (vslit != rsl.localSignalLink.end()) {
             rsl.localSignalLink.erase(vslit);
+            rsl.localDeliveries.erase(linkId);
           } else {
             qiLogWarning() << "Cannot find " << linkId << " in the remote signal vector (event:" << event << ")";
           }
@@ -580,19 +896,25 @@ namespace qi {
         socket->disconnected.disconnectAsync(
           exchangeInvalidSignalLink(_linkDisconnected));
     }
-    std::map<int, qi::Promise<AnyReference> > promises;
-    {
-      auto syncPromises = _promises.synchronize();
-      promises = *syncPromises;
-      syncPromises->clear();
-    }
     // Nobody should be able to add anything to promises at this point.
+    auto promises = _promises.takeAll();
     for (auto& pair: promises)
     {
       qiLogVerbose() << "Reporting error for request " << pair.first << "(" << reason << ")";
       pair.second.setError(reason);
     }
 
+    // The cached values are not kept up to date anymore. The remote end dropped the
+    // subscriptions to the change signals with the socket, only the local ones remain.
+    const auto weakSelf = weak_from_this();
+    for (auto& link : takePropertyCache())
+    {
+      link.andThen([weakSelf](SignalLink linkId) {
+        if (auto self = weakSelf.lock())
+          self->DynamicObject::metaDisconnect(linkId);
+      });
+    }
+
     //@warning: remove connection are not removed
     //          not very important ATM, because RemoteObject
     //          cant be reconnected
@@ -600,15 +922,134 @@ namespace qi {
 
  qi::Future<AnyValue> RemoteObject::metaProperty(qi::AnyObject context, unsigned int id)
  {
-   QI_LOG_DEBUG_REMOTEOBJECT() << "bouncing property";
-   // FIXME: perform some validations on this end?
-   return _self.async<AnyValue>("property", id);
+   if (!_propertyCacheEnabled.load())
+   {
+     QI_LOG_DEBUG_REMOTEOBJECT() << "bouncing property";
+     // FIXME: perform some validations on this end?
+     return _self.async<AnyValue>("property", id);
+   }
+
+   const auto weakSelf = weak_from_this();
+   Future<AnyValue> value;
+   {
+     boost::mutex::scoped_lock lock(_propertyCacheMutex);
+     const auto it = _propertyCache.find(id);
+     if (it != _propertyCache.end())
+       return it->second.value;
+
+     QI_LOG_DEBUG_REMOTEOBJECT() << "caching property " << id;
+     // Subscribe to the changes before reading the value, so that none is missed.
+     SignalSubscriber onChange(AnyFunction::fromDynamicFunction(
+       [weakSelf, id](const GenericFunctionParameters& params) {
+         auto self = weakSelf.lock();
+         if (self && !params.empty())
+           self->onCachedPropertyChanged(id, AnyValue(params[0], true, true));
+         return AnyReference();
+       }));
+     CachedProperty cached;
+     cached.link = metaConnect(id, onChange);
+     cached.value = cached.link.andThen([weakSelf, id](SignalLink) {
+       auto self = weakSelf.lock();
+       if (!self)
+         throwRemoteObjectDestroyedException();
+       return self->_self.async<AnyValue>("property", id);
+     }).unwrap();
+     _propertyCache[id] = cached;
+     value = cached.value;
+   }
+
+   forgetFailedPropertyRead(id, value);
+   return value;
+ }
+
+ void RemoteObject::forgetFailedPropertyRead(unsigned int id, Future<AnyValue> value)
+ {
+   // Forget a failed read, so that the next one tries again.
+   const auto weakSelf = weak_from_this();
+   const auto readId = value.uniqueId();
+   value.then(FutureCallbackType_Sync, [weakSelf, id, readId](Future<AnyValue> read) {
+     if (!read.hasError())
+       return;
+     auto self = weakSelf.lock();
+     if (!self)
+       return;
+     Future<SignalLink> link;
+     {
+       boost::mutex::scoped_lock lock(self->_propertyCacheMutex);
+       const auto it = self->_propertyCache.find(id);
+       if (it == self->_propertyCache.end() || it->second.value.uniqueId() != readId)
+         return;
+       link = it->second.link;
+       self->_propertyCache.erase(it);
+     }
+     link.andThen([weakSelf](SignalLink linkId) {
+       if (auto self = weakSelf.lock())
+         self->metaDisconnect(linkId);
+     });
+   });
  }
 
  qi::Future<void> RemoteObject::metaSetProperty(qi::AnyObject context, unsigned int id, AnyValue val)
  {
    QI_LOG_DEBUG_REMOTEOBJECT() << "bouncing setProperty";
-   return _self.async<void>("setProperty", id, val);
+   auto setting = _self.async<void>("setProperty", id, val);
+   if (!_propertyCacheEnabled.load())
+     return setting;
+   // The remote end may store another value than the one set, or a newer one may be set
+   // concurrently: reads following the write ask for the value instead of assuming it, until a
+   // change event updates it.
+   const auto weakSelf = weak_from_this();
+   return setting.andThen(FutureCallbackType_Sync, [weakSelf, id](void*) {
+     if (auto self = weakSelf.lock())
+       self->invalidateCachedProperty(id);
+   });
+ }
+
+ void RemoteObject::invalidateCachedProperty(unsigned int id)
+ {
+   Future<AnyValue> value;
+   {
+     boost::mutex::scoped_lock lock(_propertyCacheMutex);
+     const auto it = _propertyCache.find(id);
+     if (it == _propertyCache.end())
+       return;
+     value = _self.async<AnyValue>("property", id);
+     it->second.value = value;
+   }
+   forgetFailedPropertyRead(id, value);
+ }
+
+ void RemoteObject::onCachedPropertyChanged(unsigned int id, AnyValue value)
+ {
+   boost::mutex::scoped_lock lock(_propertyCacheMutex);
+   const auto it = _propertyCache.find(id);
+   if (it != _propertyCache.end())
+     it->second.value = futurize(std::move(value));
+ }
+
+ void RemoteObject::setPropertyCacheEnabled(bool enabled)
+ {
+   _propertyCacheEnabled.store(enabled);
+   if (enabled)
+     return;
+   const auto weakSelf = weak_from_this();
+   for (auto& link : takePropertyCache())
+   {
+     link.andThen([weakSelf](SignalLink linkId) {
+       if (auto self = weakSelf.lock())
+         self->metaDisconnect(linkId);
+     });
+   }
+ }
+
+ std::vector<qi::Future<SignalLink>> RemoteObject::takePropertyCache()
+ {
+   std::vector<qi::Future<SignalLink>> links;
+   boost::mutex::scoped_lock lock(_propertyCacheMutex);
+   for (const auto& cached : _propertyCache)
+     links.push_back(cached.second.link);
+   _propertyCache.clear();
+   return links;
  }
 
 // we use different ranges for ids from RemoteObject and BoundObject to avoid collisions
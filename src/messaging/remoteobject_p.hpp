@@ -14,21 +14,38 @@
 #include <qi/messaging/messagesocket_fwd.hpp>
 
 #include "messagedispatcher.hpp"
+#include "metaobjectdiskcache.hpp"
 #include "objecthost.hpp"
+#include "pendingcalls.hpp"
 
+#include <atomic>
+#include <boost/container/flat_map.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/synchronized_value.hpp>
+#include <deque>
+#include <map>
 #include <string>
 
 namespace qi {
 
   class ServerClient;
 
+  // Delivery of the events of a remote signal to a local subscriber that asked for a policy.
+  struct LocalEventDelivery;
+  using LocalEventDeliveryPtr = boost::shared_ptr<LocalEventDelivery>;
+
   struct RemoteSignalLinks
   {
     std::vector<qi::SignalLink> localSignalLink;
     qi::SignalLink remoteSignalLink = SignalBase::invalidSignalLink;
     qi::Future<qi::SignalLink>  future;
+    // Signature the remote end converts the events to, if any.
+    std::string forcedSignature;
+    // Delivery policy of the remote registration. All the local subscribers asked for it.
+    boost::optional<qi::EventDeliveryPolicy> policy;
+    // Deliveries of the local subscribers that asked for a policy, by local link. A delivery
+    // applies the policy itself when the remote registration does not.
+    std::map<qi::SignalLink, LocalEventDeliveryPtr> localDeliveries;
   };
 
   class RemoteObject;
@@ -65,8 +82,10 @@ namespace qi {
 
     unsigned int nextId() override { return ++_nextId; }
 
-    //must be called to make the object valid.
-    qi::Future<void> fetchMetaObject();
+    /// Must be called to make the object valid. If the object is a service
+    /// and the disk cache of metaobjects is enabled, the metaobject stored for
+    /// the service is used if the remote end has the same one.
+    qi::Future<void> fetchMetaObject(const std::string& serviceName = std::string());
 
     void setTransportSocket(qi::MessageSocketPtr socket);
     // Set fromSignal if close is invoked from disconnect signal callback
@@ -89,16 +108,47 @@ namespace qi {
     qi::Future<AnyValue> metaProperty(qi::AnyObject context, unsigned int id) override;
     qi::Future<void> metaSetProperty(qi::AnyObject context, unsigned int id, AnyValue val) override;
 
+    /// Enables or disables the cache of properties.
+    ///
+    /// When enabled, the first read of a property subscribes to its change
+    /// signal, and the value is then kept locally: later reads are answered
+    /// without asking the remote object. The cache is dropped when the object
+    /// is closed or when it is disabled.
+    ///
+    /// Disabled by default, unless the environment variable
+    /// QIMESSAGING_REMOTE_PROPERTY_CACHE is set to 1.
+    void setPropertyCacheEnabled(bool enabled);
+    bool isPropertyCacheEnabled() const { return _propertyCacheEnabled.load(); }
+
   protected:
     //TransportSocket.messagePending
     DispatchStatus onMessagePending(const qi::Message &msg);
     //TransportSocket.disconnected
     void onSocketDisconnected(std::string error);
 
-    void onFutureCancelled(unsigned int originalMessageId);
+    // The cancellation takes the priority of the call, so that it does not
+    // overtake it in the send queue.
+    void onFutureCancelled(unsigned int originalMessageId,
+                           boost::optional<Message::Priority> priority = {});
+
+    // Decodes the payload of a reply nobody waits for, so that the shared
+    // memory segments it refers to are removed.
+    void releaseSharedMemorySegments(const qi::Message& msg, const MessageSocketPtr& sock);
+
+    // Registers the remote link of an event, or replaces its registration.
+    qi::Future<SignalLink> registerRemoteEvent(unsigned int event, SignalLink remoteSignalLink,
+                                               const std::string& forcedSignature,
+                                               const boost::optional<EventDeliveryPolicy>& policy);
+
+    qi::Future<void> requestMetaObject(const std::string& serviceName);
+    // Only requests the metaobject if the fingerprint of the remote one
+    // differs from the stored one.
+    qi::Future<void> requestMetaObjectIfChanged(const std::string& serviceName,
+                                                const MetaObjectDiskCache::Entry& cached);
 
     //metaObject received
-    void onMetaObject(qi::Future<qi::MetaObject> fut, qi::Promise<void> prom);
+    void onMetaObject(qi::Future<qi::MetaObject> fut, qi::Promise<void> prom,
+                      const std::string& serviceName);
 
   protected:
     using LocalToRemoteSignalLinkMap = std::map<qi::uint64_t, RemoteSignalLinks>;
@@ -106,13 +156,37 @@ namespace qi {
     boost::synchronized_value<MessageSocketPtr>   _socket;
     unsigned int                                    _service;
     unsigned int                                    _object;
-    boost::synchronized_value<std::map<int, qi::Promise<AnyReference>>> _promises;
+    PendingCalls<qi::Promise<AnyReference>>         _promises;
+    // Ids of the last calls that exceeded their deadline, whose reply may still
+    // come.
+    boost::synchronized_value<std::deque<unsigned int>> _expiredCallIds;
+    void callExpired(unsigned int id);
+    bool takeExpiredCall(unsigned int id);
     qi::SignalLink _linkMessageDispatcher = SignalBase::invalidSignalLink;
     qi::SignalLink _linkDisconnected = SignalBase::invalidSignalLink;
     qi::AnyObject                                   _self;
     boost::recursive_mutex                          _localToRemoteSignalLinkMutex;
     LocalToRemoteSignalLinkMap                      _localToRemoteSignalLink;
 
+    struct CachedProperty
+    {
+      // Latest value, or its first read.
+      qi::Future<AnyValue> value;
+      // Subscription to the change signal.
+      qi::Future<SignalLink> link;
+    };
+    // Empties the cache and returns the subscriptions to the change signals.
+    std::vector<qi::Future<SignalLink>> takePropertyCache();
+    void onCachedPropertyChanged(unsigned int id, AnyValue value);
+    // Reads the value of a cached property again.
+    void invalidateCachedProperty(unsigned int id);
+    // Removes a cached property if its read fails, unless it was read again since.
+    void forgetFailedPropertyRead(unsigned int id, qi::Future<AnyValue> value);
+
+    std::atomic<bool>                               _propertyCacheEnabled;
+    boost::mutex                                    _propertyCacheMutex;
+    boost::container::flat_map<unsigned int, CachedProperty> _propertyCache;
+
   private:
     static qi::Atomic<unsigned int> _nextId;
   };
@@ -594,6 +594,30 @@ namespace qi
     });
   }
 
+  Future<std::vector<MessageSocketPtr>> Server::sockets() const
+  {
+    return safeCall([=] {
+      std::vector<MessageSocketPtr> sockets;
+      for (const auto& socketInfo : _state.binder.socketsInfo())
+      {
+        if (auto socket = socketInfo->socket())
+          sockets.push_back(std::move(socket));
+      }
+      return sockets;
+    });
+  }
+
+  Future<std::vector<MessageSocketStats>> Server::socketStats() const
+  {
+    return sockets().andThen([](const std::vector<MessageSocketPtr>& sockets) {
+      std::vector<MessageSocketStats> stats;
+      stats.reserve(sockets.size());
+      for (const auto& socket : sockets)
+        stats.push_back(socket->stats());
+      return stats;
+    });
+  }
+
   Future<bool> Server::open()
   {
     boost::shared_ptr<Strand> empty;
@@ -259,6 +259,12 @@ namespace qi
     /// @see `TransportServer::endpoints`
     Future<UrlVector> endpoints() const;
 
+    /// @returns The incoming and outgoing sockets of the server.
+    Future<std::vector<MessageSocketPtr>> sockets() const;
+
+    /// @returns The traffic of the sockets of the server.
+    Future<std::vector<MessageSocketStats>> socketStats() const;
+
     Future<void> setAuthProviderFactory(AuthProviderFactoryPtr factory);
 
   private:
@@ -494,6 +494,48 @@ namespace qi {
     return cancelOnTimeout(waitForServiceImpl(servicename).async(), timeout);
   }
 
+  namespace
+  {
+    /// The sockets connected to the service directory and to services, and
+    /// the ones of the clients connected to the services of the session.
+    Future<std::vector<MessageSocketPtr>> sessionSockets(SessionPrivate& session)
+    {
+      auto sockets = session._socketsCache.sockets();
+      if (auto sdSocket = session._sdClient.socket())
+        sockets.push_back(std::move(sdSocket));
+      return session._serverObject.sockets().then(
+        [sockets](Future<std::vector<MessageSocketPtr>> serverSockets) mutable {
+          // The server is closed if the session does not listen.
+          if (serverSockets.hasValue())
+            sockets.insert(sockets.end(), serverSockets.value().begin(), serverSockets.value().end());
+          // Outgoing sockets are also given to the server.
+          std::sort(sockets.begin(), sockets.end());
+          sockets.erase(std::unique(sockets.begin(), sockets.end()), sockets.end());
+          return sockets;
+        });
+    }
+  } // anonymous namespace
+
+  qi::FutureSync<std::vector<MessageSocketStats>> Session::socketStats() const
+  {
+    return sessionSockets(*_p).andThen(FutureCallbackType_Sync,
+      [](const std::vector<MessageSocketPtr>& sockets) {
+        std::vector<MessageSocketStats> stats;
+        stats.reserve(sockets.size());
+        for (const auto& socket : sockets)
+          stats.push_back(socket->stats());
+        return stats;
+      });
+  }
+
+  qi::FutureSync<void> Session::sendQueuesNotFull() const
+  {
+    return sessionSockets(*_p).andThen(FutureCallbackType_Sync,
+      [](const std::vector<MessageSocketPtr>& sockets) {
+        return qi::sendQueuesNotFull(sockets);
+      }).unwrap();
+  }
+
   qi::FutureSync<void> Session::waitForServiceImpl(const std::string& servicename)
   {
     qi::Promise<void> promise(
@@ -219,7 +219,7 @@ namespace qi {
         sr->remoteObject = remoteObject;
 
         // TODO 40203: check if it's possible that the following future is never set.
-        metaObjFut = remoteObject->fetchMetaObject();
+        metaObjFut = remoteObject->fetchMetaObject(sr->serviceInfo.name());
 
         qiLogVerbose() << "Fetching metaobject (1) for requestId = " << requestId;
         metaObjFut.connect(track(
@@ -258,7 +258,7 @@ namespace qi {
       sr->remoteObject = remoteObject;
 
       //ask the remoteObject to fetch the metaObject
-      metaObjFut = remoteObject->fetchMetaObject();
+      metaObjFut = remoteObject->fetchMetaObject(sr->serviceInfo.name());
       qiLogVerbose() << "Fetching metaobject (2) for requestId = " << requestId;
       metaObjFut.connect(track(
         boost::bind(
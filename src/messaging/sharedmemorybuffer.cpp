@@ -0,0 +1,278 @@
+/*
+**  Copyright (C) 2012 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <boost/predef.h>
+#include <boost/shared_ptr.hpp>
+#include <ka/scoped.hpp>
+#include <qi/log.hpp>
+#include <qi/macro.hpp>
+#include <qi/os.hpp>
+#include "src/buffer_p.hpp"
+#include "streamcontext.hpp"
+#include "sharedmemorybuffer.hpp"
+
+#if BOOST_OS_UNIX && !BOOST_OS_ANDROID
+# define QI_HAS_SHARED_MEMORY_BUFFERS 1
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#else
+# define QI_HAS_SHARED_MEMORY_BUFFERS 0
+#endif
+
+qiLogCategory("qimessaging.sharedmemorybuffer");
+
+namespace qi
+{
+  namespace shm
+  {
+    namespace
+    {
+      // Kept short: some systems limit segment names to 31 characters.
+      const char segmentNamePrefix[] = "/qi.";
+      const std::size_t defaultMinBufferSize = 256 * 1024;
+
+      bool isSegmentName(const std::string& name)
+      {
+        return name.size() > sizeof(segmentNamePrefix) - 1
+            && name.size() < 32
+            && name.compare(0, sizeof(segmentNamePrefix) - 1, segmentNamePrefix) == 0
+            && name.find('/', 1) == std::string::npos;
+      }
+
+#if QI_HAS_SHARED_MEMORY_BUFFERS
+      // Names are unique in the process thanks to the counter, and between
+      // processes thanks to the pid. The random part prevents from guessing them.
+      std::string makeSegmentName()
+      {
+        static std::atomic<unsigned> counter{0u};
+        static const unsigned salt = std::random_device{}();
+        char name[32];
+        std::snprintf(name, sizeof(name), "%s%x.%x.%x", segmentNamePrefix,
+                      static_cast<unsigned>(os::getpid()), counter++, salt);
+        return name;
+      }
+
+      // An empty segment, removed when the process exits normally.
+      struct ProbeSegment
+      {
+        ProbeSegment()
+        {
+          const auto candidate = makeSegmentName();
+          // Segments are created readable by their owner only, so opening the
+          // probe also checks that the other end can open our segments.
+          const int fd = ::shm_open(candidate.c_str(), O_CREAT | O_EXCL | O_RDONLY, S_IRUSR | S_IWUSR);
+          if (fd == -1)
+          {
+            qiLogVerbose() << "Cannot create probe segment " << candidate << ": "
+                           << std::strerror(errno);
+            return;
+          }
+          ::close(fd);
+          name = candidate;
+        }
+
+        ~ProbeSegment()
+        {
+          if (name)
+            ::shm_unlink(name->c_str());
+        }
+
+        boost::optional<std::string> name;
+      };
+#endif
+
+      // Returns the value of a string capability, if it is set.
+      template<typename Capability>
+      boost::optional<std::string> stringCapability(const Capability& capability)
+      {
+        if (!capability)
+          return {};
+        try
+        {
+          auto value = capability->template to<std::string>();
+          if (value.empty())
+            return {};
+          return value;
+        }
+        catch (const std::exception& e)
+        {
+          qiLogDebug() << "Invalid capability value: " << e.what();
+          return {};
+        }
+      }
+    } // anonymous namespace
+
+    boost::optional<std::string> probeSegmentName()
+    {
+#if QI_HAS_SHARED_MEMORY_BUFFERS
+      static const ProbeSegment probe;
+      return probe.name;
+#else
+      return {};
+#endif
+    }
+
+    boost::optional<std::string> acceptRemoteProbe(StreamContext& ctx)
+    {
+#if QI_HAS_SHARED_MEMORY_BUFFERS
+      if (!probeSegmentName())
+        return {};
+      const auto probe =
+          stringCapability(ctx.remoteCapability(capabilityname::sharedMemoryBuffers));
+      if (!probe || !isSegmentName(*probe))
+        return {};
+      if (stringCapability(ctx.localCapability(capabilityname::sharedMemoryBuffersAccepted))
+          == probe)
+        return {};
+      const int fd = ::shm_open(probe->c_str(), O_RDONLY, 0);
+      if (fd == -1)
+      {
+        qiLogVerbose() << "Cannot open probe segment " << *probe << " of the other end: "
+                       << std::strerror(errno) << ", buffers are sent on the stream";
+        return {};
+      }
+      ::close(fd);
+      ctx.advertiseCapability(capabilityname::sharedMemoryBuffersAccepted, AnyValue::from(*probe));
+      return probe;
+#else
+      QI_IGNORE_UNUSED(ctx);
+      return {};
+#endif
+    }
+
+    bool isEnabled(const StreamContext& ctx)
+    {
+      const auto probe = stringCapability(ctx.localCapability(capabilityname::sharedMemoryBuffers));
+      return probe
+          && probe == stringCapability(
+                          ctx.remoteCapability(capabilityname::sharedMemoryBuffersAccepted));
+    }
+
+    bool canImport(const StreamContext& ctx)
+    {
+      const auto accepted =
+          stringCapability(ctx.localCapability(capabilityname::sharedMemoryBuffersAccepted));
+      return accepted
+          && accepted == stringCapability(
+                             ctx.remoteCapability(capabilityname::sharedMemoryBuffers));
+    }
+
+    std::size_t minBufferSize()
+    {
+      static const auto size = [] {
+        const auto value = os::getenv("QI_SHARED_MEMORY_BUFFER_MIN_SIZE");
+        if (value.empty())
+          return defaultMinBufferSize;
+        return std::max<std::size_t>(std::strtoul(value.c_str(), 0, 0), 1u);
+      }();
+      return size;
+    }
+
+    boost::optional<std::string> exportBuffer(const Buffer& buffer)
+    {
+#if QI_HAS_SHARED_MEMORY_BUFFERS
+      const auto size = buffer.size();
+      const auto name = makeSegmentName();
+      const int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+      if (fd == -1)
+      {
+        qiLogVerbose() << "Cannot create segment " << name << ": " << std::strerror(errno);
+        return {};
+      }
+      auto closeFd = ka::scoped([&] { ::close(fd); });
+
+      void* addr = MAP_FAILED;
+      if (::ftruncate(fd, static_cast<off_t>(size)) == 0)
+        addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (addr == MAP_FAILED)
+      {
+        qiLogVerbose() << "Cannot map segment " << name << " of size " << size << ": "
+                       << std::strerror(errno);
+        ::shm_unlink(name.c_str());
+        return {};
+      }
+      std::memcpy(addr, buffer.data(), size);
+      ::munmap(addr, size);
+      return name;
+#else
+      QI_IGNORE_UNUSED(buffer);
+      return {};
+#endif
+    }
+
+    boost::optional<Buffer> importBuffer(const std::string& name, std::size_t size)
+    {
+      if (!isSegmentName(name))
+      {
+        qiLogWarning() << "Refusing to open '" << name << "': not a segment name";
+        return {};
+      }
+#if QI_HAS_SHARED_MEMORY_BUFFERS
+      const int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+      if (fd == -1)
+      {
+        qiLogWarning() << "Cannot open segment " << name << ": " << std::strerror(errno);
+        return {};
+      }
+      // From now on, the segment is ours: it disappears with the mapping.
+      ::shm_unlink(name.c_str());
+      auto closeFd = ka::scoped([&] { ::close(fd); });
+
+      struct stat st;
+      if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < size)
+      {
+        qiLogWarning() << "Segment " << name << " is smaller than " << size << " bytes";
+        return {};
+      }
+      // A private mapping can be written to without affecting the segment,
+      // which a Buffer user is allowed to do.
+      void* addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+      if (addr == MAP_FAILED)
+      {
+        qiLogWarning() << "Cannot map segment " << name << ": " << std::strerror(errno);
+        return {};
+      }
+      boost::shared_ptr<void> mapping(addr, [=](void* p) { ::munmap(p, size); });
+      return makeBufferOnExternalMemory(static_cast<unsigned char*>(addr), size,
+                                        std::move(mapping));
+#else
+      QI_IGNORE_UNUSED(size);
+      return {};
+#endif
+    }
+
+    void unlinkSegment(const std::string& name)
+    {
+#if QI_HAS_SHARED_MEMORY_BUFFERS
+      ::shm_unlink(name.c_str());
+#else
+      QI_IGNORE_UNUSED(name);
+#endif
+    }
+
+    bool segmentExists(const std::string& name)
+    {
+#if QI_HAS_SHARED_MEMORY_BUFFERS
+      const int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+      if (fd == -1)
+        return errno != ENOENT;
+      ::close(fd);
+      return true;
+#else
+      QI_IGNORE_UNUSED(name);
+      return false;
+#endif
+    }
+  } // namespace shm
+} // namespace qi
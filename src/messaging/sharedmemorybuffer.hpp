@@ -0,0 +1,82 @@
+#pragma once
+/*
+**  Copyright (C) 2012 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+#ifndef _SRC_MESSAGING_SHAREDMEMORYBUFFER_HPP_
+#define _SRC_MESSAGING_SHAREDMEMORYBUFFER_HPP_
+
+#include <cstddef>
+#include <string>
+#include <boost/optional.hpp>
+#include <qi/buffer.hpp>
+
+/// @file
+/// Passing of big buffers between processes of the same machine through POSIX
+/// shared memory segments.
+///
+/// The sender copies the buffer in a new segment and only sends the segment
+/// name on the stream. The receiver maps the segment, removes its name (it now
+/// owns it) and uses the mapping as the storage of the received buffer: the
+/// bytes are neither written to nor read from the socket.
+///
+/// The feature is negotiated on each stream. Each end advertises the name of a
+/// probe segment through the `SharedMemoryBuffers` capability. When an end can
+/// open the probe of the other one, it advertises its name back through the
+/// `SharedMemoryBuffersAccepted` capability: the other end can then export
+/// segments on the stream. Sharing the machine is not enough, the processes
+/// may not share their /dev/shm (containers, for instance).
+
+namespace qi
+{
+  class StreamContext;
+
+  namespace shm
+  {
+    /// Name of the probe segment of the process, advertised for the
+    /// `SharedMemoryBuffers` capability. It is created on first call and
+    /// removed at exit.
+    /// Empty if shared memory segments are not supported on this platform or
+    /// if the probe could not be created.
+    boost::optional<std::string> probeSegmentName();
+
+    /// Opens the probe segment of the other end if it was advertised and not
+    /// accepted yet. On success, advertises its name for the
+    /// `SharedMemoryBuffersAccepted` capability and returns it, so that the
+    /// caller sends it to the other end.
+    boost::optional<std::string> acceptRemoteProbe(StreamContext& ctx);
+
+    /// True if buffers can be exported on the stream, that is if the other end
+    /// accepted our probe.
+    bool isEnabled(const StreamContext& ctx);
+
+    /// True if buffers exported by the other end can be imported, that is if
+    /// we accepted its probe.
+    bool canImport(const StreamContext& ctx);
+
+    /// Minimal size of a buffer passed through shared memory. Smaller ones are
+    /// cheaper to send on the stream.
+    /// Can be set with the environment variable QI_SHARED_MEMORY_BUFFER_MIN_SIZE.
+    std::size_t minBufferSize();
+
+    /// Copies the buffer in a new segment and returns the segment name.
+    /// Returns an empty value if the segment could not be created.
+    /// Precondition: buffer.subBuffers().empty()
+    boost::optional<std::string> exportBuffer(const Buffer& buffer);
+
+    /// Maps the segment and removes its name. The returned buffer uses the
+    /// mapping as storage, which is released with the last reference to it.
+    /// Returns an empty value if the name is not a segment name or if the
+    /// segment could not be mapped.
+    boost::optional<Buffer> importBuffer(const std::string& name, std::size_t size);
+
+    /// Removes the name of a segment. It is not an error if it does not exist.
+    void unlinkSegment(const std::string& name);
+
+    /// True if the name of the segment was not removed yet.
+    bool segmentExists(const std::string& name);
+  } // namespace shm
+} // namespace qi
+
+#endif // _SRC_MESSAGING_SHAREDMEMORYBUFFER_HPP_
@@ -2,6 +2,10 @@
 #ifndef _QI_SOCK_COMMON_HPP
 #define _QI_SOCK_COMMON_HPP
 #include <mutex>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <boost/predef.h>
 #include <boost/shared_ptr.hpp>
 #include <boost/optional.hpp>
 #include <ka/functional.hpp>
@@ -10,6 +14,7 @@
 #include <qi/trackable.hpp>
 #include <qi/future.hpp>
 #include <qi/url.hpp>
+#include <qi/os.hpp>
 #include "concept.hpp"
 #include "traits.hpp"
 #include "option.hpp"
@@ -22,10 +27,44 @@
 
 namespace qi { namespace sock {
 
+  /// The URL scheme of local (AF_UNIX) stream sockets.
+  inline const char* localScheme()
+  {
+    return "unix";
+  }
+
+  /// Name of the local socket designated by the URL `unix://localhost:port`.
+  ///
+  /// On Linux, an abstract socket name is used, so that no file is left behind.
+  /// Elsewhere, the socket is a file in the temporary directory.
+  inline std::string localEndpointName(unsigned short port)
+  {
+#if BOOST_OS_LINUX
+    return std::string(1, '\0') + "qimessaging-" + os::to_string(port);
+#else
+    return os::tmp() + "/qimessaging-" + os::to_string(port) + ".sock";
+#endif
+  }
+
+  /// The port of a local socket name produced by `localEndpointName`, if any.
+  inline boost::optional<unsigned short> localEndpointPort(const std::string& name)
+  {
+    static const std::string tag = "qimessaging-";
+    const auto pos = name.rfind(tag);
+    if (pos == std::string::npos)
+      return {};
+    const char* const begin = name.c_str() + pos + tag.size();
+    char* end = nullptr;
+    const auto port = std::strtoul(begin, &end, 10);
+    if (end == begin || port > std::numeric_limits<unsigned short>::max())
+      return {};
+    return static_cast<unsigned short>(port);
+  }
+
   /// The URL of the endpoint
   /// NetEndpoint E
   template<typename E>
-  Url url(const E& ep, SslEnabled ssl)
+  auto url(const E& ep, SslEnabled ssl) -> decltype(ep.address(), Url{})
   {
     return Url{
       ep.address().to_string(),
@@ -33,6 +72,15 @@ namespace qi { namespace sock {
       ep.port()};
   }
 
+  /// The URL of a local endpoint. Unnamed endpoints (typically the client side
+  /// of a connection) are given the port 0.
+  /// NetLocalEndpoint E
+  template<typename E>
+  auto url(const E& ep, SslEnabled) -> decltype(ep.path(), Url{})
+  {
+    return Url{"localhost", localScheme(), localEndpointPort(ep.path()).value_or(0)};
+  }
+
   /// A polymorphic transformation that takes a procedure and returns a
   /// "stranded" equivalent.
   ///
@@ -52,10 +100,27 @@ namespace qi { namespace sock {
     }
   };
 
+  namespace detail
+  {
+    /// Cancels the transfers a network does outside of the socket (see
+    /// `NetworkAsioUring`), if it does some.
+    template<typename N, typename S>
+    auto cancelTransfers(S& s, int) -> decltype(N::cancel_transfers(s))
+    {
+      return N::cancel_transfers(s);
+    }
+
+    template<typename N, typename S>
+    void cancelTransfers(S&, long)
+    {
+    }
+  } // namespace detail
+
   /// Gracefully closes the socket.
   ///
   /// Following the Asio documentation for a portable behavior, first shutdowns
-  /// the socket, then closes it.
+  /// the socket, then closes it. The transfers still pending are canceled
+  /// before it is closed.
   ///
   /// This function ignores errors, and is therefore reentrant.
   ///
@@ -70,6 +135,7 @@ namespace qi { namespace sock {
     {
       ErrorCode<N> erc;
       socket->lowest_layer().shutdown(ShutdownMode<Lowest<SslSocket<N>>>::shutdown_both, erc);
+      detail::cancelTransfers<N>(socket->lowest_layer(), 0);
       socket->lowest_layer().close(erc);
     }
   }
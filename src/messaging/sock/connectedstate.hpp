@@ -145,7 +145,9 @@ namespace qi
         ReceiveMessageContinuous<N> _receiveMsg;
         SendMessageEnqueue<N, SocketPtr<S>> _sendMsg;
 
-        Impl(const SocketPtr<S>& socket);
+        Impl(const SocketPtr<S>& socket, std::shared_ptr<ReceiveBufferPool> receiveBufferPool,
+             std::shared_ptr<SendWaitStats> sendWaitStats,
+             std::shared_ptr<SendQueueMonitor> sendQueueMonitor);
         ~Impl();
 
         template<typename Proc>
@@ -204,11 +206,18 @@ namespace qi
       std::shared_ptr<Impl> _impl;
     public:
       /// If `onReceive` returns `false`, this stops the message receiving.
+      /// If a pool is given, payloads are received in its blocks when possible.
+      /// If wait stats are given, the time spent by messages in the send queue
+      /// is recorded in them. If a monitor is given, it tracks the depth of the
+      /// send queue.
       ///
       /// Procedure<bool (ErrorCode<N>, const Message*)> Proc
       template<typename Proc>
       Connected(const SocketPtr<S>&, SslEnabled ssl, size_t maxPayload, const Proc& onReceive,
-        qi::int64_t messageHandlingTimeoutInMus = getSocketTimeWarnThresholdFromEnv().value_or(0));
+        qi::int64_t messageHandlingTimeoutInMus = getSocketTimeWarnThresholdFromEnv().value_or(0),
+        std::shared_ptr<ReceiveBufferPool> receiveBufferPool = {},
+        std::shared_ptr<SendWaitStats> sendWaitStats = {},
+        std::shared_ptr<SendQueueMonitor> sendQueueMonitor = {});
 
       /// If `onSent` returns false, the processing of enqueued messages stops.
       /// By default, we continue sending messages even if an error occurred.
@@ -242,18 +251,27 @@ namespace qi
     template<typename N, typename S>
     template<typename Proc>
     Connected<N, S>::Connected(const SocketPtr<S>& socket, SslEnabled ssl, size_t maxPayload,
-        const Proc& onReceive, qi::int64_t messageHandlingTimeoutInMus)
-      : _impl(std::make_shared<Impl>(socket))
+        const Proc& onReceive, qi::int64_t messageHandlingTimeoutInMus,
+        std::shared_ptr<ReceiveBufferPool> receiveBufferPool,
+        std::shared_ptr<SendWaitStats> sendWaitStats,
+        std::shared_ptr<SendQueueMonitor> sendQueueMonitor)
+      : _impl(std::make_shared<Impl>(socket, std::move(receiveBufferPool),
+                                     std::move(sendWaitStats), std::move(sendQueueMonitor)))
     {
       _impl->start(ssl, maxPayload, onReceive, messageHandlingTimeoutInMus);
     }
 
     template<typename N, typename S>
-    Connected<N, S>::Impl::Impl(const SocketPtr<S>& s)
+    Connected<N, S>::Impl::Impl(const SocketPtr<S>& s,
+        std::shared_ptr<ReceiveBufferPool> receiveBufferPool,
+        std::shared_ptr<SendWaitStats> sendWaitStats,
+        std::shared_ptr<SendQueueMonitor> sendQueueMonitor)
       : _result{ boost::make_shared<SyncConnectedResult<N, S>>(ConnectedResult<N, S>{ s }) }
       , _stopRequested(false)
       , _shuttingdown(false)
-      , _sendMsg{s}
+      , _receiveMsg{std::move(receiveBufferPool)}
+      , _sendMsg{s, getSendBatchLimitsFromEnv(), getSendPrioritiesFromEnv(),
+                 std::move(sendWaitStats), std::move(sendQueueMonitor)}
     {
     }
 
@@ -0,0 +1,196 @@
+#pragma once
+#ifndef _QI_SOCK_NETWORKASIOLOCAL_HPP
+#define _QI_SOCK_NETWORKASIOLOCAL_HPP
+#include <atomic>
+#include <cstdlib>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <string>
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/optional.hpp>
+#include <ka/macroregular.hpp>
+#include "networkasio.hpp"
+#include "traits.hpp"
+#include "common.hpp"
+
+/// @file
+/// Contains the implementation of the Network concept for boost::asio local
+/// (AF_UNIX) stream sockets.
+///
+/// Local endpoints are designated by URLs of the form `unix://localhost:port`.
+/// The port is only used to name the socket (see `localEndpointName`), the
+/// host is ignored.
+///
+/// See traits.hpp
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+
+namespace qi { namespace sock {
+
+  /// Models NetResolver for local sockets.
+  ///
+  /// The resolution does not involve any system call: the port of the query
+  /// gives the socket name. The handler is nevertheless called asynchronously,
+  /// as required by the concept.
+  class LocalResolver
+  {
+  public:
+    using endpoint_type = boost::asio::local::stream_protocol::endpoint;
+
+    struct query
+    {
+      enum flags { all_matching };
+      std::string host;
+      std::string port;
+      query(std::string h, std::string p, flags = all_matching)
+        : host(std::move(h))
+        , port(std::move(p))
+      {
+      }
+    };
+
+    class entry
+    {
+      endpoint_type _endpoint;
+    public:
+    // Regular:
+      entry() = default;
+      KA_GENERATE_FRIEND_REGULAR_OPS_1(entry, _endpoint)
+    // Custom:
+      explicit entry(const endpoint_type& e)
+        : _endpoint(e)
+      {
+      }
+      const endpoint_type& endpoint() const
+      {
+        return _endpoint;
+      }
+      operator endpoint_type() const
+      {
+        return _endpoint;
+      }
+    };
+
+    /// Iterator on at most one entry. The default-constructed value is the end.
+    class iterator
+    {
+      boost::optional<entry> _entry;
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = entry;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const entry*;
+      using reference = const entry&;
+    // Regular:
+      iterator() = default;
+      KA_GENERATE_FRIEND_REGULAR_OPS_1(iterator, _entry)
+    // Custom:
+      explicit iterator(const entry& e)
+        : _entry(e)
+      {
+      }
+    // Readable:
+      reference operator*() const
+      {
+        return *_entry;
+      }
+      pointer operator->() const
+      {
+        return &*_entry;
+      }
+    // Incrementable:
+      iterator& operator++()
+      {
+        _entry = boost::none;
+        return *this;
+      }
+      iterator operator++(int)
+      {
+        auto it = *this;
+        ++*this;
+        return it;
+      }
+    };
+
+  private:
+    using Canceled = std::atomic<bool>;
+    boost::asio::io_service& _io;
+    std::shared_ptr<Canceled> _canceled;
+
+  public:
+    explicit LocalResolver(boost::asio::io_service& io)
+      : _io(io)
+    {
+    }
+
+    LocalResolver(const LocalResolver&) = delete;
+    LocalResolver& operator=(const LocalResolver&) = delete;
+
+    ~LocalResolver()
+    {
+      cancel();
+    }
+
+    /// Procedure<void (boost::system::error_code, iterator)> H
+    template<typename H>
+    void async_resolve(const query& q, H handler)
+    {
+      auto canceled = std::make_shared<Canceled>(false);
+      _canceled = canceled;
+
+      boost::system::error_code erc;
+      iterator it;
+      char* end = nullptr;
+      const auto port = std::strtoul(q.port.c_str(), &end, 10);
+      if (q.port.empty() || *end != '\0' || port > std::numeric_limits<unsigned short>::max())
+      {
+        erc = boost::asio::error::invalid_argument;
+      }
+      else
+      {
+        it = iterator{entry{endpoint_type{localEndpointName(static_cast<unsigned short>(port))}}};
+      }
+      _io.post([=]() mutable {
+        if (*canceled)
+        {
+          handler(boost::asio::error::operation_aborted, iterator{});
+          return;
+        }
+        handler(erc, it);
+      });
+    }
+
+    void cancel()
+    {
+      if (_canceled)
+        *_canceled = true;
+    }
+
+    boost::asio::io_service& get_io_service()
+    {
+      return _io;
+    }
+  };
+
+  /// Model the `Network` concept for boost::asio over local stream sockets.
+  ///
+  /// Everything that does not depend on the socket protocol (ssl context,
+  /// buffers, io service, ...) is shared with `NetworkAsio`.
+  struct NetworkAsioLocal : NetworkAsio
+  {
+    using acceptor_type = boost::asio::local::stream_protocol::acceptor;
+    using resolver_type = LocalResolver;
+    using ssl_socket_type = boost::asio::ssl::stream<boost::asio::local::stream_protocol::socket>;
+    using accept_option_reuse_address_type = boost::asio::socket_base::reuse_address;
+  };
+
+  template<>
+  struct IsTcp<NetworkAsioLocal> : std::false_type {};
+
+}} // namespace qi::sock
+
+#endif // BOOST_ASIO_HAS_LOCAL_SOCKETS
+
+#endif // _QI_SOCK_NETWORKASIOLOCAL_HPP
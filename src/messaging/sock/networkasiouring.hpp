@@ -0,0 +1,60 @@
+#pragma once
+#ifndef _QI_SOCK_NETWORKASIOURING_HPP
+#define _QI_SOCK_NETWORKASIOURING_HPP
+#include <boost/asio.hpp>
+#include <qi/macro.hpp>
+#include "networkasio.hpp"
+#include "uring.hpp"
+
+/// @file
+/// Contains the implementation of the Network concept for boost::asio, with
+/// the reads and writes of unencrypted TCP sockets done through io_uring.
+///
+/// See traits.hpp
+
+namespace qi { namespace sock {
+
+  /// Model the `Network` concept for boost::asio, except for the transfers on
+  /// unencrypted sockets that go through the `Uring` service of the io service
+  /// of the socket.
+  ///
+  /// The SSL streams are unchanged: they still use the reactor of the io
+  /// service. Everything else (resolution, connection, accept, ...) is shared
+  /// with `NetworkAsio`, including the socket type, so that a socket created
+  /// for `NetworkAsio` can be used with this network.
+  struct NetworkAsioUring : NetworkAsio
+  {
+    using NetworkAsio::async_read;
+    using NetworkAsio::async_write;
+
+    /// MutableBufferSequence B, ReadHandler H
+    template<typename B, typename H>
+    static void async_read(boost::asio::ip::tcp::socket& s, const B& b, H h)
+    {
+      boost::asio::use_service<Uring>(GET_IO_SERVICE(s))
+        .asyncRead(s.native_handle(), toIovecs(b), std::move(h));
+    }
+
+    /// ConstBufferSequence B, WriteHandler H
+    template<typename B, typename H>
+    static void async_write(boost::asio::ip::tcp::socket& s, const B& b, H h)
+    {
+      boost::asio::use_service<Uring>(GET_IO_SERVICE(s))
+        .asyncWrite(s.native_handle(), toIovecs(b), std::move(h));
+    }
+
+    /// Cancels the transfers pending on the socket, that must not outlive it.
+    ///
+    /// Lowest<SslSocket<NetworkAsio>> S
+    template<typename S>
+    static void cancel_transfers(S& s)
+    {
+      auto& io = GET_IO_SERVICE(s);
+      if (boost::asio::has_service<Uring>(io))
+        boost::asio::use_service<Uring>(io).cancel(s.native_handle());
+    }
+  };
+
+}} // namespace qi::sock
+
+#endif // _QI_SOCK_NETWORKASIOURING_HPP
@@ -0,0 +1,96 @@
+/*
+**  Copyright (C) 2012 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <boost/algorithm/string/predicate.hpp>
+#include <qi/log.hpp>
+#include <qi/os.hpp>
+#include "networkeventloops.hpp"
+
+qiLogCategory("qimessaging.messagesocket");
+
+namespace qi { namespace sock {
+
+  namespace
+  {
+    /// Live socket count of each network eventloop, in the order of
+    /// `getNetworkEventLoops()`.
+    std::vector<std::atomic<std::size_t>>& socketCounts()
+    {
+      static std::vector<std::atomic<std::size_t>> counts(getNetworkEventLoops().size());
+      return counts;
+    }
+
+    std::size_t indexOfIoService(const void* ioService)
+    {
+      const auto& loops = getNetworkEventLoops();
+      const auto it = std::find_if(loops.begin(), loops.end(), [=](EventLoop* loop) {
+        return loop->nativeHandle() == ioService;
+      });
+      return static_cast<std::size_t>(it - loops.begin());
+    }
+  } // anonymous namespace
+
+  NetworkEventLoopPolicy getNetworkEventLoopPolicyFromEnv()
+  {
+    static const auto policy = [] {
+      const auto str = os::getenv("QIMESSAGING_SOCKET_EVENTLOOP_POLICY");
+      if (boost::iequals(str, "leastload"))
+        return NetworkEventLoopPolicy::LeastLoad;
+      if (!str.empty() && !boost::iequals(str, "roundrobin"))
+        qiLogWarning() << "Ignoring invalid QIMESSAGING_SOCKET_EVENTLOOP_POLICY '" << str << "'.";
+      return NetworkEventLoopPolicy::RoundRobin;
+    }();
+    return policy;
+  }
+
+  EventLoop* pickNetworkEventLoop()
+  {
+    const auto& loops = getNetworkEventLoops();
+    if (loops.size() == 1u)
+      return loops.front();
+
+    if (getNetworkEventLoopPolicyFromEnv() == NetworkEventLoopPolicy::LeastLoad)
+    {
+      const auto& counts = socketCounts();
+      const auto it = std::min_element(counts.begin(), counts.end(),
+        [](const std::atomic<std::size_t>& a, const std::atomic<std::size_t>& b) {
+          return a.load(std::memory_order_relaxed) < b.load(std::memory_order_relaxed);
+        });
+      return loops[static_cast<std::size_t>(it - counts.begin())];
+    }
+
+    static std::atomic<std::size_t> next{0u};
+    return loops[next++ % loops.size()];
+  }
+
+  std::vector<std::size_t> networkEventLoopSocketCounts()
+  {
+    const auto& counts = socketCounts();
+    std::vector<std::size_t> result;
+    result.reserve(counts.size());
+    for (const auto& count : counts)
+      result.push_back(count.load(std::memory_order_relaxed));
+    return result;
+  }
+
+  NetworkEventLoopLoad::NetworkEventLoopLoad(const void* ioService)
+    : _index(indexOfIoService(ioService))
+  {
+    auto& counts = socketCounts();
+    if (_index < counts.size())
+      ++counts[_index];
+  }
+
+  NetworkEventLoopLoad::~NetworkEventLoopLoad()
+  {
+    auto& counts = socketCounts();
+    if (_index < counts.size())
+      --counts[_index];
+  }
+
+}} // namespace qi::sock
@@ -0,0 +1,56 @@
+#pragma once
+#ifndef _QI_SOCK_NETWORKEVENTLOOPS_HPP
+#define _QI_SOCK_NETWORKEVENTLOOPS_HPP
+#include <cstddef>
+#include <vector>
+#include <qi/api.hpp>
+#include <qi/eventloop.hpp>
+
+/// @file
+/// Contains the distribution of sockets among the network eventloops.
+
+namespace qi { namespace sock {
+
+  /// How a new socket is assigned to one of the network eventloops.
+  enum class NetworkEventLoopPolicy
+  {
+    /// Each eventloop in turn.
+    RoundRobin,
+    /// The eventloop that currently handles the fewest sockets.
+    LeastLoad,
+  };
+
+  /// Returns the round-robin policy, possibly overridden by the environment
+  /// variable `QIMESSAGING_SOCKET_EVENTLOOP_POLICY` (`roundrobin` or
+  /// `leastload`).
+  QI_API NetworkEventLoopPolicy getNetworkEventLoopPolicyFromEnv();
+
+  /// Returns the network eventloop a new socket must live on, according to the
+  /// policy given by the environment.
+  /// With a single network eventloop, it is always `getNetworkEventLoop()`.
+  QI_API EventLoop* pickNetworkEventLoop();
+
+  /// Returns the number of live sockets on each network eventloop, in the
+  /// order of `getNetworkEventLoops()`.
+  QI_API std::vector<std::size_t> networkEventLoopSocketCounts();
+
+  /// Counts a socket on the network eventloop that owns the given io service
+  /// while it lives, so that the least load policy can balance them.
+  /// An io service that is not one of a network eventloop is not counted.
+  class QI_API NetworkEventLoopLoad
+  {
+  public:
+    explicit NetworkEventLoopLoad(const void* ioService);
+    ~NetworkEventLoopLoad();
+    NetworkEventLoopLoad(const NetworkEventLoopLoad&) = delete;
+    NetworkEventLoopLoad& operator=(const NetworkEventLoopLoad&) = delete;
+
+  private:
+    /// Index of the eventloop in `getNetworkEventLoops()`, or the number of
+    /// eventloops if the io service is not one of them.
+    std::size_t _index;
+  };
+
+}} // namespace qi::sock
+
+#endif // _QI_SOCK_NETWORKEVENTLOOPS_HPP
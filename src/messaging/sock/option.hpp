@@ -75,6 +75,9 @@ namespace qi { namespace sock {
   template<typename N, typename S>
   void setSocketOptions(S socket, const boost::optional<Seconds>& timeout)
   {
+    // Local sockets have neither Nagle's algorithm nor keepalive.
+    if (!IsTcp<N>::value) return;
+
     // Transmit each Message without delay
     try
     {
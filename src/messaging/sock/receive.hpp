@@ -1,18 +1,21 @@
 #pragma once
 #ifndef _QI_SOCK_RECEIVE_HPP
 #define _QI_SOCK_RECEIVE_HPP
+#include <memory>
 #include <boost/shared_ptr.hpp>
 #include <boost/optional.hpp>
 #include <ka/src.hpp>
 #include <ka/macroregular.hpp>
 #include <qi/trackable.hpp>
 #include <qi/log.hpp>
+#include "src/buffer_p.hpp"
 #include "src/messaging/message.hpp"
 #include "concept.hpp"
 #include "traits.hpp"
 #include "option.hpp"
 #include "error.hpp"
 #include "common.hpp"
+#include "receivebufferpool.hpp"
 
 /// @file
 /// Contains functions and types related to message reception on a socket.
@@ -155,6 +158,11 @@ namespace qi { namespace sock {
   /// Precondition: The message referred to by `ptrMsg` must be valid until the
   ///   handler has been called.
   ///
+  /// If a pool is given, payloads are received in its blocks when possible
+  /// (see `ReceiveBufferPool`).
+  /// Precondition: The pool, if any, must be valid until the handler has been
+  ///   called.
+  ///
   /// Precondition: This function must not be called while a message is already
   ///   being sent. It is possible to call it again only once the handler has
   ///   been called.
@@ -197,7 +205,8 @@ namespace qi { namespace sock {
   /// Transformation<Procedure<void (Args...)>> F1
   template<typename N, typename S, typename M, typename Proc, typename F0 = ka::id_transfo_t, typename F1 = ka::id_transfo_t>
   void receiveMessage(const S& socket, M ptrMsg, SslEnabled ssl, size_t maxPayload,
-    const Proc& onReceive, F0 lifetimeTransfo = F0{}, F1 syncTransfo = F1{});
+    const Proc& onReceive, F0 lifetimeTransfo = F0{}, F1 syncTransfo = F1{},
+    ReceiveBufferPool* pool = nullptr);
 
   namespace detail
   {
@@ -209,7 +218,8 @@ namespace qi { namespace sock {
     /// Transformation<Procedure<void (Args...)>> F1
     template<typename N, typename S, typename M, typename Proc, typename F0, typename F1>
     void onReadData(const ErrorCode<N>& erc, const S& socket, M ptrMsg, SslEnabled ssl,
-      size_t maxPayload, Proc onReceive, const F0& lifetimeTransfo, const F1& syncTransfo)
+      size_t maxPayload, Proc onReceive, const F0& lifetimeTransfo, const F1& syncTransfo,
+      ReceiveBufferPool* pool)
     {
       // We inform the upper layer that we received a message (or an error
       // occurred). The upper layer returns an optional containing a pointer to
@@ -217,7 +227,8 @@ namespace qi { namespace sock {
       // receiving messages.
       if (auto optionalPtrNextMsg = onReceive(erc, ptrMsg))
       {
-        receiveMessage<N>(socket, *optionalPtrNextMsg, ssl, maxPayload, onReceive, lifetimeTransfo, syncTransfo);
+        receiveMessage<N>(socket, *optionalPtrNextMsg, ssl, maxPayload, onReceive,
+          lifetimeTransfo, syncTransfo, pool);
       }
     }
 
@@ -226,6 +237,9 @@ namespace qi { namespace sock {
     ///
     /// Note: The message size must not exceed the given maximum payload.
     ///
+    /// If a pool is given, the payload is received in a block of the pool
+    /// when possible, instead of the memory of the message buffer.
+    ///
     /// Network N,
     /// Mutable<SslSocket<N>> S,
     /// Mutable<Message> M,
@@ -235,13 +249,14 @@ namespace qi { namespace sock {
     template<typename N, typename S, typename M, typename Proc, typename F0, typename F1>
     void onReadHeader(const ErrorCode<N>& erc, std::size_t len,
       const S& socket, M ptrMsg, SslEnabled ssl,
-      size_t maxPayload, Proc onReceive, F0 lifetimeTransfo, F1 syncTransfo)
+      size_t maxPayload, Proc onReceive, F0 lifetimeTransfo, F1 syncTransfo,
+      ReceiveBufferPool* pool)
     {
       auto receiveErrorAndMaybeReceiveNext = [&](ErrorCode<N> erc) {
         if (auto optionalPtrMsg = onReceive(erc, M{}))
         {
           receiveMessage<N>(socket, *optionalPtrMsg, ssl, maxPayload, onReceive,
-            lifetimeTransfo, syncTransfo);
+            lifetimeTransfo, syncTransfo, pool);
         }
       };
       if (erc)
@@ -254,7 +269,7 @@ namespace qi { namespace sock {
       if (*ssl && len == 0)
       {
         receiveMessage<N>(socket, ptrMsg, ssl, maxPayload, onReceive,
-          lifetimeTransfo, syncTransfo);
+          lifetimeTransfo, syncTransfo, pool);
         return;
       }
       auto& msg = *ptrMsg;
@@ -262,7 +277,7 @@ namespace qi { namespace sock {
       if (header.magic != Message::Header::magicCookie)
       {
         qiLogWarning(logCategory()) << &(*socket) << ": Incorrect magic from "
-          << (*socket).lowest_layer().remote_endpoint().address().to_string()
+          << url((*socket).lowest_layer().remote_endpoint(), ssl).str()
           << " (expected " << Message::Header::magicCookie
           << ", got " << header.magic << ").";
         receiveErrorAndMaybeReceiveNext(fault<ErrorCode<N>>());
@@ -272,7 +287,7 @@ namespace qi { namespace sock {
       if (payload == 0u)
       {
         onReadData<N>(success<ErrorCode<N>>(), socket, ptrMsg, ssl, maxPayload,
-          onReceive, lifetimeTransfo, syncTransfo);
+          onReceive, lifetimeTransfo, syncTransfo, pool);
         return;
       }
       if (payload > maxPayload)
@@ -283,8 +298,10 @@ namespace qi { namespace sock {
         receiveErrorAndMaybeReceiveNext(messageSize<ErrorCode<N>>());
         return;
       }
-      auto messageBuffer = msg.extractBuffer();
-      void* ptr = messageBuffer.reserve(payload);
+      auto pooledBuffer = pool ? pool->acquire(payload) : boost::optional<Buffer>{};
+      auto messageBuffer = pooledBuffer ? std::move(*pooledBuffer) : msg.extractBuffer();
+      void* ptr = pooledBuffer ? dataForFill(messageBuffer)
+                              : reserveForFill(messageBuffer, payload);
       if (ptr == nullptr) {
         qiLogWarning(logCategory()) << "Cannot reserve a buffer for the "
           "received payload of size " << payload << " byte(s).";
@@ -294,7 +311,8 @@ namespace qi { namespace sock {
       auto buffer = N::buffer(ptr, payload);
       msg.setBuffer(std::move(messageBuffer));
       auto readData = lifetimeTransfo([=](ErrorCode<N> error, std::size_t /*len*/) {
-        onReadData<N>(error, socket, ptrMsg, ssl, maxPayload, onReceive, lifetimeTransfo, syncTransfo);
+        onReadData<N>(error, socket, ptrMsg, ssl, maxPayload, onReceive, lifetimeTransfo,
+          syncTransfo, pool);
       });
 
       // We received the header, we now wait to receive the data.
@@ -317,7 +335,7 @@ namespace qi { namespace sock {
   /// Transformation<Procedure<void (Args...)>> F1
   template<typename N, typename S, typename M, typename Proc, typename F0, typename F1>
   void receiveMessage(const S& socket, M ptrMsg, SslEnabled ssl, size_t maxPayload,
-      const Proc& onReceive, F0 lifetimeTransfo, F1 syncTransfo)
+      const Proc& onReceive, F0 lifetimeTransfo, F1 syncTransfo, ReceiveBufferPool* pool)
   {
     // Receiving a message is done in two parts:
     // 1) receiving the header
@@ -328,7 +346,7 @@ namespace qi { namespace sock {
     };
     auto readHeader = syncTransfo(lifetimeTransfo([=](ErrorCode<N> erc, std::size_t len) {
       detail::onReadHeader<N>(erc, len, socket, ptrMsg, ssl, maxPayload, onReceive,
-        lifetimeTransfo, syncTransfo);
+        lifetimeTransfo, syncTransfo, pool);
     }));
 
     // First, we wait to receive the header.
@@ -378,11 +396,18 @@ namespace qi { namespace sock {
   class ReceiveMessageContinuous
   {
     Message _msg;
+    std::shared_ptr<ReceiveBufferPool> _pool;
   public:
   // QuasiRegular:
     ReceiveMessageContinuous() = default;
     // TODO: uncomment when messages are comparable, or when latest GCC is fixed.
 //    KA_GENERATE_FRIEND_REGULAR_OPS_1(ReceiveMessageContinuous, _msg)
+  // Custom:
+    /// Payloads are received in the blocks of the pool when possible.
+    explicit ReceiveMessageContinuous(std::shared_ptr<ReceiveBufferPool> pool)
+      : _pool(std::move(pool))
+    {
+    }
   // Procedure:
     /// Mutable<SslSocket<N>> S,
     /// Procedure<bool (ErrorCode<N>, Message*)> Proc,
@@ -413,7 +438,8 @@ namespace qi { namespace sock {
           return {};
         },
         lifetimeTransfo,
-        syncTransfo
+        syncTransfo,
+        _pool.get()
       );
     }
   };
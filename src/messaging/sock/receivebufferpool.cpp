@@ -0,0 +1,147 @@
+/*
+**  Copyright (C) 2012 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+#include <cstdlib>
+#include <boost/shared_ptr.hpp>
+#include <qi/log.hpp>
+#include <qi/os.hpp>
+#include "src/buffer_p.hpp"
+#include "receivebufferpool.hpp"
+
+qiLogCategory("qimessaging.messagesocket");
+
+namespace qi { namespace sock {
+
+  namespace
+  {
+    // Smallest class: the first power of two that does not fit in the inline
+    // storage of a Buffer.
+    const std::size_t minBlockSize = 1024u;
+    static_assert(minBlockSize > STATIC_BLOCK, "smaller blocks are useless");
+    const std::size_t maxSizeClassCount = 21u; // up to 1 GiB
+
+    std::size_t blockSize(std::size_t sizeClass)
+    {
+      return minBlockSize << sizeClass;
+    }
+
+    /// Returns the last class if the size is too big for any class.
+    std::size_t sizeClassOf(std::size_t size)
+    {
+      std::size_t sizeClass = 0u;
+      while (sizeClass + 1u < maxSizeClassCount && blockSize(sizeClass) < size)
+        ++sizeClass;
+      return sizeClass;
+    }
+  } // anonymous namespace
+
+  ReceiveBufferPool::ReceiveBufferPool(Limits limits)
+    : _limits(limits)
+    , _freeBlocks(limits.maxBlockSize > STATIC_BLOCK
+                    ? sizeClassOf(limits.maxBlockSize) + 1u
+                    : 0u)
+    , _stats{0u, 0u, 0u, 0u, 0u}
+  {
+  }
+
+  std::shared_ptr<ReceiveBufferPool> ReceiveBufferPool::create(Limits limits)
+  {
+    return std::shared_ptr<ReceiveBufferPool>{new ReceiveBufferPool(limits)};
+  }
+
+  ReceiveBufferPool::~ReceiveBufferPool()
+  {
+    if (_stats.hitCount + _stats.missCount)
+    {
+      qiLogDebug() << "Receive buffer pool: " << _stats.hitCount << " hit(s), "
+                   << _stats.missCount << " miss(es), " << _stats.freeByteCount
+                   << " byte(s) kept.";
+    }
+    for (auto& blocks : _freeBlocks)
+      for (void* block : blocks)
+        std::free(block);
+  }
+
+  boost::optional<Buffer> ReceiveBufferPool::acquire(std::size_t size)
+  {
+    if (size <= STATIC_BLOCK || _limits.maxFreeByteCount == 0u || _freeBlocks.empty()
+        || size > blockSize(_freeBlocks.size() - 1u))
+      return {};
+    const auto sizeClass = sizeClassOf(size);
+
+    void* block = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      auto& blocks = _freeBlocks[sizeClass];
+      if (!blocks.empty())
+      {
+        block = blocks.back();
+        blocks.pop_back();
+        ++_stats.hitCount;
+        --_stats.freeBlockCount;
+        _stats.freeByteCount -= blockSize(sizeClass);
+      }
+      else
+      {
+        ++_stats.missCount;
+      }
+      ++_stats.usedBlockCount;
+    }
+    if (!block)
+    {
+      block = std::malloc(blockSize(sizeClass));
+      if (!block)
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        --_stats.usedBlockCount;
+        return {};
+      }
+    }
+
+    auto self = shared_from_this();
+    boost::shared_ptr<void> owner(block, [=](void* b) { self->release(b, sizeClass); });
+    return makeBufferOnExternalMemory(static_cast<unsigned char*>(block), size,
+                                      std::move(owner));
+  }
+
+  void ReceiveBufferPool::release(void* block, std::size_t sizeClass)
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      --_stats.usedBlockCount;
+      const auto size = blockSize(sizeClass);
+      if (_stats.freeByteCount + size <= _limits.maxFreeByteCount)
+      {
+        _freeBlocks[sizeClass].push_back(block);
+        ++_stats.freeBlockCount;
+        _stats.freeByteCount += size;
+        return;
+      }
+    }
+    std::free(block);
+  }
+
+  ReceiveBufferPool::Stats ReceiveBufferPool::stats() const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+  }
+
+  ReceiveBufferPool::Limits getReceiveBufferPoolLimitsFromEnv()
+  {
+    static const auto limits = [] {
+      auto limits = ReceiveBufferPool::Limits::defaults();
+      const auto maxBytes = os::getenv("QIMESSAGING_SOCKET_RECEIVE_POOL_MAX_BYTES");
+      if (!maxBytes.empty())
+        limits.maxFreeByteCount = std::strtoul(maxBytes.c_str(), 0, 0);
+      const auto maxBlockSize = os::getenv("QIMESSAGING_SOCKET_RECEIVE_POOL_MAX_BLOCK_SIZE");
+      if (!maxBlockSize.empty())
+        limits.maxBlockSize = std::strtoul(maxBlockSize.c_str(), 0, 0);
+      return limits;
+    }();
+    return limits;
+  }
+
+}} // namespace qi::sock
@@ -0,0 +1,113 @@
+#pragma once
+#ifndef _QI_SOCK_RECEIVEBUFFERPOOL_HPP
+#define _QI_SOCK_RECEIVEBUFFERPOOL_HPP
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <boost/optional.hpp>
+#include <ka/macroregular.hpp>
+#include <qi/api.hpp>
+#include <qi/buffer.hpp>
+
+/// @file
+/// Contains a pool of memory blocks in which message payloads are received.
+
+namespace qi { namespace sock {
+
+  /// Pool of memory blocks in which message payloads are received, to avoid
+  /// allocating and freeing memory for each message.
+  ///
+  /// Blocks are sorted by size classes (powers of two). A block is given back
+  /// to the pool when the last buffer using it is destroyed, from any thread.
+  /// The pool keeps free blocks up to a total size and frees the others.
+  ///
+  /// Payloads that fit in the inline storage of a `Buffer` do not need the
+  /// pool, and payloads bigger than the biggest class are too rare to be worth
+  /// keeping: both are allocated as usual.
+  ///
+  /// The pool lives as long as one of its blocks is in use.
+  class QI_API ReceiveBufferPool : public std::enable_shared_from_this<ReceiveBufferPool>
+  {
+  public:
+    struct Limits
+    {
+      /// Size of the biggest block class.
+      std::size_t maxBlockSize;
+      /// Total size of the free blocks the pool keeps. 0 disables the pool.
+      std::size_t maxFreeByteCount;
+
+    // Regular:
+      KA_GENERATE_FRIEND_REGULAR_OPS_2(Limits, maxBlockSize, maxFreeByteCount)
+
+      /// Each socket has its own pool, so the defaults are kept small. The
+      /// processes that receive big messages at a high rate can raise them
+      /// (see `getReceiveBufferPoolLimitsFromEnv`).
+      static Limits defaults()
+      {
+        return {64u * 1024u, 256u * 1024u};
+      }
+    };
+
+    struct Stats
+    {
+      /// Number of blocks taken from the free blocks.
+      std::uint64_t hitCount;
+      /// Number of blocks allocated because no free block was available.
+      std::uint64_t missCount;
+      /// Number of blocks used by buffers.
+      std::size_t usedBlockCount;
+      /// Number and total size of the free blocks.
+      std::size_t freeBlockCount;
+      std::size_t freeByteCount;
+
+    // Regular:
+      KA_GENERATE_FRIEND_REGULAR_OPS_5(Stats, hitCount, missCount, usedBlockCount,
+                                       freeBlockCount, freeByteCount)
+
+      /// Ratio of blocks taken from the free blocks, 0 if no block was taken.
+      double hitRate() const
+      {
+        const auto total = hitCount + missCount;
+        return total ? static_cast<double>(hitCount) / static_cast<double>(total) : 0.;
+      }
+    };
+
+    static std::shared_ptr<ReceiveBufferPool> create(Limits limits = Limits::defaults());
+
+    ReceiveBufferPool(const ReceiveBufferPool&) = delete;
+    ReceiveBufferPool& operator=(const ReceiveBufferPool&) = delete;
+    ~ReceiveBufferPool();
+
+    /// Returns a buffer of `size` bytes whose storage comes from the pool.
+    /// Returns an empty optional if the payload must be allocated as usual.
+    boost::optional<Buffer> acquire(std::size_t size);
+
+    Stats stats() const;
+
+    Limits limits() const
+    {
+      return _limits;
+    }
+
+  private:
+    explicit ReceiveBufferPool(Limits limits);
+    void release(void* block, std::size_t sizeClass);
+
+    const Limits _limits;
+    mutable std::mutex _mutex;
+    std::vector<std::vector<void*>> _freeBlocks; // indexed by size class
+    Stats _stats;
+  };
+
+  /// Returns the default limits, possibly overridden by the environment
+  /// variables `QIMESSAGING_SOCKET_RECEIVE_POOL_MAX_BYTES` and
+  /// `QIMESSAGING_SOCKET_RECEIVE_POOL_MAX_BLOCK_SIZE`.
+  /// By default, a socket keeps up to 256 KiB of free blocks of up to 64 KiB.
+  /// Setting the maximum number of bytes to 0 disables the pool.
+  QI_API ReceiveBufferPool::Limits getReceiveBufferPoolLimitsFromEnv();
+
+}} // namespace qi::sock
+
+#endif // _QI_SOCK_RECEIVEBUFFERPOOL_HPP
@@ -91,6 +91,20 @@ namespace qi { namespace sock {
 
   namespace detail
   {
+    /// NetEndpoint E
+    template<typename E>
+    auto isIpV6(const E& ep, int) -> decltype(ep.address().is_v6())
+    {
+      return ep.address().is_v6();
+    }
+
+    /// Endpoints without an address (local sockets) are never ipV6.
+    template<typename E>
+    bool isIpV6(const E&, long)
+    {
+      return false;
+    }
+
     /// Precondition: readableBoundedRange(b, e)
     ///
     /// Iterator<Entry<Resolver<N>>> I
@@ -102,7 +116,7 @@ namespace qi { namespace sock {
       if (!(*ipV6))
       {
         b = std::find_if(b, e, [](const Entry& entry) {
-          return !entry.endpoint().address().is_v6();
+          return !isIpV6(entry.endpoint(), 0);
         });
       }
       using O = boost::optional<Entry>;
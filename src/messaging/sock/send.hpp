@@ -1,22 +1,32 @@
 #pragma once
 #ifndef _QI_SOCK_SEND_HPP
 #define _QI_SOCK_SEND_HPP
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <deque>
+#include <limits>
 #include <vector>
 #include <list>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <sstream>
 #include <boost/thread/synchronized_value.hpp>
 #include <boost/core/ignore_unused.hpp>
+#include <ka/macroregular.hpp>
 #include <ka/src.hpp>
 #include <ka/scoped.hpp>
 #include <qi/trackable.hpp>
 #include <qi/future.hpp>
 #include <qi/atomic.hpp>
+#include <qi/clock.hpp>
 #include "src/messaging/message.hpp"
 #include "concept.hpp"
 #include "traits.hpp"
 #include "option.hpp"
+#include "sendqueuemonitor.hpp"
+#include "socketcounters.hpp"
 #include "error.hpp"
 #include "common.hpp"
 
@@ -65,10 +75,11 @@
 /// The memory for the messages can be for example maintained by an instance of
 /// `SendMessageEnqueue`. As `sendMessage`, it implements a message
 /// send loop, but being an object it can have a state and takes leverage
-/// of this to maintain a message queue. It passes the first message of the queue to
-/// `sendMessage` and removes it from the queue when sending is done. In this
-/// case, `SendMessageEnqueue` effectively constitutes the upper layer of
-/// `sendMessage`.
+/// of this to maintain a message queue. It passes the messages at the front of
+/// the queue to `sendMessageBatch` (a variant of `sendMessage` that sends
+/// several messages in a single gather write) and removes them from the queue
+/// when sending is done. In this case, `SendMessageEnqueue` effectively
+/// constitutes the upper layer of `sendMessageBatch`.
 ///
 /// `SendMessageEnqueue` has itself an upper layer: it passes it the
 /// sent message though a callback. This callback returns a boolean to
@@ -81,13 +92,13 @@
 ///  SendMessageEnqueue start
 ///             |
 ///             v
-///   sendMessage(_msgQueue.begin()) <--
-///             | message sent          |
+///  sendMessageBatch(front batch) <----
+///             | batch sent            |
 ///             v                       |
-/// pass msg/error to upper layer*      |
+/// pass each msg/error to upper layer* |
 ///             |                       |
 ///             v                       |
-///   remove msg from queue             |
+///   remove batch from queue           |
 ///             |                       |
 ///       must continue? ---------------
 ///             | no         yes
@@ -106,25 +117,36 @@
 ///                         ^ | bool
 ///         (Error, IterMsg)| v
 /// Layer 1:         SendMessageEnqueue
-///                         ^ | optional<IterMsg>
-///         (Error, IterMsg)| v
-/// Layer 0:            sendMessage
+///                         ^ | optional<Batch>
+///           (Error, Batch)| v
+/// Layer 0:         sendMessageBatch
 /// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 namespace qi { namespace sock {
 
-  /// Make network buffers for the given message.
-  ///
-  /// One buffer is for the header and the other one is for data.
+  /// Upper bound of the number of network buffers needed to send the given
+  /// message.
+  inline std::size_t bufferCount(const Message& msg)
+  {
+    // header + (data chunk, subbuffer) for each subbuffer + last data chunk
+    return 1 + 2 * msg.buffer().subBuffers().size() + 1;
+  }
+
+  /// Number of bytes written to the network to send the given message.
+  inline std::size_t byteCount(const Message& msg)
+  {
+    return sizeof(Message::Header) + msg.buffer().totalSize();
+  }
+
+  /// Append to `buffers` the network buffers for the given message.
   ///
   /// Network N
   template<typename N>
-  std::vector<ConstBuffer<N>> makeBuffers(const Message& msg)
+  void appendBuffers(const Message& msg, std::vector<ConstBuffer<N>>& buffers)
   {
     // header buffer
     ConstBuffer<N> headerBuffer = N::buffer(static_cast<const void*>(&msg.header()),
       sizeof(Message::Header));
-    std::vector<ConstBuffer<N>> buffers;
     const auto& msgBuffer = msg.buffer();
 
     // A buffer has a header and data.
@@ -140,7 +162,6 @@ namespace qi { namespace sock {
     // Memory layout for a buffer with 2 subbuffers:
     // (low address)                                                         (high address)
     // |header|buffer_part_0|size_subbuffer_0|buffer_part_1|size_subbuffer_1|buffer_part_2|
-    buffers.reserve(1 + 2 * msgBuffer.subBuffers().size() + 1);
     buffers.push_back(headerBuffer);
 
     decltype(msgBuffer.size()) beginOffset = 0;
@@ -161,6 +182,19 @@ namespace qi { namespace sock {
     // end of main buffer
     buffers.push_back(N::buffer(
       static_cast<const char*>(msgBuffer.data()) + beginOffset, msgBuffer.size() - beginOffset));
+  }
+
+  /// Make network buffers for the given message.
+  ///
+  /// One buffer is for the header and the others are for data.
+  ///
+  /// Network N
+  template<typename N>
+  std::vector<ConstBuffer<N>> makeBuffers(const Message& msg)
+  {
+    std::vector<ConstBuffer<N>> buffers;
+    buffers.reserve(bufferCount(msg));
+    appendBuffers<N>(msg, buffers);
     return buffers;
   }
 
@@ -218,22 +252,293 @@ namespace qi { namespace sock {
     }
   }
 
+  /// Limits of a batch of messages sent in a single gather write.
+  ///
+  /// A batch always contains at least one message, whatever its size. The
+  /// following messages are added to the batch as long as none of the limits
+  /// is exceeded.
+  ///
+  /// A `maxMessageCount` of 1 disables batching: each message is then sent by
+  /// its own write.
+  struct SendBatchLimits
+  {
+    std::size_t maxMessageCount;
+    std::size_t maxByteCount;
+    std::size_t maxBufferCount;
+
+  // Regular:
+    KA_GENERATE_FRIEND_REGULAR_OPS_3(SendBatchLimits, maxMessageCount, maxByteCount, maxBufferCount)
+
+    static SendBatchLimits disabled()
+    {
+      return {1u, 0u, 0u};
+    }
+
+    /// Boost.Asio never passes more than 64 buffers to a single system call.
+    static SendBatchLimits defaults()
+    {
+      return {std::numeric_limits<std::size_t>::max(), 256u * 1024u, 64u};
+    }
+  };
+
+  /// Returns the default batch limits, possibly overridden by the environment
+  /// variables `QIMESSAGING_SOCKET_SEND_BATCH_MAX_MESSAGES` and
+  /// `QIMESSAGING_SOCKET_SEND_BATCH_MAX_BYTES`.
+  /// Setting the maximum number of messages to 1 disables batching.
+  SendBatchLimits getSendBatchLimitsFromEnv();
+
+  /// Priority classes of the messages in a send queue.
+  ///
+  /// Each message type has a class. A message bigger than
+  /// `maxControlByteCount` is not in the control class but in the normal one,
+  /// so that a big reply does not delay the small control messages.
+  /// A cancellation is always in the class of calls, so that it never
+  /// overtakes the call it cancels: the other end would ignore it.
+  /// These rules do not apply to a message that has a priority of its own
+  /// (see `Message::setPriority`).
+  struct SendPriorities
+  {
+    using Priority = Message::Priority;
+    static const std::size_t typeCount = Message::Type_Canceled + 1;
+
+    std::array<Priority, typeCount> ofType;
+    std::size_t maxControlByteCount;
+
+  // Regular:
+    KA_GENERATE_FRIEND_REGULAR_OPS_2(SendPriorities, ofType, maxControlByteCount)
+
+    Priority of(const Message& msg) const
+    {
+      if (const auto priority = msg.priority())
+        return *priority;
+      auto type = static_cast<std::size_t>(msg.type());
+      if (type == Message::Type_Cancel)
+        type = Message::Type_Call;
+      const auto priority = type < typeCount ? ofType[type] : Priority::Normal;
+      if (priority == Priority::Control && byteCount(msg) > maxControlByteCount)
+        return Priority::Normal;
+      return priority;
+    }
+
+    /// All messages are in the same class, and therefore sent in order.
+    static SendPriorities disabled()
+    {
+      SendPriorities priorities;
+      priorities.ofType.fill(Priority::Normal);
+      priorities.maxControlByteCount = std::numeric_limits<std::size_t>::max();
+      return priorities;
+    }
+
+    /// Replies, errors and capabilities overtake calls, which overtake events.
+    /// Messages are then not received in the order they were sent: a reply
+    /// may arrive before an event emitted before it.
+    static SendPriorities enabled()
+    {
+      auto priorities = disabled();
+      for (auto type : {Message::Type_Reply, Message::Type_Error, Message::Type_Capability,
+                        Message::Type_Canceled})
+        priorities.ofType[type] = Priority::Control;
+      priorities.ofType[Message::Type_Event] = Priority::Bulk;
+      priorities.maxControlByteCount = 64u * 1024u;
+      return priorities;
+    }
+  };
+
+  /// Returns the priorities set by the environment variables
+  /// `QIMESSAGING_SOCKET_SEND_PRIORITIES` and
+  /// `QIMESSAGING_SOCKET_SEND_CONTROL_MAX_BYTES`. By default, priorities are
+  /// disabled and all messages are sent in order.
+  ///
+  /// The first one is either `on`, to use `SendPriorities::enabled()`, or a
+  /// comma separated list of `<type>=<class>` overrides of these priorities,
+  /// for example `Event=normal,Post=bulk`. Types are named as by
+  /// `Message::typeToString` and classes are `control`, `normal` and `bulk`.
+  SendPriorities getSendPrioritiesFromEnv();
+
+  /// Time spent by messages in a send queue, from their enqueuing to the start
+  /// of their write.
+  struct SendWait
+  {
+    std::uint64_t messageCount;
+    Duration total;
+    Duration max;
+
+  // Regular:
+    KA_GENERATE_FRIEND_REGULAR_OPS_3(SendWait, messageCount, total, max)
+
+    Duration mean() const
+    {
+      return messageCount ? total / static_cast<Duration::rep>(messageCount) : Duration::zero();
+    }
+  };
+
+  /// Records the time spent by messages in a send queue, per priority class.
+  /// Recording and reading can be done concurrently from any thread.
+  class SendWaitStats
+  {
+  public:
+    using Priority = Message::Priority;
+
+    SendWaitStats() = default;
+    SendWaitStats(const SendWaitStats&) = delete;
+    SendWaitStats& operator=(const SendWaitStats&) = delete;
+
+    void record(Priority priority, Duration wait)
+    {
+      auto& counters = _counters[static_cast<std::size_t>(priority)];
+      const auto ns = wait.count();
+      ++counters.messageCount;
+      counters.total += ns;
+      auto max = counters.max.load();
+      while (ns > max && !counters.max.compare_exchange_weak(max, ns)) {}
+      _histogram.record(wait);
+    }
+
+    SendWait operator[](Priority priority) const
+    {
+      const auto& counters = _counters[static_cast<std::size_t>(priority)];
+      return {counters.messageCount.load(), Duration{counters.total.load()},
+              Duration{counters.max.load()}};
+    }
+
+    /// Distribution of the waits of all priority classes.
+    DurationHistogram histogram() const
+    {
+      return _histogram.snapshot();
+    }
+
+  private:
+    struct Counters
+    {
+      std::atomic<std::uint64_t> messageCount{0u};
+      std::atomic<Duration::rep> total{0};
+      std::atomic<Duration::rep> max{0};
+    };
+    std::array<Counters, Message::priorityCount> _counters;
+    AtomicDurationHistogram _histogram;
+  };
+
+  /// Consecutive messages sent in a single network write.
+  ///
+  /// Only the `count` messages starting at `first` belong to the batch. The
+  /// iterator past the last message of the batch is never computed, so that
+  /// the container can be appended to concurrently (see `SendMessageEnqueue`).
+  ///
+  /// Readable<Message> I (I is also a ForwardIterator)
+  template<typename I>
+  struct MessageBatch
+  {
+    I first;
+    std::size_t count;
+
+  // Regular:
+    KA_GENERATE_FRIEND_REGULAR_OPS_2(MessageBatch, first, count)
+  };
+
+  /// Calls the procedure on each message of the batch, in order.
+  ///
+  /// ForwardIterator I, Procedure<void (I)> Proc
+  template<typename I, typename Proc>
+  void forEachMessage(const MessageBatch<I>& batch, Proc&& proc)
+  {
+    auto it = batch.first;
+    for (std::size_t i = 0u; i != batch.count; ++i)
+    {
+      // Never increment past the last message of the batch.
+      if (i != 0u) ++it;
+      proc(it);
+    }
+  }
+
+  /// Make network buffers for all the messages of the batch.
+  ///
+  /// Network N, ForwardIterator I
+  template<typename N, typename I>
+  std::vector<ConstBuffer<N>> makeBuffers(const MessageBatch<I>& batch)
+  {
+    std::vector<ConstBuffer<N>> buffers;
+    std::size_t count = 0u;
+    forEachMessage(batch, [&](I it) {
+      count += bufferCount(*it);
+    });
+    buffers.reserve(count);
+    forEachMessage(batch, [&](I it) {
+      appendBuffers<N>(*it, buffers);
+    });
+    return buffers;
+  }
+
+  /// Same as `sendMessage` but sends all the messages of a batch through a
+  /// single write operation.
+  ///
+  /// The handler is called once for the whole batch. If it returns a new
+  /// batch, it is immediately sent.
+  ///
+  /// Network N,
+  /// Mutable<SslSocket<N>> S,
+  /// ForwardIterator I,
+  /// Procedure<Optional<MessageBatch<I>> (ErrorCode<N>, MessageBatch<I>)> Proc,
+  /// Transformation<Procedure> F0,
+  /// Transformation<Procedure<void (Args...)>> F1
+  template<typename N, typename S, typename I, typename Proc, typename F0 = ka::id_transfo_t, typename F1 = ka::id_transfo_t>
+  void sendMessageBatch(const S& socket, MessageBatch<I> batch, Proc onSent, SslEnabled ssl,
+      F0 lifetimeTransfo = {}, F1 syncTransfo = {})
+  {
+    auto buffers = makeBuffers<N>(batch);
+    auto writeCont = syncTransfo(lifetimeTransfo([=](ErrorCode<N> erc, size_t /*len*/) mutable {
+      if (auto optionalNextBatch = onSent(erc, batch))
+      {
+        sendMessageBatch<N>(socket, *optionalNextBatch, onSent, ssl, lifetimeTransfo, syncTransfo);
+      }
+    }));
+    if (*ssl)
+    {
+      N::async_write(*socket, std::move(buffers), writeCont);
+    }
+    else
+    {
+      N::async_write((*socket).next_layer(), std::move(buffers), writeCont);
+    }
+  }
+
   /// Functor that sends messages through a socket.
   ///
   /// The role of this type is to provide a queue for messages.
   /// You can therefore ask to send a message before the current one has
   /// actually been sent. The message will simply be enqueued and sent ASAP.
-  /// The messages will be sent in a FIFO manner.
   /// Sending messages is thread-safe.
   ///
-  /// The actual sending is done by `sendMessage`.
+  /// There is a queue per priority class (see `SendPriorities`). Each time a
+  /// write completes, the next one takes the messages of the highest class
+  /// that has some, so that they overtake the messages of lower classes. A
+  /// message that is being written is never interrupted. The messages of a
+  /// class are sent in a FIFO manner. By default, all messages are in the same
+  /// class. The time spent by messages in the queues can be recorded.
+  ///
+  /// The depth of the queues can be tracked by a `SendQueueMonitor`, which
+  /// tells producers when they are full. Events sent while they are full are
+  /// then queued, dropped or coalesced with a queued event of the same signal,
+  /// according to the event policy of the monitor. Conflatable events (see
+  /// `Message::setConflatable`) are always coalesced with a queued conflatable
+  /// event of the same signal. A dropped or coalesced event is not passed to
+  /// the callback, and the shared memory segments it exported are removed.
+  ///
+  /// The actual sending is done by `sendMessageBatch`. Each time a write
+  /// completes, all the messages enqueued meanwhile are gathered into a single
+  /// write, within the given batch limits. A default constructed instance does
+  /// not batch, but connected sockets use `getSendBatchLimitsFromEnv`, which
+  /// batches by default.
   ///
   /// When a message has been sent, a callback is called. This callback return
   /// a boolean to decide if the queue, if not empty, must continue to be processed.
+  /// The callback is called for each message, even if it has been sent with
+  /// others in the same batch.
   ///
   /// If you decide to stop the queue processing and it contain some messages,
   /// the queue is not cleared. Next time you send a message, it will
   /// be enqueued and the queue processing will continue from where it had stopped.
+  /// If the decision is made for a message that was sent in a batch, the callback
+  /// is still called for the remaining messages of the batch.
   ///
   /// Warning: The instance must remain alive until messages are sent.
   /// You can provide a procedure transformation (`lifetimeTransfo`) that will
@@ -250,13 +555,45 @@ namespace qi { namespace sock {
     using ReadableMessage = std::list<Message>::const_iterator;
     SendMessageEnqueue()
       : _sending{false}
+      , _sendingPriority{0u}
+      , _sendingCount{0u}
+      , _batchLimits(SendBatchLimits::disabled())
+      , _priorities(SendPriorities::disabled())
     {
     }
-    explicit SendMessageEnqueue(const S& socket)
+    explicit SendMessageEnqueue(const S& socket,
+        SendBatchLimits batchLimits = SendBatchLimits::disabled(),
+        SendPriorities priorities = SendPriorities::disabled(),
+        std::shared_ptr<SendWaitStats> waitStats = {},
+        std::shared_ptr<SendQueueMonitor> queueMonitor = {})
       : _socket(socket)
       , _sending{false}
+      , _sendingPriority{0u}
+      , _sendingCount{0u}
+      , _batchLimits(batchLimits)
+      , _priorities(priorities)
+      , _waitStats(std::move(waitStats))
+      , _queueMonitor(std::move(queueMonitor))
     {
     }
+    /// The messages still queued are discarded: they leave the depth tracked
+    /// by the monitor, and the shared memory segments they exported are removed.
+    ~SendMessageEnqueue()
+    {
+      std::size_t messageCount = 0u;
+      std::size_t bytes = 0u;
+      for (const auto& queue : _sendQueues)
+      {
+        messageCount += queue.size();
+        for (const auto& msg : queue)
+        {
+          bytes += byteCount(msg);
+          msg.unlinkSharedMemorySegments();
+        }
+      }
+      if (_queueMonitor && messageCount)
+        _queueMonitor->removed(messageCount, bytes);
+    }
   // Procedure:
     /// Message Msg,
     /// Procedure<bool (ErrorCode<N>, Readable<Message>)> Proc,
@@ -268,15 +605,150 @@ namespace qi { namespace sock {
     void operator()(Msg&&, SslEnabled, Proc onSent = Proc{true},
       const F0& lifetimeTransfo = F0{}, const F1& syncTransfo = F1{});
   private:
+    using Batch = MessageBatch<std::list<Message>::iterator>;
+
+    /// Returns the batch of messages at the front of the queue of the highest
+    /// priority class that has messages, and records it as being sent.
+    /// Precondition: The queues are locked and one of them is not empty.
+    Batch frontBatch();
+
+    /// Removes the batch being sent from its queue.
+    /// Precondition: The queues are locked.
+    void eraseSent(const Batch& sent);
+
+    /// Coalesces a conflatable event with its queued predecessor, or applies
+    /// the event policy of the monitor to a message sent while the queues are
+    /// full. Returns true if the message must not be queued, in which case it
+    /// may have been moved from.
+    /// Precondition: The queues are locked.
+    template<typename Msg>
+    bool dropOrCoalesceEvent(Msg&& msg, std::size_t priority);
+
+    /// Precondition: The queues are locked.
+    bool queuesEmpty() const
+    {
+      return std::all_of(_sendQueues.begin(), _sendQueues.end(),
+                         [](const std::list<Message>& q) { return q.empty(); });
+    }
+
     S _socket;
-    /// A list is used because we need the iterators not to be invalidated by
+    /// Lists are used because we need the iterators not to be invalidated by
     /// insertions at begin or end, which is not the case with deque.
     /// See [23.3.3.4 deque modifiers].
-    std::list<Message> _sendQueue;
+    /// The queues are indexed by priority class.
+    std::array<std::list<Message>, Message::priorityCount> _sendQueues;
+    /// Enqueuing time of each message of the queues, if the waits are recorded.
+    std::array<std::deque<SteadyClock::time_point>, Message::priorityCount> _enqueueTimes;
     bool _sending;
+    /// Queue and number of messages of the batch being sent.
+    std::size_t _sendingPriority;
+    std::size_t _sendingCount;
+    SendBatchLimits _batchLimits;
+    SendPriorities _priorities;
+    std::shared_ptr<SendWaitStats> _waitStats;
+    std::shared_ptr<SendQueueMonitor> _queueMonitor;
     std::mutex _sendMutex;
   };
 
+  template<typename N, typename S>
+  auto SendMessageEnqueue<N, S>::frontBatch() -> Batch
+  {
+    QI_ASSERT(!queuesEmpty());
+    const auto queue = std::find_if(_sendQueues.begin(), _sendQueues.end(),
+                                    [](const std::list<Message>& q) { return !q.empty(); });
+    _sendingPriority = static_cast<std::size_t>(queue - _sendQueues.begin());
+    Batch batch{queue->begin(), 1u};
+    auto bufferCount = sock::bufferCount(*batch.first);
+    auto byteCount = sock::byteCount(*batch.first);
+    for (auto it = std::next(batch.first);
+         it != queue->end() && batch.count < _batchLimits.maxMessageCount;
+         ++it)
+    {
+      bufferCount += sock::bufferCount(*it);
+      byteCount += sock::byteCount(*it);
+      if (bufferCount > _batchLimits.maxBufferCount || byteCount > _batchLimits.maxByteCount)
+        break;
+      ++batch.count;
+    }
+    if (_waitStats)
+    {
+      const auto now = SteadyClock::now();
+      const auto& times = _enqueueTimes[_sendingPriority];
+      for (std::size_t i = 0u; i != batch.count; ++i)
+        _waitStats->record(static_cast<Message::Priority>(_sendingPriority), now - times[i]);
+    }
+    _sendingCount = batch.count;
+    return batch;
+  }
+
+  template<typename N, typename S>
+  void SendMessageEnqueue<N, S>::eraseSent(const Batch& sent)
+  {
+    auto last = sent.first;
+    std::advance(last, sent.count);
+    if (_queueMonitor)
+    {
+      std::size_t bytes = 0u;
+      for (auto it = sent.first; it != last; ++it)
+        bytes += byteCount(*it);
+      _queueMonitor->removed(sent.count, bytes);
+    }
+    _sendQueues[_sendingPriority].erase(sent.first, last);
+    _sendingCount = 0u;
+    auto& times = _enqueueTimes[_sendingPriority];
+    if (!times.empty())
+      times.erase(times.begin(), times.begin() + static_cast<std::ptrdiff_t>(sent.count));
+  }
+
+  template<typename N, typename S>
+  template<typename Msg>
+  bool SendMessageEnqueue<N, S>::dropOrCoalesceEvent(Msg&& msg, std::size_t priority)
+  {
+    using EventPolicy = SendQueueMonitor::EventPolicy;
+    if (msg.type() != Message::Type_Event)
+      return false;
+    // Conflatable events replace their queued predecessor whether the queues are full or not.
+    const bool conflate = msg.conflatable();
+    if (!conflate)
+    {
+      if (!_queueMonitor)
+        return false;
+      const auto policy = _queueMonitor->limits().eventPolicy;
+      if (policy == EventPolicy::Keep || !_queueMonitor->isFull())
+        return false;
+      if (policy == EventPolicy::Drop)
+      {
+        _queueMonitor->eventDropped();
+        msg.unlinkSharedMemorySegments();
+        return true;
+      }
+    }
+    // The messages being written must not be modified.
+    auto& queue = _sendQueues[priority];
+    auto it = queue.begin();
+    if (_sending && priority == _sendingPriority)
+      std::advance(it, _sendingCount);
+    const auto sameSignal = [&](const Message& queued) {
+      return queued.type() == Message::Type_Event
+          && (!conflate || queued.conflatable())
+          && queued.service() == msg.service()
+          && queued.object() == msg.object()
+          && queued.event() == msg.event();
+    };
+    it = std::find_if(it, queue.end(), sameSignal);
+    if (it == queue.end())
+      return false;
+    const auto oldByteCount = byteCount(*it);
+    it->unlinkSharedMemorySegments();
+    *it = std::forward<Msg>(msg);
+    if (_queueMonitor)
+    {
+      _queueMonitor->replaced(oldByteCount, byteCount(*it));
+      _queueMonitor->eventCoalesced();
+    }
+    return true;
+  }
+
   // Lemma SendMessageEnqueue.0:
   //  If a message is already being sent, the message is queued without
   //  invalidating the one being sent.
@@ -289,59 +761,68 @@ namespace qi { namespace sock {
       const F0& lifetimeTransfo, const F1& syncTransfo)
   {
     qiLogDebug(logCategory()) << _socket.get() << " SendMessageEnqueue()(" << msg.type() << ": " << msg.address() << ", ssl=" << *ssl << ")";
-    using I = decltype(_sendQueue.begin());
-    I itMsg;
+    Batch batch{};
     bool mustStartSendLoop = false;
+    const auto priority = static_cast<std::size_t>(_priorities.of(msg));
     {
       std::lock_guard<std::mutex> lock{_sendMutex};
-      _sendQueue.emplace_back(std::forward<Msg>(msg));
-      itMsg = _sendQueue.begin();
+      if (dropOrCoalesceEvent(std::forward<Msg>(msg), priority))
+        return;
+      if (_queueMonitor)
+        _queueMonitor->added(byteCount(msg));
+      _sendQueues[priority].emplace_back(std::forward<Msg>(msg));
+      if (_waitStats)
+        _enqueueTimes[priority].push_back(SteadyClock::now());
       // We've just added a message to the queue, so if we are not currently sending,
       // we must (re)start the send loop.
       if (!_sending)
       {
         _sending = true;
         mustStartSendLoop = true;
+        batch = frontBatch();
       }
     }
     if (mustStartSendLoop)
     {
       // Lemma SendMessageEnqueue.1:
-      //  When calling sendMessage, itMsg is still valid.
+      //  When calling sendMessageBatch, the messages of the batch are still valid.
       // Proof:
-      //  The send queue is a std::list, so inserting or erasing other elements
-      //  doesn't invalidate the iterator.
+      //  The send queues are std::lists, so inserting or erasing other elements
+      //  doesn't invalidate the iterators.
       //  Each thread adds a message to the send queue. But only one at a time
       //  can enter this branch (by tryRaiseAtomicFlag.0).
       //  Also, the sending flag is only modified while the queue is locked, so
       //  the scenario where a thread B adds a message to the queue, is suspended
       //  just before evaluating the condition of this branch, then the send loop
       //  thread A clears the queue, and then the thread B resumes, is correctly handled.
-      //  Moreover, this branch results in exactly one message being removed from
-      //  the send queue (by SendMessageEnqueue.2).
-      //  Therefore, at this point the number of messages in the send queue is
-      //  always at least 1.
+      //  Moreover, the batch is computed while the queue is locked, and only the
+      //  send loop removes messages from the queue (by SendMessageEnqueue.2).
+      //  Therefore, at this point the send queue contains at least the messages
+      //  of the batch.
+      //  Finally, iterating over a batch never reads the link from its last
+      //  message to the next one, which is the only link modified by
+      //  concurrent insertions.
 
       // Lemma SendMessageEnqueue.2:
-      //  eraseAndReturnNextMessage erases from the send queue the element pointed
-      //  by the given iterator, even if an exception is thrown.
+      //  eraseAndReturnNextBatch erases from the send queue the messages of the
+      //  given batch, even if an exception is thrown.
 
-      // This callback will be called when a message has been sent, or an error
-      // occurred. It passes an iterator on the sent message to the upper layer,
+      // This callback will be called when a batch has been sent, or an error
+      // occurred. It passes an iterator on each sent message to the upper layer,
       // which in return decides whether sending of the enqueued messaged must
-      // continue. Then, the callback erase the message.
-      auto eraseAndReturnNextMessage =
-        [&, onSent](ErrorCode<N> erc, I itSent) mutable -> boost::optional<I> {
+      // continue. Then, the callback erase the messages.
+      auto eraseAndReturnNextBatch =
+        [&, onSent](ErrorCode<N> erc, Batch sent) mutable -> boost::optional<Batch> {
           // It's ok to allow new sendings once the current one is complete.
-          bool mustContinue = false;
-          boost::optional<I> itNext;
+          bool mustContinue = true;
+          boost::optional<Batch> next;
           try
           {
             // A scoped is used to cope with potential exception thrown by onSent.
             auto scopedErase = ka::scoped([&] {
               std::lock_guard<std::mutex> lock{_sendMutex};
-              _sendQueue.erase(itSent);
-              if (!mustContinue || _sendQueue.empty())
+              eraseSent(sent);
+              if (!mustContinue || queuesEmpty())
               {
                 QI_ASSERT(_sending);
                 if (!_sending)
@@ -349,19 +830,25 @@ namespace qi { namespace sock {
                 _sending = false;
                 return;
               }
-              itNext = _sendQueue.begin();
+              next = frontBatch();
+            });
+            // If an exception is thrown, the send loop must stop.
+            mustContinue = false;
+            bool allMustContinue = true;
+            forEachMessage(sent, [&](ReadableMessage itSent) {
+              allMustContinue = onSent(erc, itSent) && allMustContinue;
             });
-            mustContinue = onSent(erc, itSent);
+            mustContinue = allMustContinue;
           }
           catch (const std::exception& e)
           {
             qiLogError(logCategory()) << "Error in post-send phase: " << e.what();
             throw;
           }
-          return itNext;
+          return next;
         };
 
-      sendMessage<N>(_socket, itMsg, std::move(eraseAndReturnNextMessage), ssl,
+      sendMessageBatch<N>(_socket, batch, std::move(eraseAndReturnNextBatch), ssl,
         lifetimeTransfo, syncTransfo);
     }
   }
@@ -0,0 +1,166 @@
+/*
+**  Copyright (C) 2012 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <boost/algorithm/string/predicate.hpp>
+#include <qi/assert.hpp>
+#include <qi/log.hpp>
+#include <qi/os.hpp>
+#include "sendqueuemonitor.hpp"
+
+qiLogCategory("qimessaging.messagesocket");
+
+namespace qi { namespace sock {
+
+  SendQueueMonitor::Limits SendQueueMonitor::Limits::unlimited()
+  {
+    const auto max = std::numeric_limits<std::size_t>::max();
+    return {max, max, max, max, EventPolicy::Keep};
+  }
+
+  SendQueueMonitor::SendQueueMonitor(Limits limits)
+    : _limits(limits)
+    , _depth{0u, 0u}
+    , _stats{0u, 0u, 0u, {0u, 0u}}
+    , _full(false)
+    , _notFullPromise(FutureCallbackType_Async)
+  {
+    _notFullPromise.setValue(nullptr);
+  }
+
+  void SendQueueMonitor::added(std::size_t byteCount)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_depth.messageCount;
+    _depth.byteCount += byteCount;
+    updateMax();
+    updateFull();
+  }
+
+  void SendQueueMonitor::removed(std::size_t messageCount, std::size_t byteCount)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    QI_ASSERT(messageCount <= _depth.messageCount && byteCount <= _depth.byteCount);
+    _depth.messageCount -= std::min(messageCount, _depth.messageCount);
+    _depth.byteCount -= std::min(byteCount, _depth.byteCount);
+    updateFull();
+  }
+
+  void SendQueueMonitor::replaced(std::size_t oldByteCount, std::size_t newByteCount)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _depth.byteCount -= std::min(oldByteCount, _depth.byteCount);
+    _depth.byteCount += newByteCount;
+    updateMax();
+    updateFull();
+  }
+
+  void SendQueueMonitor::eventDropped()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_stats.droppedEventCount;
+  }
+
+  void SendQueueMonitor::eventCoalesced()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_stats.coalescedEventCount;
+  }
+
+  void SendQueueMonitor::updateMax()
+  {
+    auto& maxDepth = _stats.maxDepth;
+    maxDepth.messageCount = std::max(maxDepth.messageCount, _depth.messageCount);
+    maxDepth.byteCount = std::max(maxDepth.byteCount, _depth.byteCount);
+  }
+
+  void SendQueueMonitor::updateFull()
+  {
+    if (!_full)
+    {
+      if (_depth.messageCount < _limits.highMessageCount
+          && _depth.byteCount < _limits.highByteCount)
+        return;
+      _full = true;
+      ++_stats.fullCount;
+      _notFullPromise = Promise<void>(FutureCallbackType_Async);
+      qiLogVerbose() << "Send queue full: " << _depth.messageCount << " message(s), "
+                     << _depth.byteCount << " byte(s).";
+    }
+    else
+    {
+      if (_depth.messageCount > _limits.lowMessageCount
+          || _depth.byteCount > _limits.lowByteCount)
+        return;
+      _full = false;
+      _notFullPromise.setValue(nullptr);
+    }
+  }
+
+  bool SendQueueMonitor::isFull() const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _full;
+  }
+
+  SendQueueMonitor::Depth SendQueueMonitor::depth() const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _depth;
+  }
+
+  SendQueueMonitor::Stats SendQueueMonitor::stats() const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+  }
+
+  Future<void> SendQueueMonitor::notFull() const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _notFullPromise.future();
+  }
+
+  namespace
+  {
+    void setFromEnv(std::size_t& value, const char* name)
+    {
+      const auto str = os::getenv(name);
+      if (!str.empty())
+        value = std::strtoul(str.c_str(), 0, 0);
+    }
+  } // anonymous namespace
+
+  SendQueueMonitor::Limits getSendQueueLimitsFromEnv()
+  {
+    static const auto limits = [] {
+      using EventPolicy = SendQueueMonitor::EventPolicy;
+      auto limits = SendQueueMonitor::Limits::unlimited();
+      setFromEnv(limits.highMessageCount, "QIMESSAGING_SOCKET_SEND_QUEUE_HIGH_MESSAGES");
+      setFromEnv(limits.highByteCount, "QIMESSAGING_SOCKET_SEND_QUEUE_HIGH_BYTES");
+      const auto max = std::numeric_limits<std::size_t>::max();
+      if (limits.highMessageCount != max)
+        limits.lowMessageCount = limits.highMessageCount / 2u;
+      if (limits.highByteCount != max)
+        limits.lowByteCount = limits.highByteCount / 2u;
+      setFromEnv(limits.lowMessageCount, "QIMESSAGING_SOCKET_SEND_QUEUE_LOW_MESSAGES");
+      setFromEnv(limits.lowByteCount, "QIMESSAGING_SOCKET_SEND_QUEUE_LOW_BYTES");
+
+      const auto policy = os::getenv("QIMESSAGING_SOCKET_SEND_QUEUE_EVENT_POLICY");
+      if (boost::iequals(policy, "drop"))
+        limits.eventPolicy = EventPolicy::Drop;
+      else if (boost::iequals(policy, "coalesce"))
+        limits.eventPolicy = EventPolicy::Coalesce;
+      else if (!policy.empty() && !boost::iequals(policy, "keep"))
+        qiLogWarning() << "Ignoring invalid QIMESSAGING_SOCKET_SEND_QUEUE_EVENT_POLICY '"
+                       << policy << "'.";
+      return limits;
+    }();
+    return limits;
+  }
+
+}} // namespace qi::sock
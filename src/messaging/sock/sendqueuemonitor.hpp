@@ -0,0 +1,146 @@
+#pragma once
+#ifndef _QI_SOCK_SENDQUEUEMONITOR_HPP
+#define _QI_SOCK_SENDQUEUEMONITOR_HPP
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ka/macroregular.hpp>
+#include <qi/api.hpp>
+#include <qi/future.hpp>
+
+/// @file
+/// Contains the watermarks of the send queue of a socket.
+
+namespace qi { namespace sock {
+
+  /// Keeps track of the depth of the send queue of a socket and tells whether
+  /// it is full, so that producers can slow down instead of letting the queue
+  /// grow without limit.
+  ///
+  /// The queue becomes full when its number of messages or of bytes reaches a
+  /// high watermark. It stays full until both its number of messages and of
+  /// bytes fall to the low watermarks.
+  ///
+  /// The monitor does not refuse messages: it is up to the producers to wait
+  /// for the queue not to be full. The queue however applies the event policy
+  /// to the events sent while it is full.
+  ///
+  /// All methods can be called concurrently from any thread.
+  class QI_API SendQueueMonitor
+  {
+  public:
+    /// What happens to an event sent while the queue is full.
+    enum class EventPolicy
+    {
+      /// The event is queued, like any other message.
+      Keep,
+      /// The event is not sent.
+      Drop,
+      /// The event replaces a queued event of the same signal if there is one
+      /// that is not being written, so that only the latest value is sent.
+      Coalesce,
+    };
+
+    struct Limits
+    {
+      std::size_t highMessageCount;
+      std::size_t highByteCount;
+      std::size_t lowMessageCount;
+      std::size_t lowByteCount;
+      EventPolicy eventPolicy;
+
+    // Regular:
+      KA_GENERATE_FRIEND_REGULAR_OPS_5(Limits, highMessageCount, highByteCount,
+                                       lowMessageCount, lowByteCount, eventPolicy)
+
+      /// The queue is never full.
+      static Limits unlimited();
+    };
+
+    struct Depth
+    {
+      std::size_t messageCount;
+      std::size_t byteCount;
+
+    // Regular:
+      KA_GENERATE_FRIEND_REGULAR_OPS_2(Depth, messageCount, byteCount)
+    };
+
+    struct Stats
+    {
+      /// Number of times the queue became full.
+      std::uint64_t fullCount;
+      /// Number of events dropped or coalesced because the queue was full.
+      std::uint64_t droppedEventCount;
+      std::uint64_t coalescedEventCount;
+      /// Maximum number of messages and of bytes the queue has held.
+      Depth maxDepth;
+
+    // Regular:
+      KA_GENERATE_FRIEND_REGULAR_OPS_4(Stats, fullCount, droppedEventCount, coalescedEventCount,
+                                       maxDepth)
+    };
+
+    explicit SendQueueMonitor(Limits limits = Limits::unlimited());
+    SendQueueMonitor(const SendQueueMonitor&) = delete;
+    SendQueueMonitor& operator=(const SendQueueMonitor&) = delete;
+
+    /// A message of `byteCount` bytes was queued.
+    void added(std::size_t byteCount);
+
+    /// Messages of `byteCount` bytes in total left the queue.
+    void removed(std::size_t messageCount, std::size_t byteCount);
+
+    /// A queued message of `oldByteCount` bytes was replaced by a message of
+    /// `newByteCount` bytes.
+    void replaced(std::size_t oldByteCount, std::size_t newByteCount);
+
+    void eventDropped();
+    void eventCoalesced();
+
+    bool isFull() const;
+
+    Depth depth() const;
+
+    Stats stats() const;
+
+    Limits limits() const
+    {
+      return _limits;
+    }
+
+    /// Returns a future set when the queue is no longer full, or a future that
+    /// is already set if it is not full.
+    Future<void> notFull() const;
+
+  private:
+    /// Precondition: The mutex is locked.
+    void updateMax();
+
+    /// Updates the full state after a change of the depth. The callbacks of
+    /// the futures returned by `notFull` are asynchronous, so that they can
+    /// send messages.
+    /// Precondition: The mutex is locked.
+    void updateFull();
+
+    const Limits _limits;
+    mutable std::mutex _mutex;
+    Depth _depth;
+    Stats _stats;
+    bool _full;
+    Promise<void> _notFullPromise;
+  };
+
+  /// Returns unlimited watermarks, possibly overridden by the environment
+  /// variables `QIMESSAGING_SOCKET_SEND_QUEUE_HIGH_MESSAGES`,
+  /// `QIMESSAGING_SOCKET_SEND_QUEUE_HIGH_BYTES`,
+  /// `QIMESSAGING_SOCKET_SEND_QUEUE_LOW_MESSAGES`,
+  /// `QIMESSAGING_SOCKET_SEND_QUEUE_LOW_BYTES` and
+  /// `QIMESSAGING_SOCKET_SEND_QUEUE_EVENT_POLICY` (`keep`, `drop` or
+  /// `coalesce`).
+  /// A low watermark that is not given is half the high one.
+  QI_API SendQueueMonitor::Limits getSendQueueLimitsFromEnv();
+
+}} // namespace qi::sock
+
+#endif // _QI_SOCK_SENDQUEUEMONITOR_HPP
@@ -0,0 +1,89 @@
+#pragma once
+#ifndef _QI_SOCK_SOCKETCOUNTERS_HPP
+#define _QI_SOCK_SOCKETCOUNTERS_HPP
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <qi/clock.hpp>
+#include <qi/messaging/messagesocketstats.hpp>
+
+/// @file
+/// Contains the counters of the traffic of a socket.
+
+namespace qi { namespace sock {
+
+  /// `DurationHistogram` that can be recorded and read concurrently from any
+  /// thread.
+  class AtomicDurationHistogram
+  {
+  public:
+    AtomicDurationHistogram() = default;
+    AtomicDurationHistogram(const AtomicDurationHistogram&) = delete;
+    AtomicDurationHistogram& operator=(const AtomicDurationHistogram&) = delete;
+
+    void record(Duration duration)
+    {
+      ++_counts[DurationHistogram::bucketOf(duration)];
+    }
+
+    DurationHistogram snapshot() const
+    {
+      DurationHistogram histogram;
+      for (std::size_t i = 0u; i != DurationHistogram::bucketCount; ++i)
+        histogram.counts[i] = _counts[i].load(std::memory_order_relaxed);
+      return histogram;
+    }
+
+  private:
+    std::array<std::atomic<std::uint64_t>, DurationHistogram::bucketCount> _counts{};
+  };
+
+  /// Counts the messages and bytes that go through a socket, and the time it
+  /// takes to handle the received ones.
+  /// Recording and reading can be done concurrently from any thread.
+  class SocketCounters
+  {
+  public:
+    SocketCounters() = default;
+    SocketCounters(const SocketCounters&) = delete;
+    SocketCounters& operator=(const SocketCounters&) = delete;
+
+    void sent(std::size_t byteCount)
+    {
+      ++_sentMessageCount;
+      _sentByteCount += byteCount;
+    }
+
+    void received(std::size_t byteCount)
+    {
+      ++_receivedMessageCount;
+      _receivedByteCount += byteCount;
+    }
+
+    void dispatched(Duration duration)
+    {
+      _dispatchTime.record(duration);
+    }
+
+    /// Fills the traffic and dispatch time members of the stats.
+    void fill(MessageSocketStats& stats) const
+    {
+      stats.sentMessageCount = _sentMessageCount.load(std::memory_order_relaxed);
+      stats.sentByteCount = _sentByteCount.load(std::memory_order_relaxed);
+      stats.receivedMessageCount = _receivedMessageCount.load(std::memory_order_relaxed);
+      stats.receivedByteCount = _receivedByteCount.load(std::memory_order_relaxed);
+      stats.dispatchTime = _dispatchTime.snapshot();
+    }
+
+  private:
+    std::atomic<std::uint64_t> _sentMessageCount{0u};
+    std::atomic<std::uint64_t> _sentByteCount{0u};
+    std::atomic<std::uint64_t> _receivedMessageCount{0u};
+    std::atomic<std::uint64_t> _receivedByteCount{0u};
+    AtomicDurationHistogram _dispatchTime;
+  };
+
+}} // namespace qi::sock
+
+#endif // _QI_SOCK_SOCKETCOUNTERS_HPP
@@ -1,6 +1,7 @@
 #pragma once
 #ifndef _QI_SOCK_TRAITS_HPP
 #define _QI_SOCK_TRAITS_HPP
+#include <type_traits>
 #include <ka/typetraits.hpp>
 #include "concept.hpp"
 
@@ -68,6 +69,12 @@ namespace qi { namespace sock {
   // Misc traits
   template<typename N>
   using ConstBuffer = typename N::const_buffer_type;
+
+  /// True if the sockets of the network are TCP sockets, on which options such
+  /// as "no delay" or keepalive apply. Networks over local sockets specialize
+  /// it to false.
+  template<typename N>
+  struct IsTcp : std::true_type {};
 }} // namespace qi::sock
 
 #endif // _QI_SOCK_TRAITS_HPP
@@ -0,0 +1,733 @@
+/*
+**  Copyright (C) 2012 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_map>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <qi/log.hpp>
+#include <qi/os.hpp>
+#include "uring.hpp"
+
+#if QI_SOCK_HAS_IO_URING
+# include <linux/io_uring.h>
+# include <fcntl.h>
+# include <poll.h>
+# include <sys/eventfd.h>
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+// Older headers lack it; older kernels never set it.
+# ifndef IORING_SQ_CQ_OVERFLOW
+#  define IORING_SQ_CQ_OVERFLOW (1U << 1)
+# endif
+#endif
+
+qiLogCategory("qimessaging.messagesocket");
+
+namespace qi { namespace sock {
+
+  namespace
+  {
+    std::atomic<SocketBackend>& currentSocketBackend()
+    {
+      static std::atomic<SocketBackend> backend{[] {
+        const auto str = os::getenv("QIMESSAGING_SOCKET_BACKEND");
+        if (boost::iequals(str, "uring"))
+        {
+          if (Uring::isSupported())
+            return SocketBackend::Uring;
+          qiLogWarning() << "io_uring is not supported by the system, using the asio socket backend.";
+        }
+        else if (!str.empty() && !boost::iequals(str, "asio"))
+        {
+          qiLogWarning() << "Ignoring invalid QIMESSAGING_SOCKET_BACKEND '" << str << "'.";
+        }
+        return SocketBackend::Asio;
+      }()};
+      return backend;
+    }
+  } // anonymous namespace
+
+  SocketBackend socketBackend()
+  {
+    return currentSocketBackend().load();
+  }
+
+  bool setSocketBackend(SocketBackend backend)
+  {
+    if (backend == SocketBackend::Uring && !Uring::isSupported())
+      return false;
+    currentSocketBackend() = backend;
+    return true;
+  }
+
+  boost::asio::io_service::id Uring::id;
+
+#if QI_SOCK_HAS_IO_URING
+
+  namespace
+  {
+    const unsigned entryCount = 256u;
+    // Registered buffers are locked in memory: keep them within the default
+    // RLIMIT_MEMLOCK of older kernels.
+    const std::size_t fixedBufferCount = 16u;
+    const std::size_t fixedBufferSize = 4096u;
+
+    int ioUringSetup(unsigned entries, io_uring_params* params)
+    {
+      return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int ioUringEnter(int fd, unsigned toSubmit, unsigned flags = 0u)
+    {
+      return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, 0u, flags, nullptr, 0u));
+    }
+
+    int ioUringRegister(int fd, unsigned opcode, const void* arg, unsigned argCount)
+    {
+      return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, argCount));
+    }
+
+    boost::system::error_code errorOf(int err)
+    {
+      return {err, boost::system::system_category()};
+    }
+
+    [[noreturn]] void throwSystemError(const char* what)
+    {
+      throw std::system_error(errno, std::system_category(), what);
+    }
+
+    std::size_t byteCount(const std::vector<iovec>& buffers)
+    {
+      std::size_t count = 0u;
+      for (const auto& b : buffers)
+        count += b.iov_len;
+      return count;
+    }
+
+    /// Removes the first `n` bytes of the buffers.
+    void consume(std::vector<iovec>& buffers, std::size_t n)
+    {
+      auto it = buffers.begin();
+      for (; it != buffers.end() && n >= it->iov_len; ++it)
+        n -= it->iov_len;
+      if (it != buffers.end())
+      {
+        it->iov_base = static_cast<char*>(it->iov_base) + n;
+        it->iov_len -= n;
+      }
+      buffers.erase(buffers.begin(), it);
+    }
+
+    /// Copies `n` bytes to the buffers.
+    void scatter(const std::vector<iovec>& buffers, const char* data, std::size_t n)
+    {
+      for (auto it = buffers.begin(); it != buffers.end() && n != 0u; ++it)
+      {
+        const auto len = std::min(n, it->iov_len);
+        std::memcpy(it->iov_base, data, len);
+        data += len;
+        n -= len;
+      }
+    }
+  } // anonymous namespace
+
+  struct Uring::Impl
+  {
+    struct Op
+    {
+      int fd;
+      /// Duplicate of `fd` on which the operation is submitted.
+      int pinnedFd;
+      bool write;
+      /// What remains to be transferred.
+      std::vector<iovec> buffers;
+      std::size_t transferred;
+      Handler handler;
+      /// Registered buffer of the pending read, if any.
+      int fixedIndex;
+      /// True while waiting for the file to be ready, after it refused to
+      /// block.
+      bool polling;
+      bool canceled;
+    };
+
+    explicit Impl(boost::asio::io_service& io)
+      : io(io)
+      , eventDescriptor(io)
+    {
+      io_uring_params params;
+      std::memset(&params, 0, sizeof(params));
+      ringFd = ioUringSetup(entryCount, &params);
+      if (ringFd < 0)
+        throwSystemError("io_uring_setup");
+      try
+      {
+        mapRings(params);
+        registerEventFd();
+      }
+      catch (...)
+      {
+        unmapRings();
+        ::close(ringFd);
+        throw;
+      }
+      registerFixedBuffers();
+    }
+
+    ~Impl()
+    {
+      close();
+    }
+
+    void mapRings(const io_uring_params& params)
+    {
+      sqEntries = params.sq_entries;
+      sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+      cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+      const bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0u;
+      if (singleMmap)
+        sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+
+      sqRing = map(sqRingSize, IORING_OFF_SQ_RING);
+      cqRing = singleMmap ? sqRing : map(cqRingSize, IORING_OFF_CQ_RING);
+      sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+      sqes = static_cast<io_uring_sqe*>(map(sqesSize, IORING_OFF_SQES));
+
+      auto sq = static_cast<char*>(sqRing);
+      sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+      sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+      sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+      sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+      sqFlags = reinterpret_cast<unsigned*>(sq + params.sq_off.flags);
+      auto cq = static_cast<char*>(cqRing);
+      cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+      cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+      cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+      cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    }
+
+    void* map(std::size_t size, unsigned long long offset)
+    {
+      void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ringFd, static_cast<off_t>(offset));
+      if (p == MAP_FAILED)
+        throwSystemError("io_uring mmap");
+      return p;
+    }
+
+    void unmapRings()
+    {
+      if (sqes)
+        ::munmap(sqes, sqesSize);
+      if (cqRing && cqRing != sqRing)
+        ::munmap(cqRing, cqRingSize);
+      if (sqRing)
+        ::munmap(sqRing, sqRingSize);
+      sqes = nullptr;
+      sqRing = cqRing = nullptr;
+    }
+
+    void registerEventFd()
+    {
+      const int fd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+      if (fd < 0)
+        throwSystemError("eventfd");
+      eventDescriptor.assign(fd);
+      if (ioUringRegister(ringFd, IORING_REGISTER_EVENTFD, &fd, 1u) < 0)
+        throwSystemError("io_uring_register eventfd");
+    }
+
+    void registerFixedBuffers()
+    {
+      fixedMemory.resize(fixedBufferCount * fixedBufferSize);
+      std::vector<iovec> iovecs;
+      for (std::size_t i = 0u; i != fixedBufferCount; ++i)
+        iovecs.push_back(iovec{&fixedMemory[i * fixedBufferSize], fixedBufferSize});
+      if (ioUringRegister(ringFd, IORING_REGISTER_BUFFERS, iovecs.data(),
+                          static_cast<unsigned>(iovecs.size())) < 0)
+      {
+        qiLogVerbose() << "Could not register io_uring buffers: " << std::strerror(errno)
+                       << ". Reads will not use them.";
+        fixedMemory.clear();
+        return;
+      }
+      for (std::size_t i = 0u; i != fixedBufferCount; ++i)
+        freeFixedIndexes.push_back(static_cast<int>(i));
+    }
+
+    void close()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (ringFd < 0)
+        return;
+      boost::system::error_code erc;
+      eventDescriptor.close(erc);
+      // Closing the ring cancels the pending operations. Their handlers are
+      // destroyed without being called, like those of the io service.
+      unmapRings();
+      ::close(ringFd);
+      ringFd = -1;
+      deferredOps.clear();
+      for (const auto& op : ops)
+        ::close(op.second->pinnedFd);
+      ops.clear();
+    }
+
+    void start(int fd, bool write, std::vector<iovec> buffers, Handler handler)
+    {
+      if (buffers.empty())
+      {
+        io.post([=] { handler(boost::system::error_code{}, 0u); });
+        return;
+      }
+      // The operation may be submitted after `fd` is closed and its number
+      // reused by another file, or go on after it with partial transfers.
+      const int pinnedFd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+      if (pinnedFd < 0)
+      {
+        const auto erc = errorOf(errno);
+        io.post([=] { handler(erc, 0u); });
+        return;
+      }
+      std::unique_ptr<Op> op(new Op{fd, pinnedFd, write, std::move(buffers), 0u, std::move(handler),
+                                    -1, false, false});
+      std::lock_guard<std::mutex> lock(mutex);
+      if (ringFd < 0)
+      {
+        ::close(pinnedFd);
+        return;
+      }
+      auto& p = *op;
+      ops.emplace(&p, std::move(op));
+      submit(p);
+      // Waiting only while operations are pending lets the io service run out
+      // of work.
+      if (!waiting)
+      {
+        waiting = true;
+        waitCompletions();
+      }
+    }
+
+    /// Precondition: The mutex is locked.
+    bool sqFull() const
+    {
+      return *sqTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries;
+    }
+
+    /// Returns null if the submission queue is still full after submitting
+    /// its entries, which happens while the completion queue is full.
+    /// Precondition: The mutex is locked.
+    io_uring_sqe* nextSqe()
+    {
+      if (sqFull())
+      {
+        submitNow();
+        if (sqFull())
+          return nullptr;
+      }
+      const auto tail = *sqTail;
+      auto& sqe = sqes[tail & *sqMask];
+      std::memset(&sqe, 0, sizeof(sqe));
+      sqArray[tail & *sqMask] = tail & *sqMask;
+      return &sqe;
+    }
+
+    /// Precondition: The mutex is locked.
+    void push()
+    {
+      __atomic_store_n(sqTail, *sqTail + 1u, __ATOMIC_RELEASE);
+      ++unsubmittedCount;
+      ++stats.submittedOpCount;
+      if (!flushPosted)
+      {
+        flushPosted = true;
+        io.post([this] { flush(); });
+      }
+    }
+
+    /// Operations that find the submission queue full wait for the next reap.
+    /// Precondition: The mutex is locked.
+    void submit(Op& op)
+    {
+      if (!deferredOps.empty())
+      {
+        deferredOps.push_back(&op);
+        return;
+      }
+      const auto next = nextSqe();
+      if (!next)
+      {
+        deferredOps.push_back(&op);
+        return;
+      }
+      auto& sqe = *next;
+      sqe.fd = op.pinnedFd;
+      sqe.user_data = reinterpret_cast<std::uintptr_t>(&op);
+      const auto remaining = byteCount(op.buffers);
+      if (op.polling)
+      {
+        sqe.opcode = IORING_OP_POLL_ADD;
+        sqe.poll_events = op.write ? POLLOUT : POLLIN;
+      }
+      else if (!op.write && remaining <= fixedBufferSize && !freeFixedIndexes.empty())
+      {
+        op.fixedIndex = freeFixedIndexes.back();
+        freeFixedIndexes.pop_back();
+        sqe.opcode = IORING_OP_READ_FIXED;
+        sqe.addr = reinterpret_cast<std::uintptr_t>(fixedBuffer(op.fixedIndex));
+        sqe.len = static_cast<std::uint32_t>(remaining);
+        sqe.buf_index = static_cast<std::uint16_t>(op.fixedIndex);
+        ++stats.fixedReadCount;
+      }
+      else
+      {
+        sqe.opcode = op.write ? IORING_OP_WRITEV : IORING_OP_READV;
+        sqe.addr = reinterpret_cast<std::uintptr_t>(op.buffers.data());
+        sqe.len = static_cast<std::uint32_t>(std::min<std::size_t>(op.buffers.size(), IOV_MAX));
+      }
+      push();
+    }
+
+    void cancel(int fd)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (ringFd < 0)
+        return;
+      for (const auto& entry : ops)
+      {
+        auto& op = *entry.second;
+        if (op.fd != fd || op.canceled)
+          continue;
+        op.canceled = true;
+        const auto deferred = std::find(deferredOps.begin(), deferredOps.end(), &op);
+        if (deferred != deferredOps.end())
+        {
+          deferredOps.erase(deferred);
+          auto aborted = &op;
+          io.post([this, aborted] { finish(*aborted, boost::asio::error::operation_aborted); });
+          continue;
+        }
+        // Submitted after the operation, if it is not yet. Its own completion
+        // is ignored.
+        const auto next = nextSqe();
+        if (!next)
+        {
+          qiLogVerbose() << "Could not cancel an io_uring operation, the rings are full. "
+                            "It completes when its socket is shut down.";
+          continue;
+        }
+        next->opcode = op.polling ? IORING_OP_POLL_REMOVE : IORING_OP_ASYNC_CANCEL;
+        next->addr = reinterpret_cast<std::uintptr_t>(&op);
+        push();
+      }
+    }
+
+    char* fixedBuffer(int index)
+    {
+      return &fixedMemory[static_cast<std::size_t>(index) * fixedBufferSize];
+    }
+
+    /// Precondition: The mutex is locked.
+    void submitNow()
+    {
+      while (unsubmittedCount != 0u)
+      {
+        const int res = ioUringEnter(ringFd, unsubmittedCount);
+        if (res < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          // The completion queue is full: submit again once it is reaped.
+          if (errno != EAGAIN && errno != EBUSY)
+            qiLogWarning() << "io_uring_enter failed: " << std::strerror(errno);
+          return;
+        }
+        ++stats.submitCallCount;
+        unsubmittedCount -= std::min(unsubmittedCount, static_cast<unsigned>(res));
+      }
+    }
+
+    /// Precondition: The mutex is locked.
+    void submitDeferred()
+    {
+      std::deque<Op*> deferred;
+      deferred.swap(deferredOps);
+      // Operations that still do not fit are deferred again, in order.
+      for (const auto op : deferred)
+        submit(*op);
+    }
+
+    void flush()
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      flushPosted = false;
+      if (ringFd >= 0)
+        submitNow();
+    }
+
+    /// Precondition: The mutex is locked.
+    void waitCompletions()
+    {
+      eventDescriptor.async_wait(boost::asio::posix::stream_descriptor::wait_read,
+        [this](const boost::system::error_code& erc) {
+          if (erc)
+            return;
+          std::uint64_t value;
+          while (::read(eventDescriptor.native_handle(), &value, sizeof(value)) > 0)
+            ;
+          reap();
+          std::lock_guard<std::mutex> lock(mutex);
+          if (ringFd < 0 || ops.empty())
+            waiting = false;
+          else
+            waitCompletions();
+        });
+    }
+
+    void reap()
+    {
+      std::vector<std::pair<Op*, int>> completions;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ringFd < 0)
+          return;
+        while (true)
+        {
+          auto head = *cqHead;
+          const auto tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+          for (; head != tail; ++head)
+          {
+            const auto& cqe = cqes[head & *cqMask];
+            if (cqe.user_data != 0u)
+              completions.emplace_back(reinterpret_cast<Op*>(cqe.user_data), cqe.res);
+          }
+          __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+          // Completions that overflowed the queue are kept by the kernel
+          // until they are asked for.
+          if ((__atomic_load_n(sqFlags, __ATOMIC_ACQUIRE) & IORING_SQ_CQ_OVERFLOW) == 0u)
+            break;
+          if (ioUringEnter(ringFd, 0u, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+            break;
+        }
+        // Submissions refused while the completion queue was full.
+        if (unsubmittedCount != 0u)
+          submitNow();
+        submitDeferred();
+      }
+      for (const auto& completion : completions)
+        complete(*completion.first, completion.second);
+    }
+
+    void complete(Op& op, int res)
+    {
+      bool canceled;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (op.fixedIndex >= 0)
+        {
+          if (res > 0)
+            scatter(op.buffers, fixedBuffer(op.fixedIndex), static_cast<std::size_t>(res));
+          freeFixedIndexes.push_back(op.fixedIndex);
+          op.fixedIndex = -1;
+        }
+        canceled = op.canceled;
+        if (canceled)
+        {
+          // The operation does not go on, whatever its result.
+          if (res > 0 && !op.polling)
+            op.transferred += static_cast<std::size_t>(res);
+        }
+        else if (op.polling)
+        {
+          op.polling = false;
+          if (res >= 0)
+          {
+            submit(op);
+            return;
+          }
+        }
+        else if (res == -EAGAIN || res == -EINTR || (res == 0 && op.write))
+        {
+          // The socket is in non-blocking mode: wait for it to be ready.
+          op.polling = true;
+          submit(op);
+          return;
+        }
+        else if (res > 0)
+        {
+          consume(op.buffers, static_cast<std::size_t>(res));
+          op.transferred += static_cast<std::size_t>(res);
+          if (!op.buffers.empty())
+          {
+            submit(op);
+            return;
+          }
+        }
+      }
+
+      boost::system::error_code erc;
+      if (canceled)
+        erc = boost::asio::error::operation_aborted;
+      else if (res < 0)
+        erc = errorOf(-res);
+      else if (res == 0 && !op.write)
+        erc = boost::asio::error::eof;
+      finish(op, erc);
+    }
+
+    void finish(Op& op, const boost::system::error_code& erc)
+    {
+      std::unique_ptr<Op> done;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = ops.find(&op);
+        if (it == ops.end())
+          return;
+        done = std::move(it->second);
+        ops.erase(it);
+      }
+      ::close(done->pinnedFd);
+      done->handler(erc, done->transferred);
+    }
+
+    boost::asio::io_service& io;
+    boost::asio::posix::stream_descriptor eventDescriptor;
+    int ringFd = -1;
+    unsigned sqEntries = 0u;
+    void* sqRing = nullptr;
+    std::size_t sqRingSize = 0u;
+    void* cqRing = nullptr;
+    std::size_t cqRingSize = 0u;
+    io_uring_sqe* sqes = nullptr;
+    std::size_t sqesSize = 0u;
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned* sqFlags = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    std::mutex mutex;
+    unsigned unsubmittedCount = 0u;
+    bool flushPosted = false;
+    bool waiting = false;
+    std::unordered_map<Op*, std::unique_ptr<Op>> ops;
+    std::deque<Op*> deferredOps;
+    std::vector<char> fixedMemory;
+    std::vector<int> freeFixedIndexes;
+    Stats stats{0u, 0u, 0u};
+  };
+
+  bool Uring::isSupported()
+  {
+    static const bool supported = [] {
+      try
+      {
+        boost::asio::io_service io;
+        Impl ring(io);
+        return true;
+      }
+      catch (const std::exception& e)
+      {
+        qiLogVerbose() << "io_uring is not available: " << e.what();
+        return false;
+      }
+    }();
+    return supported;
+  }
+
+  Uring::Uring(boost::asio::io_service& io)
+    : boost::asio::io_service::service(io)
+    , _p(new Impl(io))
+  {
+  }
+
+  void Uring::asyncRead(int fd, std::vector<iovec> buffers, Handler handler)
+  {
+    _p->start(fd, false, std::move(buffers), std::move(handler));
+  }
+
+  void Uring::asyncWrite(int fd, std::vector<iovec> buffers, Handler handler)
+  {
+    _p->start(fd, true, std::move(buffers), std::move(handler));
+  }
+
+  void Uring::cancel(int fd)
+  {
+    _p->cancel(fd);
+  }
+
+  Uring::Stats Uring::stats() const
+  {
+    std::lock_guard<std::mutex> lock(_p->mutex);
+    return _p->stats;
+  }
+
+  void Uring::shutdown_service()
+  {
+    _p->close();
+  }
+
+#else // QI_SOCK_HAS_IO_URING
+
+  struct Uring::Impl
+  {
+  };
+
+  bool Uring::isSupported()
+  {
+    return false;
+  }
+
+  Uring::Uring(boost::asio::io_service& io)
+    : boost::asio::io_service::service(io)
+  {
+    throw std::runtime_error("io_uring is not supported on this system");
+  }
+
+  void Uring::asyncRead(int, std::vector<iovec>, Handler handler)
+  {
+    get_io_service().post([=] { handler(boost::asio::error::operation_not_supported, 0u); });
+  }
+
+  void Uring::asyncWrite(int, std::vector<iovec>, Handler handler)
+  {
+    get_io_service().post([=] { handler(boost::asio::error::operation_not_supported, 0u); });
+  }
+
+  void Uring::cancel(int)
+  {
+  }
+
+  Uring::Stats Uring::stats() const
+  {
+    return {0u, 0u, 0u};
+  }
+
+  void Uring::shutdown_service()
+  {
+  }
+
+#endif // QI_SOCK_HAS_IO_URING
+
+  Uring::~Uring() = default;
+
+}} // namespace qi::sock
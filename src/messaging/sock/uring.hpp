@@ -0,0 +1,141 @@
+#pragma once
+#ifndef _QI_SOCK_URING_HPP
+#define _QI_SOCK_URING_HPP
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/predef.h>
+#include <boost/system/error_code.hpp>
+#include <ka/macroregular.hpp>
+#include <qi/api.hpp>
+
+#if BOOST_OS_LINUX && defined(__has_include)
+# if __has_include(<linux/io_uring.h>)
+#  define QI_SOCK_HAS_IO_URING 1
+# endif
+#endif
+
+#ifndef QI_SOCK_HAS_IO_URING
+# define QI_SOCK_HAS_IO_URING 0
+#endif
+
+#include <sys/uio.h>
+
+/// @file
+/// Contains an io_uring instance bound to an io service, to read from and
+/// write to sockets with fewer system calls than the reactor of the io service.
+
+namespace qi { namespace sock {
+
+  /// Low-level implementation used to read from and write to plain sockets.
+  enum class SocketBackend
+  {
+    /// The reactor of Boost.Asio (epoll on Linux).
+    Asio,
+    /// An io_uring instance per io service (Linux only).
+    Uring,
+  };
+
+  /// Returns the backend used by the sockets created from now on.
+  /// It is initially `SocketBackend::Asio`, or the value of the environment
+  /// variable `QIMESSAGING_SOCKET_BACKEND` (`asio` or `uring`). The io_uring
+  /// backend is only used if the system supports it.
+  QI_API SocketBackend socketBackend();
+
+  /// Changes the backend used by the sockets created from now on. Existing
+  /// sockets keep theirs.
+  /// Returns false if the backend is not supported by the system, in which case
+  /// nothing is changed.
+  QI_API bool setSocketBackend(SocketBackend backend);
+
+  /// io_uring instance bound to an io service, as one of its services.
+  ///
+  /// Operations are queued and submitted all at once after the current handler
+  /// of the io service returns, so that the operations started by a handler
+  /// cost a single system call. Completions are signaled through an eventfd
+  /// waited for by the io service, and their handlers run on it.
+  ///
+  /// Small reads go through buffers registered once for all to the kernel,
+  /// and are then copied to their destination.
+  ///
+  /// Like Boost.Asio composed operations, a read completes when the buffers
+  /// are full and a write when all the data is written, or on error. A read
+  /// at the end of the stream fails with `boost::asio::error::eof`.
+  ///
+  /// Operations are submitted on a duplicate of the file descriptor, so that
+  /// they never apply to another file if the descriptor is closed and its
+  /// number reused. The duplicate keeps the file open: shut the socket down or
+  /// `cancel` its operations before closing it.
+  ///
+  /// All methods can be called concurrently from any thread.
+  class QI_API Uring : public boost::asio::io_service::service
+  {
+  public:
+    using Handler = std::function<void (boost::system::error_code, std::size_t)>;
+
+    struct Stats
+    {
+      /// Number of system calls that submitted operations.
+      std::uint64_t submitCallCount;
+      /// Number of operations submitted, partial transfers included.
+      std::uint64_t submittedOpCount;
+      /// Number of reads done through the registered buffers.
+      std::uint64_t fixedReadCount;
+
+    // Regular:
+      KA_GENERATE_FRIEND_REGULAR_OPS_3(Stats, submitCallCount, submittedOpCount, fixedReadCount)
+    };
+
+    static boost::asio::io_service::id id;
+
+    explicit Uring(boost::asio::io_service& io);
+    ~Uring() override;
+
+    /// True if io_uring instances can be created on this system.
+    static bool isSupported();
+
+    /// Reads from the file descriptor until the buffers are full.
+    void asyncRead(int fd, std::vector<iovec> buffers, Handler handler);
+
+    /// Writes the whole buffers to the file descriptor.
+    void asyncWrite(int fd, std::vector<iovec> buffers, Handler handler);
+
+    /// Cancels the operations pending on the file descriptor, including the
+    /// ones not submitted yet. Their handlers are called with
+    /// `boost::asio::error::operation_aborted`.
+    void cancel(int fd);
+
+    Stats stats() const;
+
+  private:
+    void shutdown_service() override;
+
+    struct Impl;
+    std::unique_ptr<Impl> _p;
+  };
+
+  /// Returns the buffers of a Boost.Asio buffer sequence as iovecs.
+  ///
+  /// ConstBufferSequence B
+  template<typename B>
+  std::vector<iovec> toIovecs(const B& buffers)
+  {
+    std::vector<iovec> iovecs;
+    for (auto it = boost::asio::buffer_sequence_begin(buffers),
+              end = boost::asio::buffer_sequence_end(buffers);
+         it != end; ++it)
+    {
+      const boost::asio::const_buffer b(*it);
+      if (b.size() != 0u)
+        iovecs.push_back(iovec{const_cast<void*>(b.data()), b.size()});
+    }
+    return iovecs;
+  }
+
+}} // namespace qi::sock
+
+#endif // _QI_SOCK_URING_HPP
@@ -3,9 +3,12 @@
 **  See COPYING for the license
 */
 
+#include <algorithm>
 #include <boost/algorithm/string.hpp>
 
 #include "streamcontext.hpp"
+#include "sharedmemorybuffer.hpp"
+#include <src/type/metaobject_p.hpp>
 
 namespace qi
 {
@@ -17,25 +20,45 @@ namespace qi
     char const * const remoteCancelableCalls = "RemoteCancelableCalls";
     char const * const objectPtrUid          = "ObjectPtrUID";
     char const * const relativeEndpointUri   = "RelativeEndpointURI";
+    char const * const sharedMemoryBuffers   = "SharedMemoryBuffers";
+    char const * const sharedMemoryBuffersAccepted = "SharedMemoryBuffersAccepted";
+    char const * const callDeadline          = "CallDeadline";
+    char const * const callPriority          = "CallPriority";
+  }
+
+  namespace
+  {
+    const std::size_t minExportedSharedMemorySegmentsPruneSize = 1024;
+
+    // Where the MetaObjects transmitted in full by the message this thread is
+    // encoding are recorded, if any.
+    thread_local const StreamContext* recordingContext = nullptr;
+    thread_local std::vector<unsigned int>* recordedUids = nullptr;
+    thread_local std::vector<std::string>* recordedSegments = nullptr;
   }
 
 
 StreamContext::StreamContext()
+  : _exportedSharedMemorySegmentsPruneSize(minExportedSharedMemorySegmentsPruneSize)
 {
   _localCapabilityMap = StreamContext::defaultCapabilities();
 }
 
 StreamContext::~StreamContext()
 {
+  for (const auto& name : _exportedSharedMemorySegments)
+    shm::unlinkSegment(name);
 }
 
 void StreamContext::advertiseCapability(const std::string& key, const AnyValue& value)
 {
+  boost::mutex::scoped_lock lock(_contextMutex);
   _localCapabilityMap[key] = value;
 }
 
 void StreamContext::advertiseCapabilities(const CapabilityMap &map)
 {
+  boost::mutex::scoped_lock lock(_contextMutex);
   _localCapabilityMap.insert(map.begin(), map.end());
 }
 
@@ -94,21 +117,86 @@ void StreamContext::receiveCacheSet(unsigned int uid, const MetaObject& mo)
 
 std::pair<unsigned int, bool> StreamContext::sendCacheSet(const MetaObject& mo)
 {
+  const auto digest = mo._p->contentSHA1();
+  const bool recorded = recordingContext == this;
   boost::mutex::scoped_lock lock(_contextMutex);
-  SendMetaObjectCache::iterator it = _sendMetaObjectCache.find(mo);
+  auto it = _sendMetaObjectCache.find(digest);
   if (it == _sendMetaObjectCache.end())
   {
-    unsigned int v = ++_cacheNextId;
-    _sendMetaObjectCache[mo] = v;
-    return std::make_pair(v, true);
+    const unsigned int uid = ++_cacheNextId;
+    _sendMetaObjectCache.emplace(digest, uid);
+    if (recorded)
+    {
+      _unconfirmedSendCache.insert(uid);
+      recordedUids->push_back(uid);
+    }
+    return std::make_pair(uid, true);
   }
-  else
-    return std::make_pair(it->second, false);
+  const unsigned int uid = it->second;
+  if (_unconfirmedSendCache.count(uid) == 0)
+    return std::make_pair(uid, false);
+  if (recorded)
+    recordedUids->push_back(uid);
+  return std::make_pair(uid, true);
+}
+
+void StreamContext::sendCacheConfirm(const std::vector<unsigned int>& uids)
+{
+  if (uids.empty())
+    return;
+  boost::mutex::scoped_lock lock(_contextMutex);
+  for (const auto uid : uids)
+    _unconfirmedSendCache.erase(uid);
+}
+
+StreamContext::SendCacheRecorder::SendCacheRecorder(const StreamContext* context,
+                                                    std::vector<unsigned int>& uids,
+                                                    std::vector<std::string>& segments)
+  : _previousContext(recordingContext)
+  , _previousUids(recordedUids)
+  , _previousSegments(recordedSegments)
+{
+  if (!context)
+    return;
+  recordingContext = context;
+  recordedUids = &uids;
+  recordedSegments = &segments;
+}
+
+StreamContext::SendCacheRecorder::~SendCacheRecorder()
+{
+  recordingContext = _previousContext;
+  recordedUids = _previousUids;
+  recordedSegments = _previousSegments;
+}
+
+void StreamContext::sharedMemorySegmentExported(const std::string& name)
+{
+  if (recordingContext == this)
+    recordedSegments->push_back(name);
+  boost::mutex::scoped_lock lock(_contextMutex);
+  auto& segments = _exportedSharedMemorySegments;
+  segments.push_back(name);
+  if (segments.size() < _exportedSharedMemorySegmentsPruneSize)
+    return;
+  // Only forget the names that the other end removed: the other segments are
+  // still ours to remove.
+  segments.erase(std::remove_if(segments.begin(), segments.end(),
+                                [](const std::string& segment) {
+                                  return !shm::segmentExists(segment);
+                                }),
+                 segments.end());
+  _exportedSharedMemorySegmentsPruneSize =
+      std::max(minExportedSharedMemorySegmentsPruneSize, 2 * segments.size());
 }
 
 static CapabilityMap* _defaultCapabilities = nullptr;
 static void initCapabilities()
 {
+  // The MetaObject cache is disabled: the receiving end decodes the messages
+  // asynchronously once they are dispatched (see MessageDispatcher::dispatch),
+  // so a message referring to a cached MetaObject may be decoded before the
+  // one transmitting it.
   static const CapabilityMap defaultCaps =
   { { capabilityname::clientServerSocket   , AnyValue::from(true)  }
   , { capabilityname::messageFlags         , AnyValue::from(true)  }
@@ -116,9 +204,13 @@ static void initCapabilities()
   , { capabilityname::remoteCancelableCalls, AnyValue::from(true)  }
   , { capabilityname::objectPtrUid         , AnyValue::from(true)  }
   , { capabilityname::relativeEndpointUri  , AnyValue::from(true)  }
+  , { capabilityname::callDeadline         , AnyValue::from(true)  }
+  , { capabilityname::callPriority         , AnyValue::from(true)  }
   };
 
   _defaultCapabilities = new CapabilityMap(defaultCaps);
+  if (const auto probe = shm::probeSegmentName())
+    (*_defaultCapabilities)[capabilityname::sharedMemoryBuffers] = AnyValue::from(*probe);
 
   // Process override from environment
   std::string capstring = qi::os::getenv("QI_TRANSPORT_CAPABILITIES");
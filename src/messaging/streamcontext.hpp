@@ -10,7 +10,12 @@
 #include <qi/api.hpp>
 #include <qi/anyvalue.hpp>
 #include <qi/type/metaobject.hpp>
+#include <ka/sha1.hpp>
+#include <cstring>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace qi
 {
@@ -41,6 +46,23 @@ using CapabilityMap = std::map<std::string, AnyValue>;
     // Capability: ServiceDirectory may add relative endpoints to services to the list of endpoints
     // in service information.
     QI_API extern char const * const relativeEndpointUri;
+
+    // Capability: big buffers can be passed through shared memory segments
+    // (binary protocol change). The value is the name of a probe segment
+    // that the other end opens to check that it can open our segments.
+    QI_API extern char const * const sharedMemoryBuffers;
+
+    // Capability: the value is the name of the probe segment of the other end,
+    // which could be opened. Advertised once the probe succeeded.
+    QI_API extern char const * const sharedMemoryBuffersAccepted;
+
+    // Capability: calls may carry the time left before their deadline
+    // (Message::TypeFlag_Deadline), after which they are not executed.
+    QI_API extern char const * const callDeadline;
+
+    // Capability: the replies to calls take the priority class the calls carry
+    // (Message::TypeFlag_ControlPriority and TypeFlag_BulkPriority).
+    QI_API extern char const * const callPriority;
   }
 
   /// State of the `RelativeEndpointsUri` capability.
@@ -56,7 +78,10 @@ using CapabilityMap = std::map<std::string, AnyValue>;
  * - A map of local and remote capabilities. Overload advertiseCapabilities() to
  *   perform the actual sending of local capabilities to the remote endpoint.
  * - A MetaObject cache so that any given MetaObject is sent in full only once
- *   for each transport stream.
+ *   for each transport stream, or until a message sending it was written if
+ *   the encoding of this message was recorded (see SendCacheRecorder).
+ * - The shared memory segments exported to the remote endpoint, which are
+ *   removed when the stream is destroyed in case they were never received.
  */
 class QI_API StreamContext
 {
@@ -101,9 +126,40 @@ public:
   template<typename T>
   T sharedCapability(const std::string& key, const T& defaultValue) const;
 
-  /// Return (cacheUid, wasInserted)
+  /// Return (cacheUid, mustTransmit): the MetaObject must be transmitted in
+  /// full while the other end may not know it yet.
   std::pair<unsigned int, bool> sendCacheSet(const MetaObject& mo);
 
+  /// Mark MetaObjects as known by the other end, once a message transmitting
+  /// them in full was written to the stream.
+  void sendCacheConfirm(const std::vector<unsigned int>& uids);
+
+  /** Record the uids of the MetaObjects that this thread transmits in full on
+   * the stream while it exists, so that they are only confirmed once the
+   * message being encoded is written. Messages are not always written in the
+   * order they are encoded: until then, other messages transmit them in full
+   * too. Without recorder, they are confirmed immediately.
+   *
+   * The names of the shared memory segments exported meanwhile are recorded
+   * too, so that they can be removed if the message is never written.
+   */
+  class QI_API SendCacheRecorder
+  {
+  public:
+    /// Records nothing if context is null.
+    SendCacheRecorder(const StreamContext* context, std::vector<unsigned int>& uids,
+                      std::vector<std::string>& segments);
+    ~SendCacheRecorder();
+
+    SendCacheRecorder(const SendCacheRecorder&) = delete;
+    SendCacheRecorder& operator=(const SendCacheRecorder&) = delete;
+
+  private:
+    const StreamContext* _previousContext;
+    std::vector<unsigned int>* _previousUids;
+    std::vector<std::string>* _previousSegments;
+  };
+
   void receiveCacheSet(unsigned int uid, const MetaObject& mo);
 
   MetaObject receiveCacheGet(unsigned int uid) const;
@@ -111,6 +167,10 @@ public:
   /// Default capabilities injected on all transports upon connection
   static const CapabilityMap& defaultCapabilities();
 
+  /// Remember a shared memory segment exported to the other end, and record
+  /// it for the message being encoded, if any (see SendCacheRecorder).
+  void sharedMemorySegmentExported(const std::string& name);
+
 
 protected:
   qi::Atomic<int> _cacheNextId;
@@ -120,10 +180,32 @@ protected:
   CapabilityMap _remoteCapabilityMap; // remote capabilities we received
   CapabilityMap _localCapabilityMap; // memory of what we advertisedk
 
-  using SendMetaObjectCache = std::map<MetaObject, unsigned int>;
-  using ReceiveMetaObjectCache = std::map<unsigned int, MetaObject>;
+  // The digests are uniformly distributed already.
+  struct DigestHash
+  {
+    std::size_t operator()(const ka::sha1_digest_t& digest) const
+    {
+      std::size_t hash;
+      std::memcpy(&hash, digest.data(), sizeof(hash));
+      return hash;
+    }
+  };
+
+  using SendMetaObjectCache = std::unordered_map<ka::sha1_digest_t, unsigned int, DigestHash>;
+  using ReceiveMetaObjectCache = std::unordered_map<unsigned int, MetaObject>;
   SendMetaObjectCache _sendMetaObjectCache;
+  // Uids of the MetaObjects of the send cache that may not be known by the
+  // other end yet.
+  std::unordered_set<unsigned int> _unconfirmedSendCache;
   ReceiveMetaObjectCache _receiveMetaObjectCache;
+
+  // Exported segments that may still exist. The other end removes their names
+  // when it decodes them, but it may drop a message without decoding it: the
+  // names it did not remove are kept until the context is destroyed.
+  std::vector<std::string> _exportedSharedMemorySegments;
+  // Size of _exportedSharedMemorySegments above which the removed names are
+  // forgotten.
+  std::size_t _exportedSharedMemorySegmentsPruneSize;
 };
 
 template<typename T>
@@ -1,4 +1,5 @@
 #include <string>
+#include <boost/algorithm/string.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/optional.hpp>
@@ -6,6 +7,7 @@
 #include <qi/log.hpp>
 #include "sock/networkasio.hpp"
 #include "sock/option.hpp"
+#include "sock/send.hpp"
 
 #if BOOST_OS_WINDOWS
 # include <Winsock2.h> // needed by mstcpip.h
@@ -143,6 +145,77 @@ namespace qi { namespace sock {
     return warnThreshold;
   }
 
+  SendBatchLimits getSendBatchLimitsFromEnv()
+  {
+    static const auto limits = [] {
+      auto limits = SendBatchLimits::defaults();
+      const auto maxMessages = os::getenv("QIMESSAGING_SOCKET_SEND_BATCH_MAX_MESSAGES");
+      if (!maxMessages.empty())
+        limits.maxMessageCount = std::max(strtoul(maxMessages.c_str(), 0, 0), 1ul);
+      const auto maxBytes = os::getenv("QIMESSAGING_SOCKET_SEND_BATCH_MAX_BYTES");
+      if (!maxBytes.empty())
+        limits.maxByteCount = strtoul(maxBytes.c_str(), 0, 0);
+      return limits;
+    }();
+    return limits;
+  }
+
+  namespace
+  {
+    boost::optional<Message::Priority> priorityFromString(const std::string& name)
+    {
+      if (boost::iequals(name, "control")) return Message::Priority::Control;
+      if (boost::iequals(name, "normal"))  return Message::Priority::Normal;
+      if (boost::iequals(name, "bulk"))    return Message::Priority::Bulk;
+      return {};
+    }
+
+    boost::optional<std::size_t> typeFromString(const std::string& name)
+    {
+      for (std::size_t type = 0u; type != SendPriorities::typeCount; ++type)
+      {
+        if (boost::iequals(name, Message::typeToString(static_cast<Message::Type>(type))))
+          return type;
+      }
+      return {};
+    }
+  } // anonymous namespace
+
+  SendPriorities getSendPrioritiesFromEnv()
+  {
+    static const auto priorities = [] {
+      const auto spec = os::getenv("QIMESSAGING_SOCKET_SEND_PRIORITIES");
+      if (spec.empty() || boost::iequals(spec, "off"))
+        return SendPriorities::disabled();
+      auto priorities = SendPriorities::enabled();
+      std::vector<std::string> overrides;
+      if (!boost::iequals(spec, "on"))
+        boost::split(overrides, spec, boost::is_any_of(","), boost::token_compress_on);
+      for (const auto& o : overrides)
+      {
+        if (o.empty())
+          continue;
+        const auto equal = o.find('=');
+        const auto type = typeFromString(o.substr(0, equal));
+        const auto priority = equal == std::string::npos
+          ? boost::optional<Message::Priority>{}
+          : priorityFromString(o.substr(equal + 1));
+        if (!type || !priority)
+        {
+          qiLogWarning() << "Ignoring invalid send priority '" << o
+                         << "' in QIMESSAGING_SOCKET_SEND_PRIORITIES.";
+          continue;
+        }
+        priorities.ofType[*type] = *priority;
+      }
+      const auto maxControlBytes = os::getenv("QIMESSAGING_SOCKET_SEND_CONTROL_MAX_BYTES");
+      if (!maxControlBytes.empty())
+        priorities.maxControlByteCount = strtoul(maxControlBytes.c_str(), 0, 0);
+      return priorities;
+    }();
+    return priorities;
+  }
+
   void NetworkAsio::setSocketNativeOptions(
     boost::asio::ip::tcp::socket::native_handle_type socketNativeHandle, int timeoutInSeconds)
   {
@@ -24,6 +24,9 @@
 #include "sock/connectedstate.hpp"
 #include "sock/macrolog.hpp"
 #include "sock/networkasio.hpp"
+#include "sock/networkasiouring.hpp"
+#include "sock/networkeventloops.hpp"
+#include "sharedmemorybuffer.hpp"
 
 /// @file
 /// Contains a socket to send and receive qi::Messages, and the types representing
@@ -253,6 +256,48 @@ namespace qi {
       return {};
     }
     bool ensureReading() override;
+
+    /// Statistics of the pool in which payloads are received, to tune its
+    /// limits (see `sock::getReceiveBufferPoolLimitsFromEnv`).
+    sock::ReceiveBufferPool::Stats receiveBufferPoolStats() const
+    {
+      return _receiveBufferPool->stats();
+    }
+
+    /// Time spent by the sent messages in the send queue, per priority class
+    /// (see `sock::getSendPrioritiesFromEnv`).
+    sock::SendWait sendWait(Message::Priority priority) const
+    {
+      return (*_sendWaitStats)[priority];
+    }
+
+    sock::SendQueueMonitor::Depth sendQueueDepth() const override
+    {
+      return _sendQueueMonitor->depth();
+    }
+
+    Future<void> sendQueueNotFull() const override
+    {
+      return _sendQueueMonitor->notFull();
+    }
+
+    /// Watermark statistics of the send queue (see
+    /// `sock::getSendQueueLimitsFromEnv`).
+    sock::SendQueueMonitor::Stats sendQueueStats() const
+    {
+      return _sendQueueMonitor->stats();
+    }
+
+    MessageSocketStats stats() const override
+    {
+      MessageSocketStats stats;
+      stats.url = remoteEndpoint().value_or(url());
+      _counters->fill(stats);
+      stats.sendQueueDepth = _sendQueueMonitor->depth().messageCount;
+      stats.maxSendQueueDepth = _sendQueueMonitor->stats().maxDepth.messageCount;
+      stats.sendQueueWait = _sendWaitStats->histogram();
+      return stats;
+    }
   private:
     /// Handler called when we transition outside the connected state.
     /// It is the responsibility of the caller to ensure the socket pointer is
@@ -280,8 +325,15 @@ namespace qi {
     };
 
     const sock::SslEnabled _ssl;
+    // Shared by the successive connected states.
+    const std::shared_ptr<sock::ReceiveBufferPool> _receiveBufferPool;
+    const std::shared_ptr<sock::SendWaitStats> _sendWaitStats;
+    const std::shared_ptr<sock::SendQueueMonitor> _sendQueueMonitor;
+    // Shared with the callbacks of the sent messages.
+    const std::shared_ptr<sock::SocketCounters> _counters;
     mutable boost::recursive_mutex _stateMutex;
     sock::IoService<N>& _ioService;
+    const sock::NetworkEventLoopLoad _ioServiceLoad;
 
     void enterDisconnectedState(const SocketPtr& socket = {},
       Promise<void> promiseDisconnected = Promise<void>{});
@@ -334,12 +386,23 @@ namespace qi {
   template<typename N, typename S>
   using TcpMessageSocketPtr = boost::shared_ptr<TcpMessageSocket<N, S>>;
 
+  /// Socket whose unencrypted transfers go through io_uring. It uses the same
+  /// socket type as `TcpMessageSocket<>`, so that servers can accept sockets
+  /// for both.
+  using TcpMessageSocketUring =
+    TcpMessageSocket<sock::NetworkAsioUring, sock::SocketWithContext<sock::NetworkAsio>>;
+
   template<typename N, typename S>
   TcpMessageSocket<N, S>::TcpMessageSocket(sock::IoService<N>& io, sock::SslEnabled ssl,
         SocketPtr socket)
     : MessageSocket()
     , _ssl(ssl)
+    , _receiveBufferPool(sock::ReceiveBufferPool::create(sock::getReceiveBufferPoolLimitsFromEnv()))
+    , _sendWaitStats(std::make_shared<sock::SendWaitStats>())
+    , _sendQueueMonitor(std::make_shared<sock::SendQueueMonitor>(sock::getSendQueueLimitsFromEnv()))
+    , _counters(std::make_shared<sock::SocketCounters>())
     , _ioService(io)
+    , _ioServiceLoad(&io)
     , _state{DisconnectedState{}}
   {
     if (socket)
@@ -394,7 +457,9 @@ namespace qi {
         return false;
       }
       auto self = shared_from_this();
-      _state = ConnectedState(res.socket, _ssl, maxPayload, sock::HandleMessage<N, S>{self});
+      _state = ConnectedState(res.socket, _ssl, maxPayload, sock::HandleMessage<N, S>{self},
+        sock::getSocketTimeWarnThresholdFromEnv().value_or(0), _receiveBufferPool,
+        _sendWaitStats, _sendQueueMonitor);
       auto& connected = asConnected(_state);
       connected.complete().then(connected.ioServiceStranded(
         OnConnectedComplete{self, Future<void>{nullptr}}
@@ -439,7 +504,7 @@ namespace qi {
           | sock::SslContext<N>::no_tlsv1
           | sock::SslContext<N>::no_tlsv1_1
         );
-        return sock::makeSocketWithContextPtr<N>(_ioService, contextPtr);
+        return boost::make_shared<S>(_ioService, contextPtr);
       }
     );
 
@@ -472,7 +537,9 @@ namespace qi {
         // Connecting was successful, so we enter the connected state (to be able
         // send and receive messages).
         static const auto maxPayload = getMaxPayloadFromEnv();
-        _state = ConnectedState(res.socket, _ssl, maxPayload, sock::HandleMessage<N, S>{self});
+        _state = ConnectedState(res.socket, _ssl, maxPayload, sock::HandleMessage<N, S>{self},
+          sock::getSocketTimeWarnThresholdFromEnv().value_or(0), _receiveBufferPool,
+          _sendWaitStats, _sendQueueMonitor);
         auto& connected = asConnected(_state);
         connected.complete().then(connected.ioServiceStranded(
           OnConnectedComplete{self, connectedPromise.future()}
@@ -574,8 +641,27 @@ namespace qi {
         AnyValue v{msg.value(typeOf<CapabilityMap>()->signature(), shared_from_this())};
         cm = v.to<CapabilityMap>();
       }
-      boost::mutex::scoped_lock lock(_contextMutex);
-      _remoteCapabilityMap.insert(cm.begin(), cm.end());
+      {
+        boost::mutex::scoped_lock lock(_contextMutex);
+        _remoteCapabilityMap.insert(cm.begin(), cm.end());
+      }
+      // Tell the other end that it can export shared memory segments to us.
+      // Not in answer to an authentication request: the capabilities message
+      // would reach the other end before the authentication reply, which it
+      // would then not take as capabilities. We answer the acceptance that the
+      // other end sends after the reply instead.
+      if (msg.type() == Message::Type_Call)
+        return true;
+      if (const auto probe = shm::acceptRemoteProbe(*this))
+      {
+        Message accepted;
+        accepted.setType(Message::Type_Capability);
+        accepted.setService(Message::Service_Server);
+        accepted.setValue(
+            CapabilityMap{ { capabilityname::sharedMemoryBuffersAccepted, AnyValue::from(*probe) } },
+            typeOf<CapabilityMap>()->signature());
+        send(std::move(accepted));
+      }
     }
     catch (const std::runtime_error& e)
     {
@@ -597,6 +683,11 @@ namespace qi {
   template<typename N, typename S>
   bool TcpMessageSocket<N, S>::handleMessage(Message msg)
   {
+    _counters->received(sock::byteCount(msg));
+    const auto dispatchStart = SteadyClock::now();
+    auto scopedDispatchTime = ka::scoped([&] {
+      _counters->dispatched(SteadyClock::now() - dispatchStart);
+    });
     bool success = false;
     if (mustTreatAsServerAuthentication(msg) || msg.type() == Message::Type_Capability)
     {
@@ -653,9 +744,25 @@ namespace qi {
       QI_LOG_DEBUG_SOCKET(this) << "Socket must be connected to send().";
       return false;
     }
-    // NOTE: Should we specify an `onSent` callback and stop sending if an error
-    // occurred?
-    asConnected(_state).send(std::move(msg), _ssl);
+    // NOTE: Should we stop sending if an error occurred?
+    auto counters = _counters;
+    // The procedure of the message that starts the send loop is called for all
+    // the messages sent by the loop.
+    auto weakSelf = this->weak_from_this();
+    asConnected(_state).send(std::move(msg), _ssl,
+      [counters, weakSelf](const sock::ErrorCode<N>& erc, std::list<Message>::const_iterator itMsg) {
+        if (!erc)
+        {
+          counters->sent(sock::byteCount(*itMsg));
+          // Messages encoded from now on can refer to these MetaObjects by uid.
+          if (!itMsg->transmittedMetaObjects().empty())
+          {
+            if (auto self = weakSelf.lock())
+              self->sendCacheConfirm(itMsg->transmittedMetaObjects());
+          }
+        }
+        return true;
+      });
     return true;
   }
 
@@ -664,14 +771,15 @@ namespace qi {
   ///   S is compatible with N
   template <typename N = sock::NetworkAsio, typename S = sock::SocketWithContext<N>>
   TcpMessageSocketPtr<N, S> makeTcpMessageSocket(const std::string& protocol,
-                                                 EventLoop* eventLoop = getNetworkEventLoop())
+                                                 EventLoop* eventLoop = sock::pickNetworkEventLoop())
   {
     using Socket = TcpMessageSocket<N, S>;
-    if (protocol == "tcp")
+    // Networks over local sockets are never ssl.
+    if (protocol == (sock::IsTcp<N>::value ? "tcp" : sock::localScheme()))
     {
       return boost::make_shared<Socket>(*asIoServicePtr(eventLoop), false);
     }
-    if (protocol == "tcps")
+    if (sock::IsTcp<N>::value && protocol == "tcps")
     {
       return boost::make_shared<Socket>(*asIoServicePtr(eventLoop), true);
     }
@@ -8,6 +8,7 @@
 KA_WARNING_PUSH()
 KA_WARNING_DISABLE(4355, )
 
+#include <algorithm>
 #include <string>
 #include <cstring>
 #include <cstdlib>
@@ -26,6 +27,7 @@ KA_WARNING_DISABLE(4355, )
 #include "transportserver.hpp"
 #include "messagesocket.hpp"
 #include "transportserverasio_p.hpp"
+#include "transportserverlocal_p.hpp"
 
 qiLogCategory("qimessaging.transportserver");
 
@@ -47,6 +49,12 @@ namespace qi
     {
       impl = TransportServerAsioPrivate::make(this, ctx);
     }
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    else if (url.protocol() == sock::localScheme())
+    {
+      impl = TransportServerLocalPrivate::make(this, ctx);
+    }
+#endif
     else
     {
       const char* s = "Unrecognized protocol to create the TransportServer.";
@@ -57,9 +65,50 @@ namespace qi
       boost::mutex::scoped_lock l(_implMutex);
       _impl.push_back(impl);
     }
-    return impl->listen(url);
+    const auto listening = impl->listen(url);
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    if (url.protocol() == "tcp" && url.port() != 0 && listensOnLocalSockets())
+      listenLocally(url.port(), listening, ctx);
+#endif
+    return listening;
+  }
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+  bool TransportServer::listensOnLocalSockets()
+  {
+    static const bool enabled = os::getenv("QIMESSAGING_LISTEN_LOCAL_SOCKETS") != "0";
+    return enabled;
   }
 
+  void TransportServer::listenLocally(unsigned short port, qi::Future<void> tcpListening,
+                                      qi::EventLoop* ctx)
+  {
+    const Url url{"localhost", sock::localScheme(), port};
+    {
+      // Listening on several addresses with the same port needs one local socket.
+      const auto current = endpoints();
+      if (std::find(current.begin(), current.end(), url) != current.end())
+        return;
+    }
+    const auto impl = TransportServerLocalPrivate::make(this, ctx);
+    // Listening on a local socket completes at once.
+    const auto listening = impl->listen(url);
+    if (listening.hasError())
+    {
+      qiLogVerbose() << "Not listening on " << url.str() << ": " << listening.error();
+      return;
+    }
+    {
+      boost::mutex::scoped_lock l(_implMutex);
+      _impl.push_back(impl);
+    }
+    tcpListening.then(FutureCallbackType_Sync, [impl](const Future<void>& tcp) {
+      if (tcp.hasError())
+        impl->close();
+    });
+  }
+#endif
+
   bool TransportServer::setIdentity(const std::string& key, const std::string& crt)
   {
     struct ::stat status;
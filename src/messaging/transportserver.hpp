@@ -61,6 +61,10 @@ namespace qi {
     TransportServer();
     virtual ~TransportServer();
 
+    /// Listening on a TCP URL with a fixed port also listens on the local
+    /// socket `unix://localhost:port`, if the system has local sockets, so
+    /// that the clients of the same machine can use it. Setting the environment
+    /// variable QIMESSAGING_LISTEN_LOCAL_SOCKETS to 0 disables it.
     qi::Future<void> listen(const qi::Url &url,
                             qi::EventLoop* ctx = qi::getNetworkEventLoop());
     bool setIdentity(const std::string& key, const std::string& crt);
@@ -68,6 +72,11 @@ namespace qi {
 
     std::vector<qi::Url> endpoints() const;
 
+  private:
+    static bool listensOnLocalSockets();
+    // Listens on the local socket of the port, unless it fails, until the TCP listening fails.
+    void listenLocally(unsigned short port, qi::Future<void> tcpListening, qi::EventLoop* ctx);
+
   public:
     /** Emitted each time a new connection happens. startReading must be
      * called on the socket
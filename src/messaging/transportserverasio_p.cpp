@@ -29,11 +29,12 @@ namespace qi
 
   void _onAccept(TransportServerImplPtr p,
                  const boost::system::error_code& erc,
-                 sock::SocketWithContextPtr<sock::NetworkAsio> s
+                 sock::SocketWithContextPtr<sock::NetworkAsio> s,
+                 EventLoop* socketLoop
                  )
   {
     boost::shared_ptr<TransportServerAsioPrivate> ts = boost::dynamic_pointer_cast<TransportServerAsioPrivate>(p);
-    ts->onAccept(erc, s);
+    ts->onAccept(erc, s, socketLoop);
   }
 
   void TransportServerAsioPrivate::restartAcceptor()
@@ -53,7 +54,7 @@ namespace qi
   }
 
   void TransportServerAsioPrivate::onAccept(const boost::system::error_code& erc,
-    sock::SocketWithContextPtr<sock::NetworkAsio> s
+    sock::SocketWithContextPtr<sock::NetworkAsio> s, EventLoop* socketLoop
     )
   {
     qiLogDebug() << this << " onAccept";
@@ -81,7 +82,10 @@ namespace qi
     }
     else
     {
-        auto socket = boost::make_shared<qi::TcpMessageSocket<>>(*asIoServicePtr(context), _ssl, s);
+        auto& io = *asIoServicePtr(socketLoop);
+        MessageSocketPtr socket = sock::socketBackend() == sock::SocketBackend::Uring
+          ? MessageSocketPtr{boost::make_shared<TcpMessageSocketUring>(io, _ssl, s)}
+          : MessageSocketPtr{boost::make_shared<TcpMessageSocket<>>(io, _ssl, s)};
         qiLogDebug() << "New socket accepted: " << socket.get();
 
         self->newConnection(std::pair<MessageSocketPtr, Url>{
@@ -91,9 +95,17 @@ namespace qi
             qiLogError() << "bug: socket not stored by the newConnection handler (usecount:" << socket.use_count() << ")";
         }
     }
-    _s = sock::makeSocketWithContextPtr<sock::NetworkAsio>(PTR_GET_IO_SERVICE(_acceptor), _sslContext);
+    asyncAccept();
+  }
+
+  void TransportServerAsioPrivate::asyncAccept()
+  {
+    // The handlers of a socket all run on the eventloop it is created on.
+    EventLoop* socketLoop =
+      context == getNetworkEventLoop() ? sock::pickNetworkEventLoop() : context;
+    _s = sock::makeSocketWithContextPtr<sock::NetworkAsio>(*asIoServicePtr(socketLoop), _sslContext);
     _acceptor->async_accept(_s->lowest_layer(),
-                           boost::bind(_onAccept, shared_from_this(), _1, _s));
+                           boost::bind(_onAccept, shared_from_this(), _1, _s, socketLoop));
   }
 
   void TransportServerAsioPrivate::close() {
@@ -327,9 +339,7 @@ namespace qi
       ));
     }
 
-    _s = sock::makeSocketWithContextPtr<sock::NetworkAsio>(PTR_GET_IO_SERVICE(_acceptor), _sslContext);
-    _acceptor->async_accept(_s->lowest_layer(),
-      boost::bind(_onAccept, shared_from_this(), _1, _s));
+    asyncAccept();
     _connectionPromise.setValue(0);
     return _connectionPromise.future();
   }
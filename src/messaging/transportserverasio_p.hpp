@@ -41,7 +41,7 @@ namespace qi
     TransportServer* _self;
     boost::asio::ip::tcp::acceptor* _acceptor;
     void onAccept(const boost::system::error_code& erc,
-      sock::SocketWithContextPtr<sock::NetworkAsio> s);
+      sock::SocketWithContextPtr<sock::NetworkAsio> s, EventLoop* socketLoop);
     TransportServerAsioPrivate();
     std::atomic<bool> _live;
     sock::SslContextPtr<sock::NetworkAsio> _sslContext;
@@ -61,6 +61,10 @@ namespace qi
 
   private:
     void restartAcceptor();
+
+    /// Accepts the next connection on a socket living on one of the network
+    /// eventloops, or on the eventloop of the server if it has its own.
+    void asyncAccept();
   };
 }
 
@@ -0,0 +1,211 @@
+/*
+**  Copyright (C) 2012 Aldebaran Robotics
+**  See COPYING for the license
+*/
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <boost/asio.hpp>
+#include <boost/predef.h>
+#include <qi/log.hpp>
+#include <qi/eventloop.hpp>
+#include <qi/macro.hpp>
+#include "transportserver.hpp"
+#include "transportserverasio_p.hpp"
+#include "transportserverlocal_p.hpp"
+#include "messagesocket.hpp"
+#include "tcpmessagesocket.hpp"
+#include "sock/sslcontextptr.hpp"
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+
+qiLogCategory("qimessaging.transportserver");
+
+namespace qi
+{
+  namespace
+  {
+    // Ports chosen when listening on port 0 are taken in the dynamic range.
+    const unsigned short dynamicPortMin = 49152;
+    const int choosePortMaxAttempts = 64;
+
+    // True if the socket file of a previous server was left behind (the
+    // server crashed). Abstract sockets have no file and are always cleaned up.
+    bool isStaleSocketFile(boost::asio::io_service& io,
+                           const boost::asio::local::stream_protocol::endpoint& ep)
+    {
+#if BOOST_OS_LINUX
+      QI_IGNORE_UNUSED(io);
+      QI_IGNORE_UNUSED(ep);
+      return false;
+#else
+      boost::asio::local::stream_protocol::socket probe(io);
+      boost::system::error_code erc;
+      probe.connect(ep, erc);
+      return erc == boost::asio::error::connection_refused;
+#endif
+    }
+
+    void removeSocketFile(const boost::asio::local::stream_protocol::endpoint& ep)
+    {
+#if !BOOST_OS_LINUX
+      std::remove(ep.path().c_str());
+#else
+      QI_IGNORE_UNUSED(ep);
+#endif
+    }
+  } // anonymous namespace
+
+  TransportServerLocalPrivate::TransportServerLocalPrivate(TransportServer* self,
+                                                           EventLoop* ctx)
+    : TransportServerImpl(self, ctx)
+    , _acceptor(*asIoServicePtr(ctx))
+    , _sslContext(sock::makeSslContextPtr<N>(sock::SslContext<N>::tlsv12))
+    , _live(true)
+    , _port(0)
+  {
+  }
+
+  boost::shared_ptr<TransportServerLocalPrivate> TransportServerLocalPrivate::make(
+      TransportServer* self,
+      EventLoop* ctx)
+  {
+    return boost::shared_ptr<TransportServerLocalPrivate>{
+      new TransportServerLocalPrivate(self, ctx)};
+  }
+
+  TransportServerLocalPrivate::~TransportServerLocalPrivate()
+  {
+    close();
+  }
+
+  boost::system::error_code TransportServerLocalPrivate::bind(unsigned short port)
+  {
+    const sock::Endpoint<sock::Acceptor<N>> ep{sock::localEndpointName(port)};
+    boost::system::error_code erc;
+    _acceptor.bind(ep, erc);
+    if (erc == boost::asio::error::address_in_use && isStaleSocketFile(GET_IO_SERVICE(_acceptor), ep))
+    {
+      qiLogVerbose() << "Removing stale socket file " << ep.path();
+      removeSocketFile(ep);
+      erc.clear();
+      _acceptor.bind(ep, erc);
+    }
+    return erc;
+  }
+
+  qi::Future<void> TransportServerLocalPrivate::listen(const qi::Url& url)
+  {
+    boost::system::error_code erc;
+    _acceptor.open(sock::Endpoint<sock::Acceptor<N>>{}.protocol(), erc);
+    if (erc)
+    {
+      qiLogError("qimessaging.server.listen") << erc.message();
+      return qi::makeFutureError<void>(erc.message());
+    }
+
+    if (url.port() != 0)
+    {
+      _port = url.port();
+      erc = bind(_port);
+    }
+    else
+    {
+      std::random_device rd;
+      std::uniform_int_distribution<unsigned short> dist(dynamicPortMin);
+      erc = boost::asio::error::address_in_use;
+      for (int i = 0; i < choosePortMaxAttempts && erc == boost::asio::error::address_in_use; ++i)
+      {
+        _port = dist(rd);
+        erc = bind(_port);
+      }
+    }
+    if (erc)
+    {
+      std::stringstream ss;
+      ss << "failed to listen on " << url.str() << ": " << erc.message();
+      qiLogError("qimessaging.server.listen") << ss.str();
+      return qi::makeFutureError<void>(ss.str());
+    }
+
+    _acceptor.listen(boost::asio::socket_base::max_connections, erc);
+    if (erc)
+    {
+      qiLogError("qimessaging.server.listen") << erc.message();
+      return qi::makeFutureError<void>(erc.message());
+    }
+
+    const Url endpoint{"localhost", sock::localScheme(), _port};
+    {
+      boost::mutex::scoped_lock l(_endpointsMutex);
+      _endpoints.push_back(endpoint);
+    }
+    qiLogVerbose() << "TransportServer will listen on: " << endpoint.str();
+
+    startAccept();
+    _connectionPromise.setValue(0);
+    return _connectionPromise.future();
+  }
+
+  void TransportServerLocalPrivate::startAccept()
+  {
+    // The handlers of a socket all run on the eventloop it is created on.
+    EventLoop* socketLoop =
+      context == getNetworkEventLoop() ? sock::pickNetworkEventLoop() : context;
+    auto s = sock::makeSocketWithContextPtr<N>(*asIoServicePtr(socketLoop), _sslContext);
+    auto server = shared_from_this();
+    _acceptor.async_accept(s->lowest_layer(), [=](const boost::system::error_code& erc) {
+      server->onAccept(erc, s, socketLoop);
+    });
+  }
+
+  void TransportServerLocalPrivate::onAccept(const boost::system::error_code& erc,
+    sock::SocketWithContextPtr<N> s, EventLoop* socketLoop)
+  {
+    boost::mutex::scoped_lock lock(_acceptCloseMutex);
+    if (!_live)
+      return;
+    if (erc)
+    {
+      qiLogDebug() << "accept error " << erc.message();
+      self->acceptError(erc.value());
+      if (TransportServerAsioPrivate::isFatalAcceptError(erc.value()))
+      {
+        qiLogError() << "fatal accept error on " << sock::localScheme() << " port "
+                     << _port << ": " << erc.value();
+        return;
+      }
+    }
+    else
+    {
+      auto socket = boost::make_shared<TcpMessageSocket<N>>(*asIoServicePtr(socketLoop), false, s);
+      qiLogDebug() << "New local socket accepted: " << socket.get();
+
+      self->newConnection(std::pair<MessageSocketPtr, Url>{
+        socket, sock::remoteEndpoint(*s, false)});
+
+      if (socket.unique()) {
+        qiLogError() << "bug: socket not stored by the newConnection handler (usecount:" << socket.use_count() << ")";
+      }
+    }
+    startAccept();
+  }
+
+  void TransportServerLocalPrivate::close()
+  {
+    boost::mutex::scoped_lock l(_acceptCloseMutex);
+    if (!_live.exchange(false))
+      return;
+    if (_acceptor.is_open())
+    {
+      boost::system::error_code erc;
+      const auto ep = _acceptor.local_endpoint(erc);
+      const bool bound = !erc;
+      _acceptor.close(erc);
+      if (bound)
+        removeSocketFile(ep);
+    }
+  }
+}
+
+#endif // BOOST_ASIO_HAS_LOCAL_SOCKETS
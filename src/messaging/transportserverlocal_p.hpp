@@ -0,0 +1,66 @@
+#pragma once
+/*
+**  Copyright (C) 2012 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+#ifndef _SRC_TRANSPORTSERVERLOCAL_P_HPP_
+#define _SRC_TRANSPORTSERVERLOCAL_P_HPP_
+
+#include <boost/asio.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/thread/mutex.hpp>
+#include <atomic>
+
+# include <qi/api.hpp>
+# include <qi/url.hpp>
+# include "sock/networkasiolocal.hpp"
+# include "sock/traits.hpp"
+# include "sock/socketptr.hpp"
+# include "transportserver.hpp"
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+
+namespace qi
+{
+  /// Accepts connections on a local (AF_UNIX) stream socket.
+  ///
+  /// The listen URL is `unix://localhost:port`. If the port is 0, a free one is
+  /// chosen. The only endpoint published is `unix://localhost:port`.
+  /// SSL is not supported: the connection never leaves the machine.
+  class TransportServerLocalPrivate:
+      public TransportServerImpl,
+      public boost::enable_shared_from_this<TransportServerLocalPrivate>
+  {
+    using N = sock::NetworkAsioLocal;
+    TransportServerLocalPrivate(TransportServer* self, EventLoop* ctx);
+
+  public:
+    static boost::shared_ptr<TransportServerLocalPrivate> make(
+        TransportServer* self,
+        EventLoop* ctx);
+
+    ~TransportServerLocalPrivate() override;
+
+    qi::Future<void> listen(const qi::Url& listenUrl) override;
+    void close() override;
+
+  private:
+    boost::system::error_code bind(unsigned short port);
+    void startAccept();
+    void onAccept(const boost::system::error_code& erc,
+      sock::SocketWithContextPtr<N> s, EventLoop* socketLoop);
+
+    sock::Acceptor<N> _acceptor;
+    sock::SslContextPtr<N> _sslContext;
+    std::atomic<bool> _live;
+    unsigned short _port;
+
+    // See TransportServerAsioPrivate::_acceptCloseMutex.
+    boost::mutex _acceptCloseMutex;
+  };
+}
+
+#endif // BOOST_ASIO_HAS_LOCAL_SOCKETS
+
+#endif  // _SRC_TRANSPORTSERVERLOCAL_P_HPP_
@@ -3,6 +3,7 @@
 **  See COPYING for the license
 */
 #include <algorithm>
+#include <iterator>
 #include <sstream>
 
 #include <boost/algorithm/string.hpp>
@@ -14,6 +15,7 @@
 
 #include "messagesocket.hpp"
 #include "transportsocketcache.hpp"
+#include "sock/networkasiolocal.hpp"
 
 #define LOG_CATEGORY "qimessaging.transportsocketcache"
 
@@ -114,6 +116,14 @@ bool isLocalHost(const std::string& host)
   return boost::algorithm::starts_with(host, "127.") || host == "localhost";
 }
 
+static std::vector<Uri> local_socket_only(const std::vector<Uri>& input)
+{
+  std::vector<Uri> result;
+  std::copy_if(input.begin(), input.end(), std::back_inserter(result),
+               [](const Uri& uri) { return uri.scheme() == sock::localScheme(); });
+  return result;
+}
+
 static std::vector<Uri> localhost_only(const std::vector<Uri>& input)
 {
   std::vector<Uri> result;
@@ -129,20 +139,55 @@ static std::vector<Uri> localhost_only(const std::vector<Uri>& input)
 
 Future<MessageSocketPtr> TransportSocketCache::socket(const ServiceInfo& servInfo)
 {
-  const std::string& machineId = servInfo.machineId();
-  auto couple = boost::make_shared<ConnectionAttempt>();
-  couple->relatedUris = servInfo.uriEndpoints();
-  bool local = machineId == os::getMachineId();
+  const bool local = servInfo.machineId() == os::getMachineId();
   std::vector<Uri> connectionCandidates;
 
-  // If the connection is local, we're mainly interested in localhost endpoint
+  // If the connection is local, we're mainly interested in local socket
+  // endpoints, and then in localhost endpoints.
   if (local)
+  {
     connectionCandidates = localhost_only(servInfo.uriEndpoints());
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    const auto localSocketCandidates = local_socket_only(servInfo.uriEndpoints());
+    if (!localSocketCandidates.empty())
+    {
+      if (connectionCandidates.empty())
+        return connect(servInfo, localSocketCandidates);
+
+      // Peers with the same machine id may not share their network namespace,
+      // in which case local sockets fail: fall back to localhost.
+      Promise<MessageSocketPtr> promise;
+      const auto localhostCandidates = connectionCandidates;
+      connect(servInfo, localSocketCandidates).then(FutureCallbackType_Async,
+        track([=](Future<MessageSocketPtr> fut) mutable {
+          if (fut.hasValue())
+          {
+            promise.setValue(fut.value());
+            return;
+          }
+          qiLogVerbose() << "Could not connect to service #" << servInfo.serviceId()
+                         << " through local sockets, trying localhost endpoints";
+          adaptFuture(connect(servInfo, localhostCandidates), promise);
+        }, this));
+      return promise.future();
+    }
+#endif
+  }
 
   // If the connection isn't local or if the service doesn't expose local endpoints,
   // try and connect to whatever is available.
   if (connectionCandidates.size() == 0)
     connectionCandidates = servInfo.uriEndpoints();
+  return connect(servInfo, connectionCandidates);
+}
+
+Future<MessageSocketPtr> TransportSocketCache::connect(const ServiceInfo& servInfo,
+                                                       const std::vector<Uri>& connectionCandidates)
+{
+  const std::string& machineId = servInfo.machineId();
+  auto couple = boost::make_shared<ConnectionAttempt>();
+  couple->relatedUris = servInfo.uriEndpoints();
+  const bool local = machineId == os::getMachineId();
 
   {
     // If we already have a pending connection to one of the uris, we return the future in question
@@ -177,7 +222,11 @@ Future<MessageSocketPtr> TransportSocketCache::socket(const ServiceInfo& servInf
     {
       const auto scheme = uri.scheme();
       // Only these protocols are supported for message sockets.
-      if (scheme != "tcp" && scheme != "tcps")
+      if (scheme != "tcp" && scheme != "tcps"
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+          && scheme != sock::localScheme()
+#endif
+         )
         continue;
 
       if (!local && isLoopbackAddress((*uri.authority()).host()))
@@ -223,6 +272,22 @@ FutureSync<void> TransportSocketCache::disconnect(MessageSocketPtr socket)
   });
 }
 
+std::vector<MessageSocketPtr> TransportSocketCache::sockets()
+{
+  boost::mutex::scoped_lock lock(_socketMutex);
+  std::vector<MessageSocketPtr> sockets;
+  for (const auto& machineConnections : _connections)
+  {
+    for (const auto& connection : machineConnections.second)
+    {
+      const auto& attempt = *connection.second;
+      if (attempt.state == State_Connected && attempt.endpoint)
+        sockets.push_back(attempt.endpoint);
+    }
+  }
+  return sockets;
+}
+
 void TransportSocketCache::insert(const std::string& machineId, const Uri& uri, MessageSocketPtr socket)
 {
   // If a connection is pending for this machine / uri, terminate the pendage and set the
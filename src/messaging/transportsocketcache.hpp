@@ -60,6 +60,9 @@ namespace qi
     /// The returned future is set when the socket has been disconnected and
     /// effectively removed from the cache.
     FutureSync<void> disconnect(MessageSocketPtr socket);
+
+    /// Returns the connected sockets of the cache.
+    std::vector<MessageSocketPtr> sockets();
   private:
     enum State
     {
@@ -68,6 +71,9 @@ namespace qi
       State_Error
     };
 
+    /// Tries all the candidates in parallel and returns the first connected socket.
+    Future<MessageSocketPtr> connect(const ServiceInfo& servInfo,
+                                     const std::vector<Uri>& connectionCandidates);
     void onSocketParallelConnectionAttempt(Future<void> fut, MessageSocketPtr socket, Uri uri, const ServiceInfo& info);
     void onSocketDisconnected(Uri uri, const ServiceInfo& info);
 
@@ -4,6 +4,7 @@
 */
 
 #include <qi/anyobject.hpp>
+#include <qi/calloptions.hpp>
 #include <memory>
 
 #include <ka/macro.hpp>
@@ -201,6 +202,8 @@ public:
     , methodId(methodId_)
     , callerId(callerId_)
     , postTimestamp(postTimestamp_)
+    , deadline(currentCallDeadline())
+    , priority(currentCallPriority())
   {
     std::swap(this->func, func_);
     std::swap((AnyReferenceVector&) params_,
@@ -223,10 +226,19 @@ public:
     noCloneFirst = b.noCloneFirst;
     callerId = b.callerId;
     this->postTimestamp = b.postTimestamp;
+    deadline = b.deadline;
+    priority = b.priority;
   }
   void operator()()
   {
-    call(out, context, params, methodId, func, callerId, postTimestamp);
+    // The call inherits the deadline and the priority of its caller, and is
+    // not executed if the deadline passed while it was waiting to be.
+    detail::CallDeadlineScope deadlineScope(deadline);
+    detail::CallPriorityScope priorityScope(priority);
+    if (deadline && SteadyClock::now() >= *deadline)
+      out.setError(callDeadlineExceededError);
+    else
+      call(out, context, params, methodId, func, callerId, postTimestamp);
     params.destroy(noCloneFirst);
   }
   qi::Promise<AnyReference> out;
@@ -237,6 +249,8 @@ public:
   unsigned int methodId;
   unsigned int callerId;
   qi::os::timeval postTimestamp;
+  boost::optional<SteadyClockTimePoint> deadline;
+  boost::optional<CallPriority> priority;
 };
 
 }
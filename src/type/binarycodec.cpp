@@ -4,12 +4,15 @@
 */
 
 #include <boost/algorithm/string.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include <qi/binarycodec.hpp>
 #include <qi/anyvalue.hpp>
 
 #include "binarycodec_p.hpp"
+#include "src/buffer_p.hpp"
 #include "src/messaging/messagesocket.hpp"
+#include "src/messaging/sharedmemorybuffer.hpp"
 
 #include <qi/log.hpp>
 #include <qi/anyobject.hpp>
@@ -17,6 +20,8 @@
 #include <qi/types.hpp>
 #include <qi/numeric.hpp>
 #include <ka/scoped.hpp>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 #include <cstring>
 
@@ -184,6 +189,22 @@ namespace qi {
     }
   }
 
+  void BinaryDecoder::read(StringView& s)
+  {
+    std::uint32_t sz = 0;
+    read(sz);
+    if (status() != Status::Ok)
+      return;
+    BufferReader& reader = bufferReader();
+    if (!reader.peek(sz))
+    {
+      qiLogError() << "Read past end";
+      setStatus(Status::ReadPastEnd);
+      return;
+    }
+    s = StringView(readBufferSlice(reader, sz));
+  }
+
   void BinaryDecoder::read(qi::Buffer &meta) {
     BufferReader& reader = bufferReader();
     if (reader.hasSubBuffer())
@@ -195,27 +216,43 @@ namespace qi {
       uint32_t sz;
       read(sz);
       qiLogDebug() << "Extracting buffer of size " << sz <<" at " << reader.position();
-      meta.clear();
-      void* src = readRaw(sz);
-      if (!src)
+      if (!reader.peek(sz))
       {
         setStatus(Status::ReadPastEnd);
         std::stringstream err;
         err << "Read of size " << sz << " is past end.";
         throw std::runtime_error(err.str());
       }
-      void* ptr = meta.reserve(sz);
-      if (ptr == nullptr)
-      {
-        setStatus(Status::ReadError);
-        std::stringstream err;
-        err << "Cannot reserve buffer memory of size " << sz << ".";
-        throw std::runtime_error(err.str());
-      }
-      memcpy(ptr, src, sz);
+      // The content is shared with the message buffer instead of being copied.
+      meta = readBufferSlice(reader, sz);
     }
   }
 
+  namespace
+  {
+    // Size of a raw value that is in a shared memory segment. A message cannot
+    // contain a raw value of this size anyway.
+    const std::uint32_t sharedMemoryRawMarker = 0xFFFFFFFFu;
+  }
+
+  bool BinaryDecoder::readSharedMemoryRaw(std::string& segment, std::uint64_t& size)
+  {
+    BufferReader& reader = bufferReader();
+    if (reader.hasSubBuffer())
+      return false;
+    const void* p = reader.peek(sizeof(sharedMemoryRawMarker));
+    if (!p)
+      return false;
+    std::uint32_t marker;
+    memcpy(&marker, p, sizeof(marker));
+    if (marker != sharedMemoryRawMarker)
+      return false;
+    reader.seek(sizeof(marker));
+    read(segment);
+    read(size);
+    return status() == Status::Ok;
+  }
+
   // Output
   BinaryEncoder::BinaryEncoder(qi::Buffer &buffer)
     : _p(new BinaryEncoderPrivate(buffer))
@@ -290,6 +327,20 @@ namespace qi {
     //                         << " at " << buffer().size();
   }
 
+  void BinaryEncoder::writeSharedMemoryRaw(const std::string& segment, std::uint64_t size)
+  {
+    if (!_p->_innerSerialization)
+    {
+      signature() += "r";
+    }
+
+    ++_p->_innerSerialization;
+    write(sharedMemoryRawMarker);
+    write(segment);
+    write(size);
+    --_p->_innerSerialization;
+  }
+
   void BinaryEncoder::writeValue(const AnyReference &value, boost::function<void()> recurse)
   {
     qi::Signature sig = value.signature();
@@ -417,6 +468,74 @@ namespace qi {
 
   namespace detail {
 
+    namespace
+    {
+      // Numbers are encoded in the byte order of the host, so a vector of
+      // numbers has the same layout in memory as its elements in a message,
+      // and is copied in one block.
+      struct NumberVectorCodec
+      {
+        TypeInterface* type;
+        void (*write)(AnyReference list, BinaryEncoder& out);
+        void (*read)(AnyReference list, std::uint32_t size, BinaryDecoder& in);
+      };
+
+      template <typename T>
+      void writeNumberVector(AnyReference list, BinaryEncoder& out)
+      {
+        const auto& values = *list.ptr<std::vector<T>>(false);
+        out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+      }
+
+      template <typename T>
+      void readNumberVector(AnyReference list, std::uint32_t size, BinaryDecoder& in)
+      {
+        if (!size)
+          return;
+        const std::size_t byteCount = std::size_t(size) * sizeof(T);
+        // Check the size against the data actually received before allocating.
+        const void* data = in.readRaw(byteCount);
+        if (!data)
+        {
+          in.setStatus(BinaryDecoder::Status::ReadPastEnd);
+          return;
+        }
+        auto& values = *list.ptr<std::vector<T>>(false);
+        const auto first = values.size();
+        values.resize(first + size);
+        std::memcpy(values.data() + first, data, byteCount);
+      }
+
+      template <typename T>
+      NumberVectorCodec numberVectorCodec()
+      {
+        return { typeOf<std::vector<T>>(), &writeNumberVector<T>, &readNumberVector<T> };
+      }
+
+      /// Returns the codec of `type` if it is a vector of numbers (except bool),
+      /// or null.
+      const NumberVectorCodec* findNumberVectorCodec(TypeInterface* type)
+      {
+        if (type->kind() != TypeKind_List)
+          return nullptr;
+        const auto elementKind = static_cast<ListTypeInterface*>(type)->elementType()->kind();
+        if (elementKind != TypeKind_Int && elementKind != TypeKind_Float)
+          return nullptr;
+
+        static const NumberVectorCodec codecs[] = {
+          numberVectorCodec<std::int8_t>(),   numberVectorCodec<std::uint8_t>(),
+          numberVectorCodec<std::int16_t>(),  numberVectorCodec<std::uint16_t>(),
+          numberVectorCodec<std::int32_t>(),  numberVectorCodec<std::uint32_t>(),
+          numberVectorCodec<std::int64_t>(),  numberVectorCodec<std::uint64_t>(),
+          numberVectorCodec<float>(),         numberVectorCodec<double>(),
+        };
+        for (const auto& codec : codecs)
+          if (codec.type == type || codec.type->info() == type->info())
+            return &codec;
+        return nullptr;
+      }
+    }
+
     class SerializeTypeVisitor
     {
     public:
@@ -482,8 +601,13 @@ namespace qi {
       {
         out.beginList(numericConvert<std::uint32_t>(value.size()),
                       static_cast<ListTypeInterface*>(value.type())->elementType()->signature());
-        for (; it != end; ++it)
-          serialize(*it, out, serializeObjectCb, socket);
+        if (const auto codec = findNumberVectorCodec(value.type()))
+          codec->write(value, out);
+        else
+        {
+          for (; it != end; ++it)
+            serialize(*it, out, serializeObjectCb, socket);
+        }
         out.endList();
       }
 
@@ -569,7 +693,18 @@ namespace qi {
 
       void visitRaw(AnyReference raw)
       {
-        out.writeRaw(raw.to<Buffer>());
+        const auto buffer = raw.to<Buffer>();
+        if (socket && buffer.size() >= shm::minBufferSize() && buffer.subBuffers().empty()
+            && shm::isEnabled(*socket))
+        {
+          if (const auto segment = shm::exportBuffer(buffer))
+          {
+            socket->sharedMemorySegmentExported(*segment);
+            out.writeSharedMemoryRaw(*segment, buffer.size());
+            return;
+          }
+        }
+        out.writeRaw(buffer);
       }
 
       void visitIterator(AnyReference)
@@ -678,6 +813,12 @@ namespace qi {
 
       void visitString(char*, size_t)
       {
+        if (result.type()->info() == typeOf<StringView>()->info())
+        {
+          in.read(*result.ptr<StringView>());
+          return;
+        }
+
         std::string s;
         in.read(s);
 
@@ -699,6 +840,11 @@ namespace qi {
         in.read(sz);
         if (in.status() != BinaryDecoder::Status::Ok)
           return;
+        if (const auto codec = findNumberVectorCodec(result.type()))
+        {
+          codec->read(result, sz, in);
+          return;
+        }
         for (unsigned i = 0; i < sz; ++i)
         {
           AnyReference v = deserialize(elementType, in, context, socket);
@@ -830,8 +976,29 @@ namespace qi {
       void visitRaw(AnyReference)
       {
         Buffer b;
-        in.read(b);
-        result.setRaw(static_cast<const char*>(b.data()), b.size());
+        std::string segment;
+        std::uint64_t size = 0;
+        if (socket && shm::canImport(*socket) && in.readSharedMemoryRaw(segment, size))
+        {
+          auto imported = shm::importBuffer(segment, numericConvert<std::size_t>(size));
+          if (!imported)
+          {
+            in.setStatus(BinaryDecoder::Status::ReadError);
+            throw std::runtime_error("Cannot read buffer from shared memory segment " + segment);
+          }
+          b = std::move(*imported);
+        }
+        else
+        {
+          in.read(b);
+        }
+
+        // Take the buffer as is when possible: its storage may be a mapping
+        // that setRaw would copy.
+        if (result.type()->info() == typeOf<Buffer>()->info())
+          *result.ptr<Buffer>() = std::move(b);
+        else
+          result.setRaw(static_cast<const char*>(b.data()), b.size());
       }
 
       void visitOptional(AnyReference value)
@@ -856,28 +1023,453 @@ namespace qi {
       MessageSocketPtr socket;
     }; //class
 
-    void serialize(AnyReference val, BinaryEncoder& out, SerializeObjectCallback context, MessageSocketPtr socket)
+    namespace
     {
-      detail::SerializeTypeVisitor stv(out, context, val, socket);
-      qi::typeDispatch(stv, val);
-      if (out.status() != BinaryEncoder::Status::Ok) {
-        std::stringstream ss;
-        ss << "OSerialization error " << BinaryEncoder::statusToStr(out.status());
-        throw std::runtime_error(ss.str());
+      void throwOnError(const BinaryEncoder& out)
+      {
+        if (out.status() != BinaryEncoder::Status::Ok) {
+          std::stringstream ss;
+          ss << "OSerialization error " << BinaryEncoder::statusToStr(out.status());
+          throw std::runtime_error(ss.str());
+        }
+      }
+
+      void throwOnError(const BinaryDecoder& in)
+      {
+        if (in.status() != BinaryDecoder::Status::Ok) {
+          std::stringstream ss;
+          ss << "ISerialization error " << BinaryDecoder::statusToStr(in.status());
+          throw std::runtime_error(ss.str());
+        }
+      }
+
+      /// How to encode and decode the values of a type, computed once per
+      /// type, so that the signatures written in the headers of lists, maps
+      /// and tuples are not recomputed and the type is not dispatched on for
+      /// each value. Values of the kinds which depend on the value itself
+      /// (dynamic values, objects, raw buffers, optionals...) are handled by
+      /// the visitors.
+      struct CodecPlan
+      {
+        enum class Op
+        {
+          Visit,
+          Bool, Int8, UInt8, Int16, UInt16, Int32, UInt32, Int64, UInt64,
+          Float, Double,
+          String, StdString, StringView,
+          List, NumberVector, Map, Tuple,
+        };
+
+        TypeInterface* type = nullptr;
+        Op op = Op::Visit;
+        /// Element of a list, key and element of a map, members of a tuple.
+        std::vector<const CodecPlan*> children;
+        /// Element of a list, key of a map, or the tuple itself.
+        Signature signature;
+        /// Element of a map.
+        Signature elementSignature;
+        const NumberVectorCodec* numberVector = nullptr;
+      };
+
+      using CodecPlans = std::unordered_map<TypeInterface*, std::unique_ptr<CodecPlan>>;
+
+      CodecPlan::Op intOp(IntTypeInterface* type)
+      {
+        switch ((type->isSigned() ? 1 : -1) * static_cast<int>(type->size()))
+        {
+          case 0:  return CodecPlan::Op::Bool;
+          case 1:  return CodecPlan::Op::Int8;
+          case -1: return CodecPlan::Op::UInt8;
+          case 2:  return CodecPlan::Op::Int16;
+          case -2: return CodecPlan::Op::UInt16;
+          case 4:  return CodecPlan::Op::Int32;
+          case -4: return CodecPlan::Op::UInt32;
+          case 8:  return CodecPlan::Op::Int64;
+          case -8: return CodecPlan::Op::UInt64;
+          default: return CodecPlan::Op::Visit;
+        }
+      }
+
+      CodecPlan::Op floatOp(FloatTypeInterface* type)
+      {
+        switch (type->size())
+        {
+          case 4: return CodecPlan::Op::Float;
+          case 8: return CodecPlan::Op::Double;
+          default: return CodecPlan::Op::Visit;
+        }
+      }
+
+      const CodecPlan& makeCodecPlan(CodecPlans& plans, TypeInterface* type)
+      {
+        auto& slot = plans[type];
+        if (slot)
+          return *slot;
+        slot.reset(new CodecPlan);
+        // The map may be rehashed while the plans of the children are made.
+        CodecPlan& plan = *slot;
+        plan.type = type;
+        if (!type)
+          return plan;
+
+        // The operation is set last: if computing a signature throws, the
+        // values of the type are left to the visitors, and fail as before.
+        switch (type->kind())
+        {
+          case TypeKind_Int:
+            plan.op = intOp(static_cast<IntTypeInterface*>(type));
+            break;
+          case TypeKind_Float:
+            plan.op = floatOp(static_cast<FloatTypeInterface*>(type));
+            break;
+          case TypeKind_String:
+            if (type->info() == typeOf<std::string>()->info())
+              plan.op = CodecPlan::Op::StdString;
+            else if (type->info() == typeOf<StringView>()->info())
+              plan.op = CodecPlan::Op::StringView;
+            else
+              plan.op = CodecPlan::Op::String;
+            break;
+          case TypeKind_List:
+          {
+            TypeInterface* elementType = static_cast<ListTypeInterface*>(type)->elementType();
+            plan.signature = elementType->signature();
+            plan.numberVector = findNumberVectorCodec(type);
+            if (plan.numberVector)
+            {
+              plan.op = CodecPlan::Op::NumberVector;
+              break;
+            }
+            plan.children.push_back(&makeCodecPlan(plans, elementType));
+            plan.op = CodecPlan::Op::List;
+            break;
+          }
+          case TypeKind_Map:
+          {
+            MapTypeInterface* mapType = static_cast<MapTypeInterface*>(type);
+            plan.signature = mapType->keyType()->signature();
+            plan.elementSignature = mapType->elementType()->signature();
+            plan.children.push_back(&makeCodecPlan(plans, mapType->keyType()));
+            plan.children.push_back(&makeCodecPlan(plans, mapType->elementType()));
+            plan.op = CodecPlan::Op::Map;
+            break;
+          }
+          case TypeKind_Tuple:
+          {
+            const auto memberTypes = static_cast<StructTypeInterface*>(type)->memberTypes();
+            plan.signature = makeTupleSignature(memberTypes);
+            for (TypeInterface* memberType : memberTypes)
+              plan.children.push_back(&makeCodecPlan(plans, memberType));
+            plan.op = CodecPlan::Op::Tuple;
+            break;
+          }
+          default:
+            break;
+        }
+        return plan;
+      }
+
+      /// Types are never destroyed, nor are their plans.
+      const CodecPlan& codecPlan(TypeInterface* type)
+      {
+        // Each thread remembers the plans it used, to find them without
+        // locking.
+        thread_local std::unordered_map<TypeInterface*, const CodecPlan*> threadPlans;
+        const auto it = threadPlans.find(type);
+        if (it != threadPlans.end())
+          return *it->second;
+
+        struct Registry
+        {
+          boost::mutex mutex;
+          CodecPlans plans;
+        };
+        static Registry& registry = *new Registry;
+        boost::mutex::scoped_lock lock(registry.mutex);
+        try {
+          makeCodecPlan(registry.plans, type);
+        } catch (const std::exception& e) {
+          qiLogVerbose() << "No codec plan for type " << type->infoString() << ": " << e.what();
+        }
+        const CodecPlan& plan = *registry.plans[type];
+        threadPlans.emplace(type, &plan);
+        return plan;
       }
+
+      class PlanEncoder
+      {
+      public:
+        PlanEncoder(BinaryEncoder& out, const SerializeObjectCallback& context, const MessageSocketPtr& socket)
+          : out(out)
+          , context(context)
+          , socket(socket)
+        {}
+
+        /// Does not check the status of the encoder.
+        void encode(const CodecPlan& plan, AnyReference value)
+        {
+          void* storage = value.rawValue();
+          switch (plan.op)
+          {
+            case CodecPlan::Op::Visit:
+            {
+              SerializeTypeVisitor stv(out, context, value, socket);
+              typeDispatch(stv, value);
+              break;
+            }
+            case CodecPlan::Op::Bool:   out.write(static_cast<bool>(!!intValue(plan, storage))); break;
+            case CodecPlan::Op::Int8:   out.write(static_cast<int8_t>(intValue(plan, storage)));  break;
+            case CodecPlan::Op::UInt8:  out.write(static_cast<uint8_t>(intValue(plan, storage))); break;
+            case CodecPlan::Op::Int16:  out.write(static_cast<int16_t>(intValue(plan, storage))); break;
+            case CodecPlan::Op::UInt16: out.write(static_cast<uint16_t>(intValue(plan, storage)));break;
+            case CodecPlan::Op::Int32:  out.write(static_cast<int32_t>(intValue(plan, storage))); break;
+            case CodecPlan::Op::UInt32: out.write(static_cast<uint32_t>(intValue(plan, storage)));break;
+            case CodecPlan::Op::Int64:  out.write(static_cast<int64_t>(intValue(plan, storage))); break;
+            case CodecPlan::Op::UInt64: out.write(static_cast<uint64_t>(intValue(plan, storage)));break;
+            case CodecPlan::Op::Float:
+              out.write(static_cast<float>(static_cast<FloatTypeInterface*>(plan.type)->get(storage)));
+              break;
+            case CodecPlan::Op::Double:
+              out.write(static_cast<FloatTypeInterface*>(plan.type)->get(storage));
+              break;
+            case CodecPlan::Op::String:
+            {
+              StringTypeInterface::ManagedRawString content =
+                  static_cast<StringTypeInterface*>(plan.type)->get(storage);
+              out.writeString(content.first.first, content.first.second);
+              if (content.second)
+                content.second(content.first);
+              break;
+            }
+            case CodecPlan::Op::StdString:
+            {
+              const auto& s = *static_cast<std::string*>(plan.type->ptrFromStorage(&storage));
+              out.writeString(s.data(), s.size());
+              break;
+            }
+            case CodecPlan::Op::StringView:
+            {
+              const auto& s = *static_cast<StringView*>(plan.type->ptrFromStorage(&storage));
+              out.writeString(s.data(), s.size());
+              break;
+            }
+            case CodecPlan::Op::NumberVector:
+              out.beginList(numericConvert<std::uint32_t>(value.size()), plan.signature);
+              plan.numberVector->write(value, out);
+              out.endList();
+              break;
+            case CodecPlan::Op::List:
+            {
+              ListTypeInterface* listType = static_cast<ListTypeInterface*>(plan.type);
+              out.beginList(numericConvert<std::uint32_t>(listType->size(storage)), plan.signature);
+              const AnyIterator end = listType->end(storage);
+              for (AnyIterator it = listType->begin(storage); it != end; ++it)
+                encodeElement(*plan.children[0], *it);
+              out.endList();
+              break;
+            }
+            case CodecPlan::Op::Map:
+            {
+              MapTypeInterface* mapType = static_cast<MapTypeInterface*>(plan.type);
+              out.beginMap(numericConvert<std::uint32_t>(mapType->size(storage)), plan.signature,
+                           plan.elementSignature);
+              const AnyIterator end = mapType->end(storage);
+              for (AnyIterator it = mapType->begin(storage); it != end; ++it)
+              {
+                AnyReference v = *it;
+                encodeElement(*plan.children[0], v[0]);
+                encodeElement(*plan.children[1], v[1]);
+              }
+              out.endMap();
+              break;
+            }
+            case CodecPlan::Op::Tuple:
+            {
+              StructTypeInterface* tupleType = static_cast<StructTypeInterface*>(plan.type);
+              out.beginTuple(plan.signature);
+              for (unsigned i = 0; i < plan.children.size(); ++i)
+              {
+                const CodecPlan& member = *plan.children[i];
+                encodeElement(member, AnyReference(member.type, tupleType->get(storage, i)));
+              }
+              out.endTuple();
+              break;
+            }
+          }
+        }
+
+      private:
+        static int64_t intValue(const CodecPlan& plan, void* storage)
+        {
+          return static_cast<IntTypeInterface*>(plan.type)->get(storage);
+        }
+
+        // Iterators may give elements of another type than the one of their
+        // container.
+        void encodeElement(const CodecPlan& plan, AnyReference value)
+        {
+          encode(value.type() == plan.type ? plan : codecPlan(value.type()), value);
+          throwOnError(out);
+        }
+
+        BinaryEncoder& out;
+        const SerializeObjectCallback& context;
+        const MessageSocketPtr& socket;
+      };
+
+      class PlanDecoder
+      {
+      public:
+        PlanDecoder(BinaryDecoder& in, const DeserializeObjectCallback& context, const MessageSocketPtr& socket)
+          : in(in)
+          , context(context)
+          , socket(socket)
+        {}
+
+        /// Decodes in place into `result` and returns it. Does not check the
+        /// status of the decoder.
+        AnyReference decode(const CodecPlan& plan, AnyReference result)
+        {
+          void* storage = result.rawValue();
+          switch (plan.op)
+          {
+            case CodecPlan::Op::Visit:
+            {
+              DeserializeTypeVisitor dtv(in, context, socket);
+              dtv.result = result;
+              typeDispatch(dtv, dtv.result);
+              return dtv.result;
+            }
+            case CodecPlan::Op::Bool:   setInt(plan, &storage, read<bool>());     break;
+            case CodecPlan::Op::Int8:   setInt(plan, &storage, read<int8_t>());   break;
+            case CodecPlan::Op::UInt8:  setInt(plan, &storage, read<uint8_t>());  break;
+            case CodecPlan::Op::Int16:  setInt(plan, &storage, read<int16_t>());  break;
+            case CodecPlan::Op::UInt16: setInt(plan, &storage, read<uint16_t>()); break;
+            case CodecPlan::Op::Int32:  setInt(plan, &storage, read<int32_t>());  break;
+            case CodecPlan::Op::UInt32: setInt(plan, &storage, read<uint32_t>()); break;
+            case CodecPlan::Op::Int64:  setInt(plan, &storage, read<int64_t>());  break;
+            case CodecPlan::Op::UInt64:
+              setInt(plan, &storage, static_cast<int64_t>(read<uint64_t>()));
+              break;
+            case CodecPlan::Op::Float:
+              static_cast<FloatTypeInterface*>(plan.type)->set(&storage, read<float>());
+              break;
+            case CodecPlan::Op::Double:
+              static_cast<FloatTypeInterface*>(plan.type)->set(&storage, read<double>());
+              break;
+            case CodecPlan::Op::String:
+            {
+              std::string s;
+              in.read(s);
+              static_cast<StringTypeInterface*>(plan.type)->set(&storage, s.data(), s.size());
+              break;
+            }
+            case CodecPlan::Op::StdString:
+            {
+              std::string s;
+              in.read(s);
+              std::swap(s, *static_cast<std::string*>(plan.type->ptrFromStorage(&storage)));
+              break;
+            }
+            case CodecPlan::Op::StringView:
+              in.read(*static_cast<StringView*>(plan.type->ptrFromStorage(&storage)));
+              break;
+            case CodecPlan::Op::NumberVector:
+            {
+              const auto size = read<std::uint32_t>();
+              if (in.status() == BinaryDecoder::Status::Ok)
+                plan.numberVector->read(result, size, in);
+              break;
+            }
+            case CodecPlan::Op::List:
+            {
+              const auto size = read<std::uint32_t>();
+              throwOnError(in);
+              ListTypeInterface* listType = static_cast<ListTypeInterface*>(plan.type);
+              for (std::uint32_t i = 0; i < size; ++i)
+              {
+                UniqueAnyReference element{ decodeElement(*plan.children[0]) };
+                listType->pushBack(&storage, element->rawValue());
+              }
+              break;
+            }
+            case CodecPlan::Op::Map:
+            {
+              const auto size = read<std::uint32_t>();
+              throwOnError(in);
+              MapTypeInterface* mapType = static_cast<MapTypeInterface*>(plan.type);
+              for (std::uint32_t i = 0; i < size; ++i)
+              {
+                UniqueAnyReference key{ decodeElement(*plan.children[0]) };
+                UniqueAnyReference element{ decodeElement(*plan.children[1]) };
+                mapType->insert(&storage, key->rawValue(), element->rawValue());
+              }
+              break;
+            }
+            case CodecPlan::Op::Tuple:
+            {
+              std::vector<UniqueAnyReference> members;
+              std::vector<void*> memberStorages;
+              members.reserve(plan.children.size());
+              memberStorages.reserve(plan.children.size());
+              for (const CodecPlan* member : plan.children)
+              {
+                members.emplace_back(decodeElement(*member));
+                if (!members.back()->isValid())
+                  throw std::runtime_error("Deserialization of tuple field failed");
+                memberStorages.push_back(members.back()->rawValue());
+              }
+              static_cast<StructTypeInterface*>(plan.type)->set(&storage, memberStorages);
+              break;
+            }
+          }
+          return AnyReference(plan.type, storage);
+        }
+
+      private:
+        template <typename T>
+        T read()
+        {
+          T value{};
+          in.read(value);
+          return value;
+        }
+
+        static void setInt(const CodecPlan& plan, void** storage, int64_t value)
+        {
+          static_cast<IntTypeInterface*>(plan.type)->set(storage, value);
+        }
+
+        AnyReference decodeElement(const CodecPlan& plan)
+        {
+          AnyReference value(plan.type);
+          try {
+            value = decode(plan, value);
+            throwOnError(in);
+            return value;
+          } catch (const std::runtime_error&) {
+            value.destroy();
+            throw;
+          }
+        }
+
+        BinaryDecoder& in;
+        const DeserializeObjectCallback& context;
+        const MessageSocketPtr& socket;
+      };
+    }
+
+    void serialize(AnyReference val, BinaryEncoder& out, SerializeObjectCallback context, MessageSocketPtr socket)
+    {
+      PlanEncoder(out, context, socket).encode(codecPlan(val.type()), val);
+      throwOnError(out);
     }
 
     AnyReference deserialize(AnyReference what, BinaryDecoder& in, DeserializeObjectCallback context, MessageSocketPtr socket)
     {
-      detail::DeserializeTypeVisitor dtv(in, context, socket);
-      dtv.result = what;
-      qi::typeDispatch(dtv, dtv.result);
-      if (in.status() != BinaryDecoder::Status::Ok) {
-        std::stringstream ss;
-        ss << "ISerialization error " << BinaryDecoder::statusToStr(in.status());
-        throw std::runtime_error(ss.str());
-      }
-      return dtv.result;
+      const auto result = PlanDecoder(in, context, socket).decode(codecPlan(what.type()), what);
+      throwOnError(in);
+      return result;
     }
 
     AnyReference deserialize(qi::TypeInterface *type, BinaryDecoder& in, DeserializeObjectCallback context, MessageSocketPtr socket)
@@ -895,8 +1487,7 @@ namespace qi {
 
   void encodeBinary(qi::Buffer *buf, const qi::AutoAnyReference &gvp, SerializeObjectCallback onObject, MessageSocketPtr socket) {
     BinaryEncoder be(*buf);
-    detail::SerializeTypeVisitor stv(be, onObject, gvp, socket);
-    qi::typeDispatch(stv, gvp);
+    detail::PlanEncoder(be, onObject, socket).encode(detail::codecPlan(gvp.type()), gvp);
     if (be.status() != BinaryEncoder::Status::Ok) {
       std::stringstream ss;
       ss << "OSerialization error " << BinaryEncoder::statusToStr(be.status());
@@ -908,16 +1499,14 @@ namespace qi {
   AnyReference decodeBinary(qi::BufferReader *buf, qi::AnyReference gvp,
     DeserializeObjectCallback onObject, MessageSocketPtr socket) {
     BinaryDecoder in(buf);
-    detail::DeserializeTypeVisitor dtv(in, onObject, socket);
-    dtv.result = gvp;
-    qi::typeDispatch(dtv, dtv.result);
+    const auto result = detail::PlanDecoder(in, onObject, socket).decode(detail::codecPlan(gvp.type()), gvp);
     if (in.status() != BinaryDecoder::Status::Ok) {
       std::stringstream ss;
       ss << "ISerialization error " << BinaryDecoder::statusToStr(in.status());
       qiLogError() << ss.str();
       throw std::runtime_error(ss.str());
     }
-    return dtv.result;
+    return result;
   }
 
 }
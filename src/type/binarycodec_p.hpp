@@ -66,6 +66,14 @@ namespace qi {
 
     void read(qi::Buffer &buffer);
 
+    /// Reads a string as a slice of the buffer being read, without copying
+    /// its characters when they are big enough.
+    void read(StringView& s);
+
+    /// Reads a raw value written by BinaryEncoder::writeSharedMemoryRaw.
+    /// Returns false, without moving forward, if the next value is not one.
+    bool readSharedMemoryRaw(std::string& segment, std::uint64_t& size);
+
     template<typename T> void read(T& v);
 
     //read raw data
@@ -136,6 +144,9 @@ namespace qi {
 
     void writeValue(const AnyReference &value, boost::function<void()> recurse = boost::function<void()>());
     void writeRaw(const Buffer &buffer);
+    /// Writes a raw value whose content is in a shared memory segment instead
+    /// of the message. Only valid if the other end supports it.
+    void writeSharedMemoryRaw(const std::string& segment, std::uint64_t size);
 
     template<typename T>
     void write(const T &v);
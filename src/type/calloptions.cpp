@@ -0,0 +1,50 @@
+/*
+**  Copyright (C) 2012 Aldebaran Robotics
+**  See COPYING for the license
+*/
+
+#include <qi/calloptions.hpp>
+
+namespace qi
+{
+  namespace
+  {
+    thread_local boost::optional<SteadyClockTimePoint> currentDeadline;
+    thread_local boost::optional<CallPriority> currentPriority;
+  }
+
+  boost::optional<SteadyClockTimePoint> currentCallDeadline()
+  {
+    return currentDeadline;
+  }
+
+  boost::optional<CallPriority> currentCallPriority()
+  {
+    return currentPriority;
+  }
+
+  namespace detail
+  {
+    CallDeadlineScope::CallDeadlineScope(boost::optional<SteadyClockTimePoint> deadline)
+      : _previous(currentDeadline)
+    {
+      currentDeadline = deadline;
+    }
+
+    CallDeadlineScope::~CallDeadlineScope()
+    {
+      currentDeadline = _previous;
+    }
+
+    CallPriorityScope::CallPriorityScope(boost::optional<CallPriority> priority)
+      : _previous(currentPriority)
+    {
+      currentPriority = priority;
+    }
+
+    CallPriorityScope::~CallPriorityScope()
+    {
+      currentPriority = _previous;
+    }
+  }
+}
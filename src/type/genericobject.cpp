@@ -1,5 +1,6 @@
 #include <sstream>
 #include <qi/anyobject.hpp>
+#include <qi/calloptions.hpp>
 #include <qi/log.hpp>
 
 #include "metaobject_p.hpp"
@@ -76,6 +77,113 @@ qi::Future<AnyReference> GenericObject::metaCall(
   return metaCall(methodId, args, callType, returnSignature);
 }
 
+namespace
+{
+  // Special method of the bound objects that calls several of their methods in order, with the
+  // signature of `GenericObject::metaCallBatch`. Proxies of bound objects that support it have it.
+  const char* const callBatchMethod = "callBatch::([(I[m])])";
+
+  using BatchedCalls = std::vector<std::pair<unsigned int, AnyValueVector>>;
+
+  struct BatchState
+  {
+    AnyObject object;
+    BatchedCalls calls;
+    MetaCallType callType;
+    boost::optional<SteadyClockTimePoint> deadline;
+    AnyValueVector results;
+    Promise<AnyValueVector> promise;
+  };
+  using BatchStatePtr = boost::shared_ptr<BatchState>;
+
+  // Returns false and fails the batch if the call failed.
+  bool addBatchResult(BatchState& state, Future<AnyReference> result)
+  {
+    if (result.hasValue())
+    {
+      state.results.push_back(AnyValue(result.value(), false, true));
+      return true;
+    }
+    std::ostringstream ss;
+    ss << "Call #" << state.results.size() << " of the batch failed: "
+       << (result.hasError() ? result.error() : std::string("canceled"));
+    state.promise.setError(ss.str());
+    return false;
+  }
+
+  // Makes the calls that were not made yet, one after the other.
+  void continueBatch(BatchStatePtr state)
+  {
+    while (state->results.size() != state->calls.size())
+    {
+      auto& call = state->calls[state->results.size()];
+      GenericFunctionParameters params;
+      for (auto& arg : call.second)
+        params.push_back(arg.asReference());
+
+      Future<AnyReference> result;
+      {
+        detail::CallDeadlineScope deadlineScope(state->deadline);
+        result = state->object.metaCall(call.first, params, state->callType);
+      }
+      if (!result.isFinished())
+      {
+        result.then(FutureCallbackType_Sync, [state](Future<AnyReference> fut) {
+          if (addBatchResult(*state, fut))
+            continueBatch(state);
+        });
+        return;
+      }
+      if (!addBatchResult(*state, result))
+        return;
+    }
+    state->promise.setValue(std::move(state->results));
+  }
+}
+
+qi::Future<AnyValueVector> GenericObject::callBatch(const CallBatch& batch)
+{
+  BatchedCalls calls;
+  calls.reserve(batch.size());
+  for (const auto& call : batch.calls())
+  {
+    GenericFunctionParameters params;
+    for (const auto& arg : call.args)
+      params.push_back(arg.asReference());
+    const int methodId = findMethod(call.method, params);
+    if (methodId < 0) // in that case, the method ID is an error number
+      return makeFutureError<AnyValueVector>(makeFindMethodErrorMessage(call.method, params, methodId));
+    calls.emplace_back(static_cast<unsigned int>(methodId), call.args);
+  }
+
+  const int batchMethodId = metaObject().methodId(callBatchMethod);
+  if (batchMethodId < 0 || static_cast<unsigned int>(batchMethodId) >= Manageable::startId)
+    return metaCallBatch(std::move(calls), MetaCallType_Queued);
+
+  GenericFunctionParameters params;
+  params.push_back(AnyReference::from(calls));
+  auto futureMeta = metaCallNoUnwrap(static_cast<unsigned int>(batchMethodId), params,
+                                     MetaCallType_Queued, typeOf<AnyValueVector>()->signature());
+  Promise<AnyValueVector> result;
+  adaptFutureUnwrap(futureMeta, result);
+  return result.future();
+}
+
+qi::Future<AnyValueVector> GenericObject::metaCallBatch(
+    std::vector<std::pair<unsigned int, AnyValueVector>> calls,
+    MetaCallType callType)
+{
+  auto state = boost::make_shared<BatchState>();
+  state->object = AnyObject(shared_from_this());
+  state->calls = std::move(calls);
+  state->callType = callType;
+  state->deadline = currentCallDeadline();
+  state->results.reserve(state->calls.size());
+  auto result = state->promise.future();
+  continueBatch(state);
+  return result;
+}
+
 int GenericObject::findMethod(const std::string& nameWithOptionalSignature, const GenericFunctionParameters& args)
 {
   return metaObject().findMethod(nameWithOptionalSignature, args);
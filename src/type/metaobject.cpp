@@ -386,6 +386,8 @@ qi::Atomic<int> MetaObjectPrivate::uid{1};
 
   MemberAddInfo MetaObjectPrivate::addProperty(const std::string& name, const qi::Signature& signature, int id)
   {
+    // Same locking order as refreshCache().
+    boost::recursive_mutex::scoped_lock ml(_methodsMutex);
     boost::recursive_mutex::scoped_lock sl(_propertiesMutex);
     // We need a temporary MetaProperty without any UID to get full signature
     const MetaProperty mpWithoutUid(-1, name, signature);
@@ -464,6 +466,7 @@ qi::Atomic<int> MetaObjectPrivate::uid{1};
   }
 
   bool MetaObjectPrivate::addProperties(const MetaObject::PropertyMap &mms) {
+    boost::recursive_mutex::scoped_lock ml(_methodsMutex);
     boost::recursive_mutex::scoped_lock sl(_propertiesMutex);
     unsigned int newUid;
 
@@ -489,6 +492,7 @@ qi::Atomic<int> MetaObjectPrivate::uid{1};
     // Both change on property(=event) and method will invalidate the cache.
     boost::recursive_mutex::scoped_lock ml(_methodsMutex);
     boost::recursive_mutex::scoped_lock el(_eventsMutex);
+    boost::recursive_mutex::scoped_lock pl(_propertiesMutex);
     unsigned int idx = 0;
     std::ostringstream buff;
     {
@@ -525,6 +529,10 @@ qi::Atomic<int> MetaObjectPrivate::uid{1};
         buff << metaSignalNameSignature << metaSignal.uid();
       }
     }
+    // Properties share their id with a signal, but a signal can exist
+    // without its property: they must be hashed too.
+    for (const auto& metaPropertySlot : _properties)
+      buff << metaPropertySlot.second.toString() << metaPropertySlot.first;
     buff << _description;
 
     // never lower index
@@ -535,8 +543,17 @@ qi::Atomic<int> MetaObjectPrivate::uid{1};
     _dirtyCache = false;
   }
 
+  ka::sha1_digest_t MetaObjectPrivate::contentSHA1() const
+  {
+    boost::recursive_mutex::scoped_lock sl(_methodsMutex);
+    if (_dirtyCache || !_contentSHA1)
+      const_cast<MetaObjectPrivate*>(this)->refreshCache();
+    return *_contentSHA1;
+  }
+
   void MetaObjectPrivate::setDescription(const std::string &desc) {
     _description = desc;
+    _dirtyCache = true;
   }
 
   MetaObject::MetaObject()
@@ -779,6 +796,6 @@ namespace qi {
 
   bool operator < (const MetaObject& a, const MetaObject& b)
   {
-    return a._p->_contentSHA1 < b._p->_contentSHA1;
+    return a._p->contentSHA1() < b._p->contentSHA1();
   }
 }
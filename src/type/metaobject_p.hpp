@@ -154,6 +154,10 @@ namespace qi {
     // Recompute data cached in *ToIdx
     void refreshCache();
 
+    // Digest of all the members and of the description, computed by
+    // refreshCache(). Two metaobjects with the same content have the same one.
+    ka::sha1_digest_t contentSHA1() const;
+
     void setDescription(const std::string& desc);
 
     int findMethod(const std::string& nameWithOptionalSignature, const GenericFunctionParameters& args, bool* canCache) const;
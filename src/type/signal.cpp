@@ -394,6 +394,17 @@ QI_WARNING_POP()
     return *this;
   }
 
+  SignalSubscriber SignalSubscriber::setDeliveryPolicy(const EventDeliveryPolicy& policy)
+  {
+    _p->deliveryPolicy = policy;
+    return *this;
+  }
+
+  boost::optional<EventDeliveryPolicy> SignalSubscriber::deliveryPolicy() const
+  {
+    return _p->deliveryPolicy;
+  }
+
   SignalLink SignalSubscriber::link() const
   {
     return _p->linkId;
@@ -2,13 +2,18 @@
 **  Copyright (C) 2012 Aldebaran Robotics
 **  See COPYING for the license
 */
+#include <array>
 #include <cstring>
+#include <mutex>
+#include <unordered_map>
 
 #include <qi/assert.hpp>
 #include <qi/signature.hpp>
 #include <qi/type/typeinterface.hpp>
 #include <qi/jsoncodec.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/optional.hpp>
 #include "signatureconvertor.hpp"
 
 qiLogCategory("qitype.signature");
@@ -102,7 +107,7 @@ namespace qi {
   }
 
 
-  float Signature::isConvertibleTo(const qi::Signature& b) const
+  static float convertibility(const qi::Signature& a, const qi::Signature& b)
   {
     /* The returned float is just a basic heuristic, it does not handle:
      * - comparison between integral types
@@ -118,28 +123,28 @@ namespace qi {
     static const char floating[] = "fd";
     static const char container[] = "[{(";
 
-    Signature::Type s = type();
+    Signature::Type s = a.type();
     Signature::Type d = b.type();
 
     //varargs are just vector, handle them that way
-    if (s == Type_VarArgs)
-      s = Type_List;
-    if (d == Type_VarArgs)
-      d = Type_List;
-    if (d == Type_Void)
+    if (s == Signature::Type_VarArgs)
+      s = Signature::Type_List;
+    if (d == Signature::Type_VarArgs)
+      d = Signature::Type_List;
+    if (d == Signature::Type_Void)
       return calculateFactor();
-    if (d == Type_Unknown)
+    if (d == Signature::Type_Unknown)
     {
       // We cannot anwser the question for unknown types. So let it pass
       // and the conversion code will decide.
       // Type_Unknown is not serializable anyway.
-      if (s != Type_Unknown)
+      if (s != Signature::Type_Unknown)
         error += 10.f; // Weird but can happen with object pointers
       return calculateFactor();
     }
 
-    if (d == Type_Dynamic || // Dynamic can convert to whatever
-        s == Type_None) // None means parent is empty container
+    if (d == Signature::Type_Dynamic || // Dynamic can convert to whatever
+        s == Signature::Type_None) // None means parent is empty container
     {
       error += 5.f; // big malus for dynamic
       return calculateFactor();
@@ -148,22 +153,22 @@ namespace qi {
     // Source is convertible to an optional if source's type is convertible to the destination
     // optional value type or if source's type is void. For instance, int is convertible to
     // optional<int>, but also int is convertible to optional<dynamic>
-    if (d == Type_Optional)
+    if (d == Signature::Type_Optional)
     {
       // If source is also an optional then we are performing a optional to optional conversion.
       // By design this is allowed if source value type is convertible to dest value type.
-      if (s == Type_Optional)
-        return children()[0].isConvertibleTo(b.children()[0]);
+      if (s == Signature::Type_Optional)
+        return a.children()[0].isConvertibleTo(b.children()[0]);
 
       // Converting void to optional means constructing an empty optional. This design choice was
       // made to simplify conversion from language bindings where types are not explicit (like
       // python).
-      else if (s == Type_Void)
+      else if (s == Signature::Type_Void)
         return calculateFactor();
 
-      return isConvertibleTo(b.children()[0]);
+      return a.isConvertibleTo(b.children()[0]);
     }
-    else if (s == Type_Optional)
+    else if (s == Signature::Type_Optional)
     {
       // The case where dest is dynamic is already handled above, and is the same for optionals:
       // converting optionals to dynamic is allowed, but converting optionals to anything else is
@@ -188,12 +193,12 @@ namespace qi {
     { // Container, list or map
       if (d != s)
         return 0.f; // Must be same container
-      if (children().size() != b.children().size())
+      if (a.children().size() != b.children().size())
       {
-        if (s != Type_Tuple)
+        if (s != Signature::Type_Tuple)
           return 0.f;
         // Special case for same-named tuples that might be compatible
-        std::string aSrc = annotation();
+        std::string aSrc = a.annotation();
         std::string aDst = b.annotation();
         // This mode is recommended only for tests where it is more
         // conveniant to have differently named structs
@@ -211,7 +216,7 @@ namespace qi {
       SignatureVector::const_iterator its;
       SignatureVector::const_iterator itd;
       itd = b.children().begin();
-      for (its = children().begin(); its != children().end(); ++its, ++itd) {
+      for (its = a.children().begin(); its != a.children().end(); ++its, ++itd) {
         float childRes = its->isConvertibleTo(*itd);
         if (childRes == 0.f)
           return 0.f; // Just check subtype compatibility
@@ -219,7 +224,7 @@ namespace qi {
         // [s] -> m should have a greater convertibility than [s] -> [m]
         childErr *= 1.0f - (1.0f - childRes) * 0.95f;
       }
-      QI_ASSERT(its==children().end() && itd==b.children().end()); // we already exited on size mismatch
+      QI_ASSERT(its==a.children().end() && itd==b.children().end()); // we already exited on size mismatch
     }
     else if (d != s)
       return 0.f;
@@ -293,8 +298,115 @@ namespace qi {
 
     std::string            _signature;
     std::vector<Signature> _children;
+    // Hash of the type and of the children, without annotations: signatures
+    // equal by operator== have the same hash.
+    std::size_t            _hash = 0;
+    // Interned nodes are immutable and live until the end of the process.
+    bool                   _interned = false;
+    mutable std::once_flag _prettyOnce;
+    mutable std::string    _pretty;
   };
 
+  namespace
+  {
+    // Above these sizes, new signatures are parsed on their own and their
+    // conversion scores are recomputed, so that peers sending arbitrary
+    // signatures cannot grow the tables without bound.
+    const std::size_t maxInternedSignatures = 1u << 14;
+    const std::size_t maxConvertibilityScores = 1u << 16;
+
+    // Table split in shards, each with its own lock, so that threads looking
+    // up different keys rarely contend. Each shard holds an equal part of the
+    // entries.
+    template <typename Key, typename Value, typename Hash = std::hash<Key>>
+    class ShardedTable
+    {
+    public:
+      explicit ShardedTable(std::size_t maxSize)
+        : _maxShardSize(maxSize / shardCount)
+      {
+      }
+
+      boost::optional<Value> find(const Key& key)
+      {
+        auto& shard = shardOf(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const auto it = shard.entries.find(key);
+        if (it == shard.entries.end())
+          return {};
+        return it->second;
+      }
+
+      // Returns the value of the key in the table, which is the given one
+      // unless another thread inserted the key meanwhile, or none if the
+      // table is full.
+      boost::optional<Value> insert(const Key& key, Value value)
+      {
+        auto& shard = shardOf(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const auto it = shard.entries.find(key);
+        if (it != shard.entries.end())
+          return it->second;
+        if (shard.entries.size() >= _maxShardSize)
+          return {};
+        return shard.entries.emplace(key, std::move(value)).first->second;
+      }
+
+    private:
+      static const std::size_t shardCount = 32u;
+
+      struct Shard
+      {
+        std::mutex mutex;
+        std::unordered_map<Key, Value, Hash> entries;
+        // Keeps the locks of neighbouring shards on different cache lines.
+        char padding[64];
+      };
+
+      Shard& shardOf(const Key& key)
+      {
+        return _shards[Hash{}(key) % shardCount];
+      }
+
+      const std::size_t _maxShardSize;
+      std::array<Shard, shardCount> _shards;
+    };
+
+    // Parsed signatures, shared by all the Signature objects built from the
+    // same string.
+    struct SignatureTable
+    {
+      SignatureTable()
+        : none(boost::make_shared<SignaturePrivate>())
+        , nodes(maxInternedSignatures)
+      {
+        none->_interned = true;
+      }
+
+      // Shared by default constructed signatures.
+      const boost::shared_ptr<SignaturePrivate> none;
+      ShardedTable<std::string, boost::shared_ptr<SignaturePrivate>> nodes;
+    };
+
+    // Scores of isConvertibleTo between interned signatures.
+    using ConvertibilityKey = std::pair<const SignaturePrivate*, const SignaturePrivate*>;
+    using ConvertibilityTable = ShardedTable<ConvertibilityKey, float, boost::hash<ConvertibilityKey>>;
+
+    // Never destroyed: signatures may be built or compared by static
+    // destructors.
+    SignatureTable& signatureTable()
+    {
+      static SignatureTable* const table = new SignatureTable;
+      return *table;
+    }
+
+    ConvertibilityTable& convertibilityTable()
+    {
+      static ConvertibilityTable* const table = new ConvertibilityTable(maxConvertibilityScores);
+      return *table;
+    }
+  }
+
   static size_t findNext(const std::string &signature, size_t index) {
 
     if (index >= signature.size())
@@ -468,31 +580,73 @@ namespace qi {
     }
     parseChildren(signature, begin);
     _signature.assign(signature, begin, end - begin);
+    _hash = static_cast<unsigned char>(_signature[0]);
+    for (const auto& child : _children)
+      boost::hash_combine(_hash, child._p->_hash);
+  }
+
+  // Returns the node shared by all the signatures of this string, parsing it
+  // on first use.
+  static boost::shared_ptr<SignaturePrivate> internSignature(const std::string &signature, size_t begin, size_t end)
+  {
+    // Let the parser report elements running past the string.
+    if (end > signature.size())
+    {
+      auto node = boost::make_shared<SignaturePrivate>();
+      node->init(signature, begin, end);
+      return node;
+    }
+
+    auto& nodes = signatureTable().nodes;
+    const std::string key(signature, begin, end - begin);
+    if (const auto interned = nodes.find(key))
+      return *interned;
+
+    // Parse without the lock: children are interned too.
+    auto node = boost::make_shared<SignaturePrivate>();
+    node->init(signature, begin, end);
+    // Only nodes of the table are shared, and then immutable.
+    node->_interned = true;
+    if (const auto interned = nodes.insert(key, node))
+      return *interned;
+    node->_interned = false;
+    return node;
   }
 
   Signature::Signature()
-    : _p(boost::make_shared<SignaturePrivate>())
+    : _p(signatureTable().none)
   {
   }
 
   Signature::Signature(const char *signature)
-    : _p(boost::make_shared<SignaturePrivate>())
+    : Signature(std::string(signature))
   {
-    _p->_signature.assign(signature);
-    _p->init(_p->_signature, 0, _p->_signature.size());
   }
 
 
   Signature::Signature(const std::string &signature)
-    : _p(boost::make_shared<SignaturePrivate>())
+    : _p(internSignature(signature, 0, signature.size()))
   {
-    _p->init(signature, 0, signature.size());
   }
 
   Signature::Signature(const std::string &signature, size_t begin, size_t end)
-    : _p(boost::make_shared<SignaturePrivate>())
+    : _p(internSignature(signature, begin, end))
+  {
+  }
+
+  float Signature::isConvertibleTo(const qi::Signature& b) const
   {
-    _p->init(signature, begin, end);
+    if (!_p->_interned || !b._p->_interned)
+      return convertibility(*this, b);
+
+    auto& scores = convertibilityTable();
+    const ConvertibilityKey key(_p.get(), b._p.get());
+    if (const auto score = scores.find(key))
+      return *score;
+
+    const float score = convertibility(*this, b);
+    scores.insert(key, score);
+    return score;
   }
 
   bool Signature::isValid() const {
@@ -525,8 +679,11 @@ namespace qi {
   std::string Signature::toPrettySignature() const {
     if (!isValid())
       return std::string("Invalid");
-    SignatureConvertor sc(this);
-    return sc.signature();
+    std::call_once(_p->_prettyOnce, [this] {
+      SignatureConvertor sc(this);
+      _p->_pretty = sc.signature();
+    });
+    return _p->_pretty;
   }
 
   Signature::Type Signature::type() const {
@@ -597,6 +754,10 @@ namespace qi {
   //compare signature without taking annotation into account
   bool operator==(const Signature& lhs, const Signature& rhs)
   {
+    if (lhs._p == rhs._p)
+      return true;
+    if (lhs._p->_hash != rhs._p->_hash)
+      return false;
     if (lhs.type() != rhs.type())
       return false;
     if (lhs.children().size() != rhs.children().size())
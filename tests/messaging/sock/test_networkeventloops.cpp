@@ -0,0 +1,42 @@
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <qi/eventloop.hpp>
+#include <src/messaging/sock/networkeventloops.hpp>
+
+using namespace qi;
+
+TEST(NetNetworkEventLoops, FirstIsTheNetworkEventLoop)
+{
+  const auto& loops = getNetworkEventLoops();
+  ASSERT_FALSE(loops.empty());
+  EXPECT_EQ(getNetworkEventLoop(), loops.front());
+}
+
+TEST(NetNetworkEventLoops, PickedAmongNetworkEventLoops)
+{
+  const auto& loops = getNetworkEventLoops();
+  for (std::size_t i = 0u; i != 2u * loops.size(); ++i)
+  {
+    const auto loop = sock::pickNetworkEventLoop();
+    EXPECT_NE(loops.end(), std::find(loops.begin(), loops.end(), loop));
+  }
+}
+
+TEST(NetNetworkEventLoops, LoadCountsSocketsWhileTheyLive)
+{
+  const auto loop = getNetworkEventLoops().front();
+  const auto before = sock::networkEventLoopSocketCounts().front();
+  {
+    sock::NetworkEventLoopLoad load{loop->nativeHandle()};
+    EXPECT_EQ(before + 1u, sock::networkEventLoopSocketCounts().front());
+  }
+  EXPECT_EQ(before, sock::networkEventLoopSocketCounts().front());
+}
+
+TEST(NetNetworkEventLoops, LoadIgnoresOtherIoServices)
+{
+  const auto before = sock::networkEventLoopSocketCounts();
+  int other = 0;
+  sock::NetworkEventLoopLoad load{&other};
+  EXPECT_EQ(before, sock::networkEventLoopSocketCounts());
+}
@@ -0,0 +1,108 @@
+#include <cstring>
+#include <vector>
+#include <gtest/gtest.h>
+#include <qi/buffer.hpp>
+#include <src/messaging/sock/receivebufferpool.hpp>
+
+using qi::sock::ReceiveBufferPool;
+
+namespace
+{
+  const ReceiveBufferPool::Limits limits{64u * 1024u, 256u * 1024u};
+}
+
+TEST(NetReceiveBufferPool, DefaultsKeepLittleMemoryPerSocket)
+{
+  const auto defaults = ReceiveBufferPool::Limits::defaults();
+  EXPECT_LE(defaults.maxBlockSize, defaults.maxFreeByteCount);
+  EXPECT_LE(defaults.maxFreeByteCount, 256u * 1024u);
+}
+
+TEST(NetReceiveBufferPool, SmallPayloadsAreNotPooled)
+{
+  auto pool = ReceiveBufferPool::create(limits);
+  EXPECT_FALSE(pool->acquire(0u));
+  EXPECT_FALSE(pool->acquire(100u));
+  EXPECT_EQ(0u, pool->stats().missCount);
+}
+
+TEST(NetReceiveBufferPool, BigPayloadsAreNotPooled)
+{
+  auto pool = ReceiveBufferPool::create(limits);
+  EXPECT_FALSE(pool->acquire(limits.maxBlockSize + 1u));
+  EXPECT_EQ(0u, pool->stats().missCount);
+}
+
+TEST(NetReceiveBufferPool, DisabledPool)
+{
+  auto pool = ReceiveBufferPool::create({limits.maxBlockSize, 0u});
+  EXPECT_FALSE(pool->acquire(4096u));
+}
+
+TEST(NetReceiveBufferPool, BlockIsReusedWhenBufferIsDestroyed)
+{
+  auto pool = ReceiveBufferPool::create(limits);
+  const void* firstBlock = nullptr;
+  {
+    auto buffer = pool->acquire(3000u);
+    ASSERT_TRUE(buffer);
+    EXPECT_EQ(3000u, buffer->size());
+    firstBlock = buffer->data();
+    const auto stats = pool->stats();
+    EXPECT_EQ(0u, stats.hitCount);
+    EXPECT_EQ(1u, stats.missCount);
+    EXPECT_EQ(1u, stats.usedBlockCount);
+    EXPECT_EQ(0u, stats.freeBlockCount);
+  }
+  EXPECT_EQ(1u, pool->stats().freeBlockCount);
+  EXPECT_EQ(4096u, pool->stats().freeByteCount);
+
+  // Same size class.
+  auto buffer = pool->acquire(2100u);
+  ASSERT_TRUE(buffer);
+  EXPECT_EQ(firstBlock, buffer->data());
+  const auto stats = pool->stats();
+  EXPECT_EQ(1u, stats.hitCount);
+  EXPECT_EQ(1u, stats.missCount);
+  EXPECT_EQ(0.5, stats.hitRate());
+}
+
+TEST(NetReceiveBufferPool, FreeBlocksAreBounded)
+{
+  auto pool = ReceiveBufferPool::create(limits);
+  {
+    std::vector<qi::Buffer> buffers;
+    buffers.reserve(8u); // Buffers are copied when the vector grows.
+    for (int i = 0; i < 8; ++i)
+      buffers.push_back(*pool->acquire(limits.maxBlockSize));
+    EXPECT_EQ(8u, pool->stats().usedBlockCount);
+  }
+  const auto stats = pool->stats();
+  EXPECT_EQ(0u, stats.usedBlockCount);
+  EXPECT_EQ(limits.maxFreeByteCount / limits.maxBlockSize, stats.freeBlockCount);
+  EXPECT_LE(stats.freeByteCount, limits.maxFreeByteCount);
+}
+
+TEST(NetReceiveBufferPool, BufferOutlivesPool)
+{
+  auto pool = ReceiveBufferPool::create(limits);
+  auto buffer = *pool->acquire(5000u);
+  pool.reset();
+  std::memset(buffer.data(), 42, buffer.size());
+  EXPECT_EQ(42, static_cast<const char*>(buffer.data())[4999]);
+}
+
+TEST(NetReceiveBufferPool, CopiesHaveTheirOwnStorage)
+{
+  auto pool = ReceiveBufferPool::create(limits);
+  qi::Buffer copy;
+  {
+    auto buffer = *pool->acquire(5000u);
+    std::memset(buffer.data(), 7, buffer.size());
+    copy = buffer;
+    EXPECT_NE(buffer.data(), copy.data());
+  }
+  EXPECT_EQ(1u, pool->stats().freeBlockCount);
+  ASSERT_EQ(5000u, copy.size());
+  EXPECT_EQ(7, static_cast<const char*>(copy.data())[4999]);
+}
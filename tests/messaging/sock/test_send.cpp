@@ -329,3 +329,307 @@ TEST(NetSendMessageEnqueue, MultipleSendsFromMultipleThreadsAsio)
   // Allow detached thread to finish.
   for (auto& t: sendThreads) t.join();
 }
+
+// Messages enqueued while a write is pending are sent together in the next
+// write, and the callback is still called for each of them.
+TEST(NetSendMessageEnqueue, BatchesMessagesEnqueuedDuringWrite)
+{
+  using namespace qi;
+  using namespace qi::sock;
+  using N = mock::Network;
+  std::mutex writeMutex;
+  std::vector<std::size_t> writeBufferCounts;
+  std::vector<N::_anyTransferHandler> pendingWrites;
+  auto scopedWrite = ka::scoped_set_and_restore(
+    N::_async_write_next_layer,
+    [&](SslSocket<N>::next_layer_type&, const std::vector<N::_const_buffer_sequence>& buffers,
+          N::_anyTransferHandler writeCont) {
+      std::lock_guard<std::mutex> lock(writeMutex);
+      writeBufferCounts.push_back(buffers.size());
+      pendingWrites.push_back(writeCont);
+    }
+  );
+  auto completeNextWrite = [&] {
+    N::_anyTransferHandler writeCont;
+    {
+      std::lock_guard<std::mutex> lock(writeMutex);
+      writeCont = pendingWrites.front();
+      pendingWrites.erase(pendingWrites.begin());
+    }
+    writeCont(success<ErrorCode<N>>(), 0u);
+  };
+  SslContext<N> context;
+  auto socket = makeSslSocketPtr<N>(N::defaultIoService(), context);
+  using I = std::list<Message>::const_iterator;
+  std::vector<unsigned int> sentIds;
+  SendMessageEnqueue<N, SslSocketPtr<N>> send{socket, SendBatchLimits::defaults()};
+  auto onSent = [&](ErrorCode<N> erc, I itMsg) {
+    EXPECT_EQ(success<ErrorCode<N>>(), erc);
+    sentIds.push_back(itMsg->id());
+    return true;
+  };
+  const std::size_t messageCount = 5u;
+  std::vector<unsigned int> ids;
+  for (std::size_t i = 0u; i != messageCount; ++i)
+  {
+    Message msg;
+    ids.push_back(msg.id());
+    send(std::move(msg), SslEnabled{false}, onSent);
+  }
+  // The first message is written alone, the others are enqueued meanwhile.
+  completeNextWrite();
+  completeNextWrite();
+  ASSERT_EQ(ids, sentIds);
+  // An empty message needs a buffer for its header and one for its data.
+  ASSERT_EQ((std::vector<std::size_t>{2u, 2u * (messageCount - 1u)}), writeBufferCounts);
+}
+
+TEST(NetSendMessageEnqueue, BatchRespectsLimits)
+{
+  using namespace qi;
+  using namespace qi::sock;
+  using N = mock::Network;
+  std::vector<std::size_t> writeBufferCounts;
+  std::vector<N::_anyTransferHandler> pendingWrites;
+  auto scopedWrite = ka::scoped_set_and_restore(
+    N::_async_write_next_layer,
+    [&](SslSocket<N>::next_layer_type&, const std::vector<N::_const_buffer_sequence>& buffers,
+          N::_anyTransferHandler writeCont) {
+      writeBufferCounts.push_back(buffers.size());
+      pendingWrites.push_back(writeCont);
+    }
+  );
+  SslContext<N> context;
+  auto socket = makeSslSocketPtr<N>(N::defaultIoService(), context);
+  using I = std::list<Message>::const_iterator;
+  std::size_t sentCount = 0u;
+  // At most 3 messages, or 4 buffers (that is 2 empty messages), per write.
+  SendBatchLimits limits{3u, std::numeric_limits<std::size_t>::max(), 4u};
+  SendMessageEnqueue<N, SslSocketPtr<N>> send{socket, limits};
+  auto onSent = [&](ErrorCode<N>, I) {
+    ++sentCount;
+    return true;
+  };
+  const std::size_t messageCount = 6u;
+  for (std::size_t i = 0u; i != messageCount; ++i)
+  {
+    send(Message{}, SslEnabled{false}, onSent);
+  }
+  while (!pendingWrites.empty())
+  {
+    auto writeCont = pendingWrites.front();
+    pendingWrites.erase(pendingWrites.begin());
+    writeCont(success<ErrorCode<N>>(), 0u);
+  }
+  ASSERT_EQ(messageCount, sentCount);
+  ASSERT_EQ((std::vector<std::size_t>{2u, 4u, 4u, 2u}), writeBufferCounts);
+}
+
+namespace
+{
+  qi::Message makeMessage(qi::Message::Type type)
+  {
+    qi::Message msg;
+    msg.setType(type);
+    return msg;
+  }
+}
+
+// A message of a higher priority class overtakes the queued messages of lower
+// classes, but not the message being written.
+TEST(NetSendMessageEnqueue, HigherPriorityMessagesOvertakeQueuedOnes)
+{
+  using namespace qi;
+  using namespace qi::sock;
+  using N = mock::Network;
+  std::vector<N::_anyTransferHandler> pendingWrites;
+  auto scopedWrite = ka::scoped_set_and_restore(
+    N::_async_write_next_layer,
+    [&](SslSocket<N>::next_layer_type&, const std::vector<N::_const_buffer_sequence>&,
+          N::_anyTransferHandler writeCont) {
+      pendingWrites.push_back(writeCont);
+    }
+  );
+  SslContext<N> context;
+  auto socket = makeSslSocketPtr<N>(N::defaultIoService(), context);
+  using I = std::list<Message>::const_iterator;
+  auto waitStats = std::make_shared<SendWaitStats>();
+  SendMessageEnqueue<N, SslSocketPtr<N>> send{socket, SendBatchLimits::disabled(),
+                                              SendPriorities::enabled(), waitStats};
+  std::vector<unsigned int> sentIds;
+  auto onSent = [&](ErrorCode<N>, I itMsg) {
+    sentIds.push_back(itMsg->id());
+    return true;
+  };
+  std::vector<Message> msgs{
+    makeMessage(Message::Type_Event),
+    makeMessage(Message::Type_Event),
+    makeMessage(Message::Type_Call),
+    makeMessage(Message::Type_Reply),
+    makeMessage(Message::Type_Event),
+  };
+  msgs.back().setPriority(Message::Priority::Control);
+  for (const auto& msg : msgs)
+    send(msg, SslEnabled{false}, onSent);
+  while (!pendingWrites.empty())
+  {
+    auto writeCont = pendingWrites.front();
+    pendingWrites.erase(pendingWrites.begin());
+    writeCont(success<ErrorCode<N>>(), 0u);
+  }
+  EXPECT_EQ((std::vector<unsigned int>{msgs[0].id(), msgs[3].id(), msgs[4].id(),
+                                       msgs[2].id(), msgs[1].id()}), sentIds);
+  EXPECT_EQ(2u, (*waitStats)[Message::Priority::Control].messageCount);
+  EXPECT_EQ(1u, (*waitStats)[Message::Priority::Normal].messageCount);
+  EXPECT_EQ(2u, (*waitStats)[Message::Priority::Bulk].messageCount);
+  const auto bulk = (*waitStats)[Message::Priority::Bulk];
+  EXPECT_LE(bulk.mean(), bulk.max);
+  EXPECT_EQ(5u, waitStats->histogram().count());
+}
+
+TEST(NetSendPriorities, BigControlMessagesAreNormal)
+{
+  using namespace qi;
+  using namespace qi::sock;
+  auto priorities = SendPriorities::enabled();
+  priorities.maxControlByteCount = 100u;
+  auto reply = makeMessage(Message::Type_Reply);
+  EXPECT_EQ(Message::Priority::Control, priorities.of(reply));
+  Buffer buffer;
+  buffer.write(std::string(200, 'a').data(), 200u);
+  reply.setBuffer(buffer);
+  EXPECT_EQ(Message::Priority::Normal, priorities.of(reply));
+  reply.setPriority(Message::Priority::Control);
+  EXPECT_EQ(Message::Priority::Control, priorities.of(reply));
+  EXPECT_EQ(Message::Priority::Bulk, priorities.of(makeMessage(Message::Type_Event)));
+}
+
+TEST(NetSendPriorities, CancelsAreInTheClassOfCalls)
+{
+  using namespace qi;
+  using namespace qi::sock;
+  auto priorities = SendPriorities::enabled();
+  EXPECT_EQ(priorities.of(makeMessage(Message::Type_Call)),
+            priorities.of(makeMessage(Message::Type_Cancel)));
+  priorities.ofType[Message::Type_Cancel] = Message::Priority::Control;
+  priorities.ofType[Message::Type_Call] = Message::Priority::Bulk;
+  EXPECT_EQ(Message::Priority::Bulk, priorities.of(makeMessage(Message::Type_Cancel)));
+}
+
+TEST(NetSendPriorities, DisabledKeepsOrder)
+{
+  using namespace qi;
+  using namespace qi::sock;
+  const auto priorities = SendPriorities::disabled();
+  for (auto type : {Message::Type_Call, Message::Type_Reply, Message::Type_Event,
+                    Message::Type_Capability})
+    EXPECT_EQ(Message::Priority::Normal, priorities.of(makeMessage(type)));
+}
+
+// While the queue is full, an event replaces the queued event of the same
+// signal, unless it is being written.
+TEST(NetSendMessageEnqueue, EventsAreCoalescedWhenQueueIsFull)
+{
+  using namespace qi;
+  using namespace qi::sock;
+  using N = mock::Network;
+  std::vector<N::_anyTransferHandler> pendingWrites;
+  auto scopedWrite = ka::scoped_set_and_restore(
+    N::_async_write_next_layer,
+    [&](SslSocket<N>::next_layer_type&, const std::vector<N::_const_buffer_sequence>&,
+          N::_anyTransferHandler writeCont) {
+      pendingWrites.push_back(writeCont);
+    }
+  );
+  SslContext<N> context;
+  auto socket = makeSslSocketPtr<N>(N::defaultIoService(), context);
+  using I = std::list<Message>::const_iterator;
+  auto monitor = std::make_shared<SendQueueMonitor>(SendQueueMonitor::Limits{
+    2u, std::numeric_limits<std::size_t>::max(), 0u, std::numeric_limits<std::size_t>::max(),
+    SendQueueMonitor::EventPolicy::Coalesce});
+  SendMessageEnqueue<N, SslSocketPtr<N>> send{socket, SendBatchLimits::disabled(),
+                                              SendPriorities::disabled(), {}, monitor};
+  std::vector<unsigned int> sentIds;
+  auto onSent = [&](ErrorCode<N>, I itMsg) {
+    sentIds.push_back(itMsg->id());
+    return true;
+  };
+  std::vector<Message> msgs;
+  for (int i = 0; i != 4; ++i)
+    msgs.push_back(makeMessage(Message::Type_Event));
+  for (const auto& msg : msgs)
+    send(msg, SslEnabled{false}, onSent);
+  EXPECT_TRUE(monitor->isFull());
+  EXPECT_EQ(2u, monitor->depth().messageCount);
+  auto notFull = monitor->notFull();
+  while (!pendingWrites.empty())
+  {
+    auto writeCont = pendingWrites.front();
+    pendingWrites.erase(pendingWrites.begin());
+    writeCont(success<ErrorCode<N>>(), 0u);
+  }
+  EXPECT_EQ((std::vector<unsigned int>{msgs[0].id(), msgs[3].id()}), sentIds);
+  EXPECT_EQ(2u, monitor->stats().coalescedEventCount);
+  EXPECT_EQ((SendQueueMonitor::Depth{0u, 0u}), monitor->depth());
+  EXPECT_EQ(FutureState_FinishedWithValue, notFull.wait());
+}
+
+// A conflatable event replaces the queued conflatable event of the same signal,
+// unless it is being written, even without a monitor.
+TEST(NetSendMessageEnqueue, ConflatableEventsAreCoalesced)
+{
+  using namespace qi;
+  using namespace qi::sock;
+  using N = mock::Network;
+  std::vector<N::_anyTransferHandler> pendingWrites;
+  auto scopedWrite = ka::scoped_set_and_restore(
+    N::_async_write_next_layer,
+    [&](SslSocket<N>::next_layer_type&, const std::vector<N::_const_buffer_sequence>&,
+          N::_anyTransferHandler writeCont) {
+      pendingWrites.push_back(writeCont);
+    }
+  );
+  SslContext<N> context;
+  auto socket = makeSslSocketPtr<N>(N::defaultIoService(), context);
+  using I = std::list<Message>::const_iterator;
+  SendMessageEnqueue<N, SslSocketPtr<N>> send{socket};
+  std::vector<unsigned int> sentIds;
+  auto onSent = [&](ErrorCode<N>, I itMsg) {
+    sentIds.push_back(itMsg->id());
+    return true;
+  };
+  std::vector<Message> msgs;
+  for (int i = 0; i != 5; ++i)
+  {
+    msgs.push_back(makeMessage(Message::Type_Event));
+    msgs.back().setConflatable(i != 2);
+  }
+  for (const auto& msg : msgs)
+    send(msg, SslEnabled{false}, onSent);
+  while (!pendingWrites.empty())
+  {
+    auto writeCont = pendingWrites.front();
+    pendingWrites.erase(pendingWrites.begin());
+    writeCont(success<ErrorCode<N>>(), 0u);
+  }
+  // The event that is not conflatable is neither replaced nor replacing.
+  EXPECT_EQ((std::vector<unsigned int>{msgs[0].id(), msgs[4].id(), msgs[2].id()}), sentIds);
+}
+
+TEST(NetDurationHistogram, BucketsHaveExponentialBounds)
+{
+  using namespace qi;
+  EXPECT_EQ(0u, DurationHistogram::bucketOf(NanoSeconds{999}));
+  EXPECT_EQ(1u, DurationHistogram::bucketOf(MicroSeconds{1}));
+  EXPECT_EQ(3u, DurationHistogram::bucketOf(MicroSeconds{5}));
+  EXPECT_EQ(DurationHistogram::bucketCount - 1u, DurationHistogram::bucketOf(Seconds{3600}));
+
+  sock::AtomicDurationHistogram atomicHistogram;
+  for (int i = 0; i != 9; ++i)
+    atomicHistogram.record(MicroSeconds{5});
+  atomicHistogram.record(MilliSeconds{3});
+  const auto histogram = atomicHistogram.snapshot();
+  EXPECT_EQ(10u, histogram.count());
+  EXPECT_EQ(Duration{MicroSeconds{8}}, histogram.quantileUpperBound(0.5));
+  EXPECT_EQ(Duration{MicroSeconds{4096}}, histogram.quantileUpperBound(0.95));
+}
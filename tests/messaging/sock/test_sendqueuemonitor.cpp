@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+#include <src/messaging/sock/sendqueuemonitor.hpp>
+
+using qi::sock::SendQueueMonitor;
+
+namespace
+{
+  const SendQueueMonitor::Limits limits{4u, 1000u, 2u, 500u,
+                                        SendQueueMonitor::EventPolicy::Keep};
+}
+
+TEST(NetSendQueueMonitor, UnlimitedIsNeverFull)
+{
+  SendQueueMonitor monitor;
+  for (int i = 0; i != 1000; ++i)
+    monitor.added(1024u * 1024u);
+  EXPECT_FALSE(monitor.isFull());
+  EXPECT_TRUE(monitor.notFull().isFinished());
+  EXPECT_EQ((SendQueueMonitor::Depth{1000u, 1000u * 1024u * 1024u}), monitor.depth());
+}
+
+TEST(NetSendQueueMonitor, FullByMessageCountUntilLowWatermark)
+{
+  SendQueueMonitor monitor{limits};
+  for (int i = 0; i != 3; ++i)
+    monitor.added(10u);
+  EXPECT_FALSE(monitor.isFull());
+  monitor.added(10u);
+  EXPECT_TRUE(monitor.isFull());
+  auto notFull = monitor.notFull();
+  EXPECT_TRUE(notFull.isRunning());
+
+  monitor.removed(1u, 10u);
+  EXPECT_TRUE(monitor.isFull());
+  EXPECT_TRUE(notFull.isRunning());
+
+  monitor.removed(1u, 10u);
+  EXPECT_FALSE(monitor.isFull());
+  EXPECT_EQ(qi::FutureState_FinishedWithValue, notFull.wait());
+  EXPECT_EQ(1u, monitor.stats().fullCount);
+  EXPECT_EQ((SendQueueMonitor::Depth{4u, 40u}), monitor.stats().maxDepth);
+}
+
+TEST(NetSendQueueMonitor, FullByByteCountUntilLowWatermark)
+{
+  SendQueueMonitor monitor{limits};
+  monitor.added(1200u);
+  EXPECT_TRUE(monitor.isFull());
+  monitor.replaced(1200u, 600u);
+  EXPECT_TRUE(monitor.isFull());
+  monitor.replaced(600u, 400u);
+  EXPECT_FALSE(monitor.isFull());
+  EXPECT_EQ((SendQueueMonitor::Depth{1u, 400u}), monitor.depth());
+}
@@ -0,0 +1,181 @@
+#include <string>
+#include <gtest/gtest.h>
+#include <boost/asio.hpp>
+#include <src/messaging/sock/uring.hpp>
+
+using qi::sock::Uring;
+
+namespace
+{
+  using LocalSocket = boost::asio::local::stream_protocol::socket;
+
+  struct NetUring : testing::Test
+  {
+    void SetUp() override
+    {
+      supported = Uring::isSupported();
+      if (supported)
+        boost::asio::local::connect_pair(writer, reader);
+    }
+
+    boost::asio::io_service io;
+    LocalSocket writer{io};
+    LocalSocket reader{io};
+    bool supported = false;
+  };
+}
+
+TEST_F(NetUring, ReadsWhatIsWritten)
+{
+  if (!supported)
+    return;
+  auto& ring = boost::asio::use_service<Uring>(io);
+  char sent[] = "hello world";
+  char received[12] = {};
+  boost::system::error_code writeError, readError;
+  std::size_t written = 0u, read = 0u;
+  ring.asyncWrite(writer.native_handle(), {iovec{sent, 11u}},
+    [&](boost::system::error_code erc, std::size_t n) { writeError = erc; written = n; });
+  // Scattered in two buffers, to check that the read fills both.
+  ring.asyncRead(reader.native_handle(), {iovec{received, 5u}, iovec{received + 5, 6u}},
+    [&](boost::system::error_code erc, std::size_t n) { readError = erc; read = n; });
+  io.run();
+
+  EXPECT_FALSE(writeError);
+  EXPECT_FALSE(readError);
+  EXPECT_EQ(11u, written);
+  EXPECT_EQ(11u, read);
+  EXPECT_EQ(std::string("hello world"), std::string(received));
+  EXPECT_EQ(1u, ring.stats().fixedReadCount);
+}
+
+TEST_F(NetUring, TransfersMoreThanTheSocketBuffer)
+{
+  if (!supported)
+    return;
+  // Non-blocking sockets make the transfers wait for readiness.
+  writer.non_blocking(true);
+  reader.non_blocking(true);
+  auto& ring = boost::asio::use_service<Uring>(io);
+  std::string sent(4u * 1024u * 1024u, 'x');
+  std::string received(sent.size(), '\0');
+  std::size_t written = 0u, read = 0u;
+  ring.asyncWrite(writer.native_handle(), {iovec{&sent[0], sent.size()}},
+    [&](boost::system::error_code, std::size_t n) { written = n; });
+  ring.asyncRead(reader.native_handle(), {iovec{&received[0], received.size()}},
+    [&](boost::system::error_code, std::size_t n) { read = n; });
+  io.run();
+
+  EXPECT_EQ(sent.size(), written);
+  EXPECT_EQ(sent.size(), read);
+  EXPECT_EQ(sent, received);
+}
+
+TEST_F(NetUring, ReadFailsWithEofOnShutdown)
+{
+  if (!supported)
+    return;
+  auto& ring = boost::asio::use_service<Uring>(io);
+  char c;
+  boost::system::error_code readError;
+  ring.asyncRead(reader.native_handle(), {iovec{&c, 1u}},
+    [&](boost::system::error_code erc, std::size_t) { readError = erc; });
+  writer.shutdown(boost::asio::socket_base::shutdown_both);
+  io.run();
+
+  EXPECT_EQ(boost::asio::error::eof, readError);
+}
+
+// More operations than the rings hold are started before any completion is
+// reaped: those that do not fit wait, and all of them complete.
+TEST_F(NetUring, CompletesMoreOperationsThanTheRingsHold)
+{
+  if (!supported)
+    return;
+  auto& ring = boost::asio::use_service<Uring>(io);
+  const std::size_t count = 4096u;
+  std::string sent(count, 'x');
+  std::string received(count, '\0');
+  std::size_t writeCount = 0u, readCount = 0u;
+  for (std::size_t i = 0u; i != count; ++i)
+  {
+    ring.asyncWrite(writer.native_handle(), {iovec{&sent[i], 1u}},
+      [&](boost::system::error_code erc, std::size_t n) { if (!erc && n == 1u) ++writeCount; });
+  }
+  for (std::size_t i = 0u; i != count; ++i)
+  {
+    ring.asyncRead(reader.native_handle(), {iovec{&received[i], 1u}},
+      [&](boost::system::error_code erc, std::size_t n) { if (!erc && n == 1u) ++readCount; });
+  }
+  io.run();
+
+  EXPECT_EQ(count, writeCount);
+  EXPECT_EQ(count, readCount);
+  EXPECT_EQ(sent, received);
+}
+
+namespace
+{
+  // Connects a new pair of sockets, one of which takes the number of a
+  // descriptor that was just closed. Returns it, and the other one as `peer`.
+  LocalSocket& connectPairReusing(int fd, LocalSocket& a, LocalSocket& b, LocalSocket*& peer)
+  {
+    boost::asio::local::connect_pair(a, b);
+    const bool reusedByA = a.native_handle() == fd;
+    peer = reusedByA ? &b : &a;
+    return reusedByA ? a : b;
+  }
+}
+
+TEST_F(NetUring, CanceledReadIsAbortedAndLeavesTheNextSocketAlone)
+{
+  if (!supported)
+    return;
+  auto& ring = boost::asio::use_service<Uring>(io);
+  const int fd = reader.native_handle();
+  char c = '\0';
+  boost::system::error_code readError;
+  // Not submitted until the io service runs.
+  ring.asyncRead(fd, {iovec{&c, 1u}},
+    [&](boost::system::error_code erc, std::size_t) { readError = erc; });
+  ring.cancel(fd);
+  reader.close();
+
+  LocalSocket a{io}, b{io};
+  LocalSocket* peer = nullptr;
+  auto& next = connectPairReusing(fd, a, b, peer);
+  ASSERT_EQ(fd, next.native_handle());
+  boost::asio::write(*peer, boost::asio::buffer("x", 1u));
+  io.run();
+
+  EXPECT_EQ(boost::asio::error::operation_aborted, readError);
+  EXPECT_EQ('\0', c);
+  EXPECT_EQ(1u, next.available());
+}
+
+// A read started before its socket is closed goes on with the closed socket,
+// and not with the next one that takes its number.
+TEST_F(NetUring, ReadOfAClosedSocketDoesNotReadTheNextOne)
+{
+  if (!supported)
+    return;
+  auto& ring = boost::asio::use_service<Uring>(io);
+  const int fd = reader.native_handle();
+  char c = '\0';
+  boost::system::error_code readError;
+  ring.asyncRead(fd, {iovec{&c, 1u}},
+    [&](boost::system::error_code erc, std::size_t) { readError = erc; });
+  reader.close();
+
+  LocalSocket a{io}, b{io};
+  LocalSocket* peer = nullptr;
+  auto& next = connectPairReusing(fd, a, b, peer);
+  ASSERT_EQ(fd, next.native_handle());
+  boost::asio::write(*peer, boost::asio::buffer("x", 1u));
+  writer.close();
+  io.run();
+
+  EXPECT_EQ(boost::asio::error::eof, readError);
+  EXPECT_EQ('\0', c);
+  EXPECT_EQ(1u, next.available());
+}
@@ -6,7 +6,10 @@
 */
 
 #include <gtest/gtest.h>
+#include <cstring>
+#include <list>
 #include <map>
+#include <vector>
 #include <qi/buffer.hpp>
 #include <qi/binarycodec.hpp>
 #include <qi/session.hpp>
@@ -369,6 +372,59 @@ TEST(TestBind, serializeVectorStrings)
   EXPECT_EQ(vs[2], vs2[2]);
 }
 
+TEST(TestBind, serializeVectorNumbers)
+{
+  qi::Buffer      buf;
+  qi::BufferReader bufr(buf);
+  const std::vector<float> vf{ 1.5f, -2.25f, 3.f };
+  const std::vector<std::uint8_t> vu8{ 0, 42, 255 };
+  const std::vector<std::int64_t> vi64;
+  qi::encodeBinary(&buf, vf);
+  qi::encodeBinary(&buf, vu8);
+  qi::encodeBinary(&buf, vi64);
+
+  std::vector<float> vf1;
+  qi::decodeBinary(&bufr, &vf1);
+  std::vector<std::uint8_t> vu81;
+  qi::decodeBinary(&bufr, &vu81);
+  std::vector<std::int64_t> vi641;
+  qi::decodeBinary(&bufr, &vi641);
+
+  EXPECT_EQ(vf, vf1);
+  EXPECT_EQ(vu8, vu81);
+  EXPECT_TRUE(vi641.empty());
+}
+
+TEST(TestBind, serializeVectorNumbersSameAsOtherLists)
+{
+  const std::vector<int> vi{ 1, -2, 3, INT_MAX };
+  const std::list<int> li(vi.begin(), vi.end());
+  qi::Buffer bufv;
+  qi::encodeBinary(&bufv, vi);
+  qi::Buffer bufl;
+  qi::encodeBinary(&bufl, li);
+
+  ASSERT_EQ(bufl.size(), bufv.size());
+  EXPECT_EQ(0, memcmp(bufl.data(), bufv.data(), bufv.size()));
+
+  qi::BufferReader bufr(bufv);
+  std::list<int> li1;
+  qi::decodeBinary(&bufr, &li1);
+  EXPECT_EQ(li, li1);
+}
+
+TEST(TestBind, deserializeTruncatedVectorNumbers)
+{
+  qi::Buffer buf;
+  qi::encodeBinary(&buf, std::vector<double>{ 1., 2., 3. });
+  qi::Buffer truncated;
+  truncated.write(buf.data(), buf.size() - 1);
+
+  qi::BufferReader bufr(truncated);
+  std::vector<double> vd;
+  EXPECT_ANY_THROW(qi::decodeBinary(&bufr, &vd));
+}
+
 TEST(TestBind, serializeBuffer)
 {
   qi::Buffer buf;
@@ -540,6 +596,68 @@ TEST(TestBind, SerializeCustomComplex)
   ASSERT_EQ(comp, compout);
 }
 
+TEST(TestBind, SerializeMapOfCustomComplex)
+{
+  Complex comp;
+  comp.foo = 2.5;
+  comp.points.push_back(point(5, 6));
+  comp.baz = "testbaz";
+  comp.stuff.push_back(std::vector<int>(3, 7));
+  std::map<std::string, Complex> m;
+  m["first"] = comp;
+  comp.points.clear();
+  m["second"] = comp;
+
+  qi::Buffer buf;
+  qi::BufferReader bufr(buf);
+  qi::encodeBinary(&buf, m);
+  qi::encodeBinary(&buf, m);
+  std::map<std::string, Complex> mout1;
+  qi::decodeBinary(&bufr, &mout1);
+  std::map<std::string, Complex> mout2;
+  qi::decodeBinary(&bufr, &mout2);
+  ASSERT_EQ(m, mout1);
+  ASSERT_EQ(m, mout2);
+}
+
+TEST(TestBind, SerializeStringView)
+{
+  const std::string big(4096, 'b');
+  std::vector<qi::StringView> views;
+  views.push_back(qi::StringView("small"));
+  views.push_back(qi::StringView(big));
+
+  qi::Buffer buf;
+  qi::encodeBinary(&buf, views);
+
+  // Views and strings have the same encoding.
+  std::vector<std::string> strings;
+  qi::BufferReader bufr(buf);
+  qi::decodeBinary(&bufr, &strings);
+  ASSERT_EQ(2u, strings.size());
+  EXPECT_EQ("small", strings[0]);
+  EXPECT_EQ(big, strings[1]);
+
+  std::vector<qi::StringView> viewsout;
+  qi::BufferReader bufr2(buf);
+  qi::decodeBinary(&bufr2, &viewsout);
+  ASSERT_EQ(views, viewsout);
+  const char* data = static_cast<const char*>(static_cast<const qi::Buffer&>(buf).data());
+  EXPECT_LE(data, viewsout[1].data());
+  EXPECT_GE(data + buf.size(), viewsout[1].data() + viewsout[1].size());
+}
+
+TEST(TestBind, EmptyStringViewsAreEqual)
+{
+  const qi::StringView empty;
+  EXPECT_EQ(empty, qi::StringView());
+  EXPECT_EQ(empty, qi::StringView(std::string()));
+  EXPECT_EQ(empty, std::string());
+  EXPECT_EQ(std::string(), empty);
+  EXPECT_NE(empty, qi::StringView("a"));
+  EXPECT_EQ(std::string(), empty.str());
+}
+
 //compilation of weird case. C++ typesystem Hell.
 TEST(TestBind, TestShPtr) {
   boost::shared_ptr<int> sh1;
@@ -14,6 +14,7 @@
 #include <gtest/gtest.h>
 
 #include <boost/assign/list_of.hpp>
+#include <boost/filesystem.hpp>
 
 #include <qi/application.hpp>
 #include <qi/eventloop.hpp>
@@ -25,8 +26,10 @@
 #include <qi/testutils/testutils.hpp>
 #include <ka/errorhandling.hpp>
 #include <ka/functional.hpp>
+#include <ka/scoped.hpp>
 #include <testsession/testsessionpair.hpp>
 #include "src/messaging/message.hpp"
+#include "src/messaging/sharedmemorybuffer.hpp"
 
 qiLogCategory("test");
 
@@ -264,6 +267,90 @@ TEST(TestCall, CallBufferInList)
 
 }
 
+// Big enough to be passed through shared memory when both ends allow it.
+TEST(TestCall, CallBigBuffer)
+{
+  TestSessionPair          p;
+  qi::DynamicObjectBuilder ob;
+  ob.advertiseMethod("echo", [](const qi::Buffer& b) { return b; });
+  qi::AnyObject obj(ob.object());
+  p.server()->registerService("test", obj);
+  qi::AnyObject proxy = p.client()->service("test").value();
+
+  std::vector<unsigned char> data(4 * 1024 * 1024);
+  for (std::size_t i = 0; i < data.size(); ++i)
+    data[i] = static_cast<unsigned char>(i % 251);
+  qi::Buffer buf;
+  buf.write(data.data(), data.size());
+
+  for (int i = 0; i < 3; ++i)
+  {
+    qi::Buffer res = proxy.call<qi::Buffer>("echo", buf);
+    ASSERT_EQ(data.size(), res.size());
+    EXPECT_TRUE(std::equal(data.begin(), data.end(), static_cast<const unsigned char*>(res.data())));
+
+    // The received buffer can be modified and grown as any other.
+    static_cast<unsigned char*>(res.data())[0] = 42;
+    const char tail[] = "canard";
+    ASSERT_TRUE(res.write(tail, sizeof(tail)));
+    ASSERT_EQ(data.size() + sizeof(tail), res.size());
+    EXPECT_EQ(42, static_cast<const unsigned char*>(res.data())[0]);
+    EXPECT_TRUE(std::equal(data.begin() + 1, data.end(),
+                           static_cast<const unsigned char*>(res.data()) + 1));
+  }
+}
+
+namespace
+{
+  // Number of shared memory segments created by this process, the probe
+  // included.
+  std::size_t sharedMemorySegmentCount()
+  {
+    std::ostringstream prefix;
+    prefix << "qi." << std::hex << qi::os::getpid() << ".";
+    boost::system::error_code ec;
+    std::size_t count = 0;
+    for (boost::filesystem::directory_iterator it("/dev/shm", ec), end; !ec && it != end;
+         it.increment(ec))
+    {
+      if (it->path().filename().string().compare(0, prefix.str().size(), prefix.str()) == 0)
+        ++count;
+    }
+    return count;
+  }
+}
+
+TEST(TestCall, LateBigReplyDoesNotLeakItsSharedMemorySegment)
+{
+  if (!qi::shm::probeSegmentName() || !boost::filesystem::is_directory("/dev/shm"))
+    return; // Shared memory segments are not supported.
+
+  TestSessionPair p;
+  qi::DynamicObjectBuilder ob;
+  // The cancellation of the call is ignored, so it is replied to anyway.
+  qi::Promise<qi::Buffer> reply;
+  ob.advertiseMethod("get", [=] { return reply.future(); });
+  p.server()->registerService("test", ob.object());
+  qi::AnyObject proxy = p.client()->service("test").value();
+
+  const auto segmentCount = sharedMemorySegmentCount();
+  auto fut = proxy.async<void>(qi::callTimeout(qi::MilliSeconds(50)), "get");
+  ASSERT_TRUE(test::finishesWithError(fut));
+
+  std::vector<unsigned char> data(4 * 1024 * 1024, 42);
+  qi::Buffer buf;
+  buf.write(data.data(), data.size());
+  reply.setValue(buf);
+
+  // The segment is created when the reply is sent, and removed when the
+  // client drops it.
+  for (int i = 0; i < 200 && sharedMemorySegmentCount() == segmentCount; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  for (int i = 0; i < 200 && sharedMemorySegmentCount() != segmentCount; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  EXPECT_EQ(segmentCount, sharedMemorySegmentCount());
+}
+
 TEST(TestCall, CallComplexType)
 {
   std::list<std::pair<std::string, int> >  robots;
@@ -1975,3 +2062,208 @@ TYPED_TEST(TestCallReadOnlyProperty, CallAdd)
   ASSERT_EQ(qi::FutureState_FinishedWithValue, fut.wait());
   ASSERT_EQ(this->propertyDefaultValue + addedValue, fut.value());
 }
+
+TEST(TestCall, DeadlineFailsTheCallLocally)
+{
+  TestSessionPair p;
+  qi::DynamicObjectBuilder ob;
+  qi::Promise<void> release;
+  ob.advertiseMethod("wait", [=] { release.future().wait(); });
+  p.server()->registerService("deadline", ob.object());
+  qi::AnyObject proxy = p.client()->service("deadline").value();
+
+  auto fut = proxy.async<void>(qi::callTimeout(qi::MilliSeconds(50)), "wait");
+  ASSERT_TRUE(test::finishesWithError(fut));
+  EXPECT_EQ(qi::callDeadlineExceededError, fut.error());
+  release.setValue(nullptr);
+}
+
+TEST(TestCall, DeadlineCancelsTheRemoteCall)
+{
+  TestSessionPair p;
+  qi::DynamicObjectBuilder ob;
+  qi::Promise<void> remoteCanceled;
+  ob.advertiseMethod("wait", [=]() -> qi::Future<void> {
+    qi::Promise<void> promise([=](qi::Promise<void>& p) mutable {
+      p.setCanceled();
+      remoteCanceled.setValue(nullptr);
+    });
+    return promise.future();
+  });
+  p.server()->registerService("deadline", ob.object());
+  qi::AnyObject proxy = p.client()->service("deadline").value();
+
+  auto fut = proxy.async<void>(qi::callTimeout(qi::MilliSeconds(50)), "wait");
+  ASSERT_TRUE(test::finishesWithError(fut));
+  EXPECT_EQ(qi::callDeadlineExceededError, fut.error());
+  EXPECT_TRUE(test::finishesWithValue(remoteCanceled.future()));
+}
+
+TEST(TestCall, LateReplyToExpiredCallIsNotAnError)
+{
+  TestSessionPair p;
+  qi::DynamicObjectBuilder ob;
+  // The cancellation of the call is ignored, so it is replied to anyway.
+  qi::Promise<int> reply;
+  ob.advertiseMethod("get", [=] { return reply.future(); });
+  ob.advertiseMethod("ping", [] {});
+  p.server()->registerService("deadline", ob.object());
+  qi::AnyObject proxy = p.client()->service("deadline").value();
+
+  std::atomic<bool> errorLogged{false};
+  const auto logHandlerName = "check_late_reply_error";
+  qi::log::flush();
+  qi::log::addHandler(
+    logHandlerName,
+    [&errorLogged](const qi::LogLevel level, const qi::Clock::time_point,
+                   const qi::SystemClock::time_point, const char* /*category*/,
+                   const char* message, const char* /*file*/, const char* /*function*/,
+                   int /*line*/) {
+      if (level == qi::LogLevel_Error
+          && std::string(message).find("no promise found") != std::string::npos)
+        errorLogged = true;
+    },
+    qi::LogLevel_Error);
+  auto scopedLogHandler = ka::scoped(logHandlerName, &qi::log::removeHandler);
+
+  auto fut = proxy.async<int>(qi::callTimeout(qi::MilliSeconds(50)), "get");
+  ASSERT_TRUE(test::finishesWithError(fut));
+  EXPECT_EQ(qi::callDeadlineExceededError, fut.error());
+  reply.setValue(42);
+
+  // The late reply is sent before the answer to this call.
+  ASSERT_TRUE(test::finishesWithValue(proxy.async<void>("ping")));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  qi::log::flush();
+  EXPECT_FALSE(errorLogged);
+}
+
+TEST(TestCall, DeadlineIsInheritedByTheRemoteMethod)
+{
+  TestSessionPair p;
+  qi::DynamicObjectBuilder ob;
+  ob.advertiseMethod("hasDeadline", [] { return static_cast<bool>(qi::currentCallDeadline()); });
+  p.server()->registerService("deadline", ob.object());
+  qi::AnyObject proxy = p.client()->service("deadline").value();
+
+  auto withDeadline = proxy.async<bool>(qi::callTimeout(qi::Seconds(60)), "hasDeadline");
+  ASSERT_TRUE(test::finishesWithValue(withDeadline));
+  EXPECT_TRUE(withDeadline.value());
+
+  auto withoutDeadline = proxy.async<bool>("hasDeadline");
+  ASSERT_TRUE(test::finishesWithValue(withoutDeadline));
+  EXPECT_FALSE(withoutDeadline.value());
+}
+
+TEST(TestCall, PriorityIsInheritedByTheRemoteMethod)
+{
+  TestSessionPair p;
+  qi::DynamicObjectBuilder ob;
+  ob.advertiseMethod("priority", [] {
+    const auto priority = qi::currentCallPriority();
+    return priority ? static_cast<int>(*priority) : -1;
+  });
+  p.server()->registerService("priority", ob.object());
+  qi::AnyObject proxy = p.client()->service("priority").value();
+
+  qi::CallOptions options;
+  options.priority = qi::CallPriority::Low;
+  auto withPriority = proxy.async<int>(options, "priority");
+  ASSERT_TRUE(test::finishesWithValue(withPriority));
+  EXPECT_EQ(static_cast<int>(qi::CallPriority::Low), withPriority.value());
+
+  auto withoutPriority = proxy.async<int>("priority");
+  ASSERT_TRUE(test::finishesWithValue(withoutPriority));
+  EXPECT_EQ(-1, withoutPriority.value());
+}
+
+TEST(TestCall, PassedDeadlineIsNotExecuted)
+{
+  TestSessionPair p;
+  qi::DynamicObjectBuilder ob;
+  std::atomic<int> callCount{0};
+  ob.advertiseMethod("count", [&] { ++callCount; });
+  p.server()->registerService("deadline", ob.object());
+  qi::AnyObject proxy = p.client()->service("deadline").value();
+
+  auto fut = proxy.async<void>(qi::CallOptions{qi::SteadyClock::now() - qi::MilliSeconds(1)},
+                               "count");
+  ASSERT_TRUE(test::finishesWithError(fut));
+  EXPECT_EQ(qi::callDeadlineExceededError, fut.error());
+  EXPECT_EQ(0, callCount.load());
+}
+
+namespace
+{
+  qi::AnyObject makeBatchedService(std::vector<int>& calls)
+  {
+    qi::DynamicObjectBuilder ob;
+    ob.advertiseMethod("add", [&](int a, int b) { calls.push_back(a); return a + b; });
+    ob.advertiseMethod("fail", [&](int a) -> int {
+      calls.push_back(a);
+      throw std::runtime_error("failed");
+    });
+    return ob.object();
+  }
+}
+
+TEST(TestCall, CallBatchReturnsResultsInOrder)
+{
+  TestSessionPair p;
+  std::vector<int> calls;
+  p.server()->registerService("batch", makeBatchedService(calls));
+  qi::AnyObject proxy = p.client()->service("batch").value();
+
+  qi::CallBatch batch;
+  batch.add("add", 1, 2).add("add", 10, 20).add("add", 100, 200);
+  auto fut = proxy.callBatch(batch);
+  ASSERT_EQ(qi::FutureState_FinishedWithValue, fut.wait());
+  const auto results = fut.value();
+  ASSERT_EQ(3u, results.size());
+  EXPECT_EQ(3, results[0].to<int>());
+  EXPECT_EQ(30, results[1].to<int>());
+  EXPECT_EQ(300, results[2].to<int>());
+  EXPECT_EQ((std::vector<int>{1, 10, 100}), calls);
+}
+
+TEST(TestCall, CallBatchStopsAtTheFirstError)
+{
+  TestSessionPair p;
+  std::vector<int> calls;
+  p.server()->registerService("batch", makeBatchedService(calls));
+  qi::AnyObject proxy = p.client()->service("batch").value();
+
+  qi::CallBatch batch;
+  batch.add("add", 1, 2).add("fail", 2).add("add", 3, 4);
+  auto fut = proxy.callBatch(batch);
+  ASSERT_EQ(qi::FutureState_FinishedWithError, fut.wait());
+  EXPECT_NE(std::string::npos, fut.error().find("failed"));
+  EXPECT_EQ((std::vector<int>{1, 2}), calls);
+}
+
+TEST(TestCall, CallBatchOnLocalObject)
+{
+  std::vector<int> calls;
+  qi::AnyObject obj = makeBatchedService(calls);
+
+  qi::CallBatch batch;
+  batch.add("add", 4, 5).add("add", 6, 7);
+  auto fut = obj.callBatch(batch);
+  ASSERT_EQ(qi::FutureState_FinishedWithValue, fut.wait());
+  const auto results = fut.value();
+  ASSERT_EQ(2u, results.size());
+  EXPECT_EQ(9, results[0].to<int>());
+  EXPECT_EQ(13, results[1].to<int>());
+}
+
+TEST(TestCall, CallBatchWithUnknownMethodFails)
+{
+  std::vector<int> calls;
+  qi::AnyObject obj = makeBatchedService(calls);
+
+  qi::CallBatch batch;
+  batch.add("add", 4, 5).add("nope");
+  auto fut = obj.callBatch(batch);
+  ASSERT_EQ(qi::FutureState_FinishedWithError, fut.wait());
+  EXPECT_TRUE(calls.empty());
+}
@@ -2,6 +2,7 @@
 ** Copyright (C) 2012 Aldebaran Robotics
 */
 
+#include <atomic>
 #include <map>
 #include <thread>
 #include <chrono>
@@ -12,6 +13,9 @@
 #include <qi/session.hpp>
 #include <testsession/testsessionpair.hpp>
 #include <qi/testutils/testutils.hpp>
+#include "src/messaging/boundobject.hpp"
+#include "src/messaging/messagesocket.hpp"
+#include "src/messaging/sharedmemorybuffer.hpp"
 
 qiLogCategory("test");
 static qi::Promise<int> *payload;
@@ -116,6 +120,263 @@ TEST_F(ObjectEventRemote, CoDeco)
   }
 }
 
+TEST_F(ObjectEventRemote, SeveralRemoteSubscribers)
+{
+  auto otherSession = qi::makeSession();
+  otherSession->connect(p.endpointToServiceSource());
+  qi::AnyObject otherClient = otherSession->service("coin").value();
+
+  qi::Promise<int> otherPayload;
+  qi::SignalLink otherLinkId = otherClient.connect("fire", boost::function<void(int)>([&](int pl) {
+    otherPayload.setValue(pl);
+  })).value();
+  ASSERT_TRUE(qi::isValidSignalLink(otherLinkId));
+  qi::SignalLink linkId = oclient.connect("fire", &onFire).value();
+  ASSERT_TRUE(qi::isValidSignalLink(linkId));
+
+  // Both subscribers receive the event.
+  oserver.post("fire", 44);
+  ASSERT_TRUE(payload->future().hasValue(2000));
+  EXPECT_EQ(44, payload->future().value());
+  ASSERT_TRUE(otherPayload.future().hasValue(2000));
+  EXPECT_EQ(44, otherPayload.future().value());
+
+  // The remaining subscriber still receives the events after the other one disconnected.
+  otherClient.disconnect(otherLinkId).wait();
+  *payload = qi::Promise<int>();
+  oserver.post("fire", 45);
+  ASSERT_TRUE(payload->future().hasValue(2000));
+  EXPECT_EQ(45, payload->future().value());
+
+  otherSession->close();
+}
+
+namespace
+{
+  // Socket that records the messages sent on it, and on which messages can be dispatched as if
+  // they were received.
+  class RecordingMessageSocket : public qi::MessageSocket
+  {
+  public:
+    RecordingMessageSocket() { drain(); }
+
+    qi::FutureSync<void> connect(const qi::Url&) override { return qi::futurize(); }
+    qi::FutureSync<void> disconnect() override { return qi::futurize(); }
+    bool send(qi::Message msg) override
+    {
+      sent->push_back(std::move(msg));
+      return true;
+    }
+    bool ensureReading() override { return true; }
+    Status status() const override { return Status::Connected; }
+    boost::optional<qi::Url> remoteEndpoint() const override { return {}; }
+    qi::Url url() const override { return {}; }
+    qi::sock::SendQueueMonitor::Depth sendQueueDepth() const override { return {}; }
+    qi::Future<void> sendQueueNotFull() const override { return notFull->future(); }
+    qi::MessageSocketStats stats() const override { return {}; }
+
+    bool receive(qi::Message msg) { return _dispatcher.dispatch(std::move(msg)).value(); }
+
+    void setRemoteCapability(const std::string& key, const qi::AnyValue& value)
+    {
+      _remoteCapabilityMap[key] = value;
+    }
+
+    std::vector<qi::Message> sentEvents() const
+    {
+      std::vector<qi::Message> events;
+      for (const auto& msg : sent.get())
+        if (msg.type() == qi::Message::Type_Event)
+          events.push_back(msg);
+      return events;
+    }
+
+    // Set while the send queue is not full.
+    void fill() { notFull = qi::Promise<void>(); }
+    void drain() { notFull->setValue(nullptr); }
+
+    boost::synchronized_value<std::vector<qi::Message>> sent;
+    boost::synchronized_value<qi::Promise<void>> notFull;
+  };
+
+  const unsigned int boundService = 42u;
+
+  // Subscribes the socket to the event, as a remote object would.
+  bool subscribe(RecordingMessageSocket& socket, unsigned int event, qi::SignalLink link,
+                 const std::string& signature = {})
+  {
+    qi::Message call;
+    call.setType(qi::Message::Type_Call);
+    call.setService(boundService);
+    call.setObject(qi::Message::GenericObject_Main);
+    std::vector<qi::AnyReference> args{ qi::AnyReference::from(boundService),
+                                        qi::AnyReference::from(event),
+                                        qi::AnyReference::from(link) };
+    if (signature.empty())
+    {
+      call.setFunction(qi::Message::BoundObjectFunction_RegisterEvent);
+    }
+    else
+    {
+      call.setFunction(qi::Message::BoundObjectFunction_RegisterEventWithSignature);
+      args.push_back(qi::AnyReference::from(signature));
+    }
+    call.setValues(args);
+    return socket.receive(call);
+  }
+}
+
+TEST(BoundObjectEventForwarding, SubscribersShareThePayloadUnlessTheyNeedTheirOwn)
+{
+  qi::DynamicObjectBuilder ob;
+  const auto event = ob.advertiseSignal<int>("fire");
+  qi::AnyObject object = ob.object();
+  const auto bound = qi::BoundObject::makePtr(boundService, qi::Message::GenericObject_Main,
+                                              object, qi::MetaCallType_Direct);
+
+  const auto first = boost::make_shared<RecordingMessageSocket>();
+  const auto second = boost::make_shared<RecordingMessageSocket>();
+  // Asks the arguments to be converted.
+  const auto converting = boost::make_shared<RecordingMessageSocket>();
+  converting->setRemoteCapability("MessageFlags", qi::AnyValue::from(true));
+  // Takes buffers through shared memory, if the platform supports it.
+  const auto sharedMemory = boost::make_shared<RecordingMessageSocket>();
+  const auto probe = qi::shm::probeSegmentName();
+  if (probe)
+    sharedMemory->setRemoteCapability(qi::capabilityname::sharedMemoryBuffersAccepted,
+                                      qi::AnyValue::from(*probe));
+
+  const std::vector<boost::shared_ptr<RecordingMessageSocket>> sockets{ first, second, converting,
+                                                                        sharedMemory };
+  for (const auto& socket : sockets)
+    ASSERT_TRUE(bound->bindToSocket(socket));
+  ASSERT_TRUE(subscribe(*first, event, 1u));
+  ASSERT_TRUE(subscribe(*second, event, 2u));
+  ASSERT_TRUE(subscribe(*converting, event, 3u, "(d)"));
+  ASSERT_TRUE(subscribe(*sharedMemory, event, 4u));
+
+  object.post("fire", 42);
+  const auto allReceived = [&] {
+    return std::all_of(sockets.begin(), sockets.end(),
+                       [](const boost::shared_ptr<RecordingMessageSocket>& socket) {
+                         return !socket->sentEvents().empty();
+                       });
+  };
+  for (int i = 0; i != 200 && !allReceived(); ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  ASSERT_TRUE(allReceived());
+
+  // One payload for the subscribers that take it as is.
+  const auto firstEvent = first->sentEvents().front();
+  EXPECT_EQ(firstEvent.buffer().data(), second->sentEvents().front().buffer().data());
+  // Their own payload for the others.
+  const auto convertedEvent = converting->sentEvents().front();
+  EXPECT_NE(firstEvent.buffer().data(), convertedEvent.buffer().data());
+  EXPECT_TRUE(convertedEvent.flags() & qi::Message::TypeFlag_DynamicPayload);
+  if (probe)
+    EXPECT_NE(firstEvent.buffer().data(), sharedMemory->sentEvents().front().buffer().data());
+
+  for (const auto& socket : sockets)
+    bound->unbindFromSocket(socket);
+}
+
+TEST(BoundObjectCall, ReplyTakesThePriorityOfTheCall)
+{
+  qi::DynamicObjectBuilder ob;
+  const auto method = ob.advertiseMethod("answer", [] { return 42; });
+  const auto bound = qi::BoundObject::makePtr(boundService, qi::Message::GenericObject_Main,
+                                              ob.object(), qi::MetaCallType_Direct);
+  const auto socket = boost::make_shared<RecordingMessageSocket>();
+  ASSERT_TRUE(bound->bindToSocket(socket));
+
+  qi::Message call(qi::Message::Type_Call,
+                   qi::MessageAddress{ 1u, boundService, qi::Message::GenericObject_Main, method });
+  call.setCallPriority(qi::CallPriority::Low);
+  // Only the flags are sent.
+  qi::Message received;
+  received.header() = call.header();
+  ASSERT_TRUE(socket->receive(received));
+
+  for (int i = 0; i != 200 && socket->sent->empty(); ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  ASSERT_EQ(1u, socket->sent->size());
+  const auto reply = socket->sent->front();
+  EXPECT_EQ(qi::Message::Type_Reply, reply.type());
+  EXPECT_EQ(call.id(), reply.id());
+  ASSERT_TRUE(reply.priority());
+  EXPECT_EQ(qi::Message::Priority::Bulk, *reply.priority());
+
+  bound->unbindFromSocket(socket);
+}
+
+TEST(SendQueuesNotFull, ProducerWaitsUntilNoQueueIsFull)
+{
+  const auto idle = boost::make_shared<RecordingMessageSocket>();
+  auto first = boost::make_shared<RecordingMessageSocket>();
+  first->fill();
+  auto second = boost::make_shared<RecordingMessageSocket>();
+  second->fill();
+
+  // The producer sends on the first socket once it may.
+  const auto notFull = qi::sendQueuesNotFull({ idle, first, second });
+  auto produced = qi::async([=] {
+    notFull.value();
+    first->send(qi::Message());
+  });
+  ASSERT_TRUE(test::isStillRunning(produced, test::willDoNothing(), qi::MilliSeconds{ 100 }));
+  first->drain();
+  ASSERT_TRUE(test::isStillRunning(produced, test::willDoNothing(), qi::MilliSeconds{ 100 }));
+  EXPECT_TRUE(first->sent->empty());
+
+  // A socket destroyed while full does not hold producers back.
+  second.reset();
+  ASSERT_TRUE(test::finishesWithValue(produced));
+  EXPECT_EQ(1u, first->sent->size());
+}
+
+TEST_F(ObjectEventRemote, DecimatedSubscriber)
+{
+  std::atomic<int> received{0};
+  qi::EventDeliveryPolicy policy;
+  policy.decimation = 3u;
+  qi::SignalSubscriber subscriber{qi::AnyFunction::from(boost::function<void(int)>([&](int) {
+    ++received;
+  }))};
+  qi::SignalLink linkId = oclient.connect("fire", subscriber.setDeliveryPolicy(policy)).value();
+  ASSERT_TRUE(qi::isValidSignalLink(linkId));
+
+  for (int i = 0; i != 6; ++i)
+    oserver.post("fire", i);
+  for (int i = 0; i != 200 && received.load() < 2; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  std::this_thread::sleep_for(std::chrono::milliseconds{100});
+  EXPECT_EQ(2, received.load());
+}
+
+TEST_F(ObjectEventRemote, SubscribersWithDifferentPoliciesKeepTheirPolicies)
+{
+  std::atomic<int> decimatedReceived{0};
+  std::atomic<int> received{0};
+  qi::EventDeliveryPolicy policy;
+  policy.decimation = 3u;
+  qi::SignalSubscriber decimated{qi::AnyFunction::from(boost::function<void(int)>([&](int) {
+    ++decimatedReceived;
+  }))};
+  ASSERT_TRUE(qi::isValidSignalLink(
+    oclient.connect("fire", decimated.setDeliveryPolicy(policy)).value()));
+  ASSERT_TRUE(qi::isValidSignalLink(
+    oclient.connect("fire", boost::function<void(int)>([&](int) { ++received; })).value()));
+
+  // The subscriber without policy must not miss events, the other one is still decimated.
+  for (int i = 0; i != 6; ++i)
+    oserver.post("fire", i);
+  for (int i = 0; i != 200 && (received.load() < 6 || decimatedReceived.load() < 2); ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  std::this_thread::sleep_for(std::chrono::milliseconds{100});
+  EXPECT_EQ(6, received.load());
+  EXPECT_EQ(2, decimatedReceived.load());
+}
+
 TEST(TestSignal, TwoLongPost)
 {
   qi::DynamicObjectBuilder gob;
@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+#include <src/messaging/eventthrottle.hpp>
+
+using namespace qi;
+using Admission = EventThrottle::Admission;
+
+namespace
+{
+  EventDeliveryPolicy makePolicy(double maxRate, unsigned int decimation, bool conflate)
+  {
+    EventDeliveryPolicy policy;
+    policy.maxRate = maxRate;
+    policy.decimation = decimation;
+    policy.conflate = conflate;
+    return policy;
+  }
+}
+
+TEST(EventThrottle, DefaultPolicySendsEverything)
+{
+  EventThrottle throttle{EventDeliveryPolicy{}};
+  const auto now = SteadyClock::now();
+  for (int i = 0; i != 10; ++i)
+    EXPECT_EQ(Admission::Send, throttle.admit(now));
+}
+
+TEST(EventThrottle, DecimationSendsOneEventOutOfN)
+{
+  EventThrottle throttle{makePolicy(0., 3u, false)};
+  const auto now = SteadyClock::now();
+  std::vector<Admission> admissions;
+  for (int i = 0; i != 7; ++i)
+    admissions.push_back(throttle.admit(now));
+  EXPECT_EQ((std::vector<Admission>{Admission::Send, Admission::Drop, Admission::Drop,
+                                    Admission::Send, Admission::Drop, Admission::Drop,
+                                    Admission::Send}),
+            admissions);
+}
+
+TEST(EventThrottle, MaxRateDropsEarlyEvents)
+{
+  EventThrottle throttle{makePolicy(10., 1u, false)};
+  const auto start = SteadyClock::now();
+  EXPECT_EQ(Admission::Send, throttle.admit(start));
+  EXPECT_EQ(Admission::Drop, throttle.admit(start + MilliSeconds{50}));
+  EXPECT_EQ(start + MilliSeconds{100}, throttle.nextSendTime());
+  EXPECT_EQ(Admission::Send, throttle.admit(start + MilliSeconds{100}));
+  EXPECT_EQ(Admission::Drop, throttle.admit(start + MilliSeconds{150}));
+}
+
+TEST(EventThrottle, MaxRateDefersEarlyEventsWhenConflating)
+{
+  EventThrottle throttle{makePolicy(10., 1u, true)};
+  const auto start = SteadyClock::now();
+  EXPECT_EQ(Admission::Send, throttle.admit(start));
+  EXPECT_EQ(Admission::Defer, throttle.admit(start + MilliSeconds{20}));
+  EXPECT_EQ(Admission::Defer, throttle.admit(start + MilliSeconds{40}));
+
+  // The deferred event is sent when the interval has elapsed.
+  throttle.sent(start + MilliSeconds{100});
+  EXPECT_EQ(Admission::Defer, throttle.admit(start + MilliSeconds{120}));
+  EXPECT_EQ(start + MilliSeconds{200}, throttle.nextSendTime());
+}
@@ -51,3 +51,79 @@ TEST(TestMessage, CopiesAreDistinct)
   ASSERT_NE(buf.totalSize(), bb.totalSize());
 
 }
+
+TEST(TestMessage, DeadlineFollowsThePayload)
+{
+  using namespace qi;
+  Message msg(Message::Type_Call, MessageAddress{1, 2, 3, 105});
+  msg.setValue(AnyReference::from(42), Signature("i"));
+  EXPECT_FALSE(msg.deadline());
+
+  const auto deadline = SteadyClock::now() + Seconds(10);
+  msg.setDeadline(deadline);
+  EXPECT_TRUE(msg.flags() & Message::TypeFlag_Deadline);
+  EXPECT_EQ(msg.buffer().totalSize(), msg.header().size);
+
+  // The payload is still decoded as before.
+  EXPECT_EQ(42, msg.value("i", {}).to<int>());
+
+  const auto received = msg.deadline();
+  ASSERT_TRUE(received);
+  EXPECT_LE(deadline - Seconds(1), *received);
+  EXPECT_GE(deadline + Seconds(1), *received);
+}
+
+TEST(TestMessage, PassedDeadline)
+{
+  using namespace qi;
+  Message msg(Message::Type_Call, MessageAddress{1, 2, 3, 105});
+  msg.setDeadline(SteadyClock::now() - MilliSeconds(5));
+  const auto received = msg.deadline();
+  ASSERT_TRUE(received);
+  EXPECT_LE(*received, SteadyClock::now());
+}
+
+TEST(TestMessage, CallPriorityIsCarriedByTheFlags)
+{
+  using namespace qi;
+  Message msg(Message::Type_Call, MessageAddress{1, 2, 3, 105});
+  EXPECT_FALSE(msg.callPriority());
+
+  msg.setCallPriority(CallPriority::Low);
+  EXPECT_TRUE(msg.flags() & Message::TypeFlag_BulkPriority);
+  ASSERT_TRUE(msg.priority());
+  EXPECT_EQ(Message::Priority::Bulk, *msg.priority());
+  ASSERT_TRUE(msg.callPriority());
+  EXPECT_EQ(CallPriority::Low, *msg.callPriority());
+
+  // Only the flags are sent: the priority of the received message is unset.
+  Message received;
+  received.header() = msg.header();
+  EXPECT_FALSE(received.priority());
+  ASSERT_TRUE(received.callPriority());
+  EXPECT_EQ(CallPriority::Low, *received.callPriority());
+}
+
+TEST(TestMessage, StringArgumentsDecodedAsViews)
+{
+  using namespace qi;
+  const std::string big(4096, 'a');
+  Message msg(Message::Type_Call, MessageAddress{1, 2, 3, 105});
+  msg.setValue(AnyReference::from(std::make_pair(big, 42)), Signature("(si)"));
+
+  const AnyValue copied = msg.value("(si)", {});
+  EXPECT_EQ(typeOf<std::string>(), copied.asReference()[0].type());
+
+  const AnyValue viewed = msg.value("(si)", {}, Message::StringDecoding::View);
+  AnyReference arg = viewed.asReference()[0];
+  ASSERT_EQ(typeOf<StringView>(), arg.type());
+  const StringView& view = *arg.ptr<StringView>();
+  EXPECT_EQ(big, view);
+  EXPECT_EQ(big, arg.to<std::string>());
+  EXPECT_EQ(42, viewed.asReference()[1].to<int>());
+
+  // The characters are those of the payload.
+  const char* payload = static_cast<const char*>(msg.buffer().data());
+  EXPECT_LE(payload, view.data());
+  EXPECT_GE(payload + msg.buffer().size(), view.data() + view.size());
+}
@@ -0,0 +1,91 @@
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+#include <qi/os.hpp>
+#include <qi/session.hpp>
+#include <qi/type/dynamicobjectbuilder.hpp>
+#include <src/messaging/metaobjectdiskcache.hpp>
+
+using namespace qi;
+
+namespace
+{
+  MetaObject makeMetaObject(const std::string& description)
+  {
+    MetaObjectBuilder builder;
+    builder.setDescription(description);
+    builder.addMethod("i", "echo", "(i)");
+    builder.addSignal("changed", "(s)");
+    return builder.metaObject();
+  }
+
+  struct MetaObjectDiskCacheTest : testing::Test
+  {
+    MetaObjectDiskCacheTest()
+      : directory(os::mktmpdir("MetaObjectDiskCache"))
+      , cache(directory)
+    {
+    }
+
+    ~MetaObjectDiskCacheTest()
+    {
+      boost::system::error_code ec;
+      boost::filesystem::remove_all(directory, ec);
+    }
+
+    std::string directory;
+    MetaObjectDiskCache cache;
+  };
+}
+
+TEST_F(MetaObjectDiskCacheTest, LoadsWhatWasStored)
+{
+  const auto mo = makeMetaObject("stored");
+  cache.store("My.Service", mo);
+  const auto entry = cache.load("My.Service");
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(MetaObjectDiskCache::fingerprint(mo), entry->fingerprint);
+  EXPECT_EQ(mo.methodId("echo::(i)"), entry->metaObject.methodId("echo::(i)"));
+  EXPECT_EQ(mo.signalId("changed"), entry->metaObject.signalId("changed"));
+  EXPECT_EQ("stored", entry->metaObject.description());
+}
+
+TEST_F(MetaObjectDiskCacheTest, StoringReplacesTheMetaObject)
+{
+  cache.store("My.Service", makeMetaObject("first"));
+  const auto second = makeMetaObject("second");
+  cache.store("My.Service", second);
+  const auto entry = cache.load("My.Service");
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(MetaObjectDiskCache::fingerprint(second), entry->fingerprint);
+}
+
+TEST_F(MetaObjectDiskCacheTest, DoesNotLoadUnknownServices)
+{
+  cache.store("My.Service", makeMetaObject("stored"));
+  EXPECT_FALSE(cache.load("Other.Service"));
+}
+
+TEST_F(MetaObjectDiskCacheTest, DoesNotLoadTruncatedFiles)
+{
+  cache.store("My.Service", makeMetaObject("stored"));
+  for (const auto& file : boost::filesystem::directory_iterator(directory))
+    boost::filesystem::resize_file(file.path(), boost::filesystem::file_size(file.path()) / 2);
+  EXPECT_FALSE(cache.load("My.Service"));
+}
+
+TEST(MetaObjectFingerprint, SameOnBothEnds)
+{
+  auto server = makeSession();
+  server->listenStandalone(Url{"tcp://127.0.0.1:0"});
+  DynamicObjectBuilder ob;
+  ob.advertiseMethod("echo", [](int value) { return value; });
+  ob.advertiseSignal<int>("changed");
+  server->registerService("Echo", ob.object());
+
+  auto client = makeSession();
+  client->connect(server->endpoints().front());
+  AnyObject proxy = client->service("Echo").value();
+
+  EXPECT_EQ(MetaObjectDiskCache::fingerprint(proxy.metaObject()),
+            proxy.call<std::string>("metaObjectFingerprint", 0u));
+}
@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include <boost/optional/optional_io.hpp>
+#include <gtest/gtest.h>
+#include <src/messaging/pendingcalls.hpp>
+
+using namespace qi;
+
+TEST(PendingCalls, TakeReturnsTheValueOnce)
+{
+  PendingCalls<int> calls;
+  EXPECT_TRUE(calls.set(12u, 42));
+  EXPECT_EQ(1u, calls.size());
+  EXPECT_EQ(boost::make_optional(42), calls.take(12u));
+  EXPECT_FALSE(calls.take(12u));
+  EXPECT_EQ(0u, calls.size());
+}
+
+TEST(PendingCalls, SetReplacesExistingEntry)
+{
+  PendingCalls<int> calls;
+  EXPECT_TRUE(calls.set(3u, 1));
+  EXPECT_FALSE(calls.set(3u, 2));
+  EXPECT_EQ(1u, calls.size());
+  EXPECT_EQ(boost::make_optional(2), calls.take(3u));
+}
+
+TEST(PendingCalls, Erase)
+{
+  PendingCalls<int> calls;
+  calls.set(7u, 1);
+  EXPECT_TRUE(calls.erase(7u));
+  EXPECT_FALSE(calls.erase(7u));
+  EXPECT_FALSE(calls.take(7u));
+}
+
+TEST(PendingCalls, TakeAllEmptiesEveryShard)
+{
+  PendingCalls<int> calls;
+  const unsigned int count = 3u * PendingCalls<int>::shardCount;
+  for (unsigned int id = 0u; id != count; ++id)
+    calls.set(id, static_cast<int>(id) * 2);
+
+  auto entries = calls.takeAll();
+  EXPECT_EQ(0u, calls.size());
+  ASSERT_EQ(count, entries.size());
+  std::sort(entries.begin(), entries.end());
+  for (unsigned int id = 0u; id != count; ++id)
+  {
+    EXPECT_EQ(id, entries[id].first);
+    EXPECT_EQ(static_cast<int>(id) * 2, entries[id].second);
+  }
+}
+
+TEST(PendingCalls, ConcurrentSetAndTake)
+{
+  PendingCalls<unsigned int> calls;
+  const unsigned int threadCount = 8u;
+  const unsigned int countPerThread = 10000u;
+  std::vector<std::thread> threads;
+  std::vector<unsigned int> takenCounts(threadCount, 0u);
+  for (unsigned int t = 0u; t != threadCount; ++t)
+  {
+    threads.emplace_back([&, t] {
+      for (unsigned int i = 0u; i != countPerThread; ++i)
+      {
+        const unsigned int id = t * countPerThread + i;
+        calls.set(id, id);
+        if (calls.take(id) == id)
+          ++takenCounts[t];
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  for (auto taken : takenCounts)
+    EXPECT_EQ(countPerThread, taken);
+  EXPECT_EQ(0u, calls.size());
+}
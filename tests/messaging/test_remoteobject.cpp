@@ -1,9 +1,14 @@
+#include <atomic>
 #include <chrono>
 #include <future>
 #include <mutex>
+#include <thread>
 #include <gtest/gtest.h>
 #include <qi/jsoncodec.hpp>
 #include <qi/log.hpp>
+#include <qi/property.hpp>
+#include <qi/session.hpp>
+#include <qi/type/dynamicobjectbuilder.hpp>
 #include "../../src/messaging/remoteobject_p.hpp"
 #include "../../src/messaging/server.hpp"
 
@@ -131,3 +136,79 @@ TEST_F(RemoteObject, CallingAVoidMethodSendsACallMessage)
   EXPECT_EQ(methodId, message.address().functionId);
 }
 
+
+TEST(RemoteObjectPropertyCache, ReadsAreAnsweredLocallyAndKeptUpToDate)
+{
+  std::atomic<int> getCount{0};
+  qi::Property<int> prop(12, qi::Property<int>::Getter([&](boost::reference_wrapper<const int> value) {
+    ++getCount;
+    return value.get();
+  }));
+  qi::DynamicObjectBuilder builder;
+  builder.advertiseProperty("prop", &prop);
+
+  auto server = qi::makeSession();
+  server->listenStandalone(qi::Url{"tcp://127.0.0.1:0"});
+  server->registerService("Props", builder.object());
+  auto client = qi::makeSession();
+  client->connect(server->endpoints().front());
+  qi::AnyObject proxy = client->service("Props").value();
+  auto remoteObject =
+    dynamic_cast<qi::RemoteObject*>(static_cast<qi::DynamicObject*>(proxy.asGenericObject()->value));
+  ASSERT_TRUE(remoteObject);
+  remoteObject->setPropertyCacheEnabled(true);
+
+  // Only the first read reaches the remote object.
+  for (int i = 0; i != 5; ++i)
+    EXPECT_EQ(12, proxy.property<int>("prop").value());
+  EXPECT_EQ(1, getCount.load());
+
+  // Changes made on the remote end are received.
+  prop.set(13);
+  for (int i = 0; i != 200 && proxy.property<int>("prop").value() != 13; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  EXPECT_EQ(13, proxy.property<int>("prop").value());
+
+  // Writes are seen by the reads that follow them, which read the value once again.
+  proxy.setProperty("prop", 14).value();
+  EXPECT_EQ(14, proxy.property<int>("prop").value());
+  EXPECT_EQ(14, proxy.property<int>("prop").value());
+  EXPECT_EQ(2, getCount.load());
+
+  remoteObject->setPropertyCacheEnabled(false);
+  EXPECT_EQ(14, proxy.property<int>("prop").value());
+  EXPECT_EQ(3, getCount.load());
+
+  client->close();
+  server->close();
+}
+
+TEST(RemoteObjectPropertyCache, WritesCacheTheValueOfTheRemoteEnd)
+{
+  // The remote end stores another value than the one written.
+  qi::Property<int> prop(0, qi::Property<int>::Getter(),
+                         qi::Property<int>::Setter([](int& storage, const int& value) {
+                           storage = std::min(value, 10);
+                           return true;
+                         }));
+  qi::DynamicObjectBuilder builder;
+  builder.advertiseProperty("prop", &prop);
+
+  auto server = qi::makeSession();
+  server->listenStandalone(qi::Url{"tcp://127.0.0.1:0"});
+  server->registerService("Props", builder.object());
+  auto client = qi::makeSession();
+  client->connect(server->endpoints().front());
+  qi::AnyObject proxy = client->service("Props").value();
+  auto remoteObject =
+    dynamic_cast<qi::RemoteObject*>(static_cast<qi::DynamicObject*>(proxy.asGenericObject()->value));
+  ASSERT_TRUE(remoteObject);
+  remoteObject->setPropertyCacheEnabled(true);
+
+  EXPECT_EQ(0, proxy.property<int>("prop").value());
+  proxy.setProperty("prop", 14).value();
+  EXPECT_EQ(10, proxy.property<int>("prop").value());
+
+  client->close();
+  server->close();
+}
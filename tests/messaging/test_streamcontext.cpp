@@ -6,6 +6,7 @@
 #include <gtest/gtest.h>
 
 #include <src/messaging/streamcontext.hpp>
+#include <src/messaging/sharedmemorybuffer.hpp>
 
 TEST(TestStreamContext, sendCacheSetInsertTwice)
 {
@@ -38,3 +39,120 @@ TEST(TestStreamContext, sendCacheSetInsertTwoDifferent)
   EXPECT_TRUE(res2.second);
   EXPECT_NE(res1.first, res2.first);
 }
+
+TEST(TestStreamContext, sendCacheSetInsertPropertyOfSignal)
+{
+  qi::StreamContext ctx;
+  qi::MetaObjectBuilder b1;
+  b1.addSignal("value", "(i)");
+  qi::MetaObject mo1 = b1.metaObject();
+  qi::MetaObjectBuilder b2;
+  const auto id = b2.addSignal("value", "(i)").id;
+  b2.addProperty("value", "i", id);
+  qi::MetaObject mo2 = b2.metaObject();
+
+  std::pair<unsigned int, bool> res1 = ctx.sendCacheSet(mo1);
+  std::pair<unsigned int, bool> res2 = ctx.sendCacheSet(mo2);
+  EXPECT_TRUE(res2.second);
+  EXPECT_NE(res1.first, res2.first);
+}
+
+TEST(TestStreamContext, sendCacheSetTransmitsUntilConfirmed)
+{
+  qi::StreamContext ctx;
+  qi::MetaObjectBuilder b;
+  b.setDescription("my_mo");
+  qi::MetaObject mo = b.metaObject();
+
+  std::vector<std::string> segments;
+  std::vector<unsigned int> firstMessage;
+  std::pair<unsigned int, bool> res1;
+  {
+    qi::StreamContext::SendCacheRecorder recorder(&ctx, firstMessage, segments);
+    res1 = ctx.sendCacheSet(mo);
+  }
+  EXPECT_TRUE(res1.second);
+  EXPECT_EQ(std::vector<unsigned int>{ res1.first }, firstMessage);
+
+  // The first message may be written after this one.
+  std::vector<unsigned int> secondMessage;
+  std::pair<unsigned int, bool> res2;
+  {
+    qi::StreamContext::SendCacheRecorder recorder(&ctx, secondMessage, segments);
+    res2 = ctx.sendCacheSet(mo);
+  }
+  EXPECT_TRUE(res2.second);
+  EXPECT_EQ(res1.first, res2.first);
+  EXPECT_EQ(std::vector<unsigned int>{ res1.first }, secondMessage);
+
+  ctx.sendCacheConfirm(firstMessage);
+  std::vector<unsigned int> thirdMessage;
+  std::pair<unsigned int, bool> res3;
+  {
+    qi::StreamContext::SendCacheRecorder recorder(&ctx, thirdMessage, segments);
+    res3 = ctx.sendCacheSet(mo);
+  }
+  EXPECT_FALSE(res3.second);
+  EXPECT_EQ(res1.first, res3.first);
+  EXPECT_TRUE(thirdMessage.empty());
+}
+
+TEST(TestStreamContext, recordsExportedSharedMemorySegments)
+{
+  qi::StreamContext ctx;
+  std::vector<unsigned int> uids;
+  std::vector<std::string> segments;
+  {
+    qi::StreamContext::SendCacheRecorder recorder(&ctx, uids, segments);
+    ctx.sharedMemorySegmentExported("/qi.1.2.3");
+  }
+  ctx.sharedMemorySegmentExported("/qi.4.5.6");
+  EXPECT_EQ(std::vector<std::string>{ "/qi.1.2.3" }, segments);
+}
+
+namespace
+{
+  struct StreamContextWithRemote : qi::StreamContext
+  {
+    void setRemoteCapability(const std::string& key, const qi::AnyValue& value)
+    {
+      _remoteCapabilityMap[key] = value;
+    }
+  };
+}
+
+TEST(TestStreamContext, sharedMemoryBuffersNeedAcceptedProbes)
+{
+  const auto probe = qi::shm::probeSegmentName();
+  if (!probe)
+    return; // Shared memory segments are not supported.
+  namespace capabilityname = qi::capabilityname;
+
+  StreamContextWithRemote ctx;
+  ctx.setRemoteCapability(capabilityname::sharedMemoryBuffers, qi::AnyValue::from(*probe));
+  EXPECT_FALSE(qi::shm::canImport(ctx));
+  EXPECT_FALSE(qi::shm::isEnabled(ctx));
+
+  EXPECT_TRUE(probe == qi::shm::acceptRemoteProbe(ctx));
+  EXPECT_TRUE(qi::shm::canImport(ctx));
+  // Only accepted once.
+  EXPECT_FALSE(qi::shm::acceptRemoteProbe(ctx));
+  // The other end did not accept ours yet.
+  EXPECT_FALSE(qi::shm::isEnabled(ctx));
+
+  ctx.setRemoteCapability(capabilityname::sharedMemoryBuffersAccepted, qi::AnyValue::from(*probe));
+  EXPECT_TRUE(qi::shm::isEnabled(ctx));
+}
+
+TEST(TestStreamContext, sharedMemoryBuffersRejectUnreachableProbe)
+{
+  if (!qi::shm::probeSegmentName())
+    return; // Shared memory segments are not supported.
+
+  StreamContextWithRemote ctx;
+  // Same machine and user, but another /dev/shm.
+  ctx.setRemoteCapability(qi::capabilityname::sharedMemoryBuffers,
+                          qi::AnyValue::from(std::string("/qi.0.0.0")));
+  EXPECT_FALSE(qi::shm::acceptRemoteProbe(ctx));
+  EXPECT_FALSE(qi::shm::canImport(ctx));
+}
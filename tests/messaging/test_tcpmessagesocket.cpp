@@ -175,6 +175,12 @@ namespace {
     std::string operator()() const { return "tcps"; }
   };
 
+  struct SchemeUnix
+  {
+  // Function<std::string ()>:
+    std::string operator()() const { return "unix"; }
+  };
+
 
   template<class SchemeType>
   class NetMessageSocket : public ::testing::Test
@@ -229,6 +235,9 @@ namespace {
 
   using SchemeTypes = ::testing::Types< SchemeTcp
                                         , SchemeTcpSSL
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+                                        , SchemeUnix
+#endif
                                         >;
 
   TYPED_TEST_CASE(NetMessageSocket, SchemeTypes);
@@ -392,6 +401,75 @@ TYPED_TEST(NetMessageSocket, ReceiveOneMessageAsio)
   ASSERT_EQ(FutureState_FinishedWithValue, promiseReceivedMessage.future().wait(defaultTimeout));
 }
 
+TYPED_TEST(NetMessageSocket, StatsCountReceivedMessages)
+{
+  using namespace qi;
+  using namespace qi::sock;
+
+  TransportServer server;
+  const auto listenRes = this->listen(server);
+  auto& promiseServerSideSocket = listenRes.promiseConnectedSocket;
+
+  auto msgSent = makeMessage(MessageAddress{1234, 5, 9876, 107});
+  Promise<void> promiseReceivedMessage;
+  auto clientSideSocket = makeMessageSocket(this->scheme());
+  const auto _ = ka::scoped([=]{ clientSideSocket->disconnect().wait(defaultTimeout); });
+  clientSideSocket->messageReady.connect([&](const Message&) mutable {
+    promiseReceivedMessage.setValue(0);
+  });
+  ASSERT_EQ(FutureState_FinishedWithValue,
+            clientSideSocket->connect(listenRes.url).wait(defaultTimeout));
+  EXPECT_EQ(0u, clientSideSocket->stats().receivedMessageCount);
+
+  ASSERT_TRUE(promiseServerSideSocket.future().hasValue());
+  ASSERT_TRUE(promiseServerSideSocket.future().value()->ensureReading());
+  ASSERT_TRUE(promiseServerSideSocket.future().value()->send(msgSent));
+  ASSERT_EQ(FutureState_FinishedWithValue, promiseReceivedMessage.future().wait(defaultTimeout));
+
+  const auto stats = clientSideSocket->stats();
+  EXPECT_EQ(1u, stats.receivedMessageCount);
+  EXPECT_EQ(sizeof(Message::Header) + msgSent.buffer().totalSize(), stats.receivedByteCount);
+  EXPECT_EQ(0u, stats.sentMessageCount);
+}
+
+TYPED_TEST(NetMessageSocket, UringBackendExchangesMessages)
+{
+  using namespace qi;
+  using namespace qi::sock;
+
+  if (!setSocketBackend(SocketBackend::Uring))
+    return; // io_uring is not supported by this system.
+  const auto restoreBackend = ka::scoped([]{ setSocketBackend(SocketBackend::Asio); });
+
+  TransportServer server;
+  const auto listenRes = this->listen(server);
+  auto& promiseServerSideSocket = listenRes.promiseConnectedSocket;
+
+  auto msgSent = makeMessage(MessageAddress{1234, 5, 9876, 107});
+  Promise<Message> promiseReceivedMessage;
+  auto clientSideSocket = makeMessageSocket(this->scheme());
+  const auto _ = ka::scoped([=]{ clientSideSocket->disconnect().wait(defaultTimeout); });
+  clientSideSocket->messageReady.connect([&](const Message& msg) mutable {
+    promiseReceivedMessage.setValue(msg);
+  });
+  ASSERT_EQ(FutureState_FinishedWithValue,
+            clientSideSocket->connect(listenRes.url).wait(defaultTimeout));
+
+  ASSERT_TRUE(promiseServerSideSocket.future().hasValue());
+  auto serverSideSocket = promiseServerSideSocket.future().value();
+  MessageSocket* echo = serverSideSocket.get();
+  serverSideSocket->messageReady.connect([=](const Message& msg) {
+    echo->send(msg);
+  });
+  ASSERT_TRUE(serverSideSocket->ensureReading());
+  ASSERT_TRUE(clientSideSocket->send(msgSent));
+
+  auto futReceived = promiseReceivedMessage.future();
+  ASSERT_EQ(FutureState_FinishedWithValue, futReceived.wait(defaultTimeout));
+  EXPECT_EQ(msgSent.address(), futReceived.value().address());
+  EXPECT_EQ(msgSent.buffer().totalSize(), futReceived.value().buffer().totalSize());
+}
+
 TYPED_TEST(NetMessageSocketAsio, ReceiveManyMessages)
 {
   using namespace qi;
@@ -110,6 +110,71 @@ TEST_F(TestTransportSocketCache, FirstUrlWillFail)
   ASSERT_TRUE(sock->isConnected());
 }
 
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+TEST_F(TestTransportSocketCache, SameMachinePrefersLocalSocket)
+{
+  server_.listen("tcp://127.0.0.1:0").wait();
+  server_.listen("unix://localhost:0").wait();
+
+  const qi::UrlVector endpoints = server_.endpoints();
+  ASSERT_EQ(2u, endpoints.size());
+
+  qi::ServiceInfo servInfo;
+  servInfo.setMachineId(qi::os::getMachineId());
+  servInfo.setEndpoints(endpoints);
+  qi::MessageSocketPtr sock = cache_.socket(servInfo).value();
+
+  ASSERT_TRUE(sock->isConnected());
+  EXPECT_EQ("unix", sock->url().protocol());
+}
+
+TEST_F(TestTransportSocketCache, SameMachineFallsBackToLocalhostWhenLocalSocketFails)
+{
+  server_.listen("tcp://127.0.0.1:0").wait();
+
+  // Nothing listens on this local socket, as when the peers share a machine id
+  // but not a network namespace.
+  qi::UrlVector endpoints{ "unix://localhost:1" };
+  endpoints.push_back(server_.endpoints()[0]);
+
+  qi::ServiceInfo servInfo;
+  servInfo.setMachineId(qi::os::getMachineId());
+  servInfo.setEndpoints(endpoints);
+  qi::MessageSocketPtr sock = cache_.socket(servInfo).value();
+
+  ASSERT_TRUE(sock->isConnected());
+  EXPECT_EQ("tcp", sock->url().protocol());
+}
+
+TEST_F(TestTransportSocketCache, TcpListenOnFixedPortAlsoListensLocally)
+{
+  server_.listen("tcp://127.0.0.1:5557").wait();
+
+  const qi::UrlVector endpoints = server_.endpoints();
+  EXPECT_NE(endpoints.end(),
+            std::find(endpoints.begin(), endpoints.end(), qi::Url("unix://localhost:5557")));
+
+  qi::ServiceInfo servInfo;
+  servInfo.setMachineId(qi::os::getMachineId());
+  servInfo.setEndpoints(endpoints);
+  qi::MessageSocketPtr sock = cache_.socket(servInfo).value();
+
+  ASSERT_TRUE(sock->isConnected());
+  EXPECT_EQ("unix", sock->url().protocol());
+}
+
+TEST_F(TestTransportSocketCache, OtherMachineIgnoresLocalSocket)
+{
+  server_.listen("unix://localhost:0").wait();
+
+  qi::ServiceInfo servInfo;
+  servInfo.setMachineId("not this machine");
+  servInfo.setEndpoints(server_.endpoints());
+
+  EXPECT_TRUE(test::finishesWithError(cache_.socket(servInfo)));
+}
+#endif
+
 static const std::string fakeMachineId = "there is relatively low chances this \
     could end being the same machineID than the actual one of this \
     machine. Then again, one can't be too sure, and we should probably \
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2012 Aldebaran Robotics. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the COPYING file.
+ */
+
+/*
+ * Measures the encoding and decoding of values with the binary codec, as done
+ * for the payload of messages.
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <qi/perf/dataperfsuite.hpp>
+#include <qi/anyvalue.hpp>
+#include <qi/binarycodec.hpp>
+#include <qi/buffer.hpp>
+
+namespace po = boost::program_options;
+
+namespace
+{
+  struct Sample
+  {
+    std::int32_t id;
+    double timestamp;
+    std::string name;
+    std::vector<float> values;
+  };
+}
+
+QI_TYPE_STRUCT(Sample, id, timestamp, name, values)
+
+namespace
+{
+  /// Encodes a list of `size` numbers `count` times, then decodes it `count`
+  /// times.
+  template <typename T>
+  void encodeDecodeList(qi::DataPerfSuite& out, const std::string& name, unsigned size,
+                        unsigned count)
+  {
+    std::vector<T> values(size);
+    std::iota(values.begin(), values.end(), T{});
+    const auto byteCount = static_cast<unsigned long>(size * sizeof(T));
+
+    qi::Buffer buffer;
+    qi::DataPerf dp;
+    dp.start("EncodeList_" + name, count, byteCount, std::to_string(size));
+    for (unsigned i = 0u; i != count; ++i)
+    {
+      buffer.clear();
+      qi::encodeBinary(&buffer, qi::AnyReference::from(values));
+    }
+    dp.stop();
+    out << dp;
+
+    std::vector<T> decoded;
+    dp.start("DecodeList_" + name, count, byteCount, std::to_string(size));
+    for (unsigned i = 0u; i != count; ++i)
+    {
+      qi::BufferReader reader(buffer);
+      decoded.clear();
+      qi::decodeBinary(&reader, &decoded);
+    }
+    dp.stop();
+    out << dp;
+
+    if (decoded != values)
+      std::cerr << "Decoded list of " << name << " differs from the encoded one." << std::endl;
+  }
+
+  /// Encodes a list of `size` structures `count` times, then decodes it
+  /// `count` times.
+  void encodeDecodeStructList(qi::DataPerfSuite& out, unsigned size, unsigned count)
+  {
+    std::vector<Sample> values(size);
+    for (unsigned i = 0u; i != size; ++i)
+      values[i] = Sample{ static_cast<std::int32_t>(i), i * 0.5, "sample", { 1.f, 2.f, 3.f } };
+
+    qi::Buffer buffer;
+    qi::encodeBinary(&buffer, qi::AnyReference::from(values));
+    const auto byteCount = static_cast<unsigned long>(buffer.size());
+
+    qi::DataPerf dp;
+    dp.start("EncodeList_struct", count, byteCount, std::to_string(size));
+    for (unsigned i = 0u; i != count; ++i)
+    {
+      buffer.clear();
+      qi::encodeBinary(&buffer, qi::AnyReference::from(values));
+    }
+    dp.stop();
+    out << dp;
+
+    std::vector<Sample> decoded;
+    dp.start("DecodeList_struct", count, byteCount, std::to_string(size));
+    for (unsigned i = 0u; i != count; ++i)
+    {
+      qi::BufferReader reader(buffer);
+      decoded.clear();
+      qi::decodeBinary(&reader, &decoded);
+    }
+    dp.stop();
+    out << dp;
+
+    if (decoded.size() != values.size())
+      std::cerr << "Decoded list of structures differs from the encoded one." << std::endl;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  po::options_description desc;
+  desc.add_options()
+    ("help,h", "Print this help.")
+    ("count,c", po::value<unsigned>()->default_value(20u), "Number of encodings and decodings.")
+    ("size", po::value<unsigned>()->default_value(1000000u), "Number of elements of the lists.");
+
+  desc.add(qi::detail::getPerfOptions());
+
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    std::cout << desc << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  const auto count = vm["count"].as<unsigned>();
+  const auto size = vm["size"].as<unsigned>();
+  qi::DataPerfSuite out("qimessaging", "perf_binarycodec",
+                        qi::DataPerfSuite::OutputData_MsgMBPerSecond,
+                        vm["output"].as<std::string>());
+  encodeDecodeList<float>(out, "float", size, count);
+  encodeDecodeList<double>(out, "double", size, count);
+  encodeDecodeList<std::int32_t>(out, "int32", size, count);
+  encodeDecodeList<std::uint8_t>(out, "uint8", size, count);
+  encodeDecodeStructList(out, size / 10u, count);
+  out.close();
+
+  return EXIT_SUCCESS;
+}
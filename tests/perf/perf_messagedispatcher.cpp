@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2012 Aldebaran Robotics. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the COPYING file.
+ */
+
+/*
+ * Measures the routing of received messages to their handlers, when many
+ * network threads look up the message dispatcher at once while handlers are
+ * occasionally connected and disconnected.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <qi/perf/dataperfsuite.hpp>
+#include <qi/eventloop.hpp>
+#include "src/messaging/message.hpp"
+#include "src/messaging/messagedispatcher.hpp"
+
+namespace po = boost::program_options;
+
+namespace
+{
+  const unsigned int recipientCount = 64u;
+
+  /// Each of `threadCount` threads routes `count` messages, spread over the
+  /// recipients, and calls their handlers.
+  void route(qi::DataPerfSuite& out, unsigned threadCount, unsigned count)
+  {
+    qi::MessageDispatcher dispatcher{*qi::getEventLoop()};
+    for (unsigned int object = 0u; object != recipientCount; ++object)
+    {
+      dispatcher.messagePendingConnect(1u, object, [](const qi::Message&) {
+        return qi::DispatchStatus::MessageHandled;
+      });
+    }
+
+    // Connections and disconnections happen while messages are routed.
+    std::atomic<bool> routing{true};
+    std::thread writer([&] {
+      while (routing)
+      {
+        const auto link = dispatcher.messagePendingConnect(2u, 1u, [](const qi::Message&) {
+          return qi::DispatchStatus::MessageNotHandled;
+        });
+        dispatcher.messagePendingDisconnect(2u, 1u, link);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    });
+
+    const qi::Message msg;
+    std::atomic<unsigned> handledCount{0u};
+    qi::DataPerf dp;
+    dp.start("Route_" + std::to_string(threadCount) + "_threads", threadCount * count);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0u; t != threadCount; ++t)
+    {
+      threads.emplace_back([&, t] {
+        unsigned handled = 0u;
+        for (unsigned i = 0u; i != count; ++i)
+        {
+          const auto handlers = dispatcher.handlers({1u, (i + t) % recipientCount});
+          for (const auto& slot : *handlers)
+            handled += qi::isMessageHandled(slot.second(msg)) ? 1u : 0u;
+        }
+        handledCount += handled;
+      });
+    }
+    for (auto& thread : threads)
+      thread.join();
+    dp.stop();
+    out << dp;
+
+    routing = false;
+    writer.join();
+    if (handledCount != threadCount * count)
+      std::cerr << "Only " << handledCount << " messages out of " << threadCount * count
+                << " were handled." << std::endl;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  po::options_description desc;
+  desc.add_options()
+    ("help,h", "Print this help.")
+    ("count,c", po::value<unsigned>()->default_value(1000000u), "Number of messages per thread.")
+    ("threads", po::value<std::vector<unsigned>>()->multitoken()
+                  ->default_value(std::vector<unsigned>{1u, 2u, 4u, 8u, 16u}, "1 2 4 8 16"),
+     "Numbers of threads routing messages at once.");
+
+  desc.add(qi::detail::getPerfOptions());
+
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    std::cout << desc << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  const auto count = vm["count"].as<unsigned>();
+  qi::DataPerfSuite out("qimessaging", "perf_messagedispatcher",
+                        qi::DataPerfSuite::OutputData_MsgPerSecond,
+                        vm["output"].as<std::string>());
+  for (unsigned threadCount : vm["threads"].as<std::vector<unsigned>>())
+    route(out, threadCount, count);
+  out.close();
+
+  return EXIT_SUCCESS;
+}
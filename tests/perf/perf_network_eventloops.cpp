@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2012 Aldebaran Robotics. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the COPYING file.
+ */
+
+/*
+ * Measures how the throughput of a server scales with the number of network
+ * eventloops, when many clients ping-pong small messages with it concurrently.
+ *
+ * Run it with different values of `QI_NETWORK_EVENTLOOP_COUNT` (and possibly
+ * `QIMESSAGING_SOCKET_EVENTLOOP_POLICY`) to compare the configurations.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <qi/perf/dataperfsuite.hpp>
+#include <qi/eventloop.hpp>
+#include <qi/future.hpp>
+#include <qi/log.hpp>
+#include "src/messaging/message.hpp"
+#include "src/messaging/messagesocket.hpp"
+#include "src/messaging/transportserver.hpp"
+
+qiLogCategory("qi.perf.networkeventloops");
+
+namespace po = boost::program_options;
+
+namespace
+{
+  const qi::MilliSeconds connectTimeout{ 5000 };
+
+  qi::Message makeMessage(std::size_t size)
+  {
+    qi::Message msg{qi::Message::Type_Call, qi::MessageAddress{1, 1, 1, 1}};
+    qi::Buffer buf;
+    std::vector<char> data(size, 'x');
+    if (size)
+      buf.write(data.data(), data.size());
+    msg.setBuffer(buf);
+    return msg;
+  }
+
+  /// Connects `clientCount` clients to a server that echoes every message,
+  /// then lets each client send `count` messages, each one after the echo of
+  /// the previous one has been received.
+  void pingPong(qi::DataPerfSuite& out, const qi::Url& url, unsigned clientCount,
+                unsigned count, std::size_t msgSize)
+  {
+    qi::TransportServer server;
+    std::mutex serverSidesMutex;
+    std::vector<qi::MessageSocketPtr> serverSides;
+    server.newConnection.connect([&](const std::pair<qi::MessageSocketPtr, qi::Url>& p) {
+      qi::MessageSocket* serverSide = p.first.get();
+      serverSide->messageReady.connect([=](const qi::Message& msg) {
+        serverSide->send(msg);
+      });
+      serverSide->ensureReading();
+      std::lock_guard<std::mutex> lock(serverSidesMutex);
+      serverSides.push_back(p.first);
+    });
+    if (server.listen(url).wait(connectTimeout) != qi::FutureState_FinishedWithValue)
+    {
+      qiLogError() << "Cannot listen on " << url.str();
+      return;
+    }
+
+    std::vector<qi::MessageSocketPtr> clients;
+    for (unsigned i = 0; i < clientCount; ++i)
+    {
+      auto client = qi::makeMessageSocket(url.protocol());
+      if (!client
+          || client->connect(server.endpoints().front()).wait(connectTimeout)
+               != qi::FutureState_FinishedWithValue)
+      {
+        qiLogError() << "Cannot connect client " << i << " on " << url.str();
+        server.close();
+        return;
+      }
+      clients.push_back(client);
+    }
+
+    const auto msg = makeMessage(msgSize);
+    std::vector<qi::Future<void>> done;
+    for (const auto& client : clients)
+    {
+      qi::MessageSocket* clientSide = client.get();
+      qi::Promise<void> promise;
+      auto received = std::make_shared<std::atomic<unsigned>>(0u);
+      client->messageReady.connect([=](const qi::Message&) mutable {
+        if (++*received == count)
+          promise.setValue(nullptr);
+        else
+          clientSide->send(msg);
+      });
+      done.push_back(promise.future());
+    }
+
+    qi::DataPerf dp;
+    dp.start("PingPong_" + std::to_string(clientCount) + "_clients", clientCount * count,
+             static_cast<unsigned long>(msgSize));
+    for (const auto& client : clients)
+      client->send(msg);
+    for (auto& fut : done)
+      fut.wait();
+    dp.stop();
+    out << dp;
+
+    for (const auto& client : clients)
+      client->disconnect().wait(connectTimeout);
+    server.close();
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  po::options_description desc;
+  desc.add_options()
+    ("help,h", "Print this help.")
+    ("count,c", po::value<unsigned>()->default_value(1000u), "Number of messages per client.")
+    ("clients", po::value<std::vector<unsigned>>()->multitoken()
+                  ->default_value(std::vector<unsigned>{1u, 8u, 64u, 256u}, "1 8 64 256"),
+     "Numbers of concurrent clients to benchmark.")
+    ("size,s", po::value<std::size_t>()->default_value(256u), "Size of the messages.");
+
+  desc.add(qi::detail::getPerfOptions());
+
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    std::cout << desc << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  std::cout << "Network eventloops: " << qi::getNetworkEventLoops().size() << std::endl;
+
+  const auto count = vm["count"].as<unsigned>();
+  const auto size = vm["size"].as<std::size_t>();
+  qi::DataPerfSuite out("qimessaging", "perf_network_eventloops",
+                        qi::DataPerfSuite::OutputData_MsgPerSecond,
+                        vm["output"].as<std::string>());
+  for (unsigned clientCount : vm["clients"].as<std::vector<unsigned>>())
+    pingPong(out, qi::Url{"tcp://127.0.0.1:0"}, clientCount, count, size);
+  out.close();
+
+  return EXIT_SUCCESS;
+}
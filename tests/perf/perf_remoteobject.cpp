@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2012 Aldebaran Robotics. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the COPYING file.
+ */
+
+/*
+ * Measures the throughput of asynchronous calls issued concurrently by many
+ * threads on a single proxy, which all go through the table of pending calls
+ * of its remote object.
+ *
+ * Also measures the throughput of the same calls grouped in batches, each
+ * batch being sent in a single message, and of property reads, which are
+ * answered locally when the property cache of remote objects is enabled
+ * (--property-cache).
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <qi/perf/dataperfsuite.hpp>
+#include <qi/anyobject.hpp>
+#include <qi/os.hpp>
+#include <qi/property.hpp>
+#include <qi/session.hpp>
+#include <qi/type/dynamicobjectbuilder.hpp>
+
+namespace po = boost::program_options;
+
+namespace
+{
+  /// Each of `threadCount` threads issues `count` calls on the proxy, keeping
+  /// at most `inFlight` of them pending at once.
+  void call(qi::DataPerfSuite& out, qi::AnyObject proxy, unsigned threadCount,
+            unsigned count, unsigned inFlight)
+  {
+    std::atomic<unsigned> errorCount{0u};
+    qi::DataPerf dp;
+    dp.start("AsyncCall_" + std::to_string(threadCount) + "_threads", threadCount * count);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0u; t != threadCount; ++t)
+    {
+      threads.emplace_back([&] {
+        std::vector<qi::Future<int>> pending;
+        pending.reserve(inFlight);
+        for (unsigned i = 0u; i != count; ++i)
+        {
+          pending.push_back(proxy.async<int>("echo", static_cast<int>(i)));
+          if (pending.size() == inFlight || i + 1u == count)
+          {
+            for (auto& fut : pending)
+              if (fut.wait() != qi::FutureState_FinishedWithValue)
+                ++errorCount;
+            pending.clear();
+          }
+        }
+      });
+    }
+    for (auto& thread : threads)
+      thread.join();
+    dp.stop();
+    out << dp;
+
+    if (errorCount)
+      std::cerr << errorCount << " calls out of " << threadCount * count << " failed."
+                << std::endl;
+  }
+
+  /// Makes `count` calls on the proxy, in batches of `batchSize` calls, one
+  /// batch after the other.
+  void callBatched(qi::DataPerfSuite& out, qi::AnyObject proxy, unsigned count,
+                   unsigned batchSize)
+  {
+    unsigned errorCount = 0u;
+    qi::DataPerf dp;
+    dp.start("CallBatch_" + std::to_string(batchSize), count);
+    for (unsigned done = 0u; done < count; done += batchSize)
+    {
+      qi::CallBatch batch;
+      for (unsigned i = done; i != std::min(done + batchSize, count); ++i)
+        batch.add("echo", static_cast<int>(i));
+      if (proxy.callBatch(batch).wait() != qi::FutureState_FinishedWithValue)
+        ++errorCount;
+    }
+    dp.stop();
+    out << dp;
+
+    if (errorCount)
+      std::cerr << errorCount << " batches of " << batchSize << " calls failed." << std::endl;
+  }
+
+  /// Reads the property `count` times, one read after the other.
+  void getProperty(qi::DataPerfSuite& out, qi::AnyObject proxy, unsigned count)
+  {
+    unsigned errorCount = 0u;
+    qi::DataPerf dp;
+    dp.start("GetProperty", count);
+    for (unsigned i = 0u; i != count; ++i)
+    {
+      if (proxy.property<int>("value").wait() != qi::FutureState_FinishedWithValue)
+        ++errorCount;
+    }
+    dp.stop();
+    out << dp;
+
+    if (errorCount)
+      std::cerr << errorCount << " property reads out of " << count << " failed." << std::endl;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  po::options_description desc;
+  desc.add_options()
+    ("help,h", "Print this help.")
+    ("count,c", po::value<unsigned>()->default_value(20000u), "Number of calls per thread.")
+    ("inflight", po::value<unsigned>()->default_value(64u),
+     "Maximum number of pending calls per thread.")
+    ("threads", po::value<std::vector<unsigned>>()->multitoken()
+                  ->default_value(std::vector<unsigned>{1u, 2u, 4u, 8u, 16u}, "1 2 4 8 16"),
+     "Numbers of threads calling at once.")
+    ("batches", po::value<std::vector<unsigned>>()->multitoken()
+                  ->default_value(std::vector<unsigned>{1u, 8u, 64u}, "1 8 64"),
+     "Numbers of calls per batch.")
+    ("property-cache", "Answer the property reads from a local cache kept up to date by the change signal.");
+
+  desc.add(qi::detail::getPerfOptions());
+
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    std::cout << desc << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  if (vm.count("property-cache"))
+    qi::os::setenv("QIMESSAGING_REMOTE_PROPERTY_CACHE", "1");
+
+  auto server = qi::makeSession();
+  server->listenStandalone(qi::Url{"tcp://127.0.0.1:0"});
+  qi::DynamicObjectBuilder ob;
+  ob.advertiseMethod("echo", [](int value) { return value; });
+  qi::Property<int> value{42};
+  ob.advertiseProperty("value", &value);
+  server->registerService("Echo", ob.object());
+
+  auto client = qi::makeSession();
+  client->connect(server->endpoints().front());
+  qi::AnyObject proxy = client->service("Echo").value();
+
+  const auto count = vm["count"].as<unsigned>();
+  const auto inFlight = std::max(vm["inflight"].as<unsigned>(), 1u);
+  qi::DataPerfSuite out("qimessaging", "perf_remoteobject",
+                        qi::DataPerfSuite::OutputData_MsgPerSecond,
+                        vm["output"].as<std::string>());
+  for (unsigned threadCount : vm["threads"].as<std::vector<unsigned>>())
+    call(out, proxy, threadCount, count, inFlight);
+  for (unsigned batchSize : vm["batches"].as<std::vector<unsigned>>())
+    callBatched(out, proxy, count, std::max(batchSize, 1u));
+  getProperty(out, proxy, count);
+  out.close();
+
+  client->close();
+  server->close();
+  return EXIT_SUCCESS;
+}
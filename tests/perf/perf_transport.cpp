@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2012 Aldebaran Robotics. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the COPYING file.
+ */
+
+/*
+ * Compares the latency and the throughput of the message socket transports
+ * available between two processes of the same machine: loopback TCP and
+ * local (AF_UNIX) sockets.
+ *
+ * Latency is measured by ping-pong of small messages, throughput by a one way
+ * stream of big messages.
+ *
+ * Where the system supports it, TCP is measured a second time with the
+ * io_uring socket backend, to compare it with the asio (epoll) one.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <qi/perf/dataperfsuite.hpp>
+#include <qi/future.hpp>
+#include <qi/log.hpp>
+#include "src/messaging/message.hpp"
+#include "src/messaging/messagesocket.hpp"
+#include "src/messaging/transportserver.hpp"
+#include "src/messaging/sock/uring.hpp"
+
+qiLogCategory("qi.perf.transport");
+
+namespace po = boost::program_options;
+
+namespace
+{
+  const qi::MilliSeconds connectTimeout{ 5000 };
+
+  struct Connection
+  {
+    qi::TransportServer server;
+    qi::MessageSocketPtr serverSide;
+    qi::MessageSocketPtr clientSide;
+
+    ~Connection()
+    {
+      if (clientSide)
+        clientSide->disconnect().wait(connectTimeout);
+      server.close();
+    }
+  };
+
+  /// Listens on the URL, connects a client to it and sets both sides of the
+  /// connection. The server side socket does not read yet.
+  bool connect(Connection& c, const qi::Url& listenUrl)
+  {
+    qi::Promise<qi::MessageSocketPtr> accepted;
+    c.server.newConnection.connect([=](const std::pair<qi::MessageSocketPtr, qi::Url>& p) mutable {
+      accepted.setValue(p.first);
+    });
+    if (c.server.listen(listenUrl).wait(connectTimeout) != qi::FutureState_FinishedWithValue)
+      return false;
+    c.clientSide = qi::makeMessageSocket(listenUrl.protocol());
+    if (!c.clientSide
+        || c.clientSide->connect(c.server.endpoints().front()).wait(connectTimeout)
+             != qi::FutureState_FinishedWithValue)
+      return false;
+    auto fut = accepted.future();
+    if (fut.wait(connectTimeout) != qi::FutureState_FinishedWithValue)
+      return false;
+    c.serverSide = fut.value();
+    return true;
+  }
+
+  qi::Message makeMessage(std::size_t size)
+  {
+    qi::Message msg{qi::Message::Type_Call, qi::MessageAddress{1, 1, 1, 1}};
+    qi::Buffer buf;
+    std::vector<char> data(size, 'x');
+    if (size)
+      buf.write(data.data(), data.size());
+    msg.setBuffer(buf);
+    return msg;
+  }
+
+  /// Sends `count` messages from the client, each one after the echo of the
+  /// previous one has been received.
+  void pingPong(qi::DataPerfSuite& out, const std::string& name, const qi::Url& url,
+                unsigned count, std::size_t msgSize)
+  {
+    Connection c;
+    if (!connect(c, url))
+    {
+      qiLogError() << "Cannot connect on " << url.str();
+      return;
+    }
+    qi::MessageSocket* serverSide = c.serverSide.get();
+    c.serverSide->messageReady.connect([=](const qi::Message& msg) {
+      serverSide->send(msg);
+    });
+    c.serverSide->ensureReading();
+
+    const auto msg = makeMessage(msgSize);
+    qi::MessageSocket* clientSide = c.clientSide.get();
+    qi::Promise<void> done;
+    auto received = std::make_shared<std::atomic<unsigned>>(0u);
+    c.clientSide->messageReady.connect([=](const qi::Message&) mutable {
+      if (++*received == count)
+        done.setValue(nullptr);
+      else
+        clientSide->send(msg);
+    });
+
+    qi::DataPerf dp;
+    dp.start(name, count, static_cast<unsigned long>(msgSize));
+    c.clientSide->send(msg);
+    done.future().wait();
+    dp.stop();
+    out << dp;
+  }
+
+  /// Sends `count` messages from the client as fast as possible and waits for
+  /// the server to receive all of them.
+  void stream(qi::DataPerfSuite& out, const std::string& name, const qi::Url& url,
+              unsigned count, std::size_t msgSize)
+  {
+    Connection c;
+    if (!connect(c, url))
+    {
+      qiLogError() << "Cannot connect on " << url.str();
+      return;
+    }
+    qi::Promise<void> done;
+    auto received = std::make_shared<std::atomic<unsigned>>(0u);
+    c.serverSide->messageReady.connect([=](const qi::Message&) mutable {
+      if (++*received == count)
+        done.setValue(nullptr);
+    });
+    c.serverSide->ensureReading();
+
+    const auto msg = makeMessage(msgSize);
+    qi::DataPerf dp;
+    dp.start(name, count, static_cast<unsigned long>(msgSize));
+    for (unsigned i = 0; i < count; ++i)
+      c.clientSide->send(msg);
+    done.future().wait();
+    dp.stop();
+    out << dp;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  po::options_description desc;
+  desc.add_options()
+    ("help,h", "Print this help.")
+    ("count,c", po::value<unsigned>()->default_value(10000u), "Number of messages per benchmark.");
+
+  desc.add(qi::detail::getPerfOptions());
+
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    std::cout << desc << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  const auto count = vm["count"].as<unsigned>();
+  const std::vector<std::string> schemes{
+    "tcp",
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    "unix",
+#endif
+  };
+
+  qi::DataPerfSuite out("qimessaging", "perf_transport", qi::DataPerfSuite::OutputData_Period,
+                        vm["output"].as<std::string>());
+  const auto run = [&](const std::string& scheme, const std::string& suffix) {
+    const qi::Url url{scheme == "tcp" ? "tcp://127.0.0.1:0" : scheme + "://localhost:0"};
+    for (std::size_t size : {0u, 256u, 4096u})
+      pingPong(out, "PingPong_" + scheme + suffix, url, count, size);
+    for (std::size_t size : {4096u, 65536u, 1048576u})
+      stream(out, "Stream_" + scheme + suffix, url, count / 10u, size);
+  };
+  for (const auto& scheme : schemes)
+    run(scheme, "");
+
+  using qi::sock::SocketBackend;
+  const auto backend = qi::sock::socketBackend();
+  if (qi::sock::setSocketBackend(backend == SocketBackend::Uring ? SocketBackend::Asio
+                                                                 : SocketBackend::Uring))
+  {
+    run("tcp", qi::sock::socketBackend() == SocketBackend::Uring ? "_uring" : "_asio");
+    qi::sock::setSocketBackend(backend);
+  }
+  else
+  {
+    qiLogInfo() << "io_uring is not supported by the system, skipping its benchmarks.";
+  }
+  out.close();
+
+  return EXIT_SUCCESS;
+}
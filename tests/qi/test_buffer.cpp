@@ -178,3 +178,160 @@ TEST(TestBuffer, TestAssignmentsAreDistinct)
   *asIntPtr(b0.data()) = 1234;
   ASSERT_EQ(993, *asIntPtr(b1.data()));
 }
+
+namespace
+{
+  qi::Buffer makeBuffer(std::size_t size, unsigned char start)
+  {
+    std::vector<unsigned char> v(size);
+    std::iota(begin(v), end(v), start);
+    qi::Buffer b;
+    b.write(v.data(), v.size());
+    return b;
+  }
+
+  const void* constData(const qi::Buffer& b)
+  {
+    return b.data();
+  }
+}
+
+TEST(TestBuffer, CopiesShareDataUntilWrite)
+{
+  using namespace qi;
+  const Buffer b0 = makeBuffer(4096, 0);
+  Buffer b1(b0);
+  EXPECT_EQ(constData(b0), constData(b1));
+  Buffer b2;
+  b2 = b1;
+  EXPECT_EQ(constData(b0), constData(b2));
+
+  const unsigned char c = 42;
+  b1.write(&c, 1);
+  EXPECT_NE(constData(b0), constData(b1));
+  EXPECT_EQ(constData(b0), constData(b2));
+  EXPECT_EQ(4096u, b0.size());
+  EXPECT_EQ(4097u, b1.size());
+  EXPECT_EQ(42, static_cast<const unsigned char*>(constData(b1))[4096]);
+}
+
+// The heap storage of the detached copy is only as big as the data it holds.
+TEST(TestBuffer, WriteAfterShareGrowsDetachedCopy)
+{
+  using namespace qi;
+  Buffer a;
+  const std::vector<unsigned char> head(2000, 1);
+  a.write(head.data(), head.size());
+  Buffer b = a;
+  const std::vector<unsigned char> tail(3000, 2);
+  ASSERT_TRUE(b.write(tail.data(), tail.size()));
+  ASSERT_EQ(5000u, b.size());
+  EXPECT_EQ(2000u, a.size());
+  const auto data = static_cast<const unsigned char*>(constData(b));
+  EXPECT_TRUE(std::equal(head.begin(), head.end(), data));
+  EXPECT_TRUE(std::equal(tail.begin(), tail.end(), data + head.size()));
+
+  Buffer c;
+  c = a;
+  Buffer d;
+  d = c;
+  ASSERT_TRUE(d.write(tail.data(), tail.size()));
+  EXPECT_TRUE(std::equal(tail.begin(), tail.end(),
+                         static_cast<const unsigned char*>(constData(d)) + head.size()));
+}
+
+TEST(TestBuffer, DataDetachesSharedCopy)
+{
+  using namespace qi;
+  Buffer b0 = makeBuffer(4096, 3);
+  const Buffer b1(b0);
+  *static_cast<unsigned char*>(b0.data()) = 42;
+  EXPECT_EQ(3, *static_cast<const unsigned char*>(b1.data()));
+  EXPECT_EQ(42, *static_cast<const unsigned char*>(constData(b0)));
+}
+
+TEST(TestBuffer, ExposedDataIsNotShared)
+{
+  using namespace qi;
+  Buffer b0 = makeBuffer(4096, 3);
+  auto data = static_cast<unsigned char*>(b0.data());
+  const Buffer b1(b0);
+  EXPECT_NE(constData(b0), constData(b1));
+  *data = 42;
+  EXPECT_EQ(3, *static_cast<const unsigned char*>(b1.data()));
+}
+
+TEST(TestBuffer, ClearDoesNotAffectCopies)
+{
+  using namespace qi;
+  Buffer b0 = makeBuffer(100, 0);
+  b0.addSubBuffer(makeBuffer(10, 0));
+  const Buffer b1(b0);
+  b0.clear();
+  EXPECT_EQ(0u, b0.totalSize());
+  EXPECT_EQ(100u + sizeof(Buffer::size_type), b1.size());
+  EXPECT_EQ(1u, b1.subBuffers().size());
+}
+
+TEST(TestBuffer, SliceSharesData)
+{
+  using namespace qi;
+  const Buffer b = makeBuffer(4096, 0);
+  const Buffer s = b.slice(1000, 2000);
+  ASSERT_EQ(2000u, s.size());
+  EXPECT_EQ(static_cast<const unsigned char*>(constData(b)) + 1000, constData(s));
+  EXPECT_EQ(makeBuffer(2000, static_cast<unsigned char>(1000)), s);
+}
+
+TEST(TestBuffer, SliceWriteDoesNotAffectParent)
+{
+  using namespace qi;
+  Buffer b = makeBuffer(4096, 0);
+  Buffer s = b.slice(1000, 2000);
+  *static_cast<unsigned char*>(s.data()) = 1;
+  const unsigned char c = 2;
+  s.write(&c, 1);
+  EXPECT_EQ(makeBuffer(4096, 0), b);
+  EXPECT_EQ(2001u, s.size());
+  EXPECT_EQ(1, static_cast<const unsigned char*>(constData(s))[0]);
+
+  // And the other way around.
+  Buffer s2 = b.slice(0, 1000);
+  *static_cast<unsigned char*>(b.data()) = 1;
+  EXPECT_EQ(0, static_cast<const unsigned char*>(constData(s2))[0]);
+}
+
+TEST(TestBuffer, SliceOutlivesParent)
+{
+  using namespace qi;
+  Buffer s;
+  {
+    const Buffer b = makeBuffer(4096, 0);
+    s = b.slice(2048, 2048);
+  }
+  EXPECT_EQ(makeBuffer(2048, 0), s);
+}
+
+TEST(TestBuffer, SliceKeepsSubBuffersInRange)
+{
+  using namespace qi;
+  Buffer b = makeBuffer(10, 0);
+  const auto offset0 = b.addSubBuffer(makeBuffer(5, 0));
+  b.write("abc", 3);
+  const auto offset1 = b.addSubBuffer(makeBuffer(7, 0));
+
+  const Buffer s = b.slice(offset0, offset1 - offset0 + 2);
+  ASSERT_EQ(1u, s.subBuffers().size());
+  EXPECT_TRUE(s.hasSubBuffer(0));
+  EXPECT_EQ(makeBuffer(5, 0), s.subBuffer(0));
+  EXPECT_EQ(s.size() + 5u, s.totalSize());
+}
+
+TEST(TestBuffer, SliceOutOfRangeThrows)
+{
+  using namespace qi;
+  const Buffer b = makeBuffer(100, 0);
+  EXPECT_THROW(b.slice(101, 0), std::out_of_range);
+  EXPECT_THROW(b.slice(50, 51), std::out_of_range);
+  EXPECT_NO_THROW(b.slice(100, 0));
+}
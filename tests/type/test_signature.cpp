@@ -66,6 +66,25 @@ TEST(TestSignature, Equal)
   EXPECT_TRUE(qi::Signature("(mm)") != "(m)");
 }
 
+TEST(TestSignature, SameStringsShareParsedSignature)
+{
+  const std::string str = "({is}[m])";
+  const qi::Signature a(str);
+  const qi::Signature b(str.c_str());
+  EXPECT_EQ(&a.children(), &b.children());
+  EXPECT_EQ(&a.children()[0].children(), &qi::Signature("{is}").children());
+
+  const qi::Signature annotated("({is}[m])<Foo,bar,baz>");
+  EXPECT_NE(&a.children(), &annotated.children());
+  EXPECT_EQ(a, annotated);
+  EXPECT_NE(a, qi::Signature("({is}[s])"));
+
+  const float score = a.isConvertibleTo("({is}m)");
+  EXPECT_GT(score, 0.f);
+  EXPECT_EQ(score, b.isConvertibleTo("({is}m)"));
+  EXPECT_EQ(a.toPrettySignature(), b.toPrettySignature());
+}
+
 TEST(TestSignature, InvalidSignature)
 {
   //empty signature are invalid